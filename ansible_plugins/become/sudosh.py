@@ -126,6 +126,20 @@ DOCUMENTATION = """
               - name: ansible_sudosh_detection_verbose
             env:
               - name: ANSIBLE_SUDOSH_DETECTION_VERBOSE
+        sudosh_pipelining:
+            description:
+                - Hand pipelined modules to C(sudosh --ansible-pipeline) so the module
+                  source is streamed over stdin instead of copied to a temp file.
+                - Only used when no become password is set, since stdin carries the module.
+            type: bool
+            default: True
+            ini:
+              - section: sudosh_become_plugin
+                key: pipelining
+            vars:
+              - name: ansible_sudosh_pipelining
+            env:
+              - name: ANSIBLE_SUDOSH_PIPELINING
 """
 
 import re
@@ -182,6 +196,14 @@ class BecomeModule(BecomeBase):
 
     name = 'sudosh'
 
+    # sudosh accepts module source on stdin via --ansible-pipeline
+    pipelining = True
+
+    # interpreter invocation Ansible uses for pipelined modules, optionally
+    # preceded by environment assignments and followed by '&& sleep 0'
+    PIPELINED_CMD_RE = re.compile(
+        r'^((?:[A-Za-z_][A-Za-z0-9_]*=\S+\s+)*)(\S*python[0-9.]*)(?:\s+&&\s+sleep\s+0)?\s*$')
+
     # messages for detecting prompted password issues
     fail = ('Sorry, try again.', 'sudosh: authentication failed')
     missing = ('Sorry, a password is required to run sudosh', 'sudosh: password required')
@@ -283,6 +305,14 @@ class BecomeModule(BecomeBase):
         else:
             user_flag = ''
 
+        # Pipelined module: let sudosh validate the interpreter and read the
+        # module from stdin instead of wrapping it in a shell command
+        pipelined = None
+        if self.get_option('sudosh_pipelining') and not self.get_option('become_pass'):
+            pipelined = self.PIPELINED_CMD_RE.match(cmd.strip())
+        if pipelined:
+            ansible_env_vars.extend(pipelined.group(1).split())
+
         # Build the final command
         env_prefix = ' '.join(ansible_env_vars)
         flags_str = ' '.join(all_flags) if all_flags else ''
@@ -297,7 +327,11 @@ class BecomeModule(BecomeBase):
             cmd_parts.append(flags_str)
         if user_flag:
             cmd_parts.append(user_flag)
-        cmd_parts.append(self._build_success_command(cmd, shell))
+        if pipelined:
+            cmd_parts.extend(['--become-success', self.success,
+                              '--ansible-pipeline', shlex.quote(pipelined.group(2))])
+        else:
+            cmd_parts.append(self._build_success_command(cmd, shell))
         
         return ' '.join(cmd_parts)
 
@@ -0,0 +1,461 @@
+/**
+ * alloc_stats.c - Heap Allocation Accounting
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * Built with ALLOC_STATS=1 (-DSUDOSH_ALLOC_STATS), sudosh_common.h routes
+ * malloc, calloc, realloc, strdup, strndup, free and the safe_* helpers
+ * here.  Each call site (file:line) gets a count of calls and bytes
+ * requested, and the live block table gives live and peak heap bytes.
+ * The unit tests hold workloads to allocation budgets with these numbers;
+ * SUDOSH_ALLOC_REPORT=<file> (or "-" for stderr) writes the per-site
+ * report when the process exits.
+ *
+ * Only memory allocated through the wrappers is counted: buffers libc
+ * allocates itself (getline, getcwd(NULL, 0), scandir, ...) are not, and
+ * freeing one is recorded as an untracked free.
+ *
+ * In a normal build this file only provides the query functions, which
+ * report that accounting is off.
+ */
+
+#include "sudosh.h"
+
+#ifdef SUDOSH_ALLOC_STATS
+
+#include <pthread.h>
+
+/* The wrappers themselves call the real allocator */
+#undef malloc
+#undef calloc
+#undef realloc
+#undef strdup
+#undef strndup
+#undef free
+
+#define ALLOC_SITES 4096                /* Call sites tracked; the rest share the last slot */
+#define ALLOC_TOMBSTONE ((void *)1)
+
+/* One allocating call site */
+struct alloc_site {
+    const char *file;
+    int line;
+    unsigned long long calls;
+    unsigned long long bytes;
+    unsigned long long live_blocks;
+    unsigned long long live_bytes;
+};
+
+/* A live block: its size and the site that allocated it */
+struct alloc_block {
+    void *ptr;
+    size_t size;
+    uint32_t site;
+};
+
+static pthread_mutex_t alloc_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t alloc_report_once = PTHREAD_ONCE_INIT;
+static struct alloc_site sites[ALLOC_SITES];
+static struct alloc_block *blocks = NULL;
+static size_t block_capacity = 0;
+static size_t block_used = 0;           /* Live entries and tombstones */
+static struct alloc_totals totals;
+
+/**
+ * Slot for a call site, keyed by the __FILE__ pointer and line
+ */
+static uint32_t site_index(const char *file, int line) {
+    uint32_t h = (uint32_t)(((uintptr_t)file >> 3) * 2654435761u) ^ (uint32_t)line * 40503u;
+
+    for (uint32_t probe = 0; probe < ALLOC_SITES - 1; probe++) {
+        uint32_t i = (h + probe) % (ALLOC_SITES - 1);
+        if (!sites[i].file) {
+            sites[i].file = file;
+            sites[i].line = line;
+            return i;
+        }
+        if (sites[i].file == file && sites[i].line == line) {
+            return i;
+        }
+    }
+    sites[ALLOC_SITES - 1].file = "(other sites)";
+    return ALLOC_SITES - 1;
+}
+
+/**
+ * Home slot of a pointer in the live block table
+ */
+static size_t block_hash(const void *ptr) {
+    return (size_t)((((uintptr_t)ptr >> 4) * 0x9E3779B97F4A7C15ULL) >> 17) & (block_capacity - 1);
+}
+
+/**
+ * Live table entry for a pointer, or NULL
+ */
+static struct alloc_block *find_block(const void *ptr) {
+    if (!blocks) {
+        return NULL;
+    }
+    for (size_t i = block_hash(ptr); ; i = (i + 1) & (block_capacity - 1)) {
+        if (blocks[i].ptr == ptr) {
+            return &blocks[i];
+        }
+        if (!blocks[i].ptr) {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * Rebuild the live table with room to grow, dropping tombstones
+ */
+static int grow_blocks(void) {
+    size_t capacity = block_capacity ? block_capacity * 2 : 1024;
+    struct alloc_block *old = blocks;
+    size_t old_capacity = block_capacity;
+
+    /* Tombstones alone filled it: rehash at the same size */
+    if (totals.live_blocks * 4 < block_capacity) {
+        capacity = block_capacity;
+    }
+    struct alloc_block *table = calloc(capacity, sizeof(*table));
+    if (!table) {
+        return -1;
+    }
+    blocks = table;
+    block_capacity = capacity;
+    block_used = 0;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].ptr && old[i].ptr != ALLOC_TOMBSTONE) {
+            size_t j = block_hash(old[i].ptr);
+            while (blocks[j].ptr) {
+                j = (j + 1) & (block_capacity - 1);
+            }
+            blocks[j] = old[i];
+            block_used++;
+        }
+    }
+    free(old);
+    return 0;
+}
+
+/**
+ * Account a block leaving the heap
+ */
+static void forget_block(struct alloc_block *b) {
+    struct alloc_site *s = &sites[b->site];
+
+    s->live_blocks--;
+    s->live_bytes -= b->size;
+    totals.live_blocks--;
+    totals.live_bytes -= b->size;
+    b->ptr = ALLOC_TOMBSTONE;
+}
+
+/**
+ * Write the report at exit if SUDOSH_ALLOC_REPORT names a destination
+ */
+static void report_at_exit(void) {
+    const char *dest = getenv("SUDOSH_ALLOC_REPORT");
+    FILE *out;
+
+    if (!dest || !*dest) {
+        return;
+    }
+    out = strcmp(dest, "-") == 0 ? stderr : fopen(dest, "a");
+    if (!out) {
+        return;
+    }
+    alloc_stats_report(out, 50);
+    if (out != stderr) {
+        fclose(out);
+    }
+}
+
+/**
+ * Arrange for the exit report (once per process)
+ */
+static void register_report(void) {
+    if (getenv("SUDOSH_ALLOC_REPORT")) {
+        atexit(report_at_exit);
+    }
+}
+
+/**
+ * Account a block from a call site (fresh: a new allocation, not a realloc)
+ */
+static void record_block(void *ptr, size_t size, const char *file, int line, int fresh) {
+    pthread_once(&alloc_report_once, register_report);
+    pthread_mutex_lock(&alloc_lock);
+
+    if (fresh) {
+        totals.allocations++;
+    } else {
+        totals.reallocs++;
+    }
+    uint32_t site = site_index(file, line);
+    sites[site].calls++;
+    sites[site].bytes += size;
+    totals.bytes += size;
+
+    /* A stale entry at this address was freed behind our back (by libc) */
+    struct alloc_block *b = find_block(ptr);
+    if (b) {
+        forget_block(b);
+    }
+
+    if ((block_used + 1) * 2 > block_capacity && grow_blocks() != 0) {
+        pthread_mutex_unlock(&alloc_lock);
+        return;
+    }
+    size_t i = block_hash(ptr);
+    while (blocks[i].ptr && blocks[i].ptr != ALLOC_TOMBSTONE) {
+        i = (i + 1) & (block_capacity - 1);
+    }
+    if (!blocks[i].ptr) {
+        block_used++;
+    }
+    blocks[i].ptr = ptr;
+    blocks[i].size = size;
+    blocks[i].site = site;
+
+    sites[site].live_blocks++;
+    sites[site].live_bytes += size;
+    totals.live_blocks++;
+    totals.live_bytes += size;
+    if (totals.live_bytes > totals.peak_bytes) {
+        totals.peak_bytes = totals.live_bytes;
+    }
+    pthread_mutex_unlock(&alloc_lock);
+}
+
+/**
+ * Account a block being released
+ */
+static void release_block(void *ptr) {
+    pthread_mutex_lock(&alloc_lock);
+    struct alloc_block *b = find_block(ptr);
+    if (b) {
+        forget_block(b);
+        totals.frees++;
+    } else {
+        totals.untracked_frees++;
+    }
+    pthread_mutex_unlock(&alloc_lock);
+}
+
+/**
+ * malloc() charged to a call site
+ */
+void *sudosh_alloc_malloc(size_t size, const char *file, int line) {
+    void *ptr = malloc(size);
+    if (ptr) {
+        record_block(ptr, size, file, line, 1);
+    }
+    return ptr;
+}
+
+/**
+ * calloc() charged to a call site
+ */
+void *sudosh_alloc_calloc(size_t count, size_t size, const char *file, int line) {
+    void *ptr = calloc(count, size);
+    if (ptr) {
+        record_block(ptr, count * size, file, line, 1);
+    }
+    return ptr;
+}
+
+/**
+ * sudosh_safe_malloc(): zeroed, and NULL for a zero size
+ */
+void *sudosh_alloc_zalloc(size_t size, const char *file, int line) {
+    if (size == 0) {
+        return NULL;
+    }
+    void *ptr = sudosh_alloc_calloc(1, size, file, line);
+    if (!ptr) {
+        syslog(LOG_ERR, "sudosh: Memory allocation failed in sudosh_safe_malloc");
+    }
+    return ptr;
+}
+
+/**
+ * realloc() charged to a call site; a zero size frees
+ */
+void *sudosh_alloc_realloc(void *ptr, size_t size, const char *file, int line) {
+    if (size == 0) {
+        sudosh_alloc_free(ptr);
+        return NULL;
+    }
+    if (!ptr) {
+        return sudosh_alloc_malloc(size, file, line);
+    }
+
+    /* Look the old block up first: once realloc() returns it may be gone */
+    pthread_mutex_lock(&alloc_lock);
+    struct alloc_block *b = find_block(ptr);
+    void *moved = realloc(ptr, size);
+    if (!moved) {
+        pthread_mutex_unlock(&alloc_lock);
+        return NULL;
+    }
+    if (b) {
+        forget_block(b);
+    }
+    pthread_mutex_unlock(&alloc_lock);
+    record_block(moved, size, file, line, 0);
+    return moved;
+}
+
+/**
+ * strdup() charged to a call site; NULL in, NULL out like safe_strdup()
+ */
+char *sudosh_alloc_strdup(const char *str, const char *file, int line) {
+    if (!str) {
+        return NULL;
+    }
+    size_t len = strlen(str) + 1;
+    char *copy = sudosh_alloc_malloc(len, file, line);
+    if (copy) {
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
+
+/**
+ * strndup() charged to a call site
+ */
+char *sudosh_alloc_strndup(const char *str, size_t n, const char *file, int line) {
+    size_t len = strnlen(str, n);
+    char *copy = sudosh_alloc_malloc(len + 1, file, line);
+    if (copy) {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+/**
+ * free() that keeps the books
+ */
+void sudosh_alloc_free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    release_block(ptr);
+    free(ptr);
+}
+
+/**
+ * Whether this build counts allocations
+ */
+int alloc_stats_enabled(void) {
+    return 1;
+}
+
+/**
+ * Copy of the process-wide totals
+ */
+void alloc_stats_get(struct alloc_totals *out) {
+    if (!out) {
+        return;
+    }
+    pthread_mutex_lock(&alloc_lock);
+    *out = totals;
+    pthread_mutex_unlock(&alloc_lock);
+}
+
+/**
+ * Restart peak tracking from the current live bytes
+ */
+void alloc_stats_reset_peak(void) {
+    pthread_mutex_lock(&alloc_lock);
+    totals.peak_bytes = totals.live_bytes;
+    pthread_mutex_unlock(&alloc_lock);
+}
+
+/**
+ * Order sites by calls, then bytes
+ */
+static int compare_sites(const void *a, const void *b) {
+    const struct alloc_site *x = *(const struct alloc_site *const *)a;
+    const struct alloc_site *y = *(const struct alloc_site *const *)b;
+
+    if (x->calls != y->calls) {
+        return x->calls < y->calls ? 1 : -1;
+    }
+    if (x->bytes != y->bytes) {
+        return x->bytes < y->bytes ? 1 : -1;
+    }
+    return 0;
+}
+
+/**
+ * Write the totals and the busiest call sites (limit <= 0: all of them)
+ */
+int alloc_stats_report(FILE *out, int limit) {
+    static const struct alloc_site *order[ALLOC_SITES];
+    int count = 0;
+
+    if (!out) {
+        return -1;
+    }
+    pthread_mutex_lock(&alloc_lock);
+    for (int i = 0; i < ALLOC_SITES; i++) {
+        if (sites[i].calls) {
+            order[count++] = &sites[i];
+        }
+    }
+    qsort(order, (size_t)count, sizeof(order[0]), compare_sites);
+
+    fprintf(out, "allocation accounting: allocations=%llu reallocs=%llu frees=%llu bytes=%llu "
+                 "live_blocks=%llu live_bytes=%llu peak_bytes=%llu untracked_frees=%llu sites=%d\n",
+            totals.allocations, totals.reallocs, totals.frees, totals.bytes, totals.live_blocks,
+            totals.live_bytes, totals.peak_bytes, totals.untracked_frees, count);
+    fprintf(out, "%10s %12s %8s %12s  %s\n", "calls", "bytes", "live", "live_bytes", "site");
+    for (int i = 0; i < count && (limit <= 0 || i < limit); i++) {
+        fprintf(out, "%10llu %12llu %8llu %12llu  %s:%d\n", order[i]->calls, order[i]->bytes,
+                order[i]->live_blocks, order[i]->live_bytes, order[i]->file, order[i]->line);
+    }
+    pthread_mutex_unlock(&alloc_lock);
+    return count;
+}
+
+#else /* !SUDOSH_ALLOC_STATS */
+
+/**
+ * Whether this build counts allocations
+ */
+int alloc_stats_enabled(void) {
+    return 0;
+}
+
+/**
+ * Copy of the process-wide totals (all zero without accounting)
+ */
+void alloc_stats_get(struct alloc_totals *out) {
+    if (out) {
+        memset(out, 0, sizeof(*out));
+    }
+}
+
+/**
+ * Restart peak tracking (nothing to do without accounting)
+ */
+void alloc_stats_reset_peak(void) {
+}
+
+/**
+ * Write the report; without accounting there is nothing to report
+ */
+int alloc_stats_report(FILE *out, int limit) {
+    (void)limit;
+    if (!out) {
+        return -1;
+    }
+    fprintf(out, "allocation accounting: not built in (make ALLOC_STATS=1)\n");
+    return 0;
+}
+
+#endif /* SUDOSH_ALLOC_STATS */
@@ -0,0 +1,720 @@
+/**
+ * audit.c - Tamper-Evident Audit Journal
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * Keeps a root-owned local journal of commands, authentications,
+ * sessions and security violations alongside syslog.  Each record is one
+ * tab-separated line ending in the SHA-256 of the previous record and its
+ * own SHA-256 over everything before it, so editing, inserting or removing
+ * a record breaks the chain.
+ *
+ * Records are appended under an exclusive flock() on the journal and made
+ * durable with group commit: after writing, a process takes the sync lock
+ * and skips its fdatasync() if another process has already synced past
+ * its records, so concurrent sessions share one fsync per batch.  Within
+ * a process, security violations are batched (up to AUDIT_BATCH_RECORDS or
+ * AUDIT_BATCH_USEC) while commands, authentications and session events
+ * are committed immediately.
+ *
+ * Writers also extend a sidecar search index (audit_index.c) while they
+ * still hold the journal lock, and every record is handed to the
+ * collector forwarder (audit_forward.c) when one is configured.
+ *
+ * "sudosh --verify-audit" checks the chain with several threads: because
+ * every record carries its predecessor's hash, chunks of the journal are
+ * verified independently and only the chunk boundaries are linked in order.
+ */
+
+#include "sudosh.h"
+
+#include <sys/mman.h>
+#include <pthread.h>
+
+#define AUDIT_SYNC_MAGIC 0x53444153u    /* "SDAS" */
+#define AUDIT_SYNC_VERSION 1
+#define AUDIT_TAIL_READ 16384           /* Enough for the longest record */
+#define AUDIT_VERIFY_CHUNK (1024 * 1024)
+#define AUDIT_MAX_THREADS 16
+
+/* Shared durability state, kept in AUDIT_LOG_FILE ".sync" */
+struct audit_sync_state {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t durable_offset;    /* Journal bytes known to be on disk */
+    uint64_t seq;               /* Last record known durable, for truncation checks */
+    uint64_t syncs;             /* fdatasync() calls made by all sessions */
+    char hash[SHA256_HEX_LENGTH + 1];
+};
+
+/* A record waiting for the next batch commit */
+struct audit_pending {
+    char *fields;               /* Everything between seq= and prev= */
+};
+
+static int audit_fd = -1;
+static int audit_sync_fd = -1;
+static int audit_index_fd = -1;
+static int audit_disabled = 0;
+static pid_t audit_owner_pid = 0;
+static struct audit_pending audit_batch[AUDIT_BATCH_RECORDS];
+static int audit_batch_count = 0;
+static pid_t audit_batch_pid = 0;
+static long long audit_batch_started = 0;
+
+static const char audit_genesis[SHA256_HEX_LENGTH + 1] =
+    "0000000000000000000000000000000000000000000000000000000000000000";
+
+/**
+ * Location of the journal; in test mode only an explicit override is used
+ */
+const char *audit_log_path(void) {
+    extern int test_mode;
+    const char *override = getenv("SUDOSH_AUDIT_LOG");
+
+    if (test_mode) {
+        return (override && *override) ? override : NULL;
+    }
+    return AUDIT_LOG_FILE;
+}
+
+/**
+ * Check that a journal file is a regular root-owned file nobody else can write
+ */
+int audit_file_trusted(int fd) {
+    extern int test_mode;
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return 0;
+    }
+    if (st.st_uid != (test_mode ? geteuid() : 0)) {
+        return 0;
+    }
+    return (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+/**
+ * Open the journal and its sync state on first use
+ */
+static int audit_open(void) {
+    char sync_path[PATH_MAX];
+    char index_path[PATH_MAX];
+
+    if (audit_fd != -1) {
+        return 0;
+    }
+    if (audit_disabled) {
+        return -1;
+    }
+
+    const char *path = audit_log_path();
+    if (!path) {
+        audit_disabled = 1;
+        return -1;
+    }
+    if (strcmp(path, AUDIT_LOG_FILE) == 0) {
+        mkdir(AUDIT_LOG_DIR, 0700);
+    }
+
+    audit_fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    snprintf(sync_path, sizeof(sync_path), "%s.sync", path);
+    audit_sync_fd = open(sync_path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (audit_fd == -1 || audit_sync_fd == -1 ||
+        !audit_file_trusted(audit_fd) || !audit_file_trusted(audit_sync_fd)) {
+        syslog(LOG_WARNING, "AUDIT_JOURNAL: %s unavailable or not trusted; using syslog only", path);
+        if (audit_fd != -1) close(audit_fd);
+        if (audit_sync_fd != -1) close(audit_sync_fd);
+        audit_fd = audit_sync_fd = -1;
+        audit_disabled = 1;
+        return -1;
+    }
+
+    /* The search index is optional; the journal works without it */
+    snprintf(index_path, sizeof(index_path), "%s.idx", path);
+    audit_index_fd = open(index_path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (audit_index_fd != -1 && !audit_file_trusted(audit_index_fd)) {
+        syslog(LOG_WARNING, "AUDIT_JOURNAL: index %s not trusted; not maintained", index_path);
+        close(audit_index_fd);
+        audit_index_fd = -1;
+    }
+
+    audit_owner_pid = getpid();
+    atexit(audit_flush);
+    return 0;
+}
+
+/**
+ * Append src to dst with tabs, newlines, backslashes and control bytes escaped
+ */
+static size_t audit_escape(char *dst, size_t size, const char *src) {
+    size_t n = 0;
+
+    for (; src && *src && n + 5 < size && n < AUDIT_MAX_FIELD; src++) {
+        unsigned char c = (unsigned char)*src;
+        if (c == '\\') {
+            dst[n++] = '\\';
+            dst[n++] = '\\';
+        } else if (c == '\t') {
+            dst[n++] = '\\';
+            dst[n++] = 't';
+        } else if (c == '\n') {
+            dst[n++] = '\\';
+            dst[n++] = 'n';
+        } else if (c < 0x20 || c == 0x7f) {
+            n += (size_t)snprintf(dst + n, size - n, "\\x%02x", c);
+        } else {
+            dst[n++] = (char)c;
+        }
+    }
+    dst[n] = '\0';
+    return n;
+}
+
+/**
+ * Find the last record's sequence number and hash (journal lock held)
+ *
+ * A torn record left by a crash mid-write was never made durable and is
+ * cut off so the chain continues from the last complete record.
+ */
+static void audit_read_tail(uint64_t *seq, char hash[SHA256_HEX_LENGTH + 1]) {
+    char buf[AUDIT_TAIL_READ + 1];
+    struct stat st;
+
+    *seq = 0;
+    memcpy(hash, audit_genesis, sizeof(audit_genesis));
+    if (fstat(audit_fd, &st) != 0 || st.st_size == 0) {
+        return;
+    }
+
+    off_t start = st.st_size > AUDIT_TAIL_READ ? st.st_size - AUDIT_TAIL_READ : 0;
+    ssize_t n = pread(audit_fd, buf, (size_t)(st.st_size - start), start);
+    if (n <= 0) {
+        return;
+    }
+    buf[n] = '\0';
+
+    char *end = strrchr(buf, '\n');
+    if (!end) {
+        syslog(LOG_ERR, "AUDIT_JOURNAL: no complete record in the last %d bytes", AUDIT_TAIL_READ);
+        return;
+    }
+    if (end != buf + n - 1) {
+        syslog(LOG_WARNING, "AUDIT_JOURNAL: discarding torn record at offset %lld",
+               (long long)(start + (end - buf) + 1));
+        if (ftruncate(audit_fd, start + (end - buf) + 1) != 0) {
+            syslog(LOG_ERR, "AUDIT_JOURNAL: cannot truncate torn record: %m");
+        }
+    }
+    *end = '\0';
+
+    char *line = strrchr(buf, '\n');
+    line = line ? line + 1 : buf;
+    char *hash_field = strstr(line, "\thash=");
+    if (strncmp(line, "seq=", 4) != 0 || !hash_field ||
+        strlen(hash_field + 6) != SHA256_HEX_LENGTH) {
+        syslog(LOG_ERR, "AUDIT_JOURNAL: last record is malformed; chain restarts");
+        return;
+    }
+    *seq = strtoull(line + 4, NULL, 10);
+    memcpy(hash, hash_field + 6, SHA256_HEX_LENGTH + 1);
+}
+
+/**
+ * Make journal bytes up to end durable, sharing the fsync with other sessions
+ */
+static void audit_group_commit(uint64_t end, uint64_t seq, const char *hash) {
+    struct audit_sync_state state;
+    struct stat st;
+
+    if (metrics_flock(audit_sync_fd, METRIC_LOCK_CONTENDED_AUDIT_SYNC) != 0) {
+        fdatasync(audit_fd);
+        return;
+    }
+    if (pread(audit_sync_fd, &state, sizeof(state), 0) != (ssize_t)sizeof(state) ||
+        state.magic != AUDIT_SYNC_MAGIC || state.version != AUDIT_SYNC_VERSION) {
+        memset(&state, 0, sizeof(state));
+        state.magic = AUDIT_SYNC_MAGIC;
+        state.version = AUDIT_SYNC_VERSION;
+    }
+
+    /* Another session's fsync already covered these records */
+    if (state.durable_offset >= end) {
+        flock(audit_sync_fd, LOCK_UN);
+        return;
+    }
+
+    /* Everything appended so far, including other sessions' records, goes in one sync */
+    if (fstat(audit_fd, &st) != 0 || fdatasync(audit_fd) != 0) {
+        syslog(LOG_ERR, "AUDIT_JOURNAL: fdatasync failed: %m");
+        flock(audit_sync_fd, LOCK_UN);
+        return;
+    }
+    state.durable_offset = (uint64_t)st.st_size;
+    state.syncs++;
+    if ((uint64_t)st.st_size == end) {
+        state.seq = seq;
+        memcpy(state.hash, hash, sizeof(state.hash));
+    }
+    if (pwrite(audit_sync_fd, &state, sizeof(state), 0) != (ssize_t)sizeof(state)) {
+        syslog(LOG_ERR, "AUDIT_JOURNAL: cannot update sync state: %m");
+    }
+    flock(audit_sync_fd, LOCK_UN);
+}
+
+/**
+ * Drop records inherited from a parent process; they are the parent's to write
+ */
+static void audit_discard_inherited(void) {
+    if (audit_batch_pid != getpid()) {
+        for (int i = 0; i < audit_batch_count; i++) {
+            free(audit_batch[i].fields);
+        }
+        audit_batch_count = 0;
+        audit_batch_pid = getpid();
+    }
+}
+
+/**
+ * Chain and write every pending record, then commit them
+ */
+void audit_flush(void) {
+    char prev[SHA256_HEX_LENGTH + 1];
+    uint64_t seq;
+
+    if (audit_fd == -1) {
+        return;
+    }
+    audit_discard_inherited();
+    if (audit_batch_count == 0) {
+        return;
+    }
+
+    size_t capacity = 0;
+    for (int i = 0; i < audit_batch_count; i++) {
+        capacity += strlen(audit_batch[i].fields) + 2 * SHA256_HEX_LENGTH + 64;
+    }
+    char *out = malloc(capacity);
+    if (!out) {
+        return;
+    }
+
+    if (metrics_flock(audit_fd, METRIC_LOCK_CONTENDED_AUDIT_JOURNAL) != 0) {
+        free(out);
+        return;
+    }
+    audit_read_tail(&seq, prev);
+    off_t base = lseek(audit_fd, 0, SEEK_END);
+
+    size_t used = 0;
+    for (int i = 0; i < audit_batch_count; i++) {
+        size_t start = used;
+        used += (size_t)snprintf(out + used, capacity - used, "seq=%llu\t%s\tprev=%s",
+                                 (unsigned long long)++seq, audit_batch[i].fields, prev);
+        sha256_hex(out + start, used - start, prev);
+        used += (size_t)snprintf(out + used, capacity - used, "\thash=%s\n", prev);
+        free(audit_batch[i].fields);
+    }
+    audit_batch_count = 0;
+
+    size_t written = 0;
+    while (written < used) {
+        ssize_t n = write(audit_fd, out + written, used - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            syslog(LOG_ERR, "AUDIT_JOURNAL: write failed: %m");
+            break;
+        }
+        written += (size_t)n;
+    }
+    off_t end = lseek(audit_fd, 0, SEEK_END);
+    if (audit_index_fd != -1 && base >= 0) {
+        audit_index_extend(audit_index_fd, audit_fd, out, written, (uint64_t)base);
+    }
+    flock(audit_fd, LOCK_UN);
+    free(out);
+
+    if (written == used && end > 0) {
+        audit_group_commit((uint64_t)end, seq, prev);
+    }
+}
+
+/**
+ * Add a record to the audit journal
+ *
+ * type is COMMAND, AUTH, SESSION or VIOLATION.  Durable records are
+ * committed before returning; others wait for the batch to fill or age.
+ * Records from forked children are always committed immediately.
+ */
+void audit_record(const char *type, const char *username, const char *status,
+                  const char *message, int durable) {
+    extern char *target_user;
+    char fields[AUDIT_MAX_RECORD];
+    char hostname[256];
+    char *cwd;
+    const char *tty;
+    size_t n;
+
+    SUDOSH_PROBE3(audit__record, type, username, message);
+    int journal = (audit_open() == 0);
+    if (!journal && !audit_forward_enabled()) {
+        return;
+    }
+    if (journal) {
+        audit_discard_inherited();
+        if (getpid() != audit_owner_pid) {
+            durable = 1;  /* A child may exec or _exit before any later flush */
+        }
+    }
+
+    if (gethostname(hostname, sizeof(hostname)) != 0) {
+        snprintf(hostname, sizeof(hostname), "unknown");
+    }
+    hostname[sizeof(hostname) - 1] = '\0';
+    tty = ttyname(STDIN_FILENO);
+    if (!tty) {
+        tty = "unknown";
+    } else if (strncmp(tty, "/dev/", 5) == 0) {
+        tty += 5;
+    }
+    cwd = getcwd(NULL, 0);
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    n = (size_t)snprintf(fields, sizeof(fields), "time=%lld.%06ld\ttype=%s\thost=",
+                         (long long)ts.tv_sec, ts.tv_nsec / 1000, type);
+    n += audit_escape(fields + n, sizeof(fields) - n, hostname);
+    n += (size_t)snprintf(fields + n, sizeof(fields) - n, "\tuser=");
+    n += audit_escape(fields + n, sizeof(fields) - n, username ? username : "unknown");
+    n += (size_t)snprintf(fields + n, sizeof(fields) - n, "\trunas=");
+    n += audit_escape(fields + n, sizeof(fields) - n, target_user ? target_user : "root");
+    n += (size_t)snprintf(fields + n, sizeof(fields) - n, "\ttty=");
+    n += audit_escape(fields + n, sizeof(fields) - n, tty);
+    n += (size_t)snprintf(fields + n, sizeof(fields) - n, "\tstatus=");
+    n += audit_escape(fields + n, sizeof(fields) - n, status ? status : "-");
+    n += (size_t)snprintf(fields + n, sizeof(fields) - n, "\tpwd=");
+    n += audit_escape(fields + n, sizeof(fields) - n, cwd ? cwd : "unknown");
+    n += (size_t)snprintf(fields + n, sizeof(fields) - n, "\tmsg=");
+    audit_escape(fields + n, sizeof(fields) - n, message ? message : "");
+    free(cwd);
+
+    audit_forward_record(fields, durable);
+    if (!journal) {
+        return;
+    }
+
+    char *copy = safe_strdup(fields);
+    if (!copy) {
+        return;
+    }
+    long long now = monotonic_usec();
+    if (audit_batch_count == 0) {
+        audit_batch_started = now;
+    }
+    audit_batch[audit_batch_count++].fields = copy;
+
+    if (durable || audit_batch_count >= AUDIT_BATCH_RECORDS ||
+        now - audit_batch_started >= AUDIT_BATCH_USEC) {
+        audit_flush();
+    }
+}
+
+/**
+ * Flush pending records and close the journal
+ */
+void close_audit_journal(void) {
+    close_audit_forward();
+    audit_flush();
+    if (audit_fd != -1) {
+        close(audit_fd);
+        close(audit_sync_fd);
+        audit_fd = audit_sync_fd = -1;
+    }
+    if (audit_index_fd != -1) {
+        close(audit_index_fd);
+        audit_index_fd = -1;
+    }
+    audit_disabled = 0;
+}
+
+/* One verifier work unit: a run of whole records */
+struct audit_chunk {
+    const char *start;
+    const char *end;
+    uint64_t records;
+    uint64_t first_seq;
+    uint64_t last_seq;
+    char first_prev[SHA256_HEX_LENGTH + 1];
+    char last_hash[SHA256_HEX_LENGTH + 1];
+    long long error_offset;     /* -1 if the chunk verified */
+    const char *error;
+    int state_match;            /* 1 seen and matches, -1 seen and differs */
+};
+
+struct audit_verify_job {
+    const char *base;
+    struct audit_chunk *chunks;
+    size_t chunk_count;
+    size_t next;                /* Next chunk to claim, shared by workers */
+    uint64_t state_seq;
+    const char *state_hash;
+};
+
+/**
+ * Verify the records of one chunk and summarise its ends
+ */
+static void verify_chunk(struct audit_verify_job *job, struct audit_chunk *chunk) {
+    char computed[SHA256_HEX_LENGTH + 1];
+    const char *line = chunk->start;
+
+    chunk->error_offset = -1;
+    while (line < chunk->end) {
+        const char *eol = memchr(line, '\n', (size_t)(chunk->end - line));
+        const char *hash_field = NULL;
+        const char *prev_field = NULL;
+
+        if (!eol) {
+            chunk->error = "incomplete record at end of journal";
+            chunk->error_offset = line - job->base;
+            return;
+        }
+        /* The hash is the last field and prev the one before it */
+        for (const char *p = eol - 1; p > line && (!hash_field || !prev_field); p--) {
+            if (*p != '\t') {
+                continue;
+            }
+            if (!hash_field) {
+                hash_field = p;
+            } else {
+                prev_field = p;
+            }
+        }
+        if (strncmp(line, "seq=", 4) != 0 || !hash_field || !prev_field ||
+            eol - hash_field != 6 + SHA256_HEX_LENGTH || strncmp(hash_field, "\thash=", 6) != 0 ||
+            hash_field - prev_field != 6 + SHA256_HEX_LENGTH || strncmp(prev_field, "\tprev=", 6) != 0) {
+            chunk->error = "malformed record";
+            chunk->error_offset = line - job->base;
+            return;
+        }
+
+        uint64_t seq = strtoull(line + 4, NULL, 10);
+        sha256_hex(line, (size_t)(hash_field - line), computed);
+        if (memcmp(computed, hash_field + 6, SHA256_HEX_LENGTH) != 0) {
+            chunk->error = "record hash mismatch (record modified)";
+            chunk->error_offset = line - job->base;
+            return;
+        }
+
+        if (chunk->records == 0) {
+            chunk->first_seq = seq;
+            memcpy(chunk->first_prev, prev_field + 6, SHA256_HEX_LENGTH);
+        } else if (seq != chunk->last_seq + 1 ||
+                   memcmp(prev_field + 6, chunk->last_hash, SHA256_HEX_LENGTH) != 0) {
+            chunk->error = "chain broken (record inserted or removed)";
+            chunk->error_offset = line - job->base;
+            return;
+        }
+        chunk->last_seq = seq;
+        memcpy(chunk->last_hash, hash_field + 6, SHA256_HEX_LENGTH);
+        chunk->records++;
+
+        if (job->state_seq && seq == job->state_seq) {
+            chunk->state_match = memcmp(chunk->last_hash, job->state_hash, SHA256_HEX_LENGTH) == 0 ? 1 : -1;
+        }
+        line = eol + 1;
+    }
+}
+
+/**
+ * Verifier thread: claim chunks until none are left
+ */
+static void *verify_worker(void *arg) {
+    struct audit_verify_job *job = arg;
+
+    for (;;) {
+        size_t i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (i >= job->chunk_count) {
+            return NULL;
+        }
+        verify_chunk(job, &job->chunks[i]);
+    }
+}
+
+/**
+ * Verify an audit journal's hash chain
+ *
+ * Returns 0 if every record verifies and links to its predecessor, 1 if
+ * the journal has been altered (result->error and result->error_offset
+ * describe the first problem) and -1 if it cannot be read.
+ */
+int verify_audit_log(const char *path, int threads, struct audit_verify_result *result) {
+    struct audit_sync_state state;
+    char sync_path[PATH_MAX];
+    struct stat st;
+
+    memset(result, 0, sizeof(*result));
+    result->error_offset = -1;
+    if (!path) {
+        path = audit_log_path() ? audit_log_path() : AUDIT_LOG_FILE;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1 || fstat(fd, &st) != 0) {
+        if (fd != -1) close(fd);
+        return -1;
+    }
+
+    /* The sync state says how far the journal was known to reach */
+    memset(&state, 0, sizeof(state));
+    snprintf(sync_path, sizeof(sync_path), "%s.sync", path);
+    int sync_fd = open(sync_path, O_RDONLY | O_CLOEXEC);
+    if (sync_fd != -1) {
+        if (read(sync_fd, &state, sizeof(state)) != (ssize_t)sizeof(state) ||
+            state.magic != AUDIT_SYNC_MAGIC) {
+            memset(&state, 0, sizeof(state));
+        }
+        close(sync_fd);
+    }
+    state.hash[SHA256_HEX_LENGTH] = '\0';
+    result->syncs = state.syncs;
+    result->durable_seq = state.seq;
+
+    if (st.st_size == 0) {
+        close(fd);
+        if (state.seq > 0) {
+            snprintf(result->error, sizeof(result->error), "journal is empty but %llu records were committed",
+                     (unsigned long long)state.seq);
+            result->error_offset = 0;
+            return 1;
+        }
+        return 0;
+    }
+
+    const char *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    madvise((void *)base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    /* Split at record boundaries */
+    size_t size = (size_t)st.st_size;
+    size_t max_chunks = size / AUDIT_VERIFY_CHUNK + 1;
+    struct audit_chunk *chunks = calloc(max_chunks, sizeof(*chunks));
+    if (!chunks) {
+        munmap((void *)base, size);
+        return -1;
+    }
+    size_t count = 0;
+    const char *pos = base;
+    while (pos < base + size) {
+        const char *end = pos + AUDIT_VERIFY_CHUNK < base + size ? pos + AUDIT_VERIFY_CHUNK : base + size;
+        if (end < base + size) {
+            const char *nl = memchr(end, '\n', (size_t)(base + size - end));
+            end = nl ? nl + 1 : base + size;
+        }
+        chunks[count].start = pos;
+        chunks[count].end = end;
+        count++;
+        pos = end;
+    }
+
+    struct audit_verify_job job = { base, chunks, count, 0, state.seq, state.hash };
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > AUDIT_MAX_THREADS) {
+        threads = AUDIT_MAX_THREADS;
+    }
+    if ((size_t)threads > count) {
+        threads = (int)count;
+    }
+
+    pthread_t workers[AUDIT_MAX_THREADS];
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, verify_worker, &job) == 0) {
+            started++;
+        }
+    }
+    verify_worker(&job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    result->threads = started + 1;
+
+    /* Link the chunks in order; the first problem wins */
+    int state_match = 0;
+    for (size_t i = 0; i < count && result->error_offset < 0; i++) {
+        struct audit_chunk *chunk = &chunks[i];
+        if (chunk->records > 0) {
+            const char *expected_prev = i == 0 ? audit_genesis : chunks[i - 1].last_hash;
+            uint64_t expected_seq = i == 0 ? 1 : chunks[i - 1].last_seq + 1;
+            if (chunk->first_seq != expected_seq ||
+                memcmp(chunk->first_prev, expected_prev, SHA256_HEX_LENGTH) != 0) {
+                snprintf(result->error, sizeof(result->error), "%s",
+                         i == 0 ? "first record does not start the chain (records removed)"
+                                : "chain broken (record inserted or removed)");
+                result->error_offset = chunk->start - base;
+                break;
+            }
+        }
+        result->records += chunk->records;
+        result->last_seq = chunk->records ? chunk->last_seq : result->last_seq;
+        if (chunk->state_match) {
+            state_match = chunk->state_match;
+        }
+        if (chunk->error_offset >= 0) {
+            snprintf(result->error, sizeof(result->error), "%s", chunk->error);
+            result->error_offset = chunk->error_offset;
+        }
+    }
+
+    if (result->error_offset < 0 && state.seq > 0) {
+        if (state_match == 0) {
+            snprintf(result->error, sizeof(result->error),
+                     "journal ends at record %llu but record %llu was committed (truncated)",
+                     (unsigned long long)result->last_seq, (unsigned long long)state.seq);
+            result->error_offset = (long long)size;
+        } else if (state_match < 0) {
+            snprintf(result->error, sizeof(result->error),
+                     "record %llu differs from the committed record (rewritten)",
+                     (unsigned long long)state.seq);
+            result->error_offset = (long long)size;
+        }
+    }
+
+    free(chunks);
+    munmap((void *)base, size);
+    return result->error_offset >= 0 ? 1 : 0;
+}
+
+/**
+ * Implement "sudosh --verify-audit [FILE]"
+ */
+int verify_audit_command(const char *path) {
+    struct audit_verify_result result;
+    const char *shown = path ? path : (audit_log_path() ? audit_log_path() : AUDIT_LOG_FILE);
+    long long started = monotonic_usec();
+
+    int rc = verify_audit_log(path, 0, &result);
+    long long elapsed = monotonic_usec() - started;
+    if (rc < 0) {
+        fprintf(stderr, "sudosh: cannot read audit journal %s: %s\n", shown, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (rc > 0) {
+        printf("%s: TAMPERED at byte %lld after %llu valid records: %s\n", shown,
+               result.error_offset, (unsigned long long)result.records, result.error);
+        syslog(LOG_ALERT, "AUDIT_VERIFY: %s failed at byte %lld: %s", shown, result.error_offset, result.error);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: OK, %llu records verified (last seq %llu) in %.3f s with %d thread%s\n", shown,
+           (unsigned long long)result.records, (unsigned long long)result.last_seq,
+           (double)elapsed / 1e6, result.threads, result.threads == 1 ? "" : "s");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,548 @@
+/**
+ * audit_forward.c - Audit Record Forwarding to a Local Collector
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * Streams audit records to a collector (such as a log shipper) listening
+ * on the Unix socket named by audit_forward_socket in sudosh.conf.  Each
+ * record is the journal's tab-separated fields on one line, and records
+ * are sent in framed batches: a struct audit_forward_frame header followed
+ * by the records.  SOCK_SEQPACKET is used when the collector offers it;
+ * on a stream socket the header's length delimits frames.
+ *
+ * Nothing here waits for the collector.  The socket is non-blocking and
+ * records wait in a bounded in-memory queue.  When the collector is down
+ * or slow and the queue fills, or when the session ends with records
+ * unsent, they are appended to a spill file next to the journal
+ * ("<journal>.spill").  Spilled records from every session are replayed,
+ * oldest first, before new ones once the collector is reachable again.
+ */
+
+#include "sudosh.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define AUDIT_SPILL_MAGIC 0x50534453u   /* "SDSP" */
+#define AUDIT_SPILL_HEADER 16
+#define AUDIT_REPLAY_ROUNDS 8           /* spill chunks sent per flush at most */
+
+#ifdef MSG_NOSIGNAL
+#define AUDIT_SEND_FLAGS (MSG_DONTWAIT | MSG_NOSIGNAL)
+#else
+#define AUDIT_SEND_FLAGS MSG_DONTWAIT
+#endif
+
+/* Spill file header; records follow */
+struct audit_spill_header {
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t replayed;          /* Offset of the first record not yet taken for replay */
+};
+
+/* A growable byte buffer */
+struct audit_buffer {
+    char *data;
+    size_t len;
+    size_t cap;
+};
+
+static char *forward_path = NULL;
+static int forward_fd = -1;
+static int forward_stream = 0;
+static int forward_child = 0;
+static pid_t forward_owner = 0;
+static long long forward_retry_at = 0;
+static int forward_spill_fd = -1;
+static int forward_exit_registered = 0;
+
+static struct audit_buffer forward_queue;      /* Records not yet framed */
+static int forward_queue_records = 0;
+static long long forward_queue_started = 0;
+static struct audit_buffer forward_outbox;     /* Frames being sent */
+static size_t forward_sent = 0;                 /* Outbox bytes the collector has */
+static size_t forward_counted = 0;              /* Outbox bytes counted in the stats */
+static struct audit_forward_stats forward_stats;
+
+/**
+ * Append bytes to a buffer, growing it as needed
+ */
+static int buffer_append(struct audit_buffer *b, const void *data, size_t len) {
+    if (b->len + len > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+        while (cap < b->len + len) {
+            cap *= 2;
+        }
+        char *grown = realloc(b->data, cap);
+        if (!grown) {
+            return -1;
+        }
+        b->data = grown;
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    return 0;
+}
+
+/**
+ * Count the records (lines) in a run of bytes
+ */
+static int count_records(const char *data, size_t len) {
+    int n = 0;
+    for (const char *p = data; (p = memchr(p, '\n', len - (size_t)(p - data))) != NULL; p++) {
+        n++;
+    }
+    return n;
+}
+
+/**
+ * Open the spill file on first use
+ */
+static int spill_open(void) {
+    char path[PATH_MAX];
+
+    if (forward_spill_fd != -1) {
+        return 0;
+    }
+    const char *journal = audit_log_path();
+    if (!journal) {
+        return -1;
+    }
+    snprintf(path, sizeof(path), "%s.spill", journal);
+    if (strcmp(journal, AUDIT_LOG_FILE) == 0) {
+        mkdir(AUDIT_LOG_DIR, 0700);
+    }
+    forward_spill_fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (forward_spill_fd != -1 && !audit_file_trusted(forward_spill_fd)) {
+        syslog(LOG_WARNING, "AUDIT_FORWARD: spill file %s not trusted", path);
+        close(forward_spill_fd);
+        forward_spill_fd = -1;
+    }
+    return forward_spill_fd == -1 ? -1 : 0;
+}
+
+/**
+ * Read the spill header (spill lock held), initializing an empty file
+ */
+static int spill_header(struct audit_spill_header *h) {
+    if (pread(forward_spill_fd, h, sizeof(*h), 0) == (ssize_t)sizeof(*h) && h->magic == AUDIT_SPILL_MAGIC) {
+        return 0;
+    }
+    memset(h, 0, sizeof(*h));
+    h->magic = AUDIT_SPILL_MAGIC;
+    h->replayed = AUDIT_SPILL_HEADER;
+    if (ftruncate(forward_spill_fd, AUDIT_SPILL_HEADER) != 0 ||
+        pwrite(forward_spill_fd, h, sizeof(*h), 0) != (ssize_t)sizeof(*h)) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Append records to the spill file for a later replay
+ */
+static void spill_records(const char *records, size_t len) {
+    struct audit_spill_header h;
+    int count = count_records(records, len);
+
+    if (len == 0) {
+        return;
+    }
+    if (spill_open() != 0 || flock(forward_spill_fd, LOCK_EX) != 0) {
+        forward_stats.dropped += (unsigned long long)count;
+        syslog(LOG_ERR, "AUDIT_FORWARD: collector unavailable and no spill file; %d records dropped", count);
+        return;
+    }
+    off_t end = lseek(forward_spill_fd, 0, SEEK_END);
+    if (spill_header(&h) != 0 || end < AUDIT_SPILL_HEADER) {
+        end = AUDIT_SPILL_HEADER;
+    }
+    if (pwrite(forward_spill_fd, records, len, end) != (ssize_t)len) {
+        forward_stats.dropped += (unsigned long long)count;
+        syslog(LOG_ERR, "AUDIT_FORWARD: cannot write spill file: %m; %d records dropped", count);
+    } else {
+        forward_stats.spilled += (unsigned long long)count;
+    }
+    flock(forward_spill_fd, LOCK_UN);
+}
+
+/**
+ * Spill the payloads of outbox frames the collector did not fully receive
+ */
+static void spill_outbox(void) {
+    size_t pos = 0;
+
+    while (pos + sizeof(struct audit_forward_frame) <= forward_outbox.len) {
+        struct audit_forward_frame frame;
+        memcpy(&frame, forward_outbox.data + pos, sizeof(frame));
+        size_t end = pos + sizeof(frame) + frame.length;
+        if (end > forward_sent) {
+            spill_records(forward_outbox.data + pos + sizeof(frame), frame.length);
+        }
+        pos = end;
+    }
+    forward_outbox.len = forward_sent = forward_counted = 0;
+}
+
+/**
+ * Frame records into the outbox, at most AUDIT_FORWARD_FRAME_MAX bytes each
+ */
+static int pack_records(const char *records, size_t len) {
+    size_t pos = 0;
+
+    while (pos < len) {
+        size_t take = len - pos;
+        if (take > AUDIT_FORWARD_FRAME_MAX) {
+            /* Cut after the last whole record that fits */
+            const char *cut = records + pos + AUDIT_FORWARD_FRAME_MAX;
+            while (cut > records + pos && cut[-1] != '\n') {
+                cut--;
+            }
+            take = cut > records + pos ? (size_t)(cut - (records + pos)) : AUDIT_FORWARD_FRAME_MAX;
+        }
+
+        struct audit_forward_frame frame;
+        frame.magic = AUDIT_FORWARD_MAGIC;
+        frame.version = AUDIT_FORWARD_VERSION;
+        frame.records = (uint16_t)count_records(records + pos, take);
+        frame.length = (uint32_t)take;
+        frame.pid = (uint32_t)getpid();
+        if (buffer_append(&forward_outbox, &frame, sizeof(frame)) != 0 ||
+            buffer_append(&forward_outbox, records + pos, take) != 0) {
+            return -1;
+        }
+        pos += take;
+    }
+    return 0;
+}
+
+/**
+ * Drop the connection; unsent frames go to the spill file
+ */
+static void forward_disconnect(void) {
+    spill_outbox();
+    if (forward_fd != -1) {
+        close(forward_fd);
+        forward_fd = -1;
+        syslog(LOG_WARNING, "AUDIT_FORWARD: lost collector %s; spilling", forward_path);
+    }
+    forward_stats.connected = 0;
+    forward_retry_at = monotonic_usec() + AUDIT_FORWARD_RETRY_USEC;
+}
+
+/**
+ * Connect to the collector, at most once per AUDIT_FORWARD_RETRY_USEC
+ */
+static int forward_connect(void) {
+    extern int test_mode;
+    struct sockaddr_un addr;
+    struct stat st;
+    static const int types[] = { SOCK_SEQPACKET, SOCK_STREAM };
+
+    if (forward_fd != -1) {
+        return 0;
+    }
+    long long now = monotonic_usec();
+    if (now < forward_retry_at) {
+        return -1;
+    }
+    forward_retry_at = now + AUDIT_FORWARD_RETRY_USEC;
+
+    /* Only a root-owned socket is trusted with audit records */
+    if (lstat(forward_path, &st) != 0 || !S_ISSOCK(st.st_mode) ||
+        st.st_uid != (test_mode ? geteuid() : 0) || strlen(forward_path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, forward_path, sizeof(addr.sun_path) - 1);
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        int fd = socket(AF_UNIX, types[i], 0);
+        if (fd == -1) {
+            continue;  /* No SOCK_SEQPACKET on this platform */
+        }
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            forward_fd = fd;
+            forward_stream = (types[i] == SOCK_STREAM);
+            forward_stats.connected = 1;
+            return 0;
+        }
+        int err = errno;
+        close(fd);
+        if (err != EPROTOTYPE && err != EPROTONOSUPPORT) {
+            break;  /* Collector is down or busy */
+        }
+    }
+    return -1;
+}
+
+/**
+ * Send as much of the outbox as the socket takes without blocking
+ *
+ * Returns 0 (outbox empty or socket full) or -1 if the connection failed.
+ */
+static int forward_send(void) {
+    while (forward_sent < forward_outbox.len) {
+        size_t len = forward_outbox.len - forward_sent;
+        if (!forward_stream) {
+            /* One frame per datagram */
+            struct audit_forward_frame frame;
+            memcpy(&frame, forward_outbox.data + forward_sent, sizeof(frame));
+            len = sizeof(frame) + frame.length;
+        }
+        ssize_t n = send(forward_fd, forward_outbox.data + forward_sent, len, AUDIT_SEND_FLAGS);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                return 0;
+            }
+            forward_disconnect();
+            return -1;
+        }
+        forward_sent += (size_t)n;
+
+        /* Count the frames that are now complete */
+        while (forward_counted + sizeof(struct audit_forward_frame) <= forward_sent) {
+            struct audit_forward_frame frame;
+            memcpy(&frame, forward_outbox.data + forward_counted, sizeof(frame));
+            if (forward_counted + sizeof(frame) + frame.length > forward_sent) {
+                break;
+            }
+            forward_counted += sizeof(frame) + frame.length;
+            forward_stats.frames++;
+            forward_stats.records += frame.records;
+        }
+    }
+    forward_outbox.len = forward_sent = forward_counted = 0;
+    return 0;
+}
+
+/**
+ * Move a chunk of spilled records into the outbox, oldest first
+ *
+ * Returns 1 if records were taken, 0 if the spill file is empty.
+ */
+static int forward_replay(void) {
+    struct audit_spill_header h;
+    struct stat st;
+    int taken = 0;
+
+    if (spill_open() != 0 || fstat(forward_spill_fd, &st) != 0 || st.st_size <= AUDIT_SPILL_HEADER) {
+        return 0;
+    }
+    if (flock(forward_spill_fd, LOCK_EX) != 0) {
+        return 0;
+    }
+    if (spill_header(&h) == 0 && fstat(forward_spill_fd, &st) == 0 && h.replayed < (uint64_t)st.st_size) {
+        size_t want = (size_t)((uint64_t)st.st_size - h.replayed);
+        if (want > AUDIT_FORWARD_QUEUE_BYTES) {
+            want = AUDIT_FORWARD_QUEUE_BYTES;
+        }
+        char *chunk = malloc(want);
+        ssize_t n = chunk ? pread(forward_spill_fd, chunk, want, (off_t)h.replayed) : -1;
+        if (n > 0) {
+            /* Whole records only */
+            size_t len = (size_t)n;
+            while (len > 0 && chunk[len - 1] != '\n') {
+                len--;
+            }
+            if (len > 0 && pack_records(chunk, len) == 0) {
+                h.replayed += len;
+                forward_stats.replayed += (unsigned long long)count_records(chunk, len);
+                taken = 1;
+            }
+        }
+        free(chunk);
+
+        if (h.replayed >= (uint64_t)st.st_size) {
+            /* Everything has been taken back: start the file over */
+            h.replayed = AUDIT_SPILL_HEADER;
+            if (ftruncate(forward_spill_fd, AUDIT_SPILL_HEADER) != 0) {
+                syslog(LOG_ERR, "AUDIT_FORWARD: cannot truncate spill file: %m");
+            }
+        }
+        if (pwrite(forward_spill_fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) {
+            syslog(LOG_ERR, "AUDIT_FORWARD: cannot update spill file: %m");
+        }
+    }
+    flock(forward_spill_fd, LOCK_UN);
+    return taken;
+}
+
+/**
+ * Forget state inherited from a parent process; it is the parent's to send
+ */
+static void forward_check_fork(void) {
+    if (forward_owner == getpid()) {
+        return;
+    }
+    if (forward_owner != 0) {
+        forward_child = 1;
+    }
+    /* The socket and spill lock are shared with the parent: use our own */
+    if (forward_fd != -1) {
+        close(forward_fd);
+        forward_fd = -1;
+    }
+    if (forward_spill_fd != -1) {
+        close(forward_spill_fd);
+        forward_spill_fd = -1;
+    }
+    forward_queue.len = 0;
+    forward_queue_records = 0;
+    forward_outbox.len = forward_sent = forward_counted = 0;
+    memset(&forward_stats, 0, sizeof(forward_stats));
+    forward_retry_at = 0;
+    forward_owner = getpid();
+}
+
+/**
+ * Whether anything is waiting for the collector
+ *
+ * Spilled records only count while the session is running; closing down
+ * does not open a connection just to replay them.
+ */
+static int forward_pending(int final) {
+    struct stat st;
+
+    if (forward_queue.len > 0 || forward_outbox.len > forward_sent) {
+        return 1;
+    }
+    return !final && spill_open() == 0 && fstat(forward_spill_fd, &st) == 0 && st.st_size > AUDIT_SPILL_HEADER;
+}
+
+/**
+ * Send queued records if the collector is reachable
+ *
+ * Spilled records go first so the collector sees them in order.  With
+ * final set (session end), anything still unsent is spilled; otherwise
+ * records stay queued until the queue exceeds AUDIT_FORWARD_QUEUE_BYTES.
+ */
+void audit_forward_flush(int final) {
+    if (!forward_path) {
+        return;
+    }
+    forward_check_fork();
+
+    if (forward_pending(final) && forward_connect() == 0) {
+        for (int rounds = 0; rounds < AUDIT_REPLAY_ROUNDS; rounds++) {
+            if (forward_send() != 0 || forward_outbox.len > 0) {
+                break;  /* Disconnected, or the socket is full */
+            }
+            if (forward_replay()) {
+                continue;
+            }
+            if (forward_queue.len == 0) {
+                break;
+            }
+            if (pack_records(forward_queue.data, forward_queue.len) != 0) {
+                break;
+            }
+            forward_queue.len = 0;
+            forward_queue_records = 0;
+        }
+    }
+
+    if (final) {
+        spill_outbox();
+        spill_records(forward_queue.data, forward_queue.len);
+        forward_queue.len = 0;
+        forward_queue_records = 0;
+    } else if (forward_queue.len + forward_outbox.len > AUDIT_FORWARD_QUEUE_BYTES) {
+        spill_records(forward_queue.data, forward_queue.len);
+        forward_queue.len = 0;
+        forward_queue_records = 0;
+    }
+    forward_stats.queued = forward_queue.len + (forward_outbox.len - forward_sent);
+}
+
+/**
+ * Queue one record (the journal's fields) for the collector
+ *
+ * urgent records (commands, authentications, session events) are sent
+ * right away together with anything queued; others wait for the batch to
+ * fill or age.  Records from forked children are never left queued.
+ */
+void audit_forward_record(const char *fields, int urgent) {
+    if (!forward_path) {
+        return;
+    }
+    forward_check_fork();
+
+    long long now = monotonic_usec();
+    if (forward_queue_records == 0) {
+        forward_queue_started = now;
+    }
+    if (buffer_append(&forward_queue, fields, strlen(fields)) != 0 ||
+        buffer_append(&forward_queue, "\n", 1) != 0) {
+        forward_stats.dropped++;
+        return;
+    }
+    forward_queue_records++;
+
+    if (urgent || forward_child || forward_queue_records >= AUDIT_FORWARD_BATCH ||
+        now - forward_queue_started >= AUDIT_FORWARD_USEC || forward_queue.len > AUDIT_FORWARD_QUEUE_BYTES) {
+        audit_forward_flush(forward_child);
+    }
+}
+
+/**
+ * Send or spill everything queued and close the collector connection
+ */
+void close_audit_forward(void) {
+    if (!forward_path) {
+        return;
+    }
+    audit_forward_flush(1);
+    if (forward_fd != -1) {
+        close(forward_fd);
+        forward_fd = -1;
+    }
+    if (forward_spill_fd != -1) {
+        close(forward_spill_fd);
+        forward_spill_fd = -1;
+    }
+    forward_stats.connected = 0;
+    forward_retry_at = 0;
+}
+
+/**
+ * Forward audit records to the collector at socket_path (NULL stops)
+ */
+void audit_forward_configure(const char *socket_path) {
+    close_audit_forward();
+    free(forward_path);
+    forward_path = (socket_path && *socket_path) ? safe_strdup(socket_path) : NULL;
+    forward_owner = getpid();
+    forward_child = 0;
+    memset(&forward_stats, 0, sizeof(forward_stats));
+    if (forward_path && !forward_exit_registered) {
+        atexit(close_audit_forward);
+        forward_exit_registered = 1;
+    }
+}
+
+/**
+ * Whether records are being forwarded
+ */
+int audit_forward_enabled(void) {
+    return forward_path != NULL;
+}
+
+/**
+ * Report this process's forwarding counters since audit_forward_configure()
+ */
+void audit_forward_get_stats(struct audit_forward_stats *stats) {
+    *stats = forward_stats;
+    stats->queued = forward_queue.len + (forward_outbox.len - forward_sent);
+}
@@ -0,0 +1,800 @@
+/**
+ * audit_index.c - Audit Journal Index and Search
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * Maintains "<journal>.idx", a fixed-width sidecar index of the audit
+ * journal with one 40-byte entry per record: its offset and length, its
+ * time, hashes of the user and host, a Bloom mask of the command basenames
+ * on the line, the record type and whether it failed.  Writers extend the
+ * index while they still hold the journal lock, so "sudosh-audit query"
+ * binary-searches the time, scans the compact entries and reads only the
+ * matching records from the journal.
+ *
+ * The index is derived data: it is never synced, and it is caught up or
+ * rebuilt from the journal whenever it is behind, damaged or describes a
+ * different file.  Hash matches are always confirmed against the record.
+ */
+
+#include "sudosh.h"
+
+#include <sys/mman.h>
+#include <strings.h>
+
+#define AUDIT_INDEX_MAGIC 0x49414453u       /* "SDAI" */
+#define AUDIT_INDEX_VERSION 1
+#define AUDIT_INDEX_HEADER 64               /* Bytes reserved before the first entry */
+#define AUDIT_INDEX_BATCH 256               /* Entries written per pwrite() */
+#define AUDIT_ENTRY_FAILED 0x01
+
+/* Index header, at offset 0 */
+struct audit_index_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t dev;               /* Journal the index describes */
+    uint64_t ino;
+    uint64_t covered;           /* Journal bytes indexed; always a record boundary */
+    uint64_t entries;
+    uint32_t last_key;
+    uint32_t reserved;
+};
+
+/* One journal record */
+struct audit_index_entry {
+    uint64_t offset;            /* Record position in the journal */
+    uint64_t commands;          /* Bloom mask of the command basenames on the line */
+    uint32_t when;              /* Record time, seconds */
+    uint32_t key;               /* Running maximum of when, so entries are sorted by key */
+    uint32_t user;              /* Hashes of the unescaped user and host */
+    uint32_t host;
+    uint16_t length;            /* Record length including the newline */
+    uint8_t type;
+    uint8_t flags;
+    uint32_t reserved;
+};
+
+/* Query terms reduced to what the index stores */
+struct audit_filter {
+    uint32_t user;
+    uint32_t host;
+    uint64_t commands;
+    int type;
+};
+
+static const char *const audit_types[] = { "", "COMMAND", "AUTH", "SESSION", "VIOLATION" };
+
+/**
+ * FNV-1a over a byte range
+ */
+static uint64_t audit_hash(const char *s, size_t n) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * 32-bit hash of a field value as stored in an index entry
+ */
+static uint32_t audit_hash32(const char *s, size_t n) {
+    uint64_t h = audit_hash(s, n);
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+/**
+ * Undo the journal's field escaping (\\, \t, \n, \xHH)
+ */
+static size_t audit_unescape(const char *src, size_t len, char *dst, size_t size) {
+    size_t n = 0;
+
+    for (size_t i = 0; i < len && n + 1 < size; i++) {
+        char c = src[i];
+        if (c == '\\' && i + 1 < len) {
+            char e = src[++i];
+            if (e == 't') {
+                c = '\t';
+            } else if (e == 'n') {
+                c = '\n';
+            } else if (e == 'x' && i + 2 < len) {
+                char hex[3] = { src[i + 1], src[i + 2], '\0' };
+                c = (char)strtol(hex, NULL, 16);
+                i += 2;
+            } else {
+                c = e;
+            }
+        }
+        dst[n++] = c;
+    }
+    dst[n] = '\0';
+    return n;
+}
+
+/**
+ * Find a field's escaped value in a record (len excludes the newline)
+ */
+static const char *audit_field(const char *line, size_t len, const char *name, size_t *vlen) {
+    size_t nlen = strlen(name);
+    const char *p = line;
+    const char *end = line + len;
+
+    while (p < end) {
+        const char *tab = memchr(p, '\t', (size_t)(end - p));
+        const char *stop = tab ? tab : end;
+        if ((size_t)(stop - p) > nlen && memcmp(p, name, nlen) == 0 && p[nlen] == '=') {
+            *vlen = (size_t)(stop - p) - nlen - 1;
+            return p + nlen + 1;
+        }
+        if (!tab) {
+            break;
+        }
+        p = tab + 1;
+    }
+    return NULL;
+}
+
+/**
+ * Check whether a field's unescaped value equals want
+ */
+static int audit_field_equals(const char *line, size_t len, const char *name, const char *want) {
+    char text[AUDIT_MAX_FIELD + 1];
+    size_t vlen;
+    const char *v = audit_field(line, len, name, &vlen);
+
+    if (!v) {
+        return 0;
+    }
+    audit_unescape(v, vlen, text, sizeof(text));
+    return strcmp(text, want) == 0;
+}
+
+/**
+ * Walk the command basenames of a COMMAND message
+ *
+ * Every pipeline stage and list element counts, so "ps aux | grep sshd"
+ * is found by both ps and grep.  Returns the Bloom mask of the basenames
+ * and sets *found when one of them equals want.
+ */
+static uint64_t audit_commands(const char *msg, size_t len, const char *want, int *found) {
+    char text[AUDIT_MAX_RECORD];
+    uint64_t mask = 0;
+    size_t n = audit_unescape(msg, len, text, sizeof(text));
+    const char *p = text;
+    const char *end = text + n;
+
+    if (n >= 10 && strncmp(text, "pipeline: ", 10) == 0) {
+        p += 10;
+    }
+    while (p < end) {
+        while (p < end && (isspace((unsigned char)*p) || *p == '|' || *p == ';' || *p == '&')) {
+            p++;
+        }
+        const char *word = p;
+        while (p < end && !isspace((unsigned char)*p) && *p != '|' && *p != ';' && *p != '&') {
+            p++;
+        }
+        const char *base = word;
+        for (const char *q = word; q < p; q++) {
+            if (*q == '/') {
+                base = q + 1;
+            }
+        }
+        size_t blen = (size_t)(p - base);
+        if (blen > 0) {
+            uint64_t h = audit_hash(base, blen);
+            mask |= (1ULL << (h & 63)) | (1ULL << ((h >> 6) & 63));
+            if (want && found && strlen(want) == blen && memcmp(base, want, blen) == 0) {
+                *found = 1;
+            }
+        }
+        /* Arguments up to the next separator are not commands */
+        while (p < end && *p != '|' && *p != ';' && *p != '&') {
+            p++;
+        }
+    }
+    return mask;
+}
+
+/**
+ * Map a record type name to its index code (0 for anything else)
+ */
+static int audit_type_code(const char *name, size_t len) {
+    for (int i = 1; i < (int)(sizeof(audit_types) / sizeof(audit_types[0])); i++) {
+        if (strlen(audit_types[i]) == len && strncasecmp(audit_types[i], name, len) == 0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Build the index entry for one record (len excludes the newline)
+ */
+static int audit_index_parse(const char *line, size_t len, uint64_t offset, struct audit_index_entry *e) {
+    char text[AUDIT_MAX_FIELD + 1];
+    const char *v;
+    size_t vlen;
+
+    memset(e, 0, sizeof(*e));
+    if (len + 1 > UINT16_MAX || len < 4 || strncmp(line, "seq=", 4) != 0) {
+        return -1;
+    }
+    e->offset = offset;
+    e->length = (uint16_t)(len + 1);
+
+    if ((v = audit_field(line, len, "time", &vlen)) != NULL) {
+        e->when = (uint32_t)strtoul(v, NULL, 10);
+    }
+    if ((v = audit_field(line, len, "type", &vlen)) != NULL) {
+        e->type = (uint8_t)audit_type_code(v, vlen);
+    }
+    if ((v = audit_field(line, len, "user", &vlen)) != NULL) {
+        e->user = audit_hash32(text, audit_unescape(v, vlen, text, sizeof(text)));
+    }
+    if ((v = audit_field(line, len, "host", &vlen)) != NULL) {
+        e->host = audit_hash32(text, audit_unescape(v, vlen, text, sizeof(text)));
+    }
+    if ((v = audit_field(line, len, "status", &vlen)) != NULL && vlen == 6 && strncmp(v, "failed", 6) == 0) {
+        e->flags |= AUDIT_ENTRY_FAILED;
+    }
+    if (e->type == 1 && (v = audit_field(line, len, "msg", &vlen)) != NULL) {
+        e->commands = audit_commands(v, vlen, NULL, NULL);
+    }
+    return 0;
+}
+
+/**
+ * Read the index header, resetting the index if it does not describe the journal
+ */
+static int audit_index_load(int index_fd, int journal_fd, struct audit_index_header *h, uint64_t *journal_size) {
+    struct stat js, is;
+
+    if (fstat(journal_fd, &js) != 0 || fstat(index_fd, &is) != 0) {
+        return -1;
+    }
+    *journal_size = (uint64_t)js.st_size;
+
+    if (pread(index_fd, h, sizeof(*h), 0) != (ssize_t)sizeof(*h) ||
+        h->magic != AUDIT_INDEX_MAGIC || h->version != AUDIT_INDEX_VERSION ||
+        h->dev != (uint64_t)js.st_dev || h->ino != (uint64_t)js.st_ino ||
+        h->covered > (uint64_t)js.st_size ||
+        (uint64_t)is.st_size < AUDIT_INDEX_HEADER + h->entries * sizeof(struct audit_index_entry)) {
+        memset(h, 0, sizeof(*h));
+        h->magic = AUDIT_INDEX_MAGIC;
+        h->version = AUDIT_INDEX_VERSION;
+        h->dev = (uint64_t)js.st_dev;
+        h->ino = (uint64_t)js.st_ino;
+        if (ftruncate(index_fd, AUDIT_INDEX_HEADER) != 0 ||
+            pwrite(index_fd, h, sizeof(*h), 0) != (ssize_t)sizeof(*h)) {
+            return -1;
+        }
+        return 0;
+    }
+
+    /* Entries written after the last header update are redone */
+    off_t expected = (off_t)(AUDIT_INDEX_HEADER + h->entries * sizeof(struct audit_index_entry));
+    if (is.st_size > expected && ftruncate(index_fd, expected) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Index the complete records in buf, which starts at journal offset base
+ */
+static int audit_index_add(int index_fd, struct audit_index_header *h, const char *buf, size_t len, uint64_t base) {
+    struct audit_index_entry batch[AUDIT_INDEX_BATCH];
+    size_t pos = 0;
+    int count = 0;
+
+    for (;;) {
+        const char *nl = pos < len ? memchr(buf + pos, '\n', len - pos) : NULL;
+        if (nl) {
+            size_t line_len = (size_t)(nl - (buf + pos));
+            if (audit_index_parse(buf + pos, line_len, base + pos, &batch[count]) == 0) {
+                if (batch[count].when > h->last_key) {
+                    h->last_key = batch[count].when;
+                }
+                batch[count].key = h->last_key;
+                count++;
+            }
+            pos += line_len + 1;
+        }
+
+        /* An incomplete record at the end is indexed once it is finished */
+        if (count == AUDIT_INDEX_BATCH || !nl) {
+            size_t bytes = (size_t)count * sizeof(batch[0]);
+            off_t at = (off_t)(AUDIT_INDEX_HEADER + h->entries * sizeof(batch[0]));
+            if (count > 0 && pwrite(index_fd, batch, bytes, at) != (ssize_t)bytes) {
+                return -1;
+            }
+            h->entries += (uint64_t)count;
+            h->covered = base + pos;
+            count = 0;
+        }
+        if (!nl) {
+            break;
+        }
+    }
+
+    if (pwrite(index_fd, h, sizeof(*h), 0) != (ssize_t)sizeof(*h)) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Index every complete record between the covered offset and size
+ */
+static int audit_index_catch_up(int index_fd, int journal_fd, struct audit_index_header *h, uint64_t size) {
+    if (h->covered >= size) {
+        return 0;
+    }
+    void *map = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, journal_fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    int rc = audit_index_add(index_fd, h, (const char *)map + h->covered,
+                             (size_t)(size - h->covered), h->covered);
+    munmap(map, (size_t)size);
+    return rc;
+}
+
+/**
+ * Index records just appended to the journal (journal lock held)
+ *
+ * buf holds the bytes written at offset base.  When the index is not
+ * already up to base it is caught up from the journal file instead.
+ */
+int audit_index_extend(int index_fd, int journal_fd, const char *buf, size_t len, uint64_t base) {
+    struct audit_index_header h;
+    uint64_t size;
+
+    if (audit_index_load(index_fd, journal_fd, &h, &size) != 0) {
+        return -1;
+    }
+    if (h.covered == base) {
+        return audit_index_add(index_fd, &h, buf, len, base);
+    }
+    return audit_index_catch_up(index_fd, journal_fd, &h, size);
+}
+
+/**
+ * Check an index entry against the query
+ */
+static int audit_entry_matches(const struct audit_index_entry *e, const struct audit_query *q,
+                               const struct audit_filter *f) {
+    if ((q->since && (time_t)e->when < q->since) || (q->until && (time_t)e->when > q->until)) {
+        return 0;
+    }
+    if ((q->type && e->type != f->type) || (q->failed_only && !(e->flags & AUDIT_ENTRY_FAILED))) {
+        return 0;
+    }
+    if ((q->user && e->user != f->user) || (q->host && e->host != f->host)) {
+        return 0;
+    }
+    return !q->command || (e->commands & f->commands) == f->commands;
+}
+
+/**
+ * Confirm a candidate against the record itself; index hashes can collide
+ */
+static int audit_record_matches(const char *line, size_t len, const struct audit_query *q) {
+    if (q->user && !audit_field_equals(line, len, "user", q->user)) {
+        return 0;
+    }
+    if (q->host && !audit_field_equals(line, len, "host", q->host)) {
+        return 0;
+    }
+    if (q->type && !audit_field_equals(line, len, "type", q->type)) {
+        return 0;
+    }
+    if (q->command) {
+        size_t vlen;
+        int found = 0;
+        const char *msg = audit_field(line, len, "msg", &vlen);
+        if (!msg) {
+            return 0;
+        }
+        audit_commands(msg, vlen, q->command, &found);
+        return found;
+    }
+    return 1;
+}
+
+/**
+ * Report one matching record; returns 1 once the limit is reached
+ */
+static int audit_query_hit(const char *line, size_t len, const struct audit_query *q,
+                           audit_query_emit emit, void *ctx, struct audit_query_stats *stats) {
+    stats->read++;
+    if (!audit_record_matches(line, len, q)) {
+        return 0;
+    }
+    stats->matched++;
+    emit(line, len + 1, ctx);
+    return q->limit && stats->matched >= q->limit;
+}
+
+/**
+ * Search the audit journal
+ *
+ * Uses (and first catches up) the sidecar index when the journal and
+ * index are trusted; otherwise every record is parsed.  emit receives
+ * each matching record including its newline, in journal order.
+ * Returns 0, or -1 if the journal cannot be read.
+ */
+int audit_query_run(const char *path, const struct audit_query *query, audit_query_emit emit,
+                    void *ctx, struct audit_query_stats *stats) {
+    struct audit_index_header h;
+    struct audit_filter filter;
+    char index_path[PATH_MAX];
+    uint64_t size = 0;
+    int index_fd = -1;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!path) {
+        path = audit_log_path() ? audit_log_path() : AUDIT_LOG_FILE;
+    }
+    int journal_fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (journal_fd == -1) {
+        return -1;
+    }
+
+    /* Bring the index up to date under the writers' lock */
+    if (audit_file_trusted(journal_fd)) {
+        snprintf(index_path, sizeof(index_path), "%s.idx", path);
+        index_fd = open(index_path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+        if (index_fd != -1 && audit_file_trusted(index_fd) && flock(journal_fd, LOCK_EX) == 0) {
+            if (audit_index_load(index_fd, journal_fd, &h, &size) != 0 ||
+                audit_index_catch_up(index_fd, journal_fd, &h, size) != 0) {
+                close(index_fd);
+                index_fd = -1;
+            }
+            flock(journal_fd, LOCK_UN);
+        } else if (index_fd != -1) {
+            close(index_fd);
+            index_fd = -1;
+        }
+    }
+
+    memset(&filter, 0, sizeof(filter));
+    if (query->user) {
+        filter.user = audit_hash32(query->user, strlen(query->user));
+    }
+    if (query->host) {
+        filter.host = audit_hash32(query->host, strlen(query->host));
+    }
+    if (query->command) {
+        filter.commands = audit_commands(query->command, strlen(query->command), NULL, NULL);
+    }
+    if (query->type) {
+        filter.type = audit_type_code(query->type, strlen(query->type));
+    }
+
+    if (index_fd == -1) {
+        struct stat st;
+        if (fstat(journal_fd, &st) != 0) {
+            close(journal_fd);
+            return -1;
+        }
+        size = (uint64_t)st.st_size;
+    } else {
+        size = h.covered;
+    }
+    if (size == 0) {
+        if (index_fd != -1) {
+            close(index_fd);
+        }
+        close(journal_fd);
+        stats->indexed = (index_fd != -1);
+        return 0;
+    }
+
+    const char *journal = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, journal_fd, 0);
+    if (journal == MAP_FAILED) {
+        if (index_fd != -1) {
+            close(index_fd);
+        }
+        close(journal_fd);
+        return -1;
+    }
+
+    if (index_fd != -1) {
+        size_t map_size = AUDIT_INDEX_HEADER + (size_t)h.entries * sizeof(struct audit_index_entry);
+        void *map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, index_fd, 0);
+        if (map != MAP_FAILED) {
+            const struct audit_index_entry *entries =
+                (const struct audit_index_entry *)((const char *)map + AUDIT_INDEX_HEADER);
+            uint64_t lo = 0, hi = h.entries;
+
+            /* Keys never decrease, and every record at or after since has key >= since */
+            while (query->since && lo < hi) {
+                uint64_t mid = lo + (hi - lo) / 2;
+                if ((time_t)entries[mid].key < query->since) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            stats->indexed = 1;
+            for (uint64_t i = lo; i < h.entries; i++) {
+                const struct audit_index_entry *e = &entries[i];
+                stats->scanned++;
+                if (!audit_entry_matches(e, query, &filter) || e->offset + e->length > size) {
+                    continue;
+                }
+                if (audit_query_hit(journal + e->offset, (size_t)e->length - 1, query, emit, ctx, stats)) {
+                    break;
+                }
+            }
+            munmap(map, map_size);
+        }
+        close(index_fd);
+    }
+
+    /* No usable index: parse every record */
+    if (!stats->indexed) {
+        struct audit_index_entry e;
+        size_t pos = 0;
+        while (pos < size) {
+            const char *nl = memchr(journal + pos, '\n', (size_t)size - pos);
+            if (!nl) {
+                break;
+            }
+            size_t line_len = (size_t)(nl - (journal + pos));
+            stats->scanned++;
+            if (audit_index_parse(journal + pos, line_len, pos, &e) == 0 &&
+                audit_entry_matches(&e, query, &filter) &&
+                audit_query_hit(journal + pos, line_len, query, emit, ctx, stats)) {
+                break;
+            }
+            pos += line_len + 1;
+        }
+    }
+
+    munmap((void *)journal, (size_t)size);
+    close(journal_fd);
+    return 0;
+}
+
+/**
+ * Parse a time for --since/--until
+ *
+ * Accepts "@EPOCH", a relative age ("90s", "15m", "12h", "7d", "2w") and
+ * local "YYYY-MM-DD[ HH:MM[:SS]]" (a "T" may separate date and time).
+ */
+int parse_audit_time(const char *text, time_t now, time_t *out) {
+    struct tm tm;
+    char *end = NULL;
+    int year, mon, day, hour = 0, min = 0, sec = 0, used = 0;
+
+    if (!text || !*text) {
+        return -1;
+    }
+    if (text[0] == '@') {
+        long long v = strtoll(text + 1, &end, 10);
+        if (end == text + 1 || *end != '\0' || v < 0) {
+            return -1;
+        }
+        *out = (time_t)v;
+        return 0;
+    }
+
+    if (isdigit((unsigned char)text[0])) {
+        long long v = strtoll(text, &end, 10);
+        if (end != text && end[0] != '\0' && end[1] == '\0' && strchr("smhdw", end[0])) {
+            long long unit = end[0] == 's' ? 1 : end[0] == 'm' ? 60 : end[0] == 'h' ? 3600 :
+                             end[0] == 'd' ? 86400 : 604800;
+            *out = now - (time_t)(v * unit);
+            return 0;
+        }
+    }
+
+    if (sscanf(text, "%4d-%2d-%2d%n", &year, &mon, &day, &used) != 3) {
+        return -1;
+    }
+    const char *rest = text + used;
+    if (*rest == ' ' || *rest == 'T') {
+        if (sscanf(rest + 1, "%2d:%2d%n", &hour, &min, &used) != 2) {
+            return -1;
+        }
+        rest += 1 + used;
+        if (*rest == ':') {
+            if (sscanf(rest + 1, "%2d%n", &sec, &used) != 1) {
+                return -1;
+            }
+            rest += 1 + used;
+        }
+    }
+    if (*rest != '\0' || mon < 1 || mon > 12 || day < 1 || day > 31 ||
+        hour > 23 || min > 59 || sec > 60) {
+        return -1;
+    }
+
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = year - 1900;
+    tm.tm_mon = mon - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = min;
+    tm.tm_sec = sec;
+    tm.tm_isdst = -1;
+    time_t t = mktime(&tm);
+    if (t == (time_t)-1) {
+        return -1;
+    }
+    *out = t;
+    return 0;
+}
+
+/**
+ * Print a field of a record, or "-" if it is missing
+ */
+static void print_audit_field(const char *line, size_t len, const char *name, const char *suffix) {
+    size_t vlen;
+    const char *v = audit_field(line, len, name, &vlen);
+
+    if (v) {
+        fwrite(v, 1, vlen, stdout);
+    } else {
+        fputc('-', stdout);
+    }
+    fputs(suffix, stdout);
+}
+
+/**
+ * Print one search result; fields stay escaped so output is terminal-safe
+ */
+static void print_audit_record(const char *record, size_t len, void *ctx) {
+    int raw = *(const int *)ctx;
+    char stamp[32] = "-";
+    size_t vlen;
+    struct tm tm;
+
+    if (raw) {
+        fwrite(record, 1, len, stdout);
+        return;
+    }
+    len--;
+    const char *when = audit_field(record, len, "time", &vlen);
+    if (when) {
+        time_t t = (time_t)strtoll(when, NULL, 10);
+        if (localtime_r(&t, &tm)) {
+            strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+        }
+    }
+    printf("%s ", stamp);
+    print_audit_field(record, len, "type", " ");
+    print_audit_field(record, len, "host", " ");
+    print_audit_field(record, len, "user", "->");
+    print_audit_field(record, len, "runas", " ");
+    print_audit_field(record, len, "tty", " [");
+    print_audit_field(record, len, "status", "] ");
+    print_audit_field(record, len, "msg", "\n");
+}
+
+/**
+ * Print sudosh-audit usage
+ */
+static void print_audit_query_usage(FILE *out) {
+    fprintf(out, "Usage: sudosh-audit query [options]\n\n");
+    fprintf(out, "Search the sudosh audit journal using its index.\n\n");
+    fprintf(out, "Options:\n");
+    fprintf(out, "  --user USER         records for this user\n");
+    fprintf(out, "  --host HOST         records from this host\n");
+    fprintf(out, "  --cmd NAME          command lines running NAME (any pipeline or list element)\n");
+    fprintf(out, "  --type TYPE         COMMAND, AUTH, SESSION or VIOLATION\n");
+    fprintf(out, "  --since TIME        at or after TIME (@EPOCH, 15m, 12h, 7d, 2w or YYYY-MM-DD[ HH:MM[:SS]])\n");
+    fprintf(out, "  --until TIME        at or before TIME\n");
+    fprintf(out, "  --failed            failed commands and authentications only\n");
+    fprintf(out, "  --limit N           stop after N records\n");
+    fprintf(out, "  --file PATH         search PATH instead of %s\n", AUDIT_LOG_FILE);
+    fprintf(out, "  --raw               print journal records unchanged\n");
+    fprintf(out, "  --stats             report how much of the index and journal was read\n");
+}
+
+/**
+ * Implement "sudosh-audit query ..." (root only)
+ */
+int audit_query_command(int argc, char *argv[]) {
+    extern int test_mode;
+    struct audit_query query;
+    struct audit_query_stats stats;
+    const char *path = NULL;
+    int raw = 0, show_stats = 0;
+    time_t now = time(NULL);
+
+    if (!test_mode && getuid() != 0) {
+        fprintf(stderr, "sudosh-audit: only root may search the audit journal\n");
+        syslog(LOG_WARNING, "AUDIT_QUERY_DENIED: uid=%d", (int)getuid());
+        return EXIT_FAILURE;
+    }
+    if (argc < 2 || strcmp(argv[1], "query") != 0) {
+        if (argc >= 2 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0)) {
+            print_audit_query_usage(stdout);
+            return EXIT_SUCCESS;
+        }
+        print_audit_query_usage(stderr);
+        return EXIT_FAILURE;
+    }
+
+    memset(&query, 0, sizeof(query));
+    for (int i = 2; i < argc; i++) {
+        const char *opt = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(opt, "--failed") == 0) {
+            query.failed_only = 1;
+            continue;
+        } else if (strcmp(opt, "--raw") == 0) {
+            raw = 1;
+            continue;
+        } else if (strcmp(opt, "--stats") == 0) {
+            show_stats = 1;
+            continue;
+        } else if (strcmp(opt, "--help") == 0 || strcmp(opt, "-h") == 0) {
+            print_audit_query_usage(stdout);
+            return EXIT_SUCCESS;
+        }
+
+        if (!value) {
+            fprintf(stderr, "sudosh-audit: option '%s' requires an argument\n", opt);
+            return EXIT_FAILURE;
+        }
+        i++;
+        if (strcmp(opt, "--user") == 0) {
+            query.user = value;
+        } else if (strcmp(opt, "--host") == 0) {
+            query.host = value;
+        } else if (strcmp(opt, "--cmd") == 0) {
+            const char *slash = strrchr(value, '/');
+            query.command = slash ? slash + 1 : value;
+        } else if (strcmp(opt, "--type") == 0) {
+            int code = audit_type_code(value, strlen(value));
+            if (!code) {
+                fprintf(stderr, "sudosh-audit: unknown record type '%s'\n", value);
+                return EXIT_FAILURE;
+            }
+            query.type = audit_types[code];
+        } else if (strcmp(opt, "--since") == 0 || strcmp(opt, "--until") == 0) {
+            time_t *target = (opt[2] == 's') ? &query.since : &query.until;
+            if (parse_audit_time(value, now, target) != 0) {
+                fprintf(stderr, "sudosh-audit: invalid time '%s'\n", value);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(opt, "--limit") == 0) {
+            char *end = NULL;
+            query.limit = strtoul(value, &end, 10);
+            if (!end || *end != '\0' || query.limit == 0) {
+                fprintf(stderr, "sudosh-audit: invalid limit '%s'\n", value);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(opt, "--file") == 0) {
+            path = value;
+        } else {
+            fprintf(stderr, "sudosh-audit: unknown option '%s'\n", opt);
+            print_audit_query_usage(stderr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    syslog(LOG_INFO, "AUDIT_QUERY: uid=%d user=%s host=%s cmd=%s type=%s", (int)getuid(),
+           query.user ? query.user : "*", query.host ? query.host : "*",
+           query.command ? query.command : "*", query.type ? query.type : "*");
+
+    long long started = monotonic_usec();
+    if (audit_query_run(path, &query, print_audit_record, &raw, &stats) != 0) {
+        fprintf(stderr, "sudosh-audit: cannot read audit journal %s: %s\n",
+                path ? path : AUDIT_LOG_FILE, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (show_stats) {
+        fprintf(stderr, "%llu matching records; %llu %s scanned, %llu records read in %.3f ms\n",
+                stats.matched, stats.scanned, stats.indexed ? "index entries" : "records (no index)",
+                stats.read, (double)(monotonic_usec() - started) / 1000.0);
+    }
+    return EXIT_SUCCESS;
+}
@@ -253,6 +253,19 @@ char *get_password(const char *prompt) {
     return password;
 }
 
+/**
+ * Directory holding authentication caches (SUDOSH_AUTH_CACHE_DIR may move it in test mode)
+ */
+static const char *auth_cache_dir(void) {
+    extern int test_mode;
+    const char *override = getenv("SUDOSH_AUTH_CACHE_DIR");
+
+    if (test_mode && override && *override) {
+        return override;
+    }
+    return AUTH_CACHE_DIR;
+}
+
 /**
  * Create authentication cache directory if it doesn't exist
  */
@@ -260,12 +273,12 @@ int create_auth_cache_dir(void) {
     struct stat st;
 
     /* Check if directory exists */
-    if (stat(AUTH_CACHE_DIR, &st) == 0) {
+    if (stat(auth_cache_dir(), &st) == 0) {
         if (S_ISDIR(st.st_mode)) {
             /* Directory exists, check permissions */
             if ((st.st_mode & 0777) != 0700) {
                 /* Fix permissions */
-                if (chmod(AUTH_CACHE_DIR, 0700) != 0) {
+                if (chmod(auth_cache_dir(), 0700) != 0) {
                     return 0;
                 }
             }
@@ -277,7 +290,7 @@ int create_auth_cache_dir(void) {
     }
 
     /* Create directory with secure permissions */
-    if (mkdir(AUTH_CACHE_DIR, 0700) != 0) {
+    if (mkdir(auth_cache_dir(), 0700) != 0) {
         return 0;
     }
 
@@ -323,20 +336,24 @@ char *get_auth_cache_path(const char *username) {
 
     /* Create cache file path: /var/run/sudosh/auth_cache_username_tty */
     snprintf(cache_path, MAX_CACHE_PATH_LENGTH, "%s/%s%s_%s",
-             AUTH_CACHE_DIR, AUTH_CACHE_FILE_PREFIX, username, tty_safe);
+             auth_cache_dir(), AUTH_CACHE_FILE_PREFIX, username, tty_safe);
 
     return cache_path;
 }
 
 /**
  * Check if authentication is cached and still valid
+ *
+ * Readers take no lock: writers replace the cache file with rename(), so
+ * an open descriptor always sees one complete record, and concurrent
+ * sessions checking the same cache never turn each other's hits into misses.
  */
 int check_auth_cache(const char *username) {
     char *cache_path;
-    FILE *cache_file;
     struct auth_cache cache_data;
     time_t current_time;
     struct stat st;
+    int fd;
 
     if (!username) {
         return 0;
@@ -347,82 +364,63 @@ int check_auth_cache(const char *username) {
         return 0;
     }
 
-    /* Check if cache file exists and get its stats */
-    if (stat(cache_path, &st) != 0) {
-        free(cache_path);
-        return 0;
-    }
-
-    /* Check file permissions for security */
-    if ((st.st_mode & 0777) != 0600) {
-        /* Invalid permissions, remove file */
-        unlink(cache_path);
+    fd = open(cache_path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1) {
         free(cache_path);
         return 0;
     }
 
-    /* Check if file is owned by root */
-    if (st.st_uid != 0) {
-        /* Invalid ownership, remove file */
+    /* Check the file we opened, not whatever the path names now */
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        (st.st_mode & 0777) != 0600 || st.st_uid != 0) {
+        /* Invalid type, permissions or ownership, remove file */
+        close(fd);
         unlink(cache_path);
         free(cache_path);
         return 0;
     }
 
-    cache_file = fopen(cache_path, "rb");
-    if (!cache_file) {
-        free(cache_path);
-        return 0;
-    }
-
-    /* Lock file for exclusive access to prevent race conditions */
-    if (flock(fileno(cache_file), LOCK_EX | LOCK_NB) != 0) {
-        /* File is locked by another process, treat as invalid */
-        fclose(cache_file);
-        free(cache_path);
-        return 0;
-    }
-
     /* Read cache data */
-    if (fread(&cache_data, sizeof(cache_data), 1, cache_file) != 1) {
-        flock(fileno(cache_file), LOCK_UN);
-        fclose(cache_file);
+    if (pread(fd, &cache_data, sizeof(cache_data), 0) != (ssize_t)sizeof(cache_data)) {
+        close(fd);
         free(cache_path);
         return 0;
     }
-
-    /* Unlock and close file */
-    flock(fileno(cache_file), LOCK_UN);
-    fclose(cache_file);
-    free(cache_path);
+    close(fd);
+    cache_data.username[sizeof(cache_data.username) - 1] = '\0';
 
     /* Verify username matches */
     if (strcmp(cache_data.username, username) != 0) {
+        free(cache_path);
         return 0;
     }
 
     /* Check if cache has expired */
     current_time = time(NULL);
     if (current_time - cache_data.timestamp > AUTH_CACHE_TIMEOUT) {
-        /* Cache expired, remove it */
-        cache_path = get_auth_cache_path(username);
-        if (cache_path) {
+        /* Cache expired, remove it unless another session has just replaced it */
+        struct stat now;
+        if (lstat(cache_path, &now) == 0 && now.st_dev == st.st_dev && now.st_ino == st.st_ino) {
             unlink(cache_path);
-            free(cache_path);
         }
+        free(cache_path);
         return 0;
     }
 
     /* Cache is valid */
+    free(cache_path);
     return 1;
 }
 
 /**
  * Update authentication cache with current session info
+ *
+ * The record is written to a private temporary file and renamed over the
+ * cache, so readers never see a partial record and no lock is needed.
  */
 int update_auth_cache(const char *username) {
     char *cache_path;
-    FILE *cache_file;
+    char temp_path[MAX_CACHE_PATH_LENGTH + 32];
     struct auth_cache cache_data;
     char *tty;
 
@@ -462,50 +460,31 @@ int update_auth_cache(const char *username) {
     /* Get hostname */
     get_hostname_or_localhost(cache_data.hostname, sizeof(cache_data.hostname));
 
-    /* Create cache file with secure permissions atomically */
-    int fd = open(cache_path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    /* Create the temporary file with secure permissions atomically */
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp.%d", cache_path, (int)getpid());
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
     if (fd == -1) {
-        /* File already exists or creation failed */
         free(cache_path);
         return 0;
     }
 
-    /* Lock file for exclusive access */
-    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+    /* Write and sync the record, then publish it */
+    if (write(fd, &cache_data, sizeof(cache_data)) != (ssize_t)sizeof(cache_data) ||
+        fsync(fd) != 0) {
         close(fd);
-        unlink(cache_path);
+        unlink(temp_path);
         free(cache_path);
         return 0;
     }
+    close(fd);
 
-    /* Convert to FILE* for easier writing */
-    cache_file = fdopen(fd, "wb");
-    if (!cache_file) {
-        flock(fd, LOCK_UN);
-        close(fd);
-        unlink(cache_path);
-        free(cache_path);
-        return 0;
-    }
-
-    /* Write cache data */
-    if (fwrite(&cache_data, sizeof(cache_data), 1, cache_file) != 1) {
-        flock(fileno(cache_file), LOCK_UN);
-        fclose(cache_file);
-        unlink(cache_path);
+    if (rename(temp_path, cache_path) != 0) {
+        unlink(temp_path);
         free(cache_path);
         return 0;
     }
 
-    /* Sync to disk before unlocking */
-    fflush(cache_file);
-    fsync(fileno(cache_file));
-
-    /* Unlock and close file */
-    flock(fileno(cache_file), LOCK_UN);
-    fclose(cache_file);
     free(cache_path);
-
     return 1;
 }
 
@@ -526,8 +505,34 @@ void clear_auth_cache(const char *username) {
     }
 }
 
+/**
+ * Claim the next cache directory sweep: true at most once per
+ * AUTH_CACHE_SWEEP_INTERVAL across all sessions, judged by a stamp file's mtime
+ */
+static int auth_cache_sweep_due(time_t current_time) {
+    char stamp_path[MAX_CACHE_PATH_LENGTH];
+    struct stat st;
+
+    snprintf(stamp_path, sizeof(stamp_path), "%s/%s", auth_cache_dir(), AUTH_CACHE_SWEEP_STAMP);
+    if (lstat(stamp_path, &st) == 0 && S_ISREG(st.st_mode) &&
+        current_time - st.st_mtime < AUTH_CACHE_SWEEP_INTERVAL &&
+        st.st_mtime <= current_time) {
+        return 0;
+    }
+
+    int fd = open(stamp_path, O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd != -1) {
+        futimens(fd, NULL);
+        close(fd);
+    }
+    return 1;
+}
+
 /**
  * Cleanup old authentication cache files
+ *
+ * Every session calls this on exit; the directory is only scanned when
+ * no session has done so within AUTH_CACHE_SWEEP_INTERVAL.
  */
 void cleanup_auth_cache(void) {
     DIR *cache_dir;
@@ -536,12 +541,15 @@ void cleanup_auth_cache(void) {
     struct stat st;
     time_t current_time;
 
-    cache_dir = opendir(AUTH_CACHE_DIR);
-    if (!cache_dir) {
+    current_time = time(NULL);
+    if (!auth_cache_sweep_due(current_time)) {
         return;
     }
 
-    current_time = time(NULL);
+    cache_dir = opendir(auth_cache_dir());
+    if (!cache_dir) {
+        return;
+    }
 
     while ((entry = readdir(cache_dir)) != NULL) {
         /* Skip . and .. */
@@ -554,7 +562,7 @@ void cleanup_auth_cache(void) {
             continue;
         }
 
-        snprintf(file_path, sizeof(file_path), "%s/%s", AUTH_CACHE_DIR, entry->d_name);
+        snprintf(file_path, sizeof(file_path), "%s/%s", auth_cache_dir(), entry->d_name);
 
         if (stat(file_path, &st) == 0) {
             /* Remove files older than cache timeout */
@@ -600,7 +608,7 @@ int authenticate_user_cached(const char *username) {
 /**
  * Authenticate user using PAM or mock authentication with enhanced security
  */
-int authenticate_user(const char *username) {
+static int authenticate_user_backend(const char *username) {
     /* Enhanced input validation */
     if (!username || strlen(username) == 0) {
         log_security_violation("unknown", "authentication attempted with empty username");
@@ -698,6 +706,8 @@ int authenticate_user(const char *username) {
         return 0;
     }
 
+    session_stats_auth_prompt();
+
 #ifdef MOCK_AUTH
     /* Use mock authentication for systems without PAM */
     int result = mock_authenticate(username);
@@ -751,6 +761,16 @@ int authenticate_user(const char *username) {
 #endif
 }
 
+/**
+ * Authenticate user (traced by the auth__start/auth__done probes)
+ */
+int authenticate_user(const char *username) {
+    SUDOSH_PROBE1(auth__start, username);
+    int result = authenticate_user_backend(username);
+    SUDOSH_PROBE2(auth__done, username, result);
+    return result;
+}
+
 /**
  * Enhanced sudo privilege checking using NSS, sudoers parsing, and SSSD (no sudo dependency)
  */
@@ -1036,9 +1056,9 @@ int check_nopasswd_sudo_l(const char *username) {
 }
 
 /**
- * Check if user is allowed to run a specific command according to sudo configuration (no sudo dependency)
+ * Check command permission against test rules, sudoers and SSSD
  */
-int check_command_permission(const char *username, const char *command) {
+static int check_command_permission_policy(const char *username, const char *command) {
     /* Check for NULL or empty parameters */
     if (!username || *username == '\0' || !command || *command == '\0') {
         return 0;
@@ -1100,6 +1120,18 @@ int check_command_permission(const char *username, const char *command) {
     return is_allowed;
 }
 
+/**
+ * Check if user is allowed to run a specific command according to sudo configuration (no sudo dependency)
+ */
+int check_command_permission(const char *username, const char *command) {
+    SUDOSH_PROBE2(permission__check__start, username, command);
+    long long started = monotonic_usec();
+    int allowed = check_command_permission_policy(username, command);
+    session_stats_latency(SESSION_LATENCY_PERMISSION, monotonic_usec() - started);
+    SUDOSH_PROBE3(permission__check__done, username, command, allowed);
+    return allowed;
+}
+
 /**
  * Fallback command permission checking (safe version without sudo calls)
  */
@@ -9,6 +9,13 @@
 
 #include "sudosh.h"
 
+#include <fnmatch.h>
+#include <sys/mman.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
 /**
  * Expand = expressions in command arguments (like zsh)
  */
@@ -60,6 +67,329 @@ char *expand_equals_expression(const char *arg) {
     return result ? result : safe_strdup(arg);
 }
 
+/* Directory listing read once per command for glob expansion */
+struct glob_dir_listing {
+    char *dir;
+    char **names;
+    int count;
+};
+
+/* Glob pattern split into directory and compiled last component */
+struct glob_pattern {
+    char *dir;              /* Directory to scan */
+    char *result_prefix;    /* Directory as written, prepended to matches */
+    const char *name;       /* Pattern for the last path component */
+    size_t literal_len;     /* Characters before the first metacharacter */
+    int match_hidden;       /* Pattern names a dotfile explicitly */
+};
+
+/* Per-command expansion state */
+struct glob_expansion {
+    struct glob_dir_listing dirs[MAX_GLOB_CACHED_DIRS];
+    int num_dirs;
+    int total_args;
+    size_t total_bytes;
+};
+
+/**
+ * Check if a token is a glob pattern sudosh can expand
+ *
+ * Only the last path component may contain metacharacters; tokens with
+ * quotes or escapes are passed through literally.
+ */
+static int is_glob_token(const char *token) {
+    if (!token || strpbrk(token, "\"'\\")) {
+        return 0;
+    }
+
+    const char *meta = strpbrk(token, "*?[");
+    if (!meta) {
+        return 0;
+    }
+
+    const char *last_slash = strrchr(token, '/');
+    return !last_slash || meta > last_slash;
+}
+
+/**
+ * Compile a glob token into directory, result prefix and name pattern
+ */
+static int compile_glob_pattern(const char *token, struct glob_pattern *pattern) {
+    memset(pattern, 0, sizeof(*pattern));
+
+    const char *last_slash = strrchr(token, '/');
+    if (last_slash) {
+        size_t dir_len = (size_t)(last_slash - token);
+        pattern->dir = dir_len ? strndup(token, dir_len) : safe_strdup("/");
+        pattern->result_prefix = strndup(token, dir_len + 1);
+        pattern->name = last_slash + 1;
+    } else {
+        pattern->dir = safe_strdup(".");
+        pattern->result_prefix = safe_strdup("");
+        pattern->name = token;
+    }
+
+    if (!pattern->dir || !pattern->result_prefix) {
+        free(pattern->dir);
+        free(pattern->result_prefix);
+        return -1;
+    }
+
+    pattern->literal_len = strcspn(pattern->name, "*?[");
+    pattern->match_hidden = (pattern->name[0] == '.');
+    return 0;
+}
+
+/**
+ * Get the cached listing of a directory, reading it on first use
+ */
+static struct glob_dir_listing *get_glob_dir_listing(struct glob_expansion *state, const char *dir) {
+    for (int i = 0; i < state->num_dirs; i++) {
+        if (strcmp(state->dirs[i].dir, dir) == 0) {
+            return &state->dirs[i];
+        }
+    }
+
+    if (state->num_dirs >= MAX_GLOB_CACHED_DIRS) {
+        return NULL;
+    }
+
+    DIR *d = opendir(dir);
+    if (!d) {
+        return NULL;
+    }
+
+    struct glob_dir_listing *listing = &state->dirs[state->num_dirs];
+    int capacity = 64;
+    listing->dir = safe_strdup(dir);
+    listing->names = malloc(capacity * sizeof(char *));
+    listing->count = 0;
+    if (!listing->dir || !listing->names) {
+        free(listing->dir);
+        free(listing->names);
+        closedir(d);
+        return NULL;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (listing->count >= capacity) {
+            capacity *= 2;
+            char **grown = realloc(listing->names, capacity * sizeof(char *));
+            if (!grown) {
+                break;
+            }
+            listing->names = grown;
+        }
+        listing->names[listing->count] = safe_strdup(entry->d_name);
+        if (listing->names[listing->count]) {
+            listing->count++;
+        }
+    }
+    closedir(d);
+
+    state->num_dirs++;
+    return listing;
+}
+
+/**
+ * Release the directory listings cached for one command
+ */
+static void free_glob_expansion(struct glob_expansion *state) {
+    for (int i = 0; i < state->num_dirs; i++) {
+        for (int j = 0; j < state->dirs[i].count; j++) {
+            free(state->dirs[i].names[j]);
+        }
+        free(state->dirs[i].names);
+        free(state->dirs[i].dir);
+    }
+    state->num_dirs = 0;
+}
+
+/**
+ * qsort comparator for expanded names
+ */
+static int compare_glob_matches(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * Expand one glob token into sorted matches
+ *
+ * Returns the number of matches (0 keeps the token literal), or -1 when
+ * the expansion would exceed the argument caps.
+ */
+static int expand_glob_token(struct glob_expansion *state, const char *token, char ***matches) {
+    struct glob_pattern pattern;
+    *matches = NULL;
+
+    if (compile_glob_pattern(token, &pattern) != 0) {
+        return 0;
+    }
+
+    struct glob_dir_listing *listing = get_glob_dir_listing(state, pattern.dir);
+    int found = 0;
+    char **result = NULL;
+
+    if (listing && listing->count > 0) {
+        result = malloc(listing->count * sizeof(char *));
+    }
+
+    for (int i = 0; result && i < listing->count; i++) {
+        const char *name = listing->names[i];
+
+        if (name[0] == '.' && !pattern.match_hidden) {
+            continue;
+        }
+        if (strncmp(name, pattern.name, pattern.literal_len) != 0) {
+            continue;
+        }
+        if (fnmatch(pattern.name, name, FNM_PERIOD) != 0) {
+            continue;
+        }
+
+        size_t len = strlen(pattern.result_prefix) + strlen(name) + 1;
+        if (state->total_args + found + 1 > MAX_GLOB_EXPANSION_ARGS ||
+            state->total_bytes + len > MAX_GLOB_EXPANSION_BYTES) {
+            fprintf(stderr, "sudosh: %s: glob expansion exceeds %d arguments or %d bytes\n",
+                    token, MAX_GLOB_EXPANSION_ARGS, MAX_GLOB_EXPANSION_BYTES);
+            for (int j = 0; j < found; j++) {
+                free(result[j]);
+            }
+            free(result);
+            free(pattern.dir);
+            free(pattern.result_prefix);
+            return -1;
+        }
+
+        result[found] = malloc(len);
+        if (!result[found]) {
+            break;
+        }
+        snprintf(result[found], len, "%s%s", pattern.result_prefix, name);
+        state->total_bytes += len;
+        found++;
+    }
+
+    free(pattern.dir);
+    free(pattern.result_prefix);
+
+    if (found == 0) {
+        free(result);
+        return 0;
+    }
+
+    qsort(result, found, sizeof(char *), compare_glob_matches);
+    state->total_args += found;
+    *matches = result;
+    return found;
+}
+
+/**
+ * Expand glob patterns in a parsed command's arguments
+ *
+ * sudosh executes without a shell, so '*', '?' and '[...]' in arguments
+ * are expanded here.  Patterns without matches stay literal.  Arguments
+ * produced by expansion are flagged in cmd->glob_matched so they can be
+ * validated individually before execution.
+ */
+int expand_command_globs(struct command_info *cmd) {
+    if (!cmd || !cmd->argv || cmd->argc < 2) {
+        return 0;
+    }
+
+    int has_glob = 0;
+    for (int i = 1; i < cmd->argc; i++) {
+        if (is_glob_token(cmd->argv[i])) {
+            has_glob = 1;
+            break;
+        }
+    }
+    if (!has_glob) {
+        return 0;
+    }
+
+    struct glob_expansion state;
+    memset(&state, 0, sizeof(state));
+
+    int new_size = cmd->argc + 1;
+    int new_argc = 0;
+    char **new_argv = malloc(new_size * sizeof(char *));
+    unsigned char *matched = calloc(new_size, 1);
+    if (!new_argv || !matched) {
+        free(new_argv);
+        free(matched);
+        return -1;
+    }
+
+    for (int i = 0; i < cmd->argc; i++) {
+        char **matches = NULL;
+        int count = (i > 0 && is_glob_token(cmd->argv[i])) ?
+                    expand_glob_token(&state, cmd->argv[i], &matches) : 0;
+
+        if (count < 0) {
+            for (int j = 0; j < new_argc; j++) {
+                if (matched[j]) free(new_argv[j]);
+            }
+            free(new_argv);
+            free(matched);
+            free_glob_expansion(&state);
+            return -1;
+        }
+
+        if (count > 0) {
+            int needed = new_argc + count + (cmd->argc - i);
+            if (needed > new_size) {
+                char **grown_argv = realloc(new_argv, needed * sizeof(char *));
+                unsigned char *grown_matched = grown_argv ? realloc(matched, needed) : NULL;
+                if (grown_argv) new_argv = grown_argv;
+                if (grown_matched) matched = grown_matched;
+                if (!grown_argv || !grown_matched) {
+                    for (int j = 0; j < count; j++) free(matches[j]);
+                    free(matches);
+                    for (int j = 0; j < new_argc; j++) {
+                        if (matched[j]) free(new_argv[j]);
+                    }
+                    free(new_argv);
+                    free(matched);
+                    free_glob_expansion(&state);
+                    return -1;
+                }
+                new_size = needed;
+            }
+            for (int j = 0; j < count; j++) {
+                new_argv[new_argc] = matches[j];
+                matched[new_argc] = 1;
+                new_argc++;
+            }
+            free(matches);
+            free(cmd->argv[i]);
+            cmd->argv[i] = NULL;
+        } else {
+            new_argv[new_argc] = cmd->argv[i];
+            matched[new_argc] = 0;
+            new_argc++;
+        }
+    }
+    new_argv[new_argc] = NULL;
+
+    free_glob_expansion(&state);
+    free(cmd->argv);
+    cmd->argv = new_argv;
+    cmd->argc = new_argc;
+
+    /* Only keep the flags when something was actually expanded */
+    if (memchr(matched, 1, new_argc)) {
+        cmd->glob_matched = matched;
+    } else {
+        free(matched);
+    }
+    return 0;
+}
+
 /**
  * Parse command line input into command structure with shell syntax awareness
  */
@@ -107,6 +437,13 @@ int parse_command(const char *input, struct command_info *cmd) {
     cmd->argv[argc] = NULL;
     cmd->argc = argc;
 
+    /* Expand glob patterns in place of a shell */
+    if (expand_command_globs(cmd) != 0) {
+        free_command_info(cmd);
+        free(input_copy);
+        return -1;
+    }
+
     /* Store the full command */
     cmd->command = safe_strdup(input);
     if (!cmd->command) {
@@ -204,17 +541,23 @@ int validate_ansible_command(const char *command, const char *username) {
 /**
  * Execute command with elevated privileges
  */
-int execute_command(struct command_info *cmd, struct user_info *user) {
+static int launch_command(struct command_info *cmd, struct user_info *user) {
     (void)user;  /* Suppress unused parameter warning */
     pid_t pid;
     int status;
     char *command_path;
-    struct passwd *target_pwd = NULL;
+    const struct target_credentials *target_cred = NULL;
+    long long entered_us = monotonic_usec();
 
     if (!cmd || !cmd->argv || !cmd->argv[0]) {
         return -1;
     }
 
+    /* Arguments produced by glob expansion get the same checks as typed ones */
+    if (!validate_glob_expansion(cmd)) {
+        return -1;
+    }
+
     /* Validate command for Ansible sessions */
     if (!validate_ansible_command(cmd->argv[0], getenv("USER"))) {
         fprintf(stderr, "Error: Command not authorized for Ansible session\n");
@@ -222,17 +565,25 @@ int execute_command(struct command_info *cmd, struct user_info *user) {
         return -1;
     }
 
-    /* Get target user info if target user is specified */
+    /* Target identity is resolved once per session and reused */
     if (target_user) {
-        target_pwd = getpwnam(target_user);
-        if (!target_pwd) {
+        target_cred = get_target_credentials(target_user);
+        if (!target_cred) {
             fprintf(stderr, "sudosh: target user '%s' not found\n", target_user);
             return -1;
         }
     }
 
+    /* Secure editors launch from a template prepared once per session */
+    const struct editor_template *editor = get_editor_template(cmd->argv[0]);
+
     /* Find the command in PATH if it's not an absolute path */
-    if (cmd->argv[0][0] != '/') {
+    if (editor) {
+        command_path = safe_strdup(editor->binary_path);
+        if (!command_path) {
+            return -1;
+        }
+    } else if (cmd->argv[0][0] != '/') {
         command_path = find_command_in_path(cmd->argv[0]);
         if (!command_path) {
             fprintf(stderr, "sudosh: %s: command not found\n", cmd->argv[0]);
@@ -245,21 +596,49 @@ int execute_command(struct command_info *cmd, struct user_info *user) {
         }
     }
 
-    /* Check if command exists and is executable */
-    if (access(command_path, X_OK) != 0) {
-        fprintf(stderr, "sudosh: %s: permission denied or not found\n", command_path);
+    /* Open the binary once; it is checked and executed through this descriptor */
+    struct verified_binary binary;
+    if (open_verified_binary(command_path, target_cred, &binary) != 0) {
+        if (binary.reason) {
+            char log_msg[512];
+            fprintf(stderr, "sudosh: %s: refusing to execute: %s\n", command_path, binary.reason);
+            snprintf(log_msg, sizeof(log_msg), "refused to execute %s: %s", command_path, binary.reason);
+            log_security_violation(user->username, log_msg);
+        } else {
+            fprintf(stderr, "sudosh: %s: permission denied or not found\n", command_path);
+        }
+        free(command_path);
+        return EXIT_COMMAND_NOT_FOUND;
+    }
+
+    /* Binaries pinned with sha256: in sudoers must match their digest */
+    if (enforce_command_digest(user->username, &binary) != 0) {
+        close_verified_binary(&binary);
         free(command_path);
         return EXIT_COMMAND_NOT_FOUND;
     }
 
+    /*
+     * Bare less/more on a file are served by the built-in pager, once the
+     * pager binary itself has passed the checks above.  It is never chosen
+     * for an unprivileged target user, so opening the file here reads it
+     * with the access the external pager would have had.
+     */
+    if (should_use_builtin_pager(cmd, 0)) {
+        close_verified_binary(&binary);
+        free(command_path);
+        return page_file(cmd->argv[1]) == 0 ? 0 : 1;
+    }
+
     /* Handle file locking for editing commands before forking */
     char *file_to_edit = NULL;
     int file_lock_acquired = 0;
-    if (is_editing_command(cmd->command)) {
+    if (editor || is_editing_command(cmd->command)) {
         /* Check if file locking system is available */
-        if (!is_file_locking_available()) {
+        if (editor ? !editor->file_locking_available : !is_file_locking_available()) {
             fprintf(stderr, "sudosh: warning: file locking unavailable for editing command\n");
             fprintf(stderr, "sudosh: cannot ensure exclusive file access\n");
+            close_verified_binary(&binary);
             free(command_path);
             return -1;
         }
@@ -271,7 +650,7 @@ int execute_command(struct command_info *cmd, struct user_info *user) {
             } else {
                 /* Lock acquisition failed - for secure editors, continue anyway */
                 /* This ensures secure editors work even if file locking has issues */
-                if (is_secure_editor(cmd->command)) {
+                if (editor || is_secure_editor(cmd->command)) {
                     char log_msg[512];
                     snprintf(log_msg, sizeof(log_msg),
                             "file lock failed for secure editor, proceeding anyway: %s", cmd->command);
@@ -280,6 +659,7 @@ int execute_command(struct command_info *cmd, struct user_info *user) {
                 } else {
                     /* For non-secure editors, block execution on lock failure */
                     free(file_to_edit);
+                    close_verified_binary(&binary);
                     free(command_path);
                     return -1;
                 }
@@ -289,8 +669,10 @@ int execute_command(struct command_info *cmd, struct user_info *user) {
 
     /* Fork and execute */
     pid = fork();
+    long long child_start_us = monotonic_usec();
     if (pid == -1) {
         perror("fork");
+        close_verified_binary(&binary);
         free(command_path);
         return -1;
     }
@@ -317,66 +699,50 @@ int execute_command(struct command_info *cmd, struct user_info *user) {
         }
 
         for (int fd = 3; fd < max_fd; fd++) {
-            close(fd);
+            if (fd != binary.fd) {
+                close(fd);
+            }
         }
 
         /* Set up environment */
-        if (cmd->envp) {
-            environ = cmd->envp;
-        }
+        if (editor) {
+            /* Prepared secure editor environment, unless the command carries its own */
+            environ = cmd->envp ? build_secure_editor_envp(cmd->envp) : editor->envp;
+            if (!environ) {
+                fprintf(stderr, "sudosh: cannot prepare editor environment\n");
+                exit(EXIT_FAILURE);
+            }
+            umask(0077);
+        } else {
+            if (cmd->envp) {
+                environ = cmd->envp;
+            }
 
-        /* Set up secure environment for pagers */
-        if (is_secure_pager(cmd->command)) {
-            setup_secure_pager_environment();
-        }
+            /* Set up secure environment for pagers */
+            if (is_secure_pager(cmd->command)) {
+                setup_secure_pager_environment();
+            }
 
-        /* Set up secure environment for editors */
-        if (is_secure_editor(cmd->command)) {
-            setup_secure_editor_environment();
+            /* Set up secure environment for editors */
+            if (is_secure_editor(cmd->command)) {
+                setup_secure_editor_environment();
+            }
         }
 
         /* Change to target user privileges */
         extern int test_mode;
-        if (target_pwd) {
-            /* Running as specific target user */
-            if (test_mode) {
-                /* Test mode: skip privilege changes */
-            } else if (setgid(target_pwd->pw_gid) != 0) {
-                perror("setgid");
-                exit(EXIT_FAILURE);
-            }
-
-            /* Set supplementary groups for target user */
+        if (target_cred) {
+            /* Running as specific target user: no NSS lookups after fork */
             if (test_mode) {
                 /* Test mode: skip privilege changes */
-            } else if (initgroups(target_pwd->pw_name, target_pwd->pw_gid) != 0) {
-                perror("initgroups");
-                exit(EXIT_FAILURE);
-            }
-
-            if (test_mode) {
-                /* Test mode: skip privilege changes */
-            } else if (setuid(target_pwd->pw_uid) != 0) {
-                perror("setuid");
+                if (set_target_environment(target_cred) != 0) {
+                    perror("setenv");
+                    /* Non-fatal, continue */
+                }
+            } else if (apply_target_credentials(target_cred) != 0) {
+                perror("sudosh: switching to target user");
                 exit(EXIT_FAILURE);
             }
-
-            /* Set HOME environment variable for target user */
-            if (setenv("HOME", target_pwd->pw_dir, 1) != 0) {
-                perror("setenv HOME");
-                /* Non-fatal, continue */
-            }
-
-            /* Set USER and LOGNAME environment variables */
-            if (setenv("USER", target_pwd->pw_name, 1) != 0) {
-                perror("setenv USER");
-                /* Non-fatal, continue */
-            }
-
-            if (setenv("LOGNAME", target_pwd->pw_name, 1) != 0) {
-                perror("setenv LOGNAME");
-                /* Non-fatal, continue */
-            }
         } else {
             /* Default behavior - change to root privileges */
             if (test_mode) {
@@ -443,44 +809,47 @@ int execute_command(struct command_info *cmd, struct user_info *user) {
             }
         }
 
-        /* Execute the command */
-        execv(command_path, cmd->argv);
+        /* Execute the verified binary */
+        exec_verified_binary(&binary, cmd->argv);
 
         /* If we get here, exec failed */
-        perror("execv");
+        perror("execve");
         exit(EXIT_COMMAND_NOT_FOUND);
     } else {
         /* Parent process */
+        close_verified_binary(&binary);
         free(command_path);
+        session_stats_command(0);
+        session_stats_latency(SESSION_LATENCY_EXEC, child_start_us - entered_us);
 
-        /* Set up signal handling for interactive programs */
-        struct sigaction old_sigint, old_sigquit, old_sigtstp;
+        /* Ctrl-Z belongs to the child; SIGINT/SIGQUIT are handled by the supervisor */
+        struct sigaction old_sigtstp;
         struct sigaction ignore_action;
 
         ignore_action.sa_handler = SIG_IGN;
         sigemptyset(&ignore_action.sa_mask);
         ignore_action.sa_flags = 0;
-
-        /* Temporarily ignore signals that should be handled by the child */
-        sigaction(SIGINT, &ignore_action, &old_sigint);
-        sigaction(SIGQUIT, &ignore_action, &old_sigquit);
         sigaction(SIGTSTP, &ignore_action, &old_sigtstp);
 
-        /* Wait for child to complete */
-        int wait_result;
-        do {
-            wait_result = waitpid(pid, &status, 0);
-        } while (wait_result == -1 && errno == EINTR);
+        /* Wait for the child under its wall-clock limit */
+        struct supervised_child child = { .pid = pid, .start_us = child_start_us };
+        struct supervision_result outcome;
+        int timeout = get_command_timeout(cmd);
+        int wait_result = supervise_children(&child, 1, timeout, &outcome);
+        status = child.status;
 
-        /* Restore original signal handlers */
-        sigaction(SIGINT, &old_sigint, NULL);
-        sigaction(SIGQUIT, &old_sigquit, NULL);
         sigaction(SIGTSTP, &old_sigtstp, NULL);
 
-        if (wait_result == -1) {
-            if (errno != ECHILD) {  /* Don't report error if child already reaped */
-                perror("waitpid");
-            }
+        if (outcome.timed_out) {
+            char *username = get_current_username();
+            fprintf(stderr, "sudosh: %s: time limit (%ds) exceeded\n", cmd->argv[0], timeout);
+            syslog(LOG_WARNING, "COMMAND_TIMEOUT: user=%s command=%s limit=%ds elapsed_ms=%lld",
+                   username ? username : "unknown", cmd->command ? cmd->command : cmd->argv[0],
+                   timeout, child.elapsed_us / 1000);
+            free(username);
+        }
+
+        if (wait_result == -1 && !child.exited) {
             /* Clean up file lock if it was acquired */
             if (file_lock_acquired && file_to_edit) {
                 release_file_lock(file_to_edit, user->username, pid);
@@ -499,6 +868,10 @@ int execute_command(struct command_info *cmd, struct user_info *user) {
             free(file_to_edit);
         }
 
+        if (outcome.timed_out) {
+            return EXIT_COMMAND_TIMEOUT;
+        }
+
         /* Return the exit status */
         if (WIFEXITED(status)) {
             return WEXITSTATUS(status);
@@ -515,6 +888,19 @@ int execute_command(struct command_info *cmd, struct user_info *user) {
     return 0;
 }
 
+/**
+ * Execute a command (traced by the exec__start/exec__done probes)
+ */
+int execute_command(struct command_info *cmd, struct user_info *user) {
+    const char *username = user ? user->username : NULL;
+    const char *command = cmd ? cmd->command : NULL;
+
+    SUDOSH_PROBE2(exec__start, username, command);
+    int result = launch_command(cmd, user);
+    SUDOSH_PROBE3(exec__done, username, command, result);
+    return result;
+}
+
 /**
  * Find command in PATH
  */
@@ -561,6 +947,118 @@ char *find_command_in_path(const char *command) {
     return NULL;
 }
 
+/**
+ * Open a resolved command binary and verify it by descriptor
+ *
+ * The file must be a regular, executable file that is neither world-writable
+ * nor group-writable by a non-root group, owned by root or by the target
+ * user.  Because the checks run on the open descriptor and the exec goes
+ * through the same descriptor, the binary that was checked is the one that
+ * runs and the path is walked only once.  Returns 0 on success; on failure
+ * returns -1 with errno set, and vb->reason set for policy rejections.
+ */
+int open_verified_binary(const char *path, const struct target_credentials *target, struct verified_binary *vb) {
+    struct stat st;
+    extern int test_mode;
+
+    memset(vb, 0, sizeof(*vb));
+    vb->fd = -1;
+    if (!path) {
+        errno = EINVAL;
+        return -1;
+    }
+
+#ifdef O_PATH
+    int fd = open(path, O_PATH | O_CLOEXEC);
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd == -1) {
+        return -1;
+    }
+
+    if (fstat(fd, &st) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+        vb->reason = "not a regular file";
+    } else if (!(st.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH))) {
+        vb->reason = "not executable";
+    } else if (st.st_mode & S_IWOTH) {
+        vb->reason = "world-writable";
+    } else if ((st.st_mode & S_IWGRP) && st.st_gid != 0) {
+        vb->reason = "group-writable";
+    } else if (!test_mode && st.st_uid != 0 &&
+               !(target && st.st_uid == target->uid)) {
+        vb->reason = "not owned by root or the target user";
+    }
+
+    if (vb->reason) {
+        close(fd);
+        errno = EACCES;
+        return -1;
+    }
+
+    vb->path = safe_strdup(path);
+    if (!vb->path) {
+        close(fd);
+        errno = ENOMEM;
+        return -1;
+    }
+    vb->fd = fd;
+    vb->dev = st.st_dev;
+    vb->ino = st.st_ino;
+    return 0;
+}
+
+/**
+ * Execute a verified binary through its descriptor; returns only on failure
+ *
+ * Uses execveat(fd, "", AT_EMPTY_PATH) where available.  A '#!' script
+ * cannot be run that way from a close-on-exec descriptor (the interpreter
+ * would be handed an unusable /dev/fd path), so on ENOENT the path is
+ * exec'd instead, provided it still names the file that was verified.
+ */
+void exec_verified_binary(const struct verified_binary *vb, char *const argv[]) {
+    struct stat st;
+
+#if defined(__linux__) && defined(SYS_execveat) && defined(AT_EMPTY_PATH)
+    syscall(SYS_execveat, vb->fd, "", argv, environ, AT_EMPTY_PATH);
+    if (errno != ENOENT && errno != ENOSYS) {
+        return;
+    }
+#endif
+
+    if (stat(vb->path, &st) != 0) {
+        return;
+    }
+    if (st.st_dev != vb->dev || st.st_ino != vb->ino) {
+        /* Replaced since it was verified */
+        errno = ESTALE;
+        return;
+    }
+    execv(vb->path, argv);
+}
+
+/**
+ * Release a verified binary
+ */
+void close_verified_binary(struct verified_binary *vb) {
+    if (!vb) {
+        return;
+    }
+    if (vb->fd != -1) {
+        close(vb->fd);
+    }
+    free(vb->path);
+    vb->fd = -1;
+    vb->path = NULL;
+}
+
 /**
  * Free command_info structure
  */
@@ -591,6 +1089,11 @@ void free_command_info(struct command_info *cmd) {
         cmd->redirect_file = NULL;
     }
 
+    if (cmd->glob_matched) {
+        free(cmd->glob_matched);
+        cmd->glob_matched = NULL;
+    }
+
     cmd->argc = 0;
     cmd->redirect_type = REDIRECT_NONE;
     cmd->redirect_append = 0;
@@ -910,3 +1413,131 @@ char *trim_whitespace_inplace(char *str) {
 
     return str;
 }
+
+/**
+ * Open an anonymous spool for a pipelined module
+ */
+static int open_payload_spool(void) {
+#ifdef MFD_CLOEXEC
+    int fd = memfd_create("sudosh-module", MFD_CLOEXEC);
+    if (fd != -1) {
+        return fd;
+    }
+#endif
+    char template[] = "/tmp/sudosh-module.XXXXXX";
+    int tmp_fd = mkstemp(template);
+    if (tmp_fd == -1) {
+        return -1;
+    }
+    unlink(template);
+    if (fcntl(tmp_fd, F_SETFD, FD_CLOEXEC) == -1) {
+        close(tmp_fd);
+        return -1;
+    }
+    return tmp_fd;
+}
+
+/**
+ * Capture a pipelined module from in_fd into an unlinked spool
+ *
+ * The payload is hashed while it is copied so the audit record carries the
+ * SHA-256 of exactly the bytes the interpreter will read.  On success the
+ * spool is rewound and returned in *spool_fd; payloads larger than
+ * MAX_PIPELINED_PAYLOAD are rejected.
+ */
+int capture_pipelined_payload(int in_fd, int *spool_fd, size_t *payload_len, char *sha256_hex) {
+    struct sha256_ctx ctx;
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    char buffer[65536];
+    size_t total = 0;
+
+    if (in_fd < 0 || !spool_fd || !payload_len || !sha256_hex) {
+        return -1;
+    }
+
+    int fd = open_payload_spool();
+    if (fd == -1) {
+        syslog(LOG_ERR, "sudosh: cannot create pipelined module spool: %s", strerror(errno));
+        return -1;
+    }
+
+    sha256_init(&ctx);
+    for (;;) {
+        ssize_t n = read(in_fd, buffer, sizeof(buffer));
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            return -1;
+        }
+        if (total + (size_t)n > MAX_PIPELINED_PAYLOAD) {
+            syslog(LOG_WARNING, "sudosh: pipelined module exceeds %d bytes", MAX_PIPELINED_PAYLOAD);
+            close(fd);
+            return -1;
+        }
+        sha256_update(&ctx, buffer, (size_t)n);
+        for (ssize_t off = 0; off < n; ) {
+            ssize_t w = write(fd, buffer + off, (size_t)(n - off));
+            if (w < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                close(fd);
+                return -1;
+            }
+            off += w;
+        }
+        total += (size_t)n;
+    }
+
+    if (lseek(fd, 0, SEEK_SET) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    sha256_final(&ctx, digest);
+    sha256_to_hex(digest, sha256_hex);
+    *spool_fd = fd;
+    *payload_len = total;
+    return 0;
+}
+
+/**
+ * Run a whitelisted interpreter with a captured module as its stdin
+ *
+ * The interpreter was checked with is_pipelining_interpreter() by the
+ * caller; it runs through execute_command() so target user, environment
+ * and Ansible sudoers checks match the -c path.
+ */
+int execute_pipelined_module(const char *interpreter_path, int spool_fd, struct user_info *user) {
+    struct command_info cmd;
+    int result;
+
+    if (!interpreter_path || spool_fd < 0 || !user) {
+        return -1;
+    }
+
+    if (parse_command(interpreter_path, &cmd) != 0) {
+        return -1;
+    }
+
+    int saved_stdin = dup(STDIN_FILENO);
+    if (saved_stdin == -1 || dup2(spool_fd, STDIN_FILENO) == -1) {
+        if (saved_stdin != -1) {
+            close(saved_stdin);
+        }
+        free_command_info(&cmd);
+        return -1;
+    }
+
+    result = execute_command(&cmd, user);
+
+    dup2(saved_stdin, STDIN_FILENO);
+    close(saved_stdin);
+    free_command_info(&cmd);
+    return result;
+}
@@ -41,6 +41,12 @@ sudosh_config_t *sudosh_config_init(void) {
     config->ansible_detection_confidence_threshold = 70;
     /* Shell enhancements */
     config->rc_alias_import_enabled = 1; /* default enabled */
+    /* Child supervision */
+    config->command_timeout = 0; /* no limit */
+    /* Live observation */
+    config->session_watch = 0;
+    /* Audit forwarding */
+    config->audit_forward_socket = NULL;
 
 
 
@@ -67,6 +73,7 @@ void sudosh_config_free(sudosh_config_t *config) {
     sudosh_safe_free((void**)&config->log_facility);
     sudosh_safe_free((void**)&config->cache_directory);
     sudosh_safe_free((void**)&config->lock_directory);
+    sudosh_safe_free((void**)&config->audit_forward_socket);
 
     sudosh_safe_free((void**)&config);
 }
@@ -153,6 +160,29 @@ static sudosh_error_t parse_config_line(sudosh_config_t *config, const char *lin
         config->ansible_detection_force = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
     } else if (strcmp(key, "rc_alias_import_enabled") == 0) {
         config->rc_alias_import_enabled = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+    } else if (strcmp(key, "command_timeout") == 0) {
+        config->command_timeout = atoi(value);
+    } else if (strncmp(key, "command_timeout.", 16) == 0) {
+        /* Per-command limits live in the supervisor's table */
+        if (set_command_timeout(key + 16, atoi(value)) != 0) {
+            char warning_msg[512];
+            snprintf(warning_msg, sizeof(warning_msg), "Invalid per-command timeout: %s", key);
+            SUDOSH_LOG_WARNING(warning_msg);
+        }
+    } else if (strcmp(key, "session_watch") == 0) {
+        config->session_watch = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+    } else if (strcmp(key, "audit_forward_socket") == 0) {
+        if (value[0] != '/') {
+            char warning_msg[512];
+            snprintf(warning_msg, sizeof(warning_msg), "audit_forward_socket must be an absolute path: %s", value);
+            SUDOSH_LOG_WARNING(warning_msg);
+            return SUDOSH_SUCCESS;
+        }
+        sudosh_safe_free((void**)&config->audit_forward_socket);
+        config->audit_forward_socket = sudosh_safe_strdup(value);
+        if (!config->audit_forward_socket) {
+            return SUDOSH_ERROR_MEMORY_ALLOCATION;
+        }
     } else if (strcmp(key, "ansible_detection_verbose") == 0) {
         config->ansible_detection_verbose = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
     } else if (strcmp(key, "ansible_detection_confidence_threshold") == 0) {
@@ -243,6 +273,11 @@ sudosh_error_t sudosh_config_validate(const sudosh_config_t *config) {
         return SUDOSH_ERROR_INVALID_CONFIGURATION;
     }
 
+    if (config->command_timeout < 0 || config->command_timeout > 86400) {
+        SUDOSH_LOG_ERROR("Invalid command_timeout (must be 0-86400 seconds)");
+        return SUDOSH_ERROR_INVALID_CONFIGURATION;
+    }
+
     /* Validate command length */
     if (config->max_command_length < 256 || config->max_command_length > 65536) {
         SUDOSH_LOG_ERROR("Invalid max_command_length (must be 256-65536 characters)");
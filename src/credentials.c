@@ -0,0 +1,178 @@
+/**
+ * credentials.c - Target User Credentials
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * Resolves the identity used for -u runs (uid, gid, supplementary
+ * groups, home and shell) once per session.  With LDAP or SSSD backed
+ * accounts every getpwnam()/initgroups() is a directory round trip, so
+ * the record is looked up on first use and reused by every command and
+ * prompt; children switch identity from it with setgroups(), setresgid()
+ * and setresuid() and make no NSS calls after fork.
+ */
+
+#include "sudosh.h"
+
+static struct target_credentials *cached_credentials = NULL;
+
+/**
+ * Free a credential record
+ */
+static void free_target_credentials(struct target_credentials *cred) {
+    if (!cred) {
+        return;
+    }
+    free(cred->name);
+    free(cred->home);
+    free(cred->shell);
+    free(cred->groups);
+    free(cred);
+}
+
+/**
+ * Resolve the supplementary groups of a user (initgroups() equivalent)
+ */
+static int resolve_groups(const char *name, gid_t gid, gid_t **groups, int *ngroups) {
+    int count = 32;
+
+    for (int attempt = 0; attempt < 8; attempt++) {
+        gid_t *list = malloc((size_t)count * sizeof(gid_t));
+        if (!list) {
+            return -1;
+        }
+        int n = count;
+#ifdef __APPLE__
+        if (getgrouplist(name, (int)gid, (int *)list, &n) != -1) {
+#else
+        if (getgrouplist(name, gid, list, &n) != -1) {
+#endif
+            *groups = list;
+            *ngroups = n;
+            return 0;
+        }
+        free(list);
+        /* n holds the required size on glibc; grow geometrically otherwise */
+        count = (n > count) ? n : count * 2;
+        if (count > NGROUPS_MAX * 4 + 64) {
+            break;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Look up a target user and build its credential record
+ */
+static struct target_credentials *resolve_target_credentials(const char *name) {
+    struct passwd *pwd = getpwnam(name);
+    if (!pwd) {
+        return NULL;
+    }
+
+    struct target_credentials *cred = calloc(1, sizeof(*cred));
+    if (!cred) {
+        return NULL;
+    }
+    cred->uid = pwd->pw_uid;
+    cred->gid = pwd->pw_gid;
+    cred->name = safe_strdup(pwd->pw_name);
+    cred->home = safe_strdup(pwd->pw_dir ? pwd->pw_dir : "/");
+    cred->shell = safe_strdup(pwd->pw_shell && *pwd->pw_shell ? pwd->pw_shell : "/bin/sh");
+    if (!cred->name || !cred->home || !cred->shell) {
+        free_target_credentials(cred);
+        return NULL;
+    }
+
+    /* getpwnam()'s buffer may be reused by getgrouplist(); only copies are used below */
+    if (resolve_groups(cred->name, cred->gid, &cred->groups, &cred->ngroups) != 0) {
+        free_target_credentials(cred);
+        return NULL;
+    }
+
+    return cred;
+}
+
+/**
+ * Get the session's credential record for a target user (NULL name means root)
+ *
+ * The first call resolves the account through NSS; later calls for the
+ * same user return the cached record.  Returns NULL if the user does not
+ * exist.
+ */
+const struct target_credentials *get_target_credentials(const char *name) {
+    if (!name || !*name) {
+        name = "root";
+    }
+
+    if (cached_credentials && strcmp(cached_credentials->name, name) == 0) {
+        return cached_credentials;
+    }
+
+    struct target_credentials *cred = resolve_target_credentials(name);
+    if (!cred) {
+        return NULL;
+    }
+
+    syslog(LOG_DEBUG, "TARGET_CREDENTIALS: user=%s uid=%d gid=%d groups=%d",
+           cred->name, (int)cred->uid, (int)cred->gid, cred->ngroups);
+    free_target_credentials(cached_credentials);
+    cached_credentials = cred;
+    return cred;
+}
+
+/**
+ * Drop the cached record so the next lookup goes back to NSS
+ */
+void clear_target_credentials(void) {
+    free_target_credentials(cached_credentials);
+    cached_credentials = NULL;
+}
+
+/**
+ * Switch the calling process to a credential record
+ *
+ * Intended for a forked child just before exec: sets the supplementary
+ * groups, then real/effective/saved gid, then uid, and sets HOME, USER and
+ * LOGNAME.  No NSS lookups are made.  Returns 0 on success, -1 with errno
+ * set on failure.
+ */
+int apply_target_credentials(const struct target_credentials *cred) {
+    if (!cred) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (setgroups((size_t)cred->ngroups, cred->groups) != 0) {
+        return -1;
+    }
+#ifdef __APPLE__
+    if (setregid(cred->gid, cred->gid) != 0 || setreuid(cred->uid, cred->uid) != 0) {
+        return -1;
+    }
+#else
+    if (setresgid(cred->gid, cred->gid, cred->gid) != 0 ||
+        setresuid(cred->uid, cred->uid, cred->uid) != 0) {
+        return -1;
+    }
+#endif
+
+    /* Regaining root must be impossible after dropping to another user */
+    if (cred->uid != 0 && setuid(0) == 0) {
+        errno = EPERM;
+        return -1;
+    }
+
+    return set_target_environment(cred);
+}
+
+/**
+ * Set HOME, USER and LOGNAME for a credential record
+ */
+int set_target_environment(const struct target_credentials *cred) {
+    if (setenv("HOME", cred->home, 1) != 0 ||
+        setenv("USER", cred->name, 1) != 0 ||
+        setenv("LOGNAME", cred->name, 1) != 0) {
+        return -1;
+    }
+    return 0;
+}
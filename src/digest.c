@@ -0,0 +1,519 @@
+/**
+ * digest.c - Digest-Pinned Command Verification
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * Enforces sudoers "sha256:" pins on the binary about to be executed.
+ * Digests are cached by file identity (device, inode, size, mtime and
+ * ctime), in memory and in a root-owned cache file shared by all
+ * sessions, so a pinned binary is hashed once after it changes and every
+ * later exec costs a single fstat() and a table lookup.  Any write to the
+ * file changes its mtime or ctime and therefore misses the cache.
+ *
+ * The pins themselves come from the sudoers policy, which is loaded once
+ * and reused for as long as the stat() identities of its inputs are
+ * unchanged, as the shared policy image is.
+ */
+
+#include "sudosh.h"
+
+#include <sys/mman.h>
+
+#define DIGEST_CACHE_MAGIC 0x53444743u  /* "SDGC" */
+#define DIGEST_CACHE_VERSION 1
+
+/* One cached digest; also the on-disk record format */
+struct digest_cache_entry {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t ctime_sec;
+    int64_t ctime_nsec;
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+};
+
+struct digest_cache_header {
+    uint32_t magic;
+    uint32_t version;
+};
+
+static struct digest_cache_entry digest_cache[MAX_DIGEST_CACHE_ENTRIES];
+static int digest_cache_count = 0;
+static int digest_cache_next = 0;       /* Replacement cursor once full */
+
+/* Sudoers policy the pins were last read from */
+static struct sudoers_config *digest_policy = NULL;
+static int digest_policy_settled = 0;   /* Later changes to its inputs are visible */
+static int digest_policy_pinned = -1;   /* It has sha256 pins; -1 until one is loaded */
+static int digest_cache_loaded = 0;
+static size_t digest_cache_file_records = 0;
+
+/**
+ * Location of the shared cache file (overridable in test mode only)
+ */
+static const char *digest_cache_path(void) {
+    extern int test_mode;
+    const char *override = getenv("SUDOSH_DIGEST_CACHE");
+
+    if (test_mode && override && *override) {
+        return override;
+    }
+    return DIGEST_CACHE_FILE;
+}
+
+/**
+ * Fill a cache key from stat information
+ */
+static void digest_key_from_stat(const struct stat *st, struct digest_cache_entry *key) {
+    memset(key, 0, sizeof(*key));
+    key->dev = (uint64_t)st->st_dev;
+    key->ino = (uint64_t)st->st_ino;
+    key->size = (uint64_t)st->st_size;
+#if defined(__APPLE__)
+    key->mtime_sec = st->st_mtimespec.tv_sec;
+    key->mtime_nsec = st->st_mtimespec.tv_nsec;
+    key->ctime_sec = st->st_ctimespec.tv_sec;
+    key->ctime_nsec = st->st_ctimespec.tv_nsec;
+#else
+    key->mtime_sec = st->st_mtim.tv_sec;
+    key->mtime_nsec = st->st_mtim.tv_nsec;
+    key->ctime_sec = st->st_ctim.tv_sec;
+    key->ctime_nsec = st->st_ctim.tv_nsec;
+#endif
+}
+
+/**
+ * Compare the identity fields of two entries
+ */
+static int digest_key_equal(const struct digest_cache_entry *a, const struct digest_cache_entry *b) {
+    return a->dev == b->dev && a->ino == b->ino && a->size == b->size &&
+           a->mtime_sec == b->mtime_sec && a->mtime_nsec == b->mtime_nsec &&
+           a->ctime_sec == b->ctime_sec && a->ctime_nsec == b->ctime_nsec;
+}
+
+/**
+ * Insert or refresh an entry in the in-memory cache
+ */
+static void digest_cache_store(const struct digest_cache_entry *entry) {
+    for (int i = 0; i < digest_cache_count; i++) {
+        if (digest_cache[i].dev == entry->dev && digest_cache[i].ino == entry->ino) {
+            /* Same file, newer identity: replace the stale entry */
+            digest_cache[i] = *entry;
+            return;
+        }
+    }
+    if (digest_cache_count < MAX_DIGEST_CACHE_ENTRIES) {
+        digest_cache[digest_cache_count++] = *entry;
+        return;
+    }
+    digest_cache[digest_cache_next] = *entry;
+    digest_cache_next = (digest_cache_next + 1) % MAX_DIGEST_CACHE_ENTRIES;
+}
+
+/**
+ * Check that a cache file may be trusted: regular, ours and private
+ */
+static int digest_cache_file_trusted(int fd) {
+    extern int test_mode;
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return 0;
+    }
+    if (st.st_uid != (test_mode ? geteuid() : 0)) {
+        return 0;
+    }
+    return (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+/**
+ * Load the shared cache file into memory (once per process)
+ */
+static void digest_cache_load(void) {
+    struct digest_cache_header header;
+    struct digest_cache_entry entry;
+
+    if (digest_cache_loaded) {
+        return;
+    }
+    digest_cache_loaded = 1;
+
+    int fd = open(digest_cache_path(), O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1) {
+        return;
+    }
+    if (!digest_cache_file_trusted(fd) ||
+        read(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+        header.magic != DIGEST_CACHE_MAGIC || header.version != DIGEST_CACHE_VERSION) {
+        close(fd);
+        return;
+    }
+
+    /* Later records supersede earlier ones for the same file */
+    while (read(fd, &entry, sizeof(entry)) == (ssize_t)sizeof(entry)) {
+        digest_cache_store(&entry);
+        digest_cache_file_records++;
+    }
+    close(fd);
+}
+
+/**
+ * Make sure the directory holding the cache file exists
+ */
+static void digest_cache_ensure_dir(const char *path) {
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (!slash || slash == dir) {
+        return;
+    }
+    *slash = '\0';
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        syslog(LOG_DEBUG, "sudosh: cannot create %s: %m", dir);
+    }
+}
+
+/**
+ * Rewrite the cache file from memory once it has grown well past the table
+ */
+static void digest_cache_compact(const char *path) {
+    char tmp_path[PATH_MAX];
+    struct digest_cache_header header = { DIGEST_CACHE_MAGIC, DIGEST_CACHE_VERSION };
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d", path, (int)getpid());
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        return;
+    }
+
+    size_t len = (size_t)digest_cache_count * sizeof(struct digest_cache_entry);
+    if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+        write(fd, digest_cache, len) != (ssize_t)len ||
+        close(fd) != 0 || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return;
+    }
+    digest_cache_file_records = (size_t)digest_cache_count;
+}
+
+/**
+ * Append a freshly computed digest to the shared cache file
+ */
+static void digest_cache_persist(const struct digest_cache_entry *entry) {
+    const char *path = digest_cache_path();
+    struct digest_cache_header header = { DIGEST_CACHE_MAGIC, DIGEST_CACHE_VERSION };
+    struct stat st;
+
+    digest_cache_ensure_dir(path);
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        return;
+    }
+    if (!digest_cache_file_trusted(fd) || flock(fd, LOCK_EX) != 0) {
+        close(fd);
+        return;
+    }
+
+    if (fstat(fd, &st) == 0 && st.st_size == 0 &&
+        write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+        close(fd);
+        return;
+    }
+    if (write(fd, entry, sizeof(*entry)) == (ssize_t)sizeof(*entry)) {
+        digest_cache_file_records++;
+    }
+
+    if (digest_cache_file_records > 4 * MAX_DIGEST_CACHE_ENTRIES) {
+        digest_cache_compact(path);
+    }
+    close(fd);
+}
+
+/**
+ * Hash the contents of an open file
+ */
+static int hash_file_contents(int fd, size_t size, unsigned char digest[SHA256_DIGEST_LENGTH]) {
+    struct sha256_ctx ctx;
+    sha256_init(&ctx);
+
+    if (size > 0) {
+        void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+            madvise(map, size, MADV_SEQUENTIAL);
+#endif
+            sha256_update(&ctx, map, size);
+            munmap(map, size);
+            sha256_final(&ctx, digest);
+            return 0;
+        }
+    }
+
+    char buf[65536];
+    ssize_t n;
+    off_t offset = 0;
+    while ((n = pread(fd, buf, sizeof(buf), offset)) > 0) {
+        sha256_update(&ctx, buf, (size_t)n);
+        offset += n;
+    }
+    if (n < 0) {
+        return -1;
+    }
+    sha256_final(&ctx, digest);
+    return 0;
+}
+
+/**
+ * Open a verified binary for reading without walking its path again
+ */
+static int reopen_for_reading(const struct verified_binary *vb) {
+    char proc_path[64];
+    struct stat st;
+
+    snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d", vb->fd);
+    int fd = open(proc_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        fd = open(vb->path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    }
+    if (fd == -1) {
+        return -1;
+    }
+
+    /* Must still be the file that was verified */
+    if (fstat(fd, &st) != 0 || st.st_dev != vb->dev || st.st_ino != vb->ino) {
+        close(fd);
+        errno = ESTALE;
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Get the SHA-256 of a verified binary, from cache when its identity is unchanged
+ *
+ * Sets *from_cache when no hashing was needed.  Returns 0 on success.
+ */
+int get_binary_digest(const struct verified_binary *vb, unsigned char digest[SHA256_DIGEST_LENGTH],
+                      int *from_cache) {
+    struct stat st;
+    struct digest_cache_entry key;
+
+    if (from_cache) {
+        *from_cache = 0;
+    }
+    if (!vb || vb->fd < 0 || fstat(vb->fd, &st) != 0) {
+        return -1;
+    }
+
+    digest_key_from_stat(&st, &key);
+    digest_cache_load();
+    for (int i = 0; i < digest_cache_count; i++) {
+        if (digest_key_equal(&digest_cache[i], &key)) {
+            memcpy(digest, digest_cache[i].digest, SHA256_DIGEST_LENGTH);
+            if (from_cache) {
+                *from_cache = 1;
+            }
+            return 0;
+        }
+    }
+
+    int fd = reopen_for_reading(vb);
+    if (fd == -1) {
+        return -1;
+    }
+    int rc = hash_file_contents(fd, (size_t)st.st_size, key.digest);
+    struct stat after;
+    int changed = (fstat(fd, &after) != 0);
+    close(fd);
+    if (rc != 0) {
+        return -1;
+    }
+
+    /* Only cache a digest if the file did not change while it was read */
+    struct digest_cache_entry after_key;
+    if (!changed) {
+        digest_key_from_stat(&after, &after_key);
+        changed = !digest_key_equal(&key, &after_key);
+    }
+    if (changed) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    digest_cache_store(&key);
+    digest_cache_persist(&key);
+    memcpy(digest, key.digest, SHA256_DIGEST_LENGTH);
+    return 0;
+}
+
+/**
+ * Forget the in-memory cache so the next lookup reloads the shared file
+ */
+void reset_digest_cache(void) {
+    digest_cache_count = 0;
+    digest_cache_next = 0;
+    digest_cache_loaded = 0;
+    digest_cache_file_records = 0;
+}
+
+/**
+ * Decode a base64 SHA-256 digest (44 characters with padding)
+ */
+static int decode_base64_digest(const char *text, size_t len, unsigned char digest[SHA256_DIGEST_LENGTH]) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    unsigned char out[33];
+    size_t out_len = 0;
+    uint32_t acc = 0;
+    int bits = 0;
+
+    if (len != 44 || text[43] != '=' || text[42] == '=') {
+        return -1;
+    }
+    for (size_t i = 0; i < 43; i++) {
+        const char *pos = strchr(alphabet, text[i]);
+        if (!pos || !text[i]) {
+            return -1;
+        }
+        acc = (acc << 6) | (uint32_t)(pos - alphabet);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out[out_len++] = (unsigned char)(acc >> bits);
+        }
+    }
+    if (out_len != SHA256_DIGEST_LENGTH) {
+        return -1;
+    }
+    memcpy(digest, out, SHA256_DIGEST_LENGTH);
+    return 0;
+}
+
+/**
+ * Parse a sudoers digest prefix ("sha256:DIGEST command")
+ *
+ * Returns 1 and sets *command to the rest of the entry when a sha256 pin
+ * was parsed, 0 when the entry has no digest prefix, and -1 for other
+ * algorithms or malformed digests.
+ */
+int parse_digest_spec(const char *entry, unsigned char digest[SHA256_DIGEST_LENGTH], const char **command) {
+    static const char *algorithms[] = { "sha224:", "sha384:", "sha512:", NULL };
+
+    if (!entry) {
+        return 0;
+    }
+    for (int i = 0; algorithms[i]; i++) {
+        if (strncmp(entry, algorithms[i], strlen(algorithms[i])) == 0) {
+            return -1;
+        }
+    }
+    if (strncmp(entry, "sha256:", 7) != 0) {
+        return 0;
+    }
+
+    const char *text = entry + 7;
+    size_t len = strcspn(text, " \t");
+    const char *rest = text + len;
+    while (*rest == ' ' || *rest == '\t') {
+        rest++;
+    }
+    if (*rest == '\0') {
+        return -1;
+    }
+
+    if (len == SHA256_HEX_LENGTH) {
+        for (size_t i = 0; i < SHA256_DIGEST_LENGTH; i++) {
+            unsigned int byte;
+            if (!isxdigit((unsigned char)text[i * 2]) || !isxdigit((unsigned char)text[i * 2 + 1]) ||
+                sscanf(text + i * 2, "%2x", &byte) != 1) {
+                return -1;
+            }
+            digest[i] = (unsigned char)byte;
+        }
+    } else if (decode_base64_digest(text, len, digest) != 0) {
+        return -1;
+    }
+
+    *command = rest;
+    return 1;
+}
+
+/**
+ * Get the sudoers policy to read pins from, parsing again only when one
+ * of its inputs has changed since it was loaded
+ */
+static struct sudoers_config *get_digest_policy(void) {
+    if (digest_policy && digest_policy_settled && sudoers_config_current(digest_policy)) {
+        return digest_policy;
+    }
+
+    free_sudoers_config(digest_policy);
+    digest_policy = parse_sudoers_file(NULL);
+    if (!digest_policy) {
+        return NULL;
+    }
+    digest_policy_settled = policy_config_settled(digest_policy);
+    digest_policy_pinned = sudoers_has_command_digests(digest_policy);
+    return digest_policy;
+}
+
+/**
+ * Refuse a binary whose digest does not match the user's sudoers pins
+ *
+ * Returns 0 when no pin applies or the digest matches one of them, -1
+ * (after reporting and logging) otherwise.  If the policy cannot be
+ * loaded the binary is refused too, unless the last policy loaded had
+ * no pins at all.
+ */
+int enforce_command_digest(const char *username, const struct verified_binary *vb) {
+    char pins[MAX_DIGEST_PINS][SHA256_HEX_LENGTH + 1];
+    char hostname[256];
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    char hex[SHA256_HEX_LENGTH + 1];
+    char log_msg[512];
+    int from_cache = 0;
+
+    if (!username || !vb) {
+        return -1;
+    }
+    if (gethostname(hostname, sizeof(hostname)) != 0) {
+        snprintf(hostname, sizeof(hostname), "%s", "localhost");
+    }
+
+    struct sudoers_config *sudoers = get_digest_policy();
+    if (!sudoers) {
+        if (digest_policy_pinned == 0) {
+            return 0;
+        }
+        fprintf(stderr, "sudosh: %s: cannot load sudoers digest pins\n", vb->path);
+        snprintf(log_msg, sizeof(log_msg), "digest pins unavailable for %s", vb->path);
+        log_security_violation(username, log_msg);
+        return -1;
+    }
+    int count = get_sudoers_command_digests(username, hostname, vb->path, sudoers, pins, MAX_DIGEST_PINS);
+    if (count == 0) {
+        return 0;
+    }
+
+    if (get_binary_digest(vb, digest, &from_cache) != 0) {
+        fprintf(stderr, "sudosh: %s: cannot compute digest: %s\n", vb->path, strerror(errno));
+        snprintf(log_msg, sizeof(log_msg), "digest check failed for %s: %s", vb->path, strerror(errno));
+        log_security_violation(username, log_msg);
+        return -1;
+    }
+
+    sha256_to_hex(digest, hex);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(hex, pins[i]) == 0) {
+            syslog(LOG_DEBUG, "DIGEST_VERIFIED: user=%s binary=%s sha256=%s cached=%d",
+                   username, vb->path, hex, from_cache);
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "sudosh: %s: digest does not match sudoers\n", vb->path);
+    snprintf(log_msg, sizeof(log_msg), "digest mismatch for %s: sha256=%s", vb->path, hex);
+    log_security_violation(username, log_msg);
+    return -1;
+}
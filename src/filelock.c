@@ -19,26 +19,83 @@ static int file_locking_available = 0;
 /* Runtime-selected lock directory (defaults to LOCK_DIR, may change in tests) */
 static char lock_dir_runtime[MAX_LOCK_PATH_LENGTH] = LOCK_DIR;
 
+/* On-disk lock index: a header followed by `count` packed records. Removal
+   moves the last record into the freed slot, so readers touch only active
+   locks and never scan or parse the per-lock files. */
+#define LOCK_INDEX_MAGIC "SDLKIDX1"
+#define LOCK_INDEX_READ_BATCH 16      /* Records read per pread() when searching */
+#define LOCK_SWEEP_STAMP ".sweep"     /* mtime marks the last stale-lock sweep */
+#define LOCK_SWEEP_INTERVAL 60        /* Seconds between sweeps across sessions */
+
+struct lock_index_header {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t count;
+};
+
+struct lock_index_record {
+    int32_t pid;
+    uint32_t reserved;
+    int64_t timestamp;
+    char username[MAX_USERNAME_LENGTH];
+    char file_path[MAX_LOCK_PATH_LENGTH];
+};
+
 /**
- * Initialize file locking system
+ * Select the runtime lock directory (per-process temp dir in test mode,
+ * or SUDOSH_LOCK_DIR so several test processes share one)
  */
-int init_file_locking(void) {
-    struct stat st;
-    const char *lock_dir;
-    char test_lock_dir[256];
-
-    /* Check if we're running in test mode */
+static void select_lock_directory(void) {
     char *test_env = getenv("SUDOSH_TEST_MODE");
     if (test_env && strcmp(test_env, "1") == 0) {
         /* Test mode: use temporary directory; do not require root */
-        snprintf(test_lock_dir, sizeof(test_lock_dir), "/tmp/sudosh_test_locks_%d", getpid());
-        lock_dir = test_lock_dir;
+        const char *shared = getenv("SUDOSH_LOCK_DIR");
+        if (shared && *shared) {
+            snprintf(lock_dir_runtime, sizeof(lock_dir_runtime), "%s", shared);
+        } else {
+            snprintf(lock_dir_runtime, sizeof(lock_dir_runtime), "/tmp/sudosh_test_locks_%d", getpid());
+        }
     } else {
-        lock_dir = LOCK_DIR;
+        snprintf(lock_dir_runtime, sizeof(lock_dir_runtime), "%s", LOCK_DIR);
     }
+}
+
+/**
+ * Scan the lock directory for stale locks unless a session on this host
+ * has done so within LOCK_SWEEP_INTERVAL (judged by a stamp file's mtime).
+ * Stale locks met in between are still reaped by acquire and check.
+ */
+static void sweep_stale_locks_if_due(void) {
+    char stamp_path[MAX_LOCK_PATH_LENGTH];
+    struct stat st;
+    time_t now = time(NULL);
+
+    if (snprintf(stamp_path, sizeof(stamp_path), "%s/%s", lock_dir_runtime,
+                 LOCK_SWEEP_STAMP) >= (int)sizeof(stamp_path)) {
+        cleanup_stale_locks();
+        return;
+    }
+    if (lstat(stamp_path, &st) == 0 && S_ISREG(st.st_mode) &&
+        now - st.st_mtime < LOCK_SWEEP_INTERVAL && st.st_mtime <= now) {
+        return;
+    }
+
+    int fd = open(stamp_path, O_WRONLY | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        futimens(fd, NULL);
+        close(fd);
+    }
+    cleanup_stale_locks();
+}
+
+/**
+ * Initialize file locking system
+ */
+int init_file_locking(void) {
+    struct stat st;
 
     /* Persist runtime lock dir for subsequent helpers */
-    snprintf(lock_dir_runtime, sizeof(lock_dir_runtime), "%s", lock_dir);
+    select_lock_directory();
 
     /* Create lock directory if it doesn't exist */
     if (stat(lock_dir_runtime, &st) != 0) {
@@ -57,7 +114,7 @@ int init_file_locking(void) {
     (void)chmod(lock_dir_runtime, 0755);
 
     /* Clean up any stale locks from previous runs */
-    cleanup_stale_locks();
+    sweep_stale_locks_if_due();
 
     /* Mark file locking as available */
     file_locking_available = 1;
@@ -70,7 +127,7 @@ int init_file_locking(void) {
  */
 void cleanup_file_locking(void) {
     /* Clean up any locks owned by this process */
-    cleanup_stale_locks();
+    sweep_stale_locks_if_due();
 }
 
 /**
@@ -80,75 +137,309 @@ int is_file_locking_available(void) {
     return file_locking_available;
 }
 
+/* Per-session path resolution cache keyed by (cwd dev/ino, input path).
+   Absolute paths ignore the cwd part; the cache is dropped on directory
+   changes made through the cd/pushd/popd builtins. */
+#define PATH_CACHE_SIZE 32
+
+struct path_cache_entry {
+    char *input_path;
+    dev_t cwd_dev;
+    ino_t cwd_ino;
+    struct path_identity identity;
+    unsigned long last_used;
+};
+
+static struct path_cache_entry path_cache[PATH_CACHE_SIZE];
+static unsigned long path_cache_clock = 0;
+
 /**
- * Resolve canonical path for a file
+ * Drop all cached path resolutions (called on directory changes)
  */
-char *resolve_canonical_path(const char *file_path) {
-    char *canonical_path = NULL;
-    char *resolved_path = NULL;
-
-    if (!file_path) {
-        return NULL;
+void invalidate_path_cache(void) {
+    for (int i = 0; i < PATH_CACHE_SIZE; i++) {
+        free(path_cache[i].input_path);
+        free(path_cache[i].identity.canonical_path);
+        memset(&path_cache[i], 0, sizeof(path_cache[i]));
     }
+}
+
+/**
+ * Resolve a path the slow way: realpath() on the file, or on its parent
+ * directory when the file does not exist yet (e.g. a new file in an editor)
+ */
+static int resolve_path_identity_uncached(const char *file_path, struct path_identity *out) {
+    struct stat st;
+
+    memset(out, 0, sizeof(*out));
 
-    /* Use realpath to resolve symlinks and relative paths */
-    resolved_path = realpath(file_path, NULL);
+    char *resolved_path = realpath(file_path, NULL);
     if (resolved_path) {
-        canonical_path = safe_strdup(resolved_path);
+        out->canonical_path = safe_strdup(resolved_path);
         free(resolved_path);
+        if (!out->canonical_path) {
+            return -1;
+        }
+        if (stat(out->canonical_path, &st) == 0) {
+            out->exists = 1;
+            out->dev = st.st_dev;
+            out->ino = st.st_ino;
+        }
     } else {
-        /* If realpath fails (file doesn't exist yet), use absolute path */
-        if (file_path[0] == '/') {
-            canonical_path = safe_strdup(file_path);
+        /* File doesn't exist yet: canonicalize the directory it would live in */
+        char *path_copy = safe_strdup(file_path);
+        if (!path_copy) {
+            return -1;
+        }
+        char *slash = strrchr(path_copy, '/');
+        const char *name = slash ? slash + 1 : path_copy;
+        const char *parent = slash ? (slash == path_copy ? "/" : path_copy) : ".";
+        if (slash) {
+            *slash = '\0';
+        }
+
+        char *resolved_parent = (*name != '\0') ? realpath(parent, NULL) : NULL;
+        if (resolved_parent) {
+            size_t path_len = strlen(resolved_parent) + strlen(name) + 2;
+            out->canonical_path = malloc(path_len);
+            if (out->canonical_path) {
+                snprintf(out->canonical_path, path_len, "%s%s%s", resolved_parent,
+                         strcmp(resolved_parent, "/") == 0 ? "" : "/", name);
+            }
+            free(resolved_parent);
+        } else if (file_path[0] == '/') {
+            /* Parent missing too: fall back to the absolute path as given */
+            out->canonical_path = safe_strdup(file_path);
         } else {
             /* Convert relative path to absolute */
             char *cwd = getcwd(NULL, 0);
             if (cwd) {
                 size_t path_len = strlen(cwd) + strlen(file_path) + 2;
-                canonical_path = malloc(path_len);
-                if (canonical_path) {
-                    snprintf(canonical_path, path_len, "%s/%s", cwd, file_path);
+                out->canonical_path = malloc(path_len);
+                if (out->canonical_path) {
+                    snprintf(out->canonical_path, path_len, "%s/%s", cwd, file_path);
                 }
                 free(cwd);
             }
         }
+        free(path_copy);
+
+        if (!out->canonical_path) {
+            return -1;
+        }
+    }
+
+    /* Identity of the containing directory, used to key file locks */
+    char *parent_copy = safe_strdup(out->canonical_path);
+    if (parent_copy) {
+        char *slash = strrchr(parent_copy, '/');
+        if (slash) {
+            if (slash == parent_copy) {
+                slash[1] = '\0';
+            } else {
+                *slash = '\0';
+            }
+            if (stat(parent_copy, &st) == 0 && S_ISDIR(st.st_mode)) {
+                out->parent_known = 1;
+                out->parent_dev = st.st_dev;
+                out->parent_ino = st.st_ino;
+            }
+        }
+        free(parent_copy);
+    }
+
+    return 0;
+}
+
+/**
+ * Check that a cached resolution still describes the filesystem: the
+ * input path and the canonical path must both reach the same inode, or,
+ * if it did not exist, both must still be absent and the input's parent
+ * directory must be the one resolved.  A symlink along the input that
+ * now points elsewhere fails the first stat().
+ */
+static int path_identity_still_valid(const struct path_identity *identity, const char *input_path) {
+    struct stat st;
+
+    if (stat(input_path, &st) == 0) {
+        if (!identity->exists || st.st_dev != identity->dev || st.st_ino != identity->ino) {
+            return 0;
+        }
+        return stat(identity->canonical_path, &st) == 0 &&
+               st.st_dev == identity->dev && st.st_ino == identity->ino;
+    }
+    if (errno != ENOENT || identity->exists || !identity->parent_known) {
+        return 0;
+    }
+
+    char parent[PATH_MAX];
+    const char *slash = strrchr(input_path, '/');
+    if (!slash) {
+        snprintf(parent, sizeof(parent), ".");
+    } else if (slash == input_path) {
+        snprintf(parent, sizeof(parent), "/");
+    } else if ((size_t)(slash - input_path) < sizeof(parent)) {
+        memcpy(parent, input_path, (size_t)(slash - input_path));
+        parent[slash - input_path] = '\0';
+    } else {
+        return 0;
+    }
+    if (stat(parent, &st) != 0 || st.st_dev != identity->parent_dev || st.st_ino != identity->parent_ino) {
+        return 0;
+    }
+    return stat(identity->canonical_path, &st) != 0 && errno == ENOENT;
+}
+
+/**
+ * Resolve a file path to its canonical path and (dev, ino) identity,
+ * reusing earlier resolutions from this session when still valid.
+ * Returns 0 on success; release with free_path_identity().
+ */
+int resolve_path_identity(const char *file_path, struct path_identity *out) {
+    if (!file_path || !out) {
+        return -1;
+    }
+
+    path_cache_clock++;
+
+    /* Relative paths are only meaningful together with the cwd */
+    dev_t cwd_dev = 0;
+    ino_t cwd_ino = 0;
+    if (file_path[0] != '/') {
+        struct stat cwd_st;
+        if (stat(".", &cwd_st) == 0) {
+            cwd_dev = cwd_st.st_dev;
+            cwd_ino = cwd_st.st_ino;
+        }
+    }
+
+    struct path_cache_entry *victim = &path_cache[0];
+    for (int i = 0; i < PATH_CACHE_SIZE; i++) {
+        struct path_cache_entry *entry = &path_cache[i];
+        if (!entry->input_path) {
+            if (victim->input_path) {
+                victim = entry;
+            }
+            continue;
+        }
+        if (entry->cwd_dev == cwd_dev && entry->cwd_ino == cwd_ino &&
+            strcmp(entry->input_path, file_path) == 0) {
+            if (path_identity_still_valid(&entry->identity, file_path)) {
+                entry->last_used = path_cache_clock;
+                *out = entry->identity;
+                out->canonical_path = safe_strdup(entry->identity.canonical_path);
+                return out->canonical_path ? 0 : -1;
+            }
+            /* Stale: drop it whether or not the path resolves again */
+            free(entry->input_path);
+            free(entry->identity.canonical_path);
+            memset(entry, 0, sizeof(*entry));
+            victim = entry;
+            break;
+        }
+        if (victim->input_path && entry->last_used < victim->last_used) {
+            victim = entry;
+        }
+    }
+
+    if (resolve_path_identity_uncached(file_path, out) != 0) {
+        return -1;
+    }
+
+    /* Remember the result, evicting the least recently used entry */
+    char *input_copy = safe_strdup(file_path);
+    char *canonical_copy = safe_strdup(out->canonical_path);
+    if (input_copy && canonical_copy) {
+        free(victim->input_path);
+        free(victim->identity.canonical_path);
+        victim->input_path = input_copy;
+        victim->cwd_dev = cwd_dev;
+        victim->cwd_ino = cwd_ino;
+        victim->identity = *out;
+        victim->identity.canonical_path = canonical_copy;
+        victim->last_used = path_cache_clock;
+    } else {
+        free(input_copy);
+        free(canonical_copy);
     }
 
-    return canonical_path;
+    return 0;
+}
+
+/**
+ * Free the canonical path held by a path identity
+ */
+void free_path_identity(struct path_identity *identity) {
+    if (identity) {
+        free(identity->canonical_path);
+        identity->canonical_path = NULL;
+    }
 }
 
 /**
- * Generate lock file path from canonical file path
+ * Resolve canonical path for a file
  */
-static char *generate_lock_file_path(const char *canonical_path) {
-    if (!canonical_path) {
+char *resolve_canonical_path(const char *file_path) {
+    struct path_identity identity;
+
+    if (resolve_path_identity(file_path, &identity) != 0) {
         return NULL;
     }
 
-    /* Create a safe filename by replacing / with _ */
-    size_t path_len = strlen(canonical_path);
-    char *safe_name = malloc(path_len + 1);
-    if (!safe_name) {
+    return identity.canonical_path;
+}
+
+/**
+ * Generate lock file path for a resolved file.
+ *
+ * Locks are keyed on the (dev, ino) of the containing directory plus a hash
+ * of the file name rather than on the file's own inode: editors that save
+ * by writing a new file and renaming it over the old one change the inode
+ * mid-session, while the directory stays put. When the directory identity
+ * is unknown, fall back to the canonical path with '/' replaced by '_'.
+ */
+static char *generate_lock_file_path(const struct path_identity *identity) {
+    if (!identity || !identity->canonical_path) {
         return NULL;
     }
 
-    for (size_t i = 0; i < path_len; i++) {
-        if (canonical_path[i] == '/') {
-            safe_name[i] = '_';
-        } else {
-            safe_name[i] = canonical_path[i];
+    const char *canonical_path = identity->canonical_path;
+    char lock_name[MAX_LOCK_PATH_LENGTH];
+
+    if (identity->parent_known) {
+        const char *name = strrchr(canonical_path, '/');
+        name = name ? name + 1 : canonical_path;
+
+        /* FNV-1a 64-bit hash of the file name */
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+            hash ^= *p;
+            hash *= 0x100000001b3ULL;
+        }
+
+        snprintf(lock_name, sizeof(lock_name), "%llx-%llx-%016llx",
+                 (unsigned long long)identity->parent_dev,
+                 (unsigned long long)identity->parent_ino,
+                 (unsigned long long)hash);
+    } else {
+        /* Create a safe filename by replacing / with _ */
+        if (strlen(canonical_path) >= sizeof(lock_name)) {
+            return NULL;
+        }
+        size_t i;
+        for (i = 0; canonical_path[i]; i++) {
+            lock_name[i] = (canonical_path[i] == '/') ? '_' : canonical_path[i];
         }
+        lock_name[i] = '\0';
     }
-    safe_name[path_len] = '\0';
 
     /* Create full lock file path using runtime-selected dir */
-    size_t lock_path_len = strlen(lock_dir_runtime) + strlen(safe_name) + strlen(LOCK_FILE_EXTENSION) + 2;
+    size_t lock_path_len = strlen(lock_dir_runtime) + strlen(lock_name) + strlen(LOCK_FILE_EXTENSION) + 2;
     char *lock_file_path = malloc(lock_path_len);
     if (lock_file_path) {
-        snprintf(lock_file_path, lock_path_len, "%s/%s%s", lock_dir_runtime, safe_name, LOCK_FILE_EXTENSION);
+        snprintf(lock_file_path, lock_path_len, "%s/%s%s", lock_dir_runtime, lock_name, LOCK_FILE_EXTENSION);
     }
 
-    free(safe_name);
     return lock_file_path;
 }
 
@@ -233,6 +524,16 @@ static struct file_lock_info *read_lock_metadata(const char *lock_file_path) {
     return lock_info;
 }
 
+/**
+ * Read lock metadata if the lock file exists
+ */
+static struct file_lock_info *read_lock_metadata_if_present(const char *lock_file_path) {
+    if (access(lock_file_path, F_OK) != 0) {
+        return NULL;
+    }
+    return read_lock_metadata(lock_file_path);
+}
+
 /**
  * Check if a process is still running
  */
@@ -274,6 +575,281 @@ static int is_lock_stale(struct file_lock_info *lock_info) {
     return 0;
 }
 
+/**
+ * Open the lock index and take a flock of the requested type.
+ * Returns the fd, or -1 if the index is unavailable.
+ */
+static int open_lock_index(int lock_type) {
+    char index_path[MAX_LOCK_PATH_LENGTH];
+    if (snprintf(index_path, sizeof(index_path), "%s/%s", lock_dir_runtime,
+                 LOCK_INDEX_FILE_NAME) >= (int)sizeof(index_path)) {
+        return -1;
+    }
+
+    int flags = (lock_type == LOCK_EX) ? (O_RDWR | O_CREAT) : O_RDONLY;
+#if defined(O_NOFOLLOW)
+    flags |= O_NOFOLLOW;
+#endif
+    int fd = open(index_path, flags | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || flock(fd, lock_type) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * Read and validate the index header; an empty or foreign file reads as
+ * an empty index.
+ */
+static void read_lock_index_header(int fd, struct lock_index_header *header) {
+    if (pread(fd, header, sizeof(*header), 0) != (ssize_t)sizeof(*header) ||
+        memcmp(header->magic, LOCK_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+        header->record_size != sizeof(struct lock_index_record)) {
+        memcpy(header->magic, LOCK_INDEX_MAGIC, sizeof(header->magic));
+        header->record_size = sizeof(struct lock_index_record);
+        header->count = 0;
+    }
+}
+
+static off_t lock_index_offset(uint32_t slot) {
+    return (off_t)sizeof(struct lock_index_header) + (off_t)slot * (off_t)sizeof(struct lock_index_record);
+}
+
+/**
+ * Find the slot holding canonical_path; returns -1 if absent.
+ * Records are read LOCK_INDEX_READ_BATCH at a time to keep the exclusive
+ * index lock short when many sessions hold editor locks.
+ */
+static int find_lock_index_slot(int fd, const struct lock_index_header *header,
+                                const char *canonical_path, struct lock_index_record *record) {
+    struct lock_index_record batch[LOCK_INDEX_READ_BATCH];
+
+    for (uint32_t first = 0; first < header->count; first += LOCK_INDEX_READ_BATCH) {
+        uint32_t n = header->count - first;
+        if (n > LOCK_INDEX_READ_BATCH) {
+            n = LOCK_INDEX_READ_BATCH;
+        }
+        ssize_t got = pread(fd, batch, n * sizeof(batch[0]), lock_index_offset(first));
+        if (got < (ssize_t)sizeof(batch[0])) {
+            return -1;
+        }
+        n = (uint32_t)((size_t)got / sizeof(batch[0]));
+        for (uint32_t i = 0; i < n; i++) {
+            if (strncmp(batch[i].file_path, canonical_path, sizeof(batch[i].file_path)) == 0) {
+                *record = batch[i];
+                return (int)(first + i);
+            }
+        }
+        if (n < LOCK_INDEX_READ_BATCH && first + n < header->count) {
+            return -1;  /* Index shorter than its header claims */
+        }
+    }
+    return -1;
+}
+
+/**
+ * Add or replace the index record for a lock
+ */
+static void lock_index_add(const char *canonical_path, const char *username, pid_t pid, time_t timestamp) {
+    int fd = open_lock_index(LOCK_EX);
+    if (fd < 0) {
+        return;
+    }
+
+    struct lock_index_header header;
+    struct lock_index_record record;
+    read_lock_index_header(fd, &header);
+
+    int slot = find_lock_index_slot(fd, &header, canonical_path, &record);
+    if (slot < 0) {
+        slot = (int)header.count++;
+    }
+
+    memset(&record, 0, sizeof(record));
+    record.pid = (int32_t)pid;
+    record.timestamp = (int64_t)timestamp;
+    snprintf(record.username, sizeof(record.username), "%s", username);
+    snprintf(record.file_path, sizeof(record.file_path), "%s", canonical_path);
+
+    if (pwrite(fd, &record, sizeof(record), lock_index_offset((uint32_t)slot)) == (ssize_t)sizeof(record)) {
+        (void)pwrite(fd, &header, sizeof(header), 0);
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+/**
+ * Remove the index record for a lock (swap-remove with the last record)
+ */
+static void lock_index_remove(const char *canonical_path) {
+    int fd = open_lock_index(LOCK_EX);
+    if (fd < 0) {
+        return;
+    }
+
+    struct lock_index_header header;
+    struct lock_index_record record;
+    read_lock_index_header(fd, &header);
+
+    int slot = find_lock_index_slot(fd, &header, canonical_path, &record);
+    if (slot >= 0) {
+        uint32_t last = header.count - 1;
+        if ((uint32_t)slot != last &&
+            pread(fd, &record, sizeof(record), lock_index_offset(last)) == (ssize_t)sizeof(record)) {
+            (void)pwrite(fd, &record, sizeof(record), lock_index_offset((uint32_t)slot));
+        }
+        header.count = last;
+        if (pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)) {
+            (void)ftruncate(fd, lock_index_offset(header.count));
+        }
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+/**
+ * Rewrite the index from lock files that survived a directory scan; fd is
+ * the index, held LOCK_EX since before the scan began
+ */
+static void lock_index_rebuild(int fd, struct lock_index_record *records, uint32_t count) {
+    struct lock_index_header header;
+    memcpy(header.magic, LOCK_INDEX_MAGIC, sizeof(header.magic));
+    header.record_size = sizeof(struct lock_index_record);
+    header.count = count;
+
+    if (pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header)) {
+        size_t bytes = (size_t)count * sizeof(struct lock_index_record);
+        if (bytes == 0 || pwrite(fd, records, bytes, lock_index_offset(0)) == (ssize_t)bytes) {
+            (void)ftruncate(fd, lock_index_offset(count));
+        }
+    }
+}
+
+/**
+ * Enumerate active editor locks from the lock index.
+ * Stale entries (dead process or timed out) are skipped.
+ * Returns an array of lock info pointers and stores its length in *count;
+ * free with free_file_lock_list().
+ */
+struct file_lock_info **list_active_file_locks(int *count) {
+    if (!count) {
+        return NULL;
+    }
+    *count = 0;
+
+    int fd = open_lock_index(LOCK_SH);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct lock_index_header header;
+    read_lock_index_header(fd, &header);
+    if (header.count == 0) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return NULL;
+    }
+
+    size_t bytes = (size_t)header.count * sizeof(struct lock_index_record);
+    struct lock_index_record *records = malloc(bytes);
+    struct file_lock_info **locks = calloc(header.count, sizeof(struct file_lock_info *));
+    if (!records || !locks || pread(fd, records, bytes, lock_index_offset(0)) != (ssize_t)bytes) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        free(records);
+        free(locks);
+        return NULL;
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+
+    int found = 0;
+    for (uint32_t i = 0; i < header.count; i++) {
+        struct file_lock_info candidate = {
+            .pid = (pid_t)records[i].pid,
+            .timestamp = (time_t)records[i].timestamp,
+        };
+        if (is_lock_stale(&candidate)) {
+            continue;
+        }
+
+        struct file_lock_info *info = calloc(1, sizeof(struct file_lock_info));
+        if (!info) {
+            break;
+        }
+        records[i].username[sizeof(records[i].username) - 1] = '\0';
+        records[i].file_path[sizeof(records[i].file_path) - 1] = '\0';
+        info->file_path = safe_strdup(records[i].file_path);
+        info->username = safe_strdup(records[i].username);
+        info->pid = candidate.pid;
+        info->timestamp = candidate.timestamp;
+        if (!info->file_path || !info->username) {
+            free_file_lock_info(info);
+            continue;
+        }
+        locks[found++] = info;
+    }
+
+    free(records);
+    if (found == 0) {
+        free(locks);
+        return NULL;
+    }
+
+    *count = found;
+    return locks;
+}
+
+/**
+ * Free a list returned by list_active_file_locks()
+ */
+void free_file_lock_list(struct file_lock_info **locks, int count) {
+    if (!locks) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        free_file_lock_info(locks[i]);
+    }
+    free(locks);
+}
+
+/**
+ * Print active editor locks (sudosh --locks)
+ */
+int print_file_locks(void) {
+    select_lock_directory();
+
+    int count = 0;
+    struct file_lock_info **locks = list_active_file_locks(&count);
+    if (!locks) {
+        printf("No active editor locks.\n");
+        return 0;
+    }
+
+    printf("%-8s %-16s %-20s %s\n", "PID", "USER", "SINCE", "FILE");
+    for (int i = 0; i < count; i++) {
+        char time_str[64];
+        struct tm *tm_info = localtime(&locks[i]->timestamp);
+        if (!tm_info || strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", tm_info) == 0) {
+            snprintf(time_str, sizeof(time_str), "%ld", (long)locks[i]->timestamp);
+        }
+        printf("%-8d %-16s %-20s %s\n", (int)locks[i]->pid, locks[i]->username,
+               time_str, locks[i]->file_path);
+    }
+
+    free_file_lock_list(locks, count);
+    return count;
+}
+
 /**
  * Free file lock info structure
  */
@@ -292,6 +868,7 @@ void free_file_lock_info(struct file_lock_info *lock_info) {
  * Acquire exclusive lock on a file
  */
 int acquire_file_lock(const char *file_path, const char *username, pid_t pid) {
+    struct path_identity identity;
     char *canonical_path = NULL;
     char *lock_file_path = NULL;
     int lock_fd = -1;
@@ -301,25 +878,26 @@ int acquire_file_lock(const char *file_path, const char *username, pid_t pid) {
         return -1;
     }
 
-    /* Resolve canonical path */
-    canonical_path = resolve_canonical_path(file_path);
-    if (!canonical_path) {
+    /* Resolve canonical path and identity once for the whole acquisition */
+    if (resolve_path_identity(file_path, &identity) != 0) {
         log_error("Failed to resolve canonical path for file locking");
         return -1;
     }
+    canonical_path = identity.canonical_path;
 
     /* Generate lock file path */
-    lock_file_path = generate_lock_file_path(canonical_path);
+    lock_file_path = generate_lock_file_path(&identity);
     if (!lock_file_path) {
         free(canonical_path);
         return -1;
     }
 
     /* Check if file is already locked */
-    struct file_lock_info *existing_lock = check_file_lock(canonical_path);
+    struct file_lock_info *existing_lock = read_lock_metadata_if_present(lock_file_path);
     if (existing_lock) {
         if (!is_lock_stale(existing_lock)) {
             /* File is actively locked by another user/process */
+            metrics_count(METRIC_LOCK_CONTENDED_EDITOR_FILE);
             char error_msg[1024];
             char time_str[64];
             struct tm *tm_info = localtime(&existing_lock->timestamp);
@@ -341,6 +919,7 @@ int acquire_file_lock(const char *file_path, const char *username, pid_t pid) {
             if (existing_lock->lock_file_path) {
                 unlink(existing_lock->lock_file_path);
             }
+            lock_index_remove(canonical_path);
             free_file_lock_info(existing_lock);
         }
     }
@@ -354,6 +933,7 @@ int acquire_file_lock(const char *file_path, const char *username, pid_t pid) {
     if (lock_fd == -1) {
         if (errno == EEXIST) {
             /* Race condition - another process created the lock */
+            metrics_count(METRIC_LOCK_CONTENDED_EDITOR_FILE);
             fprintf(stderr, "sudosh: File is being edited by another user\n");
         } else {
             perror("Failed to create lock file");
@@ -375,6 +955,8 @@ int acquire_file_lock(const char *file_path, const char *username, pid_t pid) {
 
     /* Write metadata to lock file safely */
     if (write_lock_metadata_fd(lock_fd, canonical_path, username, pid) == 0) {
+        lock_index_add(canonical_path, username, pid, time(NULL));
+
         char log_msg[512];
         snprintf(log_msg, sizeof(log_msg), "acquired file lock: %s", canonical_path);
         log_security_violation(username, log_msg);
@@ -397,6 +979,7 @@ int acquire_file_lock(const char *file_path, const char *username, pid_t pid) {
  * Release file lock
  */
 int release_file_lock(const char *file_path, const char *username, pid_t pid) {
+    struct path_identity identity;
     char *canonical_path = NULL;
     char *lock_file_path = NULL;
     int result = -1;
@@ -405,14 +988,14 @@ int release_file_lock(const char *file_path, const char *username, pid_t pid) {
         return -1;
     }
 
-    /* Resolve canonical path */
-    canonical_path = resolve_canonical_path(file_path);
-    if (!canonical_path) {
+    /* Resolve canonical path (normally a cache hit from acquisition) */
+    if (resolve_path_identity(file_path, &identity) != 0) {
         return -1;
     }
+    canonical_path = identity.canonical_path;
 
     /* Generate lock file path */
-    lock_file_path = generate_lock_file_path(canonical_path);
+    lock_file_path = generate_lock_file_path(&identity);
     if (!lock_file_path) {
         free(canonical_path);
         return -1;
@@ -431,6 +1014,8 @@ int release_file_lock(const char *file_path, const char *username, pid_t pid) {
             if (lock_info) {
                 if (strcmp(lock_info->username, username) == 0 && lock_info->pid == pid) {
                     if (unlink(lock_file_path) == 0) {
+                        lock_index_remove(canonical_path);
+
                         char log_msg[512];
                         snprintf(log_msg, sizeof(log_msg), "released file lock: %s", canonical_path);
                         log_security_violation(username, log_msg);
@@ -453,6 +1038,7 @@ int release_file_lock(const char *file_path, const char *username, pid_t pid) {
  * Check if file is locked
  */
 struct file_lock_info *check_file_lock(const char *file_path) {
+    struct path_identity identity;
     char *canonical_path = NULL;
     char *lock_file_path = NULL;
     struct file_lock_info *lock_info = NULL;
@@ -462,24 +1048,25 @@ struct file_lock_info *check_file_lock(const char *file_path) {
     }
 
     /* Resolve canonical path */
-    canonical_path = resolve_canonical_path(file_path);
-    if (!canonical_path) {
+    if (resolve_path_identity(file_path, &identity) != 0) {
         return NULL;
     }
+    canonical_path = identity.canonical_path;
 
     /* Generate lock file path */
-    lock_file_path = generate_lock_file_path(canonical_path);
+    lock_file_path = generate_lock_file_path(&identity);
     if (!lock_file_path) {
         free(canonical_path);
         return NULL;
     }
 
     /* Check if lock file exists */
-    if (access(lock_file_path, F_OK) == 0) {
-        lock_info = read_lock_metadata(lock_file_path);
-        if (lock_info && is_lock_stale(lock_info)) {
+    lock_info = read_lock_metadata_if_present(lock_file_path);
+    if (lock_info) {
+        if (is_lock_stale(lock_info)) {
             /* Lock is stale, remove it */
             unlink(lock_file_path);
+            lock_index_remove(canonical_path);
             free_file_lock_info(lock_info);
             lock_info = NULL;
         }
@@ -492,16 +1079,31 @@ struct file_lock_info *check_file_lock(const char *file_path) {
 
 /**
  * Clean up stale locks
+ *
+ * The index is held LOCK_EX from before the directory scan until it has
+ * been rebuilt, so lock_index_add() and lock_index_remove() from other
+ * sessions wait for the rebuild instead of being overwritten by it.
  */
 int cleanup_stale_locks(void) {
+    int index_fd = open_lock_index(LOCK_EX);
     DIR *lock_dir = opendir(lock_dir_runtime);
     if (!lock_dir) {
+        if (index_fd >= 0) {
+            flock(index_fd, LOCK_UN);
+            close(index_fd);
+        }
         return -1;
     }
 
     struct dirent *entry;
     int cleaned_count = 0;
 
+    /* Surviving locks are collected to rebuild the index from ground truth */
+    struct lock_index_record *live = NULL;
+    uint32_t live_count = 0;
+    uint32_t live_capacity = 0;
+    int scan_complete = 1;      /* Cleared if a live lock could not be recorded */
+
     while ((entry = readdir(lock_dir)) != NULL) {
         /* Skip . and .. */
         if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
@@ -513,6 +1115,7 @@ int cleanup_stale_locks(void) {
             size_t path_len = strlen(lock_dir_runtime) + strlen(entry->d_name) + 2; /* '/' + NUL */
             char *lock_file_path = malloc(path_len);
             if (!lock_file_path) {
+                scan_complete = 0;
                 continue;
             }
             snprintf(lock_file_path, path_len, "%s/%s", lock_dir_runtime, entry->d_name);
@@ -528,6 +1131,25 @@ int cleanup_stale_locks(void) {
                         log_security_violation("system", log_msg);
                         cleaned_count++;
                     }
+                } else {
+                    if (live_count == live_capacity) {
+                        uint32_t new_capacity = live_capacity ? live_capacity * 2 : 16;
+                        struct lock_index_record *grown = realloc(live, new_capacity * sizeof(*live));
+                        if (grown) {
+                            live = grown;
+                            live_capacity = new_capacity;
+                        } else {
+                            scan_complete = 0;
+                        }
+                    }
+                    if (live_count < live_capacity) {
+                        struct lock_index_record *record = &live[live_count++];
+                        memset(record, 0, sizeof(*record));
+                        record->pid = (int32_t)lock_info->pid;
+                        record->timestamp = (int64_t)lock_info->timestamp;
+                        snprintf(record->username, sizeof(record->username), "%s", lock_info->username);
+                        snprintf(record->file_path, sizeof(record->file_path), "%s", lock_info->file_path);
+                    }
                 }
                 free_file_lock_info(lock_info);
             }
@@ -536,6 +1158,16 @@ int cleanup_stale_locks(void) {
     }
 
     closedir(lock_dir);
+
+    /* A partial list would drop live locks from the index; keep it as it is */
+    if (index_fd >= 0) {
+        if (scan_complete) {
+            lock_index_rebuild(index_fd, live, live_count);
+        }
+        flock(index_fd, LOCK_UN);
+        close(index_fd);
+    }
+    free(live);
     return cleaned_count;
 }
 
@@ -0,0 +1,721 @@
+/**
+ * jobs.c - Background Jobs
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * Runs a command line ending in '&' in the background of the session.
+ * The line is validated, authorized and authenticated by the main loop
+ * exactly like a foreground command; this file then forks a job runner
+ * in its own process group that executes it through the normal command,
+ * pipeline or command-list path with stdin from /dev/null and
+ * stdout/stderr captured to a private per-job file.  The jobs, fg, bg
+ * and wait built-ins operate on the resulting job table.
+ */
+
+#include "sudosh.h"
+
+static struct background_job job_table[MAX_JOBS];
+static char *job_output_dir = NULL;
+static volatile sig_atomic_t suspend_requested = 0;
+
+/**
+ * Remove a trailing background operator from a command line
+ *
+ * Returns 1 if a lone unquoted '&' ended the line (it is removed along
+ * with surrounding whitespace), 0 otherwise.  '&&' and '|&' are left alone.
+ */
+int strip_background_operator(char *command_line) {
+    if (!command_line) {
+        return 0;
+    }
+
+    size_t len = strlen(command_line);
+    while (len > 0 && isspace((unsigned char)command_line[len - 1])) {
+        len--;
+    }
+    if (len == 0 || command_line[len - 1] != '&') {
+        return 0;
+    }
+
+    /* The '&' must be outside quotes and not escaped */
+    char quote_char = 0;
+    for (size_t i = 0; i < len - 1; i++) {
+        char c = command_line[i];
+        if (c == '\\' && !quote_char) {
+            i++;
+            if (i == len - 1) {
+                return 0;
+            }
+        } else if (quote_char) {
+            if (c == quote_char) {
+                quote_char = 0;
+            }
+        } else if (c == '"' || c == '\'') {
+            quote_char = c;
+        }
+    }
+    if (quote_char) {
+        return 0;
+    }
+    if (len >= 2 && (command_line[len - 2] == '&' || command_line[len - 2] == '|')) {
+        return 0;
+    }
+
+    len--;
+    while (len > 0 && isspace((unsigned char)command_line[len - 1])) {
+        len--;
+    }
+    if (len == 0) {
+        return 0;
+    }
+    command_line[len] = '\0';
+    return 1;
+}
+
+/**
+ * Free a job table slot
+ */
+static void release_job(struct background_job *job) {
+    if (job->output_path) {
+        unlink(job->output_path);
+    }
+    free(job->command);
+    free(job->username);
+    free(job->target_user);
+    free(job->output_path);
+    memset(job, 0, sizeof(*job));
+}
+
+/**
+ * Create the private directory holding job output for this session
+ */
+static int ensure_job_output_dir(void) {
+    if (job_output_dir) {
+        return 0;
+    }
+
+    const char *tmpdir = getenv("TMPDIR");
+    char template[PATH_MAX];
+    if (geteuid() == 0 || !tmpdir || tmpdir[0] != '/') {
+        /* Never let a caller-controlled TMPDIR place privileged output */
+        tmpdir = "/tmp";
+    }
+    snprintf(template, sizeof(template), "%s/sudosh-jobs-XXXXXX", tmpdir);
+
+    if (!mkdtemp(template)) {
+        return -1;
+    }
+    job_output_dir = safe_strdup(template);
+    if (!job_output_dir) {
+        rmdir(template);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Pick a slot and job number for a new job
+ *
+ * Uses the lowest free number; when the table is full the oldest finished
+ * job whose output was never collected gives up its slot.
+ */
+static struct background_job *allocate_job(void) {
+    struct background_job *oldest_done = NULL;
+
+    for (int id = 1; id <= MAX_JOBS; id++) {
+        struct background_job *job = &job_table[id - 1];
+        if (job->state == JOB_FREE) {
+            job->id = id;
+            return job;
+        }
+        if (job->state == JOB_DONE && job->notified &&
+            (!oldest_done || job->start_us < oldest_done->start_us)) {
+            oldest_done = job;
+        }
+    }
+
+    if (oldest_done) {
+        int id = oldest_done->id;
+        release_job(oldest_done);
+        oldest_done->id = id;
+    }
+    return oldest_done;
+}
+
+/**
+ * Check whether a command line can run detached from the terminal
+ */
+int can_run_in_background(const char *command_line) {
+    /* Session built-ins only make sense in the session itself */
+    const char *builtin = builtin_command_name(command_line);
+    if (builtin) {
+        fprintf(stderr, "sudosh: built-in '%s' cannot run in the background\n", builtin);
+        return 0;
+    }
+
+    if (is_editing_command(command_line) || is_secure_pager(command_line)) {
+        fprintf(stderr, "sudosh: interactive commands cannot run in the background\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Body of the job runner: execute the command line and return its status
+ */
+static int run_job(const char *command_line, struct user_info *user, const char *username) {
+    int result;
+
+    if (is_command_list(command_line)) {
+        struct command_list list;
+        if (parse_command_list(command_line, &list) != 0) {
+            fprintf(stderr, "sudosh: failed to parse command list\n");
+            return EXIT_FAILURE;
+        }
+        result = execute_command_list(&list, user, username);
+        free_command_list(&list);
+    } else if (is_pipeline_command(command_line)) {
+        struct pipeline_info pipeline;
+        if (parse_pipeline(command_line, &pipeline) != 0) {
+            fprintf(stderr, "sudosh: failed to parse pipeline\n");
+            return EXIT_FAILURE;
+        }
+        result = execute_pipeline(&pipeline, user);
+        free_pipeline_info(&pipeline);
+    } else {
+        struct command_info cmd;
+        if (parse_command(command_line, &cmd) != 0) {
+            fprintf(stderr, "sudosh: failed to parse command\n");
+            return EXIT_FAILURE;
+        }
+        result = execute_command(&cmd, user);
+        free_command_info(&cmd);
+    }
+
+    return result < 0 ? EXIT_FAILURE : result;
+}
+
+/**
+ * Start an already authorized command line as a background job
+ *
+ * Returns the job number, or -1 if the job could not be started.
+ */
+int start_background_job(const char *command_line, struct user_info *user, const char *username) {
+    if (!command_line || !user || !username) {
+        return -1;
+    }
+    if (!can_run_in_background(command_line)) {
+        return -1;
+    }
+
+    struct background_job *job = allocate_job();
+    if (!job) {
+        fprintf(stderr, "sudosh: too many background jobs (limit %d)\n", MAX_JOBS);
+        return -1;
+    }
+    if (ensure_job_output_dir() != 0) {
+        fprintf(stderr, "sudosh: cannot create job output directory: %s\n", strerror(errno));
+        job->id = 0;
+        return -1;
+    }
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/job-%d.out", job_output_dir, job->id);
+    unlink(path);
+    int out_fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_TRUNC | O_CLOEXEC, 0600);
+    if (out_fd == -1) {
+        fprintf(stderr, "sudosh: cannot create job output file: %s\n", strerror(errno));
+        job->id = 0;
+        return -1;
+    }
+
+    job->command = safe_strdup(command_line);
+    job->username = safe_strdup(username);
+    job->target_user = target_user ? safe_strdup(target_user) : NULL;
+    job->output_path = safe_strdup(path);
+    if (!job->command || !job->username || !job->output_path ||
+        (target_user && !job->target_user)) {
+        close(out_fd);
+        unlink(path);
+        release_job(job);
+        return -1;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        close(out_fd);
+        release_job(job);
+        return -1;
+    }
+
+    if (pid == 0) {
+        /* Job runner: own process group so terminal signals stay with the session */
+        setpgid(0, 0);
+
+        int null_fd = open("/dev/null", O_RDONLY);
+        if (null_fd == -1 || dup2(null_fd, STDIN_FILENO) == -1 ||
+            dup2(out_fd, STDOUT_FILENO) == -1 || dup2(out_fd, STDERR_FILENO) == -1) {
+            _exit(EXIT_FAILURE);
+        }
+        close(null_fd);
+        close(out_fd);
+
+        int result = run_job(command_line, user, username);
+        fflush(NULL);
+        _exit(result & 0xff);
+    }
+
+    /* Parent: set the group here too so signals can target it immediately */
+    setpgid(pid, pid);
+    close(out_fd);
+
+    job->pid = pid;
+    job->state = JOB_RUNNING;
+    job->start_us = monotonic_usec();
+
+    syslog(LOG_INFO, "JOB_START: user=%s job=%d pid=%d command=%s%s%s output=%s",
+           username, job->id, (int)pid, command_line,
+           target_user ? " runas=" : "", target_user ? target_user : "", path);
+
+    printf("[%d] %d\n", job->id, (int)pid);
+    return job->id;
+}
+
+/**
+ * Record a finished job and log its completion
+ */
+static void finish_job(struct background_job *job, int status) {
+    job->state = JOB_DONE;
+    job->status = status;
+    job->elapsed_us = monotonic_usec() - job->start_us;
+
+    int exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    syslog(LOG_INFO, "JOB_DONE: user=%s job=%d pid=%d command=%s exit_code=%d elapsed_ms=%lld",
+           job->username, job->id, (int)job->pid, job->command, exit_code,
+           job->elapsed_us / 1000);
+
+    char log_message[1024];
+    if (job->target_user) {
+        snprintf(log_message, sizeof(log_message), "%s & (as %s)", job->command, job->target_user);
+    } else {
+        snprintf(log_message, sizeof(log_message), "%s &", job->command);
+    }
+    log_command_with_ansible_context(job->username, log_message, (exit_code == 0));
+}
+
+/**
+ * Poll one job without blocking; returns 1 once it has finished
+ */
+static int reap_job(struct background_job *job) {
+    int status;
+
+    if (job->state == JOB_DONE) {
+        return 1;
+    }
+    if (job->state == JOB_FREE) {
+        return 0;
+    }
+
+    pid_t r = waitpid(job->pid, &status, WNOHANG);
+    if (r == job->pid) {
+        finish_job(job, status);
+        return 1;
+    }
+    if (r == -1 && errno == ECHILD) {
+        /* Reaped elsewhere; the status is lost */
+        finish_job(job, W_EXITCODE(EXIT_FAILURE, 0));
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Describe a job's state the way 'jobs' prints it
+ */
+static void format_job_state(const struct background_job *job, char *buf, size_t size) {
+    if (job->state == JOB_RUNNING) {
+        snprintf(buf, size, "Running");
+    } else if (job->state == JOB_STOPPED) {
+        snprintf(buf, size, "Stopped");
+    } else if (WIFEXITED(job->status) && WEXITSTATUS(job->status) == 0) {
+        snprintf(buf, size, "Done");
+    } else if (WIFEXITED(job->status)) {
+        snprintf(buf, size, "Exit %d", WEXITSTATUS(job->status));
+    } else {
+        snprintf(buf, size, "Killed (signal %d)", WTERMSIG(job->status));
+    }
+}
+
+/**
+ * Check whether a job has output nobody has looked at yet
+ */
+static int has_unread_output(const struct background_job *job) {
+    struct stat st;
+    return job->output_path && stat(job->output_path, &st) == 0 &&
+           st.st_size > job->output_shown;
+}
+
+/**
+ * Print one job line
+ */
+static void print_job(const struct background_job *job, int long_format) {
+    char state[32];
+    format_job_state(job, state, sizeof(state));
+
+    if (long_format) {
+        printf("[%d]  %-6d %-20s %s &\n", job->id, (int)job->pid, state, job->command);
+        printf("        output: %s\n", job->output_path);
+    } else if (job->state == JOB_DONE && has_unread_output(job)) {
+        printf("[%d]  %-20s %s &  (output: fg %%%d)\n", job->id, state, job->command, job->id);
+    } else {
+        printf("[%d]  %-20s %s &\n", job->id, state, job->command);
+    }
+}
+
+/**
+ * Report jobs that finished since the last prompt
+ *
+ * Finished jobs without unread output are dropped from the table; the
+ * others stay listed until 'fg' shows their output.
+ */
+void notify_finished_jobs(void) {
+    for (int i = 0; i < MAX_JOBS; i++) {
+        struct background_job *job = &job_table[i];
+        if (job->state == JOB_FREE || !reap_job(job) || job->notified) {
+            continue;
+        }
+        print_job(job, 0);
+        job->notified = 1;
+        if (!has_unread_output(job)) {
+            release_job(job);
+        }
+    }
+}
+
+/**
+ * Number of jobs still running or stopped
+ */
+int count_active_jobs(void) {
+    int active = 0;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (job_table[i].state != JOB_FREE) {
+            reap_job(&job_table[i]);
+        }
+        if (job_table[i].state == JOB_RUNNING || job_table[i].state == JOB_STOPPED) {
+            active++;
+        }
+    }
+    return active;
+}
+
+/**
+ * Resolve a job spec: "%N", "N", "%+", "%%" or empty for the current job
+ *
+ * The current job is the most recently started job still running or
+ * stopped, or failing that the most recent finished job.
+ */
+struct background_job *find_job(const char *spec) {
+    if (spec && *spec && strcmp(spec, "%") != 0 && strcmp(spec, "%+") != 0 &&
+        strcmp(spec, "%%") != 0) {
+        const char *digits = (spec[0] == '%') ? spec + 1 : spec;
+        char *end;
+        errno = 0;
+        long id = strtol(digits, &end, 10);
+        if (errno || end == digits || *end || id < 1 || id > MAX_JOBS) {
+            return NULL;
+        }
+        struct background_job *job = &job_table[id - 1];
+        return job->state == JOB_FREE ? NULL : job;
+    }
+
+    struct background_job *current = NULL;
+    for (int pass = 0; pass < 2 && !current; pass++) {
+        for (int i = 0; i < MAX_JOBS; i++) {
+            struct background_job *job = &job_table[i];
+            int active = (job->state == JOB_RUNNING || job->state == JOB_STOPPED);
+            if (job->state == JOB_FREE || (pass == 0 && !active)) {
+                continue;
+            }
+            if (!current || job->start_us > current->start_us) {
+                current = job;
+            }
+        }
+    }
+    return current;
+}
+
+/**
+ * 'jobs' built-in
+ */
+void list_jobs(int long_format) {
+    for (int i = 0; i < MAX_JOBS; i++) {
+        struct background_job *job = &job_table[i];
+        if (job->state == JOB_FREE) {
+            continue;
+        }
+        reap_job(job);
+        print_job(job, long_format);
+        if (job->state == JOB_DONE) {
+            job->notified = 1;
+        }
+    }
+}
+
+/**
+ * Copy job output the terminal has not seen yet
+ */
+static void copy_job_output(struct background_job *job) {
+    int fd = open(job->output_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return;
+    }
+
+    char buf[8192];
+    ssize_t n;
+    while ((n = pread(fd, buf, sizeof(buf), job->output_shown)) > 0) {
+        if (fwrite(buf, 1, (size_t)n, stdout) != (size_t)n) {
+            break;
+        }
+        job->output_shown += n;
+    }
+    fflush(stdout);
+    close(fd);
+}
+
+/**
+ * Ctrl-Z while a job is in the foreground stops the job, not sudosh
+ */
+static void request_suspend(int sig) {
+    (void)sig;
+    suspend_requested = 1;
+}
+
+/**
+ * Sleep for one polling interval
+ */
+static void job_poll_sleep(void) {
+    struct timespec ts = { 0, JOB_POLL_INTERVAL_MS * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * Exit status of a finished job in shell terms
+ */
+static int job_exit_code(const struct background_job *job) {
+    if (WIFEXITED(job->status)) {
+        return WEXITSTATUS(job->status);
+    }
+    return 128 + WTERMSIG(job->status);
+}
+
+/**
+ * 'fg' built-in: follow a job's output until it finishes
+ *
+ * Ctrl-C interrupts the job and Ctrl-Z stops it and returns to the prompt.
+ * Returns the job's exit status, or -1 if there is no such job.
+ */
+int foreground_job(const char *spec) {
+    struct background_job *job = find_job(spec);
+    if (!job) {
+        fprintf(stderr, "fg: %s: no such job\n", (spec && *spec) ? spec : "current");
+        return -1;
+    }
+
+    printf("%s\n", job->command);
+    if (job->state == JOB_STOPPED) {
+        kill(-job->pid, SIGCONT);
+        job->state = JOB_RUNNING;
+    }
+
+    struct sigaction suspend_action, old_sigtstp;
+    suspend_action.sa_handler = request_suspend;
+    sigemptyset(&suspend_action.sa_mask);
+    suspend_action.sa_flags = 0;
+    sigaction(SIGTSTP, &suspend_action, &old_sigtstp);
+    suspend_requested = 0;
+    reset_sigint_flag();
+
+    while (!reap_job(job)) {
+        copy_job_output(job);
+        if (received_sigint_signal()) {
+            reset_sigint_flag();
+            /* The runner forwards it to every process of the job */
+            kill(job->pid, SIGINT);
+        }
+        if (suspend_requested || is_interrupted()) {
+            break;
+        }
+        job_poll_sleep();
+    }
+
+    sigaction(SIGTSTP, &old_sigtstp, NULL);
+    copy_job_output(job);
+
+    if (job->state != JOB_DONE) {
+        if (suspend_requested) {
+            kill(-job->pid, SIGTSTP);
+            job->state = JOB_STOPPED;
+            syslog(LOG_INFO, "JOB_STOPPED: user=%s job=%d pid=%d", job->username, job->id, (int)job->pid);
+            printf("\n");
+            print_job(job, 0);
+        }
+        suspend_requested = 0;
+        return 128 + SIGTSTP;
+    }
+
+    int exit_code = job_exit_code(job);
+    release_job(job);
+    return exit_code;
+}
+
+/**
+ * 'bg' built-in: let a stopped job continue in the background
+ */
+int resume_job_in_background(const char *spec) {
+    struct background_job *job = find_job(spec);
+    if (!job) {
+        fprintf(stderr, "bg: %s: no such job\n", (spec && *spec) ? spec : "current");
+        return -1;
+    }
+    if (job->state == JOB_DONE) {
+        fprintf(stderr, "bg: job %d has already completed\n", job->id);
+        return -1;
+    }
+    if (job->state == JOB_STOPPED) {
+        kill(-job->pid, SIGCONT);
+        job->state = JOB_RUNNING;
+        syslog(LOG_INFO, "JOB_CONTINUED: user=%s job=%d pid=%d", job->username, job->id, (int)job->pid);
+    }
+    printf("[%d]  %s &\n", job->id, job->command);
+    return 0;
+}
+
+/**
+ * 'wait' built-in: wait for one job, or for every running job
+ *
+ * Ctrl-C stops waiting without touching the jobs.  Returns the exit
+ * status of the (last) job waited for.
+ */
+int wait_for_jobs(const char *spec) {
+    struct background_job *target = NULL;
+    int exit_code = 0;
+
+    if (spec && *spec) {
+        target = find_job(spec);
+        if (!target) {
+            fprintf(stderr, "wait: %s: no such job\n", spec);
+            return 127;
+        }
+        if (target->state == JOB_STOPPED) {
+            fprintf(stderr, "wait: job %d is stopped\n", target->id);
+            return -1;
+        }
+    }
+
+    reset_sigint_flag();
+    for (;;) {
+        int pending = 0;
+        for (int i = 0; i < MAX_JOBS; i++) {
+            struct background_job *job = &job_table[i];
+            if (job->state != JOB_RUNNING || (target && job != target)) {
+                continue;
+            }
+            if (!reap_job(job)) {
+                pending++;
+            }
+        }
+        if (!pending) {
+            break;
+        }
+        if (received_sigint_signal() || is_interrupted()) {
+            reset_sigint_flag();
+            return 130;
+        }
+        job_poll_sleep();
+    }
+
+    /* Report what finished and pick the status to return */
+    long long latest = -1;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        struct background_job *job = &job_table[i];
+        if (job->state != JOB_DONE || (target && job != target)) {
+            continue;
+        }
+        if (target || job->start_us > latest) {
+            latest = job->start_us;
+            exit_code = job_exit_code(job);
+        }
+    }
+    notify_finished_jobs();
+    return exit_code;
+}
+
+/**
+ * Terminate remaining jobs and remove captured output at session end
+ */
+void cleanup_jobs(void) {
+    int active = 0;
+
+    for (int i = 0; i < MAX_JOBS; i++) {
+        struct background_job *job = &job_table[i];
+        if (job->state == JOB_RUNNING || job->state == JOB_STOPPED) {
+            if (!reap_job(job)) {
+                syslog(LOG_WARNING, "JOB_TERMINATED: user=%s job=%d pid=%d command=%s reason=session_end",
+                       job->username, job->id, (int)job->pid, job->command);
+                kill(-job->pid, SIGTERM);
+                kill(-job->pid, SIGCONT);
+                active++;
+            }
+        }
+    }
+
+    /* Same grace period as a supervised teardown, then force it */
+    long long deadline = monotonic_usec() + SUPERVISE_KILL_GRACE_MS * 1000LL;
+    while (active > 0) {
+        active = 0;
+        for (int i = 0; i < MAX_JOBS; i++) {
+            struct background_job *job = &job_table[i];
+            if (job->state == JOB_RUNNING || job->state == JOB_STOPPED) {
+                if (!reap_job(job)) {
+                    active++;
+                }
+            }
+        }
+        if (active == 0) {
+            break;
+        }
+        if (monotonic_usec() >= deadline) {
+            for (int i = 0; i < MAX_JOBS; i++) {
+                struct background_job *job = &job_table[i];
+                if (job->state == JOB_RUNNING || job->state == JOB_STOPPED) {
+                    kill(-job->pid, SIGKILL);
+                    kill(job->pid, SIGKILL);
+                    int status = W_EXITCODE(0, SIGKILL);
+                    while (waitpid(job->pid, &status, 0) == -1 && errno == EINTR) {
+                        /* Retry */
+                    }
+                    finish_job(job, status);
+                }
+            }
+            break;
+        }
+        job_poll_sleep();
+    }
+
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (job_table[i].state != JOB_FREE) {
+            release_job(&job_table[i]);
+        }
+    }
+
+    if (job_output_dir) {
+        rmdir(job_output_dir);
+        free(job_output_dir);
+        job_output_dir = NULL;
+    }
+}
@@ -24,16 +24,55 @@ static int history_logging_enabled = 0;
 static char **history_buffer = NULL;
 static int history_count = 0;
 static int history_capacity = 0;
+static char *history_arena = NULL;      /* File contents; loaded entries point into it */
+static size_t history_arena_size = 0;
 
 /* Global variable for duplicate command detection */
 static char *last_logged_command = NULL;
 
+/* A distinct security violation and the repeats not yet logged */
+struct violation_slot {
+    char *username;
+    char *violation;
+    const char *session_type;
+    uint64_t hash;
+    unsigned long suppressed;
+    time_t first_suppressed;
+    time_t last_suppressed;
+    long long last_seen;        /* monotonic_usec(), for eviction */
+    int syslog_pending;         /* First occurrence journaled but not yet in syslog */
+};
+
+/* Lines that may be logged now, refilled over time */
+struct violation_bucket {
+    double tokens;
+    long long refilled;         /* monotonic_usec() of the last refill */
+};
+
+/* Per-session rate limiting state for security violation logging */
+static struct violation_slot violation_slots[VIOLATION_LOG_SLOTS];
+static struct violation_bucket violation_repeats;       /* Repeats and their summaries */
+static struct violation_bucket violation_new;           /* First occurrences */
+static uint64_t violation_evicted[VIOLATION_LOG_EVICTED];   /* Hashes of evicted slots */
+static int violation_evicted_next = 0;
+static unsigned long violation_overflow = 0;    /* Held back by slots evicted with no token */
+static time_t violation_overflow_first;
+static time_t violation_overflow_last;
+static char *violation_overflow_user = NULL;
+static const char *violation_overflow_type = NULL;
+static unsigned long violation_journal_only = 0;    /* First occurrences never sent to syslog */
+static pid_t violation_owner = 0;
+
 /**
  * Initialize syslog for sudosh
+ *
+ * LOG_CONS is only used without the audit journal: when syslogd is down it
+ * writes every message to /dev/console synchronously, serializing all
+ * sessions on the host, while the journal already keeps the record.
  */
 void init_logging(void) {
     if (!logging_initialized) {
-        openlog("sudosh", LOG_PID | LOG_CONS, LOG_AUTHPRIV);
+        openlog("sudosh", LOG_PID | (audit_log_path() ? 0 : LOG_CONS), LOG_AUTHPRIV);
         logging_initialized = 1;
     }
 }
@@ -94,6 +133,10 @@ void log_command(const char *username, const char *command, int success) {
                username, session_type, tty, pwd, command);
     }
 
+    /* Commands are committed to the local journal before returning */
+    SUDOSH_PROBE3(log__command, username, command, success);
+    audit_record("COMMAND", username, success ? "ok" : "failed", command, 1);
+
     if (pwd) {
         free(pwd);
     }
@@ -136,6 +179,10 @@ void log_authentication(const char *username, int success) {
                "%s : TTY=%s ; authentication failed",
                username, tty);
     }
+
+    SUDOSH_PROBE2(log__auth, username, success);
+    metrics_count(success ? METRIC_AUTH_SUCCESS : METRIC_AUTH_FAILURE);
+    audit_record("AUTH", username, success ? "ok" : "failed", "authentication", 1);
 }
 
 /**
@@ -169,10 +216,12 @@ void log_session_start(const char *username) {
     syslog(LOG_INFO,
            "%s : TTY=%s ; session opened for user root",
            username, tty);
+    SUDOSH_PROBE2(log__session, username, 1);
+    audit_record("SESSION", username, "opened", "session opened", 1);
 }
 
 /**
- * Log session end
+ * Log session end, with the session's summary counters
  */
 void log_session_end(const char *username) {
     char hostname[256];
@@ -199,9 +248,18 @@ void log_session_end(const char *username) {
         }
     }
 
+    /* Counters and latencies gathered during the session, as one record */
+    char summary[1024];
+    if (format_session_summary(summary, sizeof(summary)) > 0) {
+        syslog(LOG_INFO, "%s : TTY=%s ; %s", username, tty, summary);
+        audit_record("SESSION", username, "summary", summary, 0);
+    }
+
     syslog(LOG_INFO,
            "%s : TTY=%s ; session closed for user root",
            username, tty);
+    SUDOSH_PROBE2(log__session, username, 0);
+    audit_record("SESSION", username, "closed", "session closed", 1);
 }
 
 /**
@@ -215,33 +273,240 @@ void log_error(const char *message) {
     syslog(LOG_ERROR, "error: %s", message);
 }
 
+/**
+ * Write one security violation line to syslog
+ */
+static void syslog_security_violation(const char *username, const char *session_type, const char *text) {
+    const char *tty = ttyname(STDIN_FILENO);
+
+    if (!tty) {
+        tty = "unknown";
+    } else if (strncmp(tty, "/dev/", 5) == 0) {
+        /* Remove /dev/ prefix if present */
+        tty += 5;
+    }
+
+    syslog(LOG_WARNING,
+           "%s : %s: TTY=%s ; SECURITY VIOLATION: %s",
+           username, session_type, tty, text);
+}
+
+/**
+ * Write one security violation line to syslog and the audit journal
+ */
+static void emit_security_violation(const char *username, const char *session_type, const char *text) {
+    syslog_security_violation(username, session_type, text);
+
+    /* Violations can come in bursts; they are batched into one commit */
+    audit_record("VIOLATION", username, session_type, text, 0);
+}
+
+/**
+ * Log a violation held back from syslog: its first occurrence, if only
+ * the journal has it, then its repeats as one line
+ */
+static void flush_violation_slot(struct violation_slot *slot) {
+    char first[32], last[32], *summary;
+    struct tm tm;
+
+    if (slot->syslog_pending) {
+        syslog_security_violation(slot->username, slot->session_type, slot->violation);
+        slot->syslog_pending = 0;
+    }
+    if (slot->suppressed == 0) {
+        return;
+    }
+    localtime_r(&slot->first_suppressed, &tm);
+    strftime(first, sizeof(first), "%Y-%m-%d %H:%M:%S", &tm);
+    localtime_r(&slot->last_suppressed, &tm);
+    strftime(last, sizeof(last), "%Y-%m-%d %H:%M:%S", &tm);
+
+    size_t size = strlen(slot->violation) + 128;
+    summary = malloc(size);
+    if (summary) {
+        snprintf(summary, size, "last message repeated %lu times (first %s, last %s): %s",
+                 slot->suppressed, first, last, slot->violation);
+        emit_security_violation(slot->username, slot->session_type, summary);
+        free(summary);
+    }
+    slot->suppressed = 0;
+}
+
+/**
+ * Log the count of violations that lost their slot before they could be
+ * reported, as one line
+ */
+static void flush_violation_overflow(void) {
+    char first[32], last[32], summary[160];
+    struct tm tm;
+
+    if (violation_overflow == 0) {
+        return;
+    }
+    localtime_r(&violation_overflow_first, &tm);
+    strftime(first, sizeof(first), "%Y-%m-%d %H:%M:%S", &tm);
+    localtime_r(&violation_overflow_last, &tm);
+    strftime(last, sizeof(last), "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(summary, sizeof(summary), "%lu more violations not logged individually (first %s, last %s)",
+             violation_overflow, first, last);
+    emit_security_violation(violation_overflow_user ? violation_overflow_user : "unknown",
+                            violation_overflow_type, summary);
+    violation_overflow = 0;
+}
+
+/**
+ * Tell syslog how many first occurrences it never saw; the audit journal
+ * has each of them in full
+ */
+static void flush_violation_journal_only(void) {
+    char summary[96];
+
+    if (violation_journal_only == 0) {
+        return;
+    }
+    snprintf(summary, sizeof(summary), "%lu more violations recorded only in the audit journal",
+             violation_journal_only);
+    syslog_security_violation(violation_overflow_user ? violation_overflow_user : "unknown",
+                              violation_overflow_type ? violation_overflow_type : "INTERACTIVE_SESSION",
+                              summary);
+    violation_journal_only = 0;
+}
+
+/**
+ * Forget violations inherited from a parent process; they are the parent's to report
+ */
+static void reset_violation_limiter(void) {
+    for (int i = 0; i < VIOLATION_LOG_SLOTS; i++) {
+        free(violation_slots[i].username);
+        free(violation_slots[i].violation);
+    }
+    memset(violation_slots, 0, sizeof(violation_slots));
+    memset(violation_evicted, 0, sizeof(violation_evicted));
+    violation_evicted_next = 0;
+    violation_overflow = 0;
+    violation_journal_only = 0;
+    free(violation_overflow_user);
+    violation_overflow_user = NULL;
+    violation_repeats.tokens = violation_new.tokens = VIOLATION_LOG_BURST;
+    violation_repeats.refilled = violation_new.refilled = monotonic_usec();
+    violation_owner = getpid();
+}
+
+/**
+ * Take a token from one of the session's buckets, refilling it for the time passed
+ */
+static int take_violation_token(struct violation_bucket *bucket, long long now) {
+    bucket->tokens += (double)(now - bucket->refilled) * VIOLATION_LOG_RATE / 1e6;
+    if (bucket->tokens > VIOLATION_LOG_BURST) {
+        bucket->tokens = VIOLATION_LOG_BURST;
+    }
+    bucket->refilled = now;
+    if (bucket->tokens < 1.0) {
+        return 0;
+    }
+    bucket->tokens -= 1.0;
+    return 1;
+}
+
+/**
+ * Report the summary lines under the user of the slot last folded into them
+ */
+static void keep_overflow_owner(struct violation_slot *slot) {
+    if (slot->username) {
+        free(violation_overflow_user);
+        violation_overflow_user = slot->username;
+        violation_overflow_type = slot->session_type;
+        slot->username = NULL;
+    }
+}
+
+/**
+ * Free a slot for another violation
+ *
+ * A first occurrence syslog has not seen yet is sent there if the
+ * first-occurrence bucket allows and is otherwise counted (the audit
+ * journal already has it).  Repeats it still holds are logged if the
+ * repeat bucket allows and are otherwise added to the overflow count.
+ * Its hash is remembered so that the violation counts as a repeat when it
+ * comes back.
+ */
+static void evict_violation_slot(struct violation_slot *slot, long long now) {
+    if (slot->violation) {
+        if (slot->syslog_pending) {
+            if (take_violation_token(&violation_new, now)) {
+                syslog_security_violation(slot->username, slot->session_type, slot->violation);
+            } else {
+                violation_journal_only++;
+                keep_overflow_owner(slot);
+            }
+            slot->syslog_pending = 0;
+        }
+        if (slot->suppressed > 0 && take_violation_token(&violation_repeats, now)) {
+            flush_violation_slot(slot);
+        } else if (slot->suppressed > 0) {
+            if (violation_overflow == 0 || slot->first_suppressed < violation_overflow_first) {
+                violation_overflow_first = slot->first_suppressed;
+            }
+            if (violation_overflow == 0 || slot->last_suppressed > violation_overflow_last) {
+                violation_overflow_last = slot->last_suppressed;
+            }
+            violation_overflow += slot->suppressed;
+            keep_overflow_owner(slot);
+        }
+        violation_evicted[violation_evicted_next] = slot->hash;
+        violation_evicted_next = (violation_evicted_next + 1) % VIOLATION_LOG_EVICTED;
+    }
+    free(slot->username);
+    free(slot->violation);
+    memset(slot, 0, sizeof(*slot));
+}
+
+/**
+ * Check whether a violation was seen before and lost its slot
+ */
+static int violation_was_evicted(uint64_t hash) {
+    for (int i = 0; i < VIOLATION_LOG_EVICTED; i++) {
+        if (violation_evicted[i] == hash) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 /**
  * Log security violations
+ *
+ * Repeats share a per-session token bucket (VIOLATION_LOG_BURST,
+ * refilled at VIOLATION_LOG_RATE per second) and first occurrences of
+ * distinct violations draw on a second one of the same size, so a loop
+ * over one message does not hide new ones and a loop over many distinct
+ * messages is limited too; the limit applies to syslog only, and a first
+ * occurrence over it is still written to the audit journal in full and
+ * sent to syslog later.  A violation whose slot was evicted counts as a
+ * repeat when it returns.  Repeats over the limit are counted and later
+ * logged as one "last message repeated N times" line with the first and
+ * last times, or, if their slot is evicted while no token is left, in one
+ * "N more violations not logged individually" line at the end of the
+ * session, so syslog cannot be flooded while every occurrence is still
+ * accounted for.
  */
 void log_security_violation(const char *username, const char *violation) {
-    char hostname[256];
-    char *tty;
+    struct violation_slot *slot = NULL, *victim = NULL;
 
     if (!logging_initialized) {
         init_logging();
     }
-
-    /* Get hostname */
-    if (gethostname(hostname, sizeof(hostname)) != 0) {
-        strncpy(hostname, "unknown", sizeof(hostname) - 1);
-        hostname[sizeof(hostname) - 1] = '\0';
+    if (violation_owner != getpid()) {
+        reset_violation_limiter();
     }
-
-    /* Get TTY */
-    tty = ttyname(STDIN_FILENO);
-    if (!tty) {
-        tty = "unknown";
-    } else {
-        /* Remove /dev/ prefix if present */
-        if (strncmp(tty, "/dev/", 5) == 0) {
-            tty += 5;
-        }
+    if (!username) {
+        username = "unknown";
     }
+    if (!violation) {
+        violation = "";
+    }
+    /* Fires for every violation, including repeats the rate limit holds back */
+    SUDOSH_PROBE2(log__violation, username, violation);
 
     /* Get session type indicator */
     extern struct ansible_detection_info *global_ansible_info;
@@ -254,15 +519,110 @@ void log_security_violation(const char *username, const char *violation) {
         session_type = "ANSIBLE_SESSION";
     }
 
-    syslog(LOG_WARNING,
-           "%s : %s: TTY=%s ; SECURITY VIOLATION: %s",
-           username, session_type, tty, violation);
+    /* FNV-1a over user, session type and message */
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const char *parts[3] = { username, session_type, violation };
+    for (int p = 0; p < 3; p++) {
+        for (const char *c = parts[p]; ; c++) {
+            hash = (hash ^ (unsigned char)*c) * 0x100000001b3ULL;
+            if (!*c) {
+                break;
+            }
+        }
+    }
+
+    long long now = monotonic_usec();
+    for (int i = 0; i < VIOLATION_LOG_SLOTS; i++) {
+        struct violation_slot *s = &violation_slots[i];
+        if (s->violation && s->hash == hash && s->session_type == session_type &&
+            strcmp(s->username, username) == 0 && strcmp(s->violation, violation) == 0) {
+            slot = s;
+            break;
+        }
+        /* Reuse a free slot, else the one seen least recently */
+        if (!s->violation) {
+            if (!victim || victim->violation) {
+                victim = s;
+            }
+        } else if (!victim || (victim->violation && s->last_seen < victim->last_seen)) {
+            victim = s;
+        }
+    }
+
+    if (!slot) {
+        /* Not tracked: new, or back after its slot was evicted */
+        struct violation_bucket *bucket = violation_was_evicted(hash) ? &violation_repeats : &violation_new;
+        evict_violation_slot(victim, now);
+        victim->username = safe_strdup(username);
+        victim->violation = safe_strdup(violation);
+        if (victim->username && victim->violation) {
+            victim->session_type = session_type;
+            victim->hash = hash;
+            victim->last_seen = now;
+        } else {
+            free(victim->username);
+            free(victim->violation);
+            victim->username = victim->violation = NULL;
+        }
+        if (take_violation_token(bucket, now)) {
+            emit_security_violation(username, session_type, violation);
+        } else if (bucket == &violation_new) {
+            /* The journal keeps every distinct violation; only syslog waits */
+            audit_record("VIOLATION", username, session_type, violation, 0);
+            if (victim->violation) {
+                victim->syslog_pending = 1;
+            } else {
+                violation_journal_only++;
+            }
+        } else if (victim->violation) {
+            victim->suppressed = 1;
+            victim->first_suppressed = victim->last_suppressed = time(NULL);
+        }
+        return;
+    }
+
+    slot->last_seen = now;
+    if (!take_violation_token(&violation_repeats, now)) {
+        time_t wall = time(NULL);
+        if (slot->suppressed++ == 0) {
+            slot->first_suppressed = wall;
+        }
+        slot->last_suppressed = wall;
+        return;
+    }
+
+    if (slot->suppressed > 0) {
+        /* This repeat is reported with the ones held back */
+        slot->suppressed++;
+        slot->last_suppressed = time(NULL);
+        flush_violation_slot(slot);
+    } else {
+        emit_security_violation(username, session_type, violation);
+    }
+}
+
+/**
+ * Log every violation repeat still held back by the rate limiter
+ */
+void flush_security_violations(void) {
+    if (violation_owner != getpid()) {
+        return;
+    }
+    for (int i = 0; i < VIOLATION_LOG_SLOTS; i++) {
+        if (violation_slots[i].violation) {
+            flush_violation_slot(&violation_slots[i]);
+        }
+    }
+    flush_violation_overflow();
+    flush_violation_journal_only();
 }
 
 /**
  * Close logging
  */
 void close_logging(void) {
+    flush_security_violations();
+    close_audit_journal();
     if (logging_initialized) {
         closelog();
         logging_initialized = 0;
@@ -374,6 +734,20 @@ void close_session_logging(void) {
     }
 }
 
+/**
+ * Path of the history file under a home directory (SUDOSH_HISTORY_FILE in test mode)
+ */
+void get_history_path(const char *home_dir, char *buf, size_t size) {
+    extern int test_mode;
+    const char *override = getenv("SUDOSH_HISTORY_FILE");
+
+    if (test_mode && override && *override) {
+        snprintf(buf, size, "%s", override);
+    } else {
+        snprintf(buf, size, "%s/.sudosh_history", home_dir);
+    }
+}
+
 /**
  * Initialize command history logging
  */
@@ -392,7 +766,7 @@ int init_command_history(const char *username) {
     }
 
     /* Create history file path */
-    snprintf(history_path, sizeof(history_path), "%s/.sudosh_history", pwd->pw_dir);
+    get_history_path(pwd->pw_dir, history_path, sizeof(history_path));
 
     /* Open history file for appending */
     history_file = fopen(history_path, "a");
@@ -447,8 +821,20 @@ void log_command_history(const char *command) {
     tm_info = localtime(&now);
     strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
 
-    fprintf(history_file, "[%s] %s\n", timestamp, command);
-    fflush(history_file);
+    /* One write() per entry: the file is opened O_APPEND, so entries from
+       concurrent sessions sharing a history file never interleave */
+    char entry[MAX_COMMAND_LENGTH + 96];
+    int len = snprintf(entry, sizeof(entry), "[%s] %s\n", timestamp, command);
+    if (len < 0) {
+        return;
+    }
+    if ((size_t)len >= sizeof(entry)) {
+        len = (int)sizeof(entry) - 1;
+        entry[len - 1] = '\n';
+    }
+    if (write(fileno(history_file), entry, (size_t)len) != len) {
+        /* History is best effort, as before */
+    }
 }
 
 /**
@@ -474,14 +860,24 @@ void close_command_history(void) {
     }
 }
 
+/**
+ * True if a history entry points into the arena rather than its own allocation
+ */
+static int history_in_arena(const char *entry) {
+    return history_arena && entry >= history_arena && entry < history_arena + history_arena_size;
+}
+
 /**
  * Load command history into memory buffer for navigation
+ *
+ * The file is shared by every session of the user and only grows, so it
+ * is read with one read() into an arena and entries point into it rather
+ * than being copied line by line.
  */
 int load_history_buffer(void) {
     char history_path[PATH_MAX];
-    FILE *file;
-    char line[1024];
     struct passwd *pwd;
+    struct stat st;
 
     /* Get current user's home directory */
     pwd = getpwuid(getuid());
@@ -490,58 +886,75 @@ int load_history_buffer(void) {
     }
 
     /* Build history file path */
-    snprintf(history_path, sizeof(history_path), "%s/.sudosh_history", pwd->pw_dir);
+    get_history_path(pwd->pw_dir, history_path, sizeof(history_path));
 
     /* Open history file */
-    file = fopen(history_path, "r");
-    if (!file) {
+    int fd = open(history_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
         /* No history file exists yet, that's okay */
         return 0;
     }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return 0;
+    }
 
     /* Initialize history buffer */
     history_capacity = 100;
     history_buffer = malloc(history_capacity * sizeof(char *));
     if (!history_buffer) {
-        fclose(file);
+        close(fd);
         return -1;
     }
 
-    /* Read history entries */
-    while (fgets(line, sizeof(line), file)) {
-        /* Remove trailing newline */
-        size_t len = strlen(line);
-        if (len > 0 && line[len - 1] == '\n') {
-            line[len - 1] = '\0';
-        }
-
-        /* Skip empty lines */
-        if (strlen(line) == 0) {
+    /* Read the whole file; entries appended meanwhile wait for the next session */
+    size_t size = (size_t)st.st_size;
+    history_arena = malloc(size + 1);
+    if (!history_arena) {
+        close(fd);
+        return -1;
+    }
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = read(fd, history_arena + got, size - got);
+        if (n < 0 && errno == EINTR) {
             continue;
         }
-
-        /* Expand buffer if needed */
-        if (history_count >= history_capacity) {
-            history_capacity *= 2;
-            char **new_buffer = realloc(history_buffer, history_capacity * sizeof(char *));
-            if (!new_buffer) {
-                break;
-            }
-            history_buffer = new_buffer;
+        if (n <= 0) {
+            break;
+        }
+        got += (size_t)n;
+    }
+    close(fd);
+    history_arena[got] = '\0';
+    history_arena_size = got + 1;
+
+    /* Split into entries in place */
+    char *line = history_arena;
+    while (line < history_arena + got) {
+        char *newline = memchr(line, '\n', (size_t)(history_arena + got - line));
+        char *next = newline ? newline + 1 : history_arena + got;
+        if (newline) {
+            *newline = '\0';
         }
 
-        /* Extract just the command part (after timestamp) */
-        char *command_start = strchr(line, ']');
+        /* Extract just the command part (after timestamp), skipping empty lines */
+        char *command_start = *line ? strchr(line, ']') : NULL;
         if (command_start && command_start[1] == ' ') {
-            command_start += 2;  /* Skip "] " */
-            history_buffer[history_count] = safe_strdup(command_start);
-            if (history_buffer[history_count]) {
-                history_count++;
+            /* Expand buffer if needed */
+            if (history_count >= history_capacity) {
+                char **new_buffer = realloc(history_buffer, history_capacity * 2 * sizeof(char *));
+                if (!new_buffer) {
+                    break;
+                }
+                history_buffer = new_buffer;
+                history_capacity *= 2;
             }
+            history_buffer[history_count++] = command_start + 2;  /* Skip "] " */
         }
+        line = next;
     }
 
-    fclose(file);
     return 0;
 }
 
@@ -551,13 +964,18 @@ int load_history_buffer(void) {
 void free_history_buffer(void) {
     if (history_buffer) {
         for (int i = 0; i < history_count; i++) {
-            free(history_buffer[i]);
+            if (!history_in_arena(history_buffer[i])) {
+                free(history_buffer[i]);
+            }
         }
         free(history_buffer);
         history_buffer = NULL;
         history_count = 0;
         history_capacity = 0;
     }
+    free(history_arena);
+    history_arena = NULL;
+    history_arena_size = 0;
 }
 
 /**
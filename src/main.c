@@ -48,6 +48,34 @@ struct ai_detection_info *global_ai_info = NULL;
 int sudo_compat_mode_flag = 0;
 int non_interactive_mode_flag = 0;
 
+/* session_watch from the configuration file */
+static int session_watch_configured = 0;
+
+/**
+ * Load command time limits, session watch and audit forwarding settings from the configuration file
+ */
+static void load_runtime_config(void) {
+    sudosh_config_t *cfg = sudosh_config_init();
+    if (!cfg) {
+        return;
+    }
+    const char *paths[] = { "/etc/sudosh.conf", "/usr/local/etc/sudosh.conf", NULL };
+    for (int pi = 0; paths[pi]; ++pi) {
+        sudosh_config_load(cfg, paths[pi]);
+    }
+    if (cfg->command_timeout >= 0 && cfg->command_timeout <= 86400) {
+        set_command_timeout(NULL, cfg->command_timeout);
+    }
+    session_watch_configured = cfg->session_watch;
+    if (cfg->audit_forward_socket) {
+        audit_forward_configure(cfg->audit_forward_socket);
+    }
+    sudosh_config_free(cfg);
+}
+
+static int plan_command_list(const char *username, const char *command_line,
+                             struct command_list *list, int has_sudo_privileges);
+
 /**
  * Execute a single command and exit (like sudo)
  */
@@ -57,6 +85,8 @@ static int execute_single_command(const char *command_str, const char *target_us
     int result;
     char *username;
 
+    metrics_count(METRIC_INVOCATIONS_COMMAND);
+
     /* Initialize logging */
     init_logging();
 
@@ -126,6 +156,23 @@ static int execute_single_command(const char *command_str, const char *target_us
         return EXIT_FAILURE;
     }
 
+    /* Command lists are validated, authorized and authenticated element by
+     * element, as in the interactive shell, before anything runs */
+    if (is_command_list(command_str)) {
+        struct command_list list;
+        if (plan_command_list(username, command_str, &list,
+                              check_sudo_privileges_enhanced(username)) != 0) {
+            free_user_info(user);
+            free(username);
+            return EXIT_FAILURE;
+        }
+        result = execute_command_list(&list, user, username);
+        free_command_list(&list);
+        free_user_info(user);
+        free(username);
+        return result;
+    }
+
     /* Validate command early to honor security policy */
     int valid = validate_command(command_str);
     diag_logf("-c mode validate=%d for cmd='%s'", valid, command_str);
@@ -164,6 +211,308 @@ static int execute_single_command(const char *command_str, const char *target_us
     return result;
 }
 
+/**
+ * Check an Ansible become-success marker before echoing it
+ */
+static int is_valid_become_marker(const char *marker) {
+    if (!marker || !*marker || strlen(marker) > 128) {
+        return 0;
+    }
+    for (const char *p = marker; *p; p++) {
+        if (!isalnum((unsigned char)*p) && *p != '-') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Run an Ansible pipelined module: INTERPRETER with the module on stdin
+ *
+ * stdin carries the module source, so there is no way to prompt for a
+ * password; the user must have NOPASSWD rights (or a cached authentication)
+ * and the session must be detected as Ansible.  The interpreter is checked
+ * against the pipelining whitelist and sudoers, the payload is spooled and
+ * logged with its SHA-256, and only then is the module run.
+ */
+static int execute_ansible_pipeline(const char *interpreter, const char *success_marker,
+                                    const char *target_user) {
+    struct user_info *user;
+    char *username;
+    char *interpreter_path;
+    int result;
+
+    metrics_count(METRIC_INVOCATIONS_ANSIBLE);
+    init_logging();
+    init_security();
+    if (init_file_locking() != 0) {
+        fprintf(stderr, "sudosh: warning: file locking system unavailable\n");
+    }
+
+    struct passwd *pwd = getpwuid(getuid());
+    if (!pwd) {
+        fprintf(stderr, "sudosh: failed to determine current user\n");
+        return EXIT_FAILURE;
+    }
+    username = safe_strdup(pwd->pw_name);
+    if (!username) {
+        fprintf(stderr, "sudosh: failed to allocate memory for username\n");
+        return EXIT_FAILURE;
+    }
+    set_current_username(username);
+
+    if (ansible_detection_enabled) {
+        global_ansible_info = detect_ansible_session();
+        if (ansible_detection_force && global_ansible_info) {
+            global_ansible_info->is_ansible_session = 1;
+            global_ansible_info->method = ANSIBLE_DETECTION_FORCED;
+            global_ansible_info->confidence_level = 100;
+            snprintf(global_ansible_info->detection_details,
+                     sizeof(global_ansible_info->detection_details),
+                     "%s", "forced via command line");
+        }
+        if (global_ansible_info) {
+            log_ansible_detection(global_ansible_info);
+        }
+    }
+    if (!test_mode && (!global_ansible_info || !global_ansible_info->is_ansible_session)) {
+        fprintf(stderr, "sudosh: --ansible-pipeline requires an Ansible session\n");
+        log_security_violation(username, "pipelined module outside Ansible session");
+        free(username);
+        return EXIT_FAILURE;
+    }
+
+    if (interpreter[0] == '/') {
+        interpreter_path = safe_strdup(interpreter);
+    } else {
+        interpreter_path = find_command_in_path(interpreter);
+    }
+    if (!interpreter_path || !is_pipelining_interpreter(interpreter_path)) {
+        fprintf(stderr, "sudosh: '%s' is not an allowed pipelining interpreter\n", interpreter);
+        log_security_violation(username, "pipelined module with disallowed interpreter");
+        free(interpreter_path);
+        free(username);
+        return EXIT_FAILURE;
+    }
+
+    if (!test_mode && !check_command_permission(username, interpreter_path)) {
+        fprintf(stderr, "sudosh: %s is not allowed to run '%s' according to sudoers configuration\n",
+                username, interpreter_path);
+        log_security_violation(username, "pipelined interpreter not permitted by sudoers");
+        free(interpreter_path);
+        free(username);
+        return EXIT_FAILURE;
+    }
+
+    /* The payload occupies stdin, so a password prompt is impossible */
+    int has_nopasswd = test_mode ||
+                       check_nopasswd_privileges_with_command(username, interpreter_path) ||
+                       check_auth_cache(username);
+    if (!has_nopasswd) {
+        fprintf(stderr, "sudosh: password required; Ansible pipelining needs NOPASSWD\n");
+        log_security_violation(username, "pipelined module without NOPASSWD");
+        free(interpreter_path);
+        free(username);
+        return EXIT_AUTH_FAILURE;
+    }
+    log_authentication_with_ansible_context(username, 1);
+
+    user = get_user_info(test_mode ? username : (target_user ? target_user : "root"));
+    if (!user) {
+        fprintf(stderr, "sudosh: failed to get user information\n");
+        free(interpreter_path);
+        free(username);
+        return EXIT_FAILURE;
+    }
+
+    if (success_marker) {
+        printf("%s\n", success_marker);
+        fflush(stdout);
+    }
+
+    int spool_fd = -1;
+    size_t payload_len = 0;
+    char digest[SHA256_HEX_LENGTH + 1];
+    if (capture_pipelined_payload(STDIN_FILENO, &spool_fd, &payload_len, digest) != 0) {
+        fprintf(stderr, "sudosh: failed to read pipelined module\n");
+        log_security_violation(username, "pipelined module capture failed");
+        free_user_info(user);
+        free(interpreter_path);
+        free(username);
+        return EXIT_FAILURE;
+    }
+
+    char audit[PATH_MAX + 128];
+    snprintf(audit, sizeof(audit), "pipelined module: %s bytes=%zu sha256=%s",
+             interpreter_path, payload_len, digest);
+    log_command_with_ansible_context(username, audit, 0);
+
+    result = execute_pipelined_module(interpreter_path, spool_fd, user);
+
+    close(spool_fd);
+    free_user_info(user);
+    free(interpreter_path);
+    free(username);
+    return result;
+}
+
+/**
+ * Check that the user may run a command line (simple command or pipeline)
+ */
+static int authorize_command_line(const char *username, const char *command_line,
+                                  int has_sudo_privileges) {
+    /* First check if it's a safe command - these are always allowed */
+    if (is_safe_command(command_line)) {
+        /* Safe command - allow it regardless of sudo privileges */
+        return 1;
+    }
+
+    if (!has_sudo_privileges) {
+        fprintf(stderr, "sudosh: %s is not in the sudoers file and '%s' is not a safe command\n",
+                username, command_line);
+        fprintf(stderr, "Available safe commands: ls, pwd, whoami, id, date, uptime, w, who, last\n");
+        log_security_violation(username, "attempted privileged command without sudoers access");
+        session_stats_denied(SESSION_DENY_PERMISSION);
+        return 0;
+    }
+
+    if (!check_command_permission(username, command_line)) {
+        /* User has sudo privileges but not for this specific command */
+        fprintf(stderr, "sudosh: %s is not allowed to run '%s' according to sudoers configuration\n",
+                username, command_line);
+        log_security_violation(username, "attempted command not permitted by sudoers");
+        session_stats_denied(SESSION_DENY_PERMISSION);
+        return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Authenticate for a command that needs it despite NOPASSWD or is conditionally blocked
+ */
+static int authenticate_for_command_line(const char *username, const char *command_line) {
+    /* Check if this command requires authentication despite NOPASSWD */
+    if (should_require_authentication(username, command_line)) {
+        /* This command requires authentication in the current environment */
+        if (!authenticate_user_cached(username)) {
+            fprintf(stderr, "sudosh: authentication required for command '%s' in editor environment\n", command_line);
+            fprintf(stderr, "sudosh: reason: %s\n", get_danger_explanation(command_line));
+            session_stats_denied(SESSION_DENY_AUTHENTICATION);
+            return 0;
+        }
+    }
+
+    /* Check if this is a conditionally blocked command requiring authentication */
+    if (is_conditionally_blocked_command(command_line)) {
+        /* Check if user has authorization */
+        if (!check_conditionally_blocked_command_authorization(username, command_line)) {
+            fprintf(stderr, "sudosh: command '%s' requires sudo privileges\n", command_line);
+            session_stats_denied(SESSION_DENY_AUTHENTICATION);
+            return 0;
+        }
+
+        /* User has authorization, but check if authentication is needed */
+        if (!check_nopasswd_privileges_enhanced(username)) {
+            /* User doesn't have NOPASSWD, require authentication */
+            if (!authenticate_user_cached(username)) {
+                fprintf(stderr, "sudosh: authentication required for command '%s'\n", command_line);
+                session_stats_denied(SESSION_DENY_AUTHENTICATION);
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Parse, validate, authorize and authenticate every element of a command list
+ *
+ * On success the parsed list is left in *list for the caller to run and free.
+ */
+static int plan_command_list(const char *username, const char *command_line,
+                             struct command_list *list, int has_sudo_privileges) {
+    if (parse_command_list(command_line, list) != 0) {
+        fprintf(stderr, "sudosh: failed to parse command list\n");
+        return -1;
+    }
+
+    if (!validate_command_list(list)) {
+        fprintf(stderr, "sudosh: command rejected for security reasons\n");
+        log_security_violation(username, "command list rejected");
+        session_stats_denied(SESSION_DENY_VALIDATION);
+        free_command_list(list);
+        return -1;
+    }
+
+    for (int i = 0; i < list->num_elements; i++) {
+        const char *element = list->elements[i].command;
+        if (!authorize_command_line(username, element, has_sudo_privileges) ||
+            (!is_pipeline_command(element) && !authenticate_for_command_line(username, element))) {
+            free_command_list(list);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Run a command list (;, &&, ||) as one plan
+ *
+ * Every element is validated, authorized and authenticated before the
+ * first one runs; a single rejected element rejects the whole line.
+ */
+static int run_command_list(const char *username, const char *command_line,
+                            struct user_info *user, int has_sudo_privileges) {
+    struct command_list list;
+
+    if (plan_command_list(username, command_line, &list, has_sudo_privileges) != 0) {
+        return -1;
+    }
+
+    int result = execute_command_list(&list, user, username);
+    free_command_list(&list);
+    return result;
+}
+
+/**
+ * Start a command line ending in '&' as a background job
+ *
+ * The line goes through the same validation, authorization and
+ * authentication as in the foreground before anything is started.
+ */
+static void run_background_command_line(const char *username, const char *command_line,
+                                        struct user_info *user, int has_sudo_privileges) {
+    if (!can_run_in_background(command_line)) {
+        return;
+    }
+
+    if (is_command_list(command_line)) {
+        struct command_list list;
+        if (plan_command_list(username, command_line, &list, has_sudo_privileges) != 0) {
+            return;
+        }
+        free_command_list(&list);
+    } else {
+        if (!validate_command(command_line)) {
+            fprintf(stderr, "sudosh: command rejected for security reasons\n");
+            session_stats_denied(SESSION_DENY_VALIDATION);
+            return;
+        }
+        if (!authorize_command_line(username, command_line, has_sudo_privileges)) {
+            return;
+        }
+        if (!is_pipeline_command(command_line) &&
+            !authenticate_for_command_line(username, command_line)) {
+            return;
+        }
+    }
+
+    start_background_job(command_line, user, username);
+}
+
 /**
  * Main program loop - interactive shell
  */
@@ -174,6 +523,9 @@ int main_loop(void) {
     struct command_info cmd;
     int result;
     int builtin_result;
+    int jobs_exit_warned = 0;
+
+    metrics_count(METRIC_INVOCATIONS_INTERACTIVE);
 
     /* Get current username */
     username = get_current_username();
@@ -313,11 +665,21 @@ int main_loop(void) {
     /* Log session start with Ansible context */
     log_session_start_with_ansible_context(username);
 
+    /* Interactive sessions can be observed live with sudosh --watch */
+    if (session_watch_configured && isatty(STDIN_FILENO)) {
+        watch_session_start(username, target_user);
+    }
+
     /* Print banner */
     print_banner();
 
     /* Main command loop */
     while (!is_interrupted()) {
+        /* Report background jobs that finished since the last prompt */
+        notify_finished_jobs();
+        int exit_warned = jobs_exit_warned;
+        jobs_exit_warned = 0;
+
         /* Read command from user */
         command_line = read_command();
         if (!command_line) {
@@ -336,6 +698,7 @@ int main_loop(void) {
 
         /* Log the input command */
         log_session_input(command_line);
+        watch_record_input(command_line);
 
         /* Expand history references (e.g., !1, !42) */
         char *expanded_command = expand_history(command_line);
@@ -367,10 +730,33 @@ int main_loop(void) {
         /* Add command to in-memory history buffer for immediate arrow key access */
         add_to_history_buffer(command_line);
 
+        /* A trailing '&' starts the line as a background job */
+        if (strip_background_operator(command_line)) {
+            run_background_command_line(username, command_line, user, has_sudo_privileges);
+            free(command_line);
+            continue;
+        }
+
+        /* Command lists are planned, authorized and run as a whole */
+        if (is_command_list(command_line)) {
+            watch_begin_output(command_line);
+            result = run_command_list(username, command_line, user, has_sudo_privileges);
+            watch_end_output(result);
+            last_exit_status = result;
+            free(command_line);
+            continue;
+        }
+
         /* Check for built-in commands */
         builtin_result = handle_builtin_command(command_line);
         if (builtin_result == -1) {
-            /* Exit command */
+            /* Exit command; warn once if jobs would be terminated */
+            if (!exit_warned && count_active_jobs() > 0) {
+                fprintf(stderr, "sudosh: there are running jobs; exit again to terminate them\n");
+                jobs_exit_warned = 1;
+                free(command_line);
+                continue;
+            }
             free(command_line);
             break;
         } else if (builtin_result == 1) {
@@ -382,26 +768,13 @@ int main_loop(void) {
         /* Validate command for security */
         if (!validate_command(command_line)) {
             fprintf(stderr, "sudosh: command rejected for security reasons\n");
+            session_stats_denied(SESSION_DENY_VALIDATION);
             free(command_line);
             continue;
         }
 
         /* Check if user has privileges for this specific command */
-        /* First check if it's a safe command - these are always allowed */
-        if (is_safe_command(command_line)) {
-            /* Safe command - allow it regardless of sudo privileges */
-        } else if (!has_sudo_privileges) {
-            fprintf(stderr, "sudosh: %s is not in the sudoers file and '%s' is not a safe command\n",
-                    username, command_line);
-            fprintf(stderr, "Available safe commands: ls, pwd, whoami, id, date, uptime, w, who, last\n");
-            log_security_violation(username, "attempted privileged command without sudoers access");
-            free(command_line);
-            continue;
-        } else if (!check_command_permission(username, command_line)) {
-            /* User has sudo privileges but not for this specific command */
-            fprintf(stderr, "sudosh: %s is not allowed to run '%s' according to sudoers configuration\n",
-                    username, command_line);
-            log_security_violation(username, "attempted command not permitted by sudoers");
+        if (!authorize_command_line(username, command_line, has_sudo_privileges)) {
             free(command_line);
             continue;
         }
@@ -418,7 +791,9 @@ int main_loop(void) {
             }
 
             /* Execute pipeline */
+            watch_begin_output(command_line);
             result = execute_pipeline(&pipeline, user);
+            watch_end_output(result);
 
             /* Log pipeline execution */
             if (target_user) {
@@ -443,45 +818,20 @@ int main_loop(void) {
                 continue;
             }
 
-            /* Check if this command requires authentication despite NOPASSWD */
-            if (should_require_authentication(username, command_line)) {
-                /* This command requires authentication in the current environment */
-                if (!authenticate_user_cached(username)) {
-                    fprintf(stderr, "sudosh: authentication required for command '%s' in editor environment\n", command_line);
-                    fprintf(stderr, "sudosh: reason: %s\n", get_danger_explanation(command_line));
-                    free_command_info(&cmd);
-                    free(command_line);
-                    continue;
-                }
-            }
-
-            /* Check if this is a conditionally blocked command requiring authentication */
-            if (is_conditionally_blocked_command(command_line)) {
-                /* Check if user has authorization */
-                if (!check_conditionally_blocked_command_authorization(username, command_line)) {
-                    fprintf(stderr, "sudosh: command '%s' requires sudo privileges\n", command_line);
-                    free_command_info(&cmd);
-                    free(command_line);
-                    continue;
-                }
-
-                /* User has authorization, but check if authentication is needed */
-                if (!check_nopasswd_privileges_enhanced(username)) {
-                    /* User doesn't have NOPASSWD, require authentication */
-                    if (!authenticate_user_cached(username)) {
-                        fprintf(stderr, "sudosh: authentication required for command '%s'\n", command_line);
-                        free_command_info(&cmd);
-                        free(command_line);
-                        continue;
-                    }
-                }
+            /* Authenticate if the command needs it despite NOPASSWD */
+            if (!authenticate_for_command_line(username, command_line)) {
+                free_command_info(&cmd);
+                free(command_line);
+                continue;
             }
 
             /* Execute command */
+            watch_begin_output(command_line);
             result = execute_command(&cmd, user);
+            watch_end_output(result);
 
             /* Update last exit status for prompt customization */
-            extern int last_exit_status; last_exit_status = result;
+            last_exit_status = result;
 
             /* Log command execution with target user info and Ansible context */
             if (target_user) {
@@ -504,6 +854,11 @@ int main_loop(void) {
         printf("\nInterrupted - exiting gracefully\n");
     }
 
+    /* Background jobs do not outlive the session */
+    cleanup_jobs();
+    clear_target_credentials();
+    watch_session_end();
+
     /* Log session end */
     log_session_end(username);
 
@@ -546,6 +901,8 @@ int main(int argc, char *argv[]) {
     int exit_code;
     char *session_logfile = NULL;
     char *custom_prompt = NULL;
+    const char *pipeline_interpreter = NULL;
+    const char *become_success_marker = NULL;
     int i;
 
     /* sudo-compat mode detection: if invoked as 'sudo', enable compatibility behavior */
@@ -590,6 +947,14 @@ int main(int argc, char *argv[]) {
     /* Store AI detection info for later use */
     global_ai_info = ai_info;
 
+    /* Invoked as 'sudosh-audit': search the audit journal and exit */
+    if (invoked_name && strcmp(invoked_name, "sudosh-audit") == 0) {
+        return audit_query_command(argc, argv);
+    }
+
+    /* Time limits come from the configuration; --timeout overrides the default */
+    load_runtime_config();
+
     /* Parse command line arguments */
     for (i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
@@ -607,8 +972,14 @@ int main(int argc, char *argv[]) {
             printf("  -l, --list              List available sudo rules and permissions\n");
             printf("  -ll                     List sudo rules with detailed command categories\n");
             printf("  -L, --log-session FILE  Log entire session to FILE\n");
+            printf("      --locks             List active editor file locks\n");
+            printf("      --watch [SESSION]   Watch a session live, or list watchable sessions\n");
+            printf("      --metrics           Print host metrics in Prometheus text format\n");
+            printf("      --verify-audit [FILE]\n");
+            printf("                          Verify the audit journal's hash chain\n");
             printf("  -u, --user USER         Run commands as target USER\n");
             printf("  -c, --command COMMAND   Execute COMMAND and exit (like sudo -c)\n");
+            printf("      --timeout SECONDS   Stop commands that run longer than SECONDS\n");
             if (sudo_compat_mode) {
                 printf("  -p, --prompt PROMPT     Use custom password prompt\n");
             }
@@ -617,7 +988,11 @@ int main(int argc, char *argv[]) {
             printf("      --ansible-detect    Enable Ansible session detection (default)\n");
             printf("      --no-ansible-detect Disable Ansible session detection\n");
             printf("      --ansible-force     Force Ansible session mode\n");
-            printf("      --ansible-verbose   Enable verbose Ansible detection output\n\n");
+            printf("      --ansible-verbose   Enable verbose Ansible detection output\n");
+            printf("      --ansible-pipeline INTERPRETER\n");
+            printf("                          Run a pipelined Ansible module read from stdin\n");
+            printf("      --become-success MARKER\n");
+            printf("                          Print MARKER once a pipelined module is authorized\n\n");
             printf("Command Execution:\n");
             printf("  sudosh                  Start interactive shell (default)\n");
             printf("  sudosh command          Execute command and exit\n");
@@ -659,6 +1034,11 @@ int main(int argc, char *argv[]) {
             if (!user) user = "unknown";
             printf("sudosh %s\n", SUDOSH_VERSION);
             printf("build: git=%s date=%s by=%s\n", git, date, user);
+#ifdef SUDOSH_PROBES_ENABLED
+            printf("usdt probes: yes (provider sudosh)\n");
+#else
+            printf("usdt probes: no\n");
+#endif
             return EXIT_SUCCESS;
         } else if (strcmp(argv[i], "-v") == 0 && sudo_compat_mode) {
             /* sudo-compat: -v = validate/update timestamp (no command execution) */
@@ -721,6 +1101,19 @@ int main(int argc, char *argv[]) {
             list_available_commands_detailed(username);
             free(username);
             return EXIT_SUCCESS;
+        } else if (strcmp(argv[i], "--locks") == 0) {
+            /* List active editor locks from the lock index and exit */
+            print_file_locks();
+            return EXIT_SUCCESS;
+        } else if (strcmp(argv[i], "--metrics") == 0) {
+            /* Render the host-wide counters for the textfile collector and exit */
+            return metrics_command();
+        } else if (strcmp(argv[i], "--verify-audit") == 0) {
+            /* Check the local audit journal's hash chain and exit */
+            return verify_audit_command(i + 1 < argc ? argv[i + 1] : NULL);
+        } else if (strcmp(argv[i], "--watch") == 0) {
+            /* Follow a session's watch ring (root only) and exit */
+            return watch_session_command(i + 1 < argc ? argv[i + 1] : NULL);
         } else if (strcmp(argv[i], "--log-session") == 0 || strcmp(argv[i], "-L") == 0) {
             if (i + 1 >= argc) {
                 fprintf(stderr, "sudosh: option '%s' requires an argument\n", argv[i]);
@@ -744,6 +1137,28 @@ int main(int argc, char *argv[]) {
             ansible_detection_enabled = 1;  /* Force implies enabled */
         } else if (strcmp(argv[i], "--ansible-verbose") == 0) {
             ansible_detection_verbose = 1;
+        } else if (strcmp(argv[i], "--timeout") == 0) {
+            char *end = NULL;
+            long seconds = (i + 1 < argc) ? strtol(argv[i + 1], &end, 10) : -1;
+            if (i + 1 >= argc || !end || *end != '\0' || seconds < 0 || seconds > 86400) {
+                fprintf(stderr, "sudosh: option '%s' requires a number of seconds (0-86400)\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            set_command_timeout(NULL, (int)seconds);
+            i++;
+        } else if (strcmp(argv[i], "--ansible-pipeline") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "sudosh: option '%s' requires an argument\n", argv[i]);
+                fprintf(stderr, "Try '%s --help' for more information.\n", argv[0]);
+                return EXIT_FAILURE;
+            }
+            pipeline_interpreter = argv[++i];
+        } else if (strcmp(argv[i], "--become-success") == 0) {
+            if (i + 1 >= argc || !is_valid_become_marker(argv[i + 1])) {
+                fprintf(stderr, "sudosh: option '%s' requires a marker of letters, digits and '-'\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+            become_success_marker = argv[++i];
         } else if (strcmp(argv[i], "-n") == 0) {
             /* Non-interactive: refuse any auth prompt (compat with sudo -n) */
             non_interactive_mode_flag = 1;
@@ -802,6 +1217,11 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    /* Pipelined Ansible module: interpreter on argv, module source on stdin */
+    if (pipeline_interpreter) {
+        return execute_ansible_pipeline(pipeline_interpreter, become_success_marker, target_user);
+    }
+
     /* Initialize logging */
     init_logging();
 
@@ -0,0 +1,322 @@
+/**
+ * metrics.c - Host-Level Metrics for the Prometheus Textfile Collector
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * Every sudosh process on the host counts into one shared segment: a
+ * root-only file (METRICS_FILE) mapped MAP_SHARED on first use and updated
+ * with relaxed atomic increments, so there is no locking and no system
+ * call per event.  It holds invocations, commands, denials, authentication
+ * results and lock contention counters, and latency histograms for SSSD
+ * queries, sudoers parsing and contended audit locks.
+ *
+ * "sudosh --metrics" renders the segment in the Prometheus text exposition
+ * format, for node_exporter's textfile collector:
+ *
+ *     sudosh --metrics > /var/lib/node_exporter/textfile/sudosh.prom.$$ &&
+ *         mv /var/lib/node_exporter/textfile/sudosh.prom.$$ \
+ *            /var/lib/node_exporter/textfile/sudosh.prom
+ *
+ * Counters only grow; they restart from zero when the file is removed
+ * (e.g. at boot, /var/run being a tmpfs) or its layout version changes.
+ */
+
+#include "sudosh.h"
+
+#include <sys/mman.h>
+
+/* Histogram data: per-bucket counts (not cumulative) and the sum */
+struct metrics_histogram_data {
+    uint64_t buckets[METRICS_LATENCY_BUCKETS + 1];  /* Last bucket is +Inf */
+    uint64_t count;
+    uint64_t sum_usec;
+};
+
+/* Layout of the shared segment */
+struct metrics_segment {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t reserved;
+    uint64_t created;               /* Unix time the counters started from */
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    struct metrics_histogram_data histograms[METRIC_HISTOGRAM_COUNT];
+};
+
+/* Upper bounds of the finite histogram buckets, in microseconds */
+static const uint64_t latency_bounds[METRICS_LATENCY_BUCKETS] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 1000000
+};
+
+/* Names and labels, rendered in this order; a name's series are adjacent */
+static const struct {
+    const char *name;
+    const char *labels;
+    const char *help;
+} counter_info[METRIC_COUNTER_COUNT] = {
+    { "sudosh_invocations_total", "mode=\"interactive\"", "sudosh invocations by mode" },
+    { "sudosh_invocations_total", "mode=\"command\"", NULL },
+    { "sudosh_invocations_total", "mode=\"ansible_pipeline\"", NULL },
+    { "sudosh_commands_total", "kind=\"command\"", "Commands and pipelines started" },
+    { "sudosh_commands_total", "kind=\"pipeline\"", NULL },
+    { "sudosh_denials_total", "reason=\"validation\"", "Command lines refused, by reason" },
+    { "sudosh_denials_total", "reason=\"permission\"", NULL },
+    { "sudosh_denials_total", "reason=\"authentication\"", NULL },
+    { "sudosh_authentications_total", "result=\"success\"", "Authentication attempts by result" },
+    { "sudosh_authentications_total", "result=\"failure\"", NULL },
+    { "sudosh_lock_contentions_total", "lock=\"audit_journal\"", "Locks found held by another process" },
+    { "sudosh_lock_contentions_total", "lock=\"audit_sync\"", NULL },
+    { "sudosh_lock_contentions_total", "lock=\"editor_file\"", NULL },
+};
+
+static const struct {
+    const char *name;
+    const char *help;
+} histogram_info[METRIC_HISTOGRAM_COUNT] = {
+    { "sudosh_sssd_query_duration_seconds", "SSSD sudo rules query latency" },
+    { "sudosh_policy_parse_duration_seconds", "sudoers parse latency" },
+    { "sudosh_lock_wait_duration_seconds", "Time spent waiting for a contended audit lock" },
+};
+
+static struct metrics_segment *metrics = NULL;
+static int metrics_disabled = 0;
+
+/**
+ * Path of the metrics segment (SUDOSH_METRICS_FILE in test mode), or NULL
+ */
+static const char *metrics_path(void) {
+    extern int test_mode;
+    const char *override = getenv("SUDOSH_METRICS_FILE");
+
+    if (test_mode) {
+        return (override && *override) ? override : NULL;
+    }
+    return METRICS_FILE;
+}
+
+/**
+ * Check a metrics file: regular, root-owned, private
+ */
+static int metrics_file_trusted(int fd) {
+    extern int test_mode;
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return 0;
+    }
+    if (st.st_uid != (test_mode ? geteuid() : 0)) {
+        return 0;
+    }
+    return (st.st_mode & (S_IRWXG | S_IRWXO)) == 0;
+}
+
+/**
+ * Map the segment on first use, creating or resetting it if needed
+ */
+static int metrics_open(void) {
+    struct metrics_segment header;
+    struct stat st;
+
+    if (metrics) {
+        return 0;
+    }
+    if (metrics_disabled) {
+        return -1;
+    }
+    metrics_disabled = 1;   /* Until the mapping is in place */
+
+    const char *path = metrics_path();
+    if (!path) {
+        return -1;
+    }
+    if (strcmp(path, METRICS_FILE) == 0) {
+        mkdir(AUTH_CACHE_DIR, 0700);
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd == -1 || !metrics_file_trusted(fd) || flock(fd, LOCK_EX) != 0) {
+        syslog(LOG_WARNING, "METRICS: %s unavailable or not trusted; not counting", path);
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    /* A new file, or one from another layout, starts over from zero */
+    int valid = fstat(fd, &st) == 0 && st.st_size == (off_t)sizeof(header) &&
+                pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+                header.magic == METRICS_MAGIC && header.version == METRICS_VERSION &&
+                header.size == sizeof(header);
+    if (!valid) {
+        memset(&header, 0, sizeof(header));
+        header.magic = METRICS_MAGIC;
+        header.version = METRICS_VERSION;
+        header.size = sizeof(header);
+        header.created = (uint64_t)time(NULL);
+        if (ftruncate(fd, 0) != 0 ||
+            pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+            syslog(LOG_WARNING, "METRICS: cannot initialize %s: %m", path);
+            flock(fd, LOCK_UN);
+            close(fd);
+            return -1;
+        }
+    }
+
+    void *map = mmap(NULL, sizeof(struct metrics_segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    flock(fd, LOCK_UN);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    metrics = map;
+    metrics_disabled = 0;
+    return 0;
+}
+
+/**
+ * Count one event
+ */
+void metrics_count(enum metrics_counter which) {
+    if ((int)which < 0 || which >= METRIC_COUNTER_COUNT || metrics_open() != 0) {
+        return;
+    }
+    __atomic_fetch_add(&metrics->counters[which], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Record one latency sample in microseconds
+ */
+void metrics_observe(enum metrics_histogram which, long long usec) {
+    if ((int)which < 0 || which >= METRIC_HISTOGRAM_COUNT || metrics_open() != 0) {
+        return;
+    }
+
+    struct metrics_histogram_data *h = &metrics->histograms[which];
+    uint64_t value = usec > 0 ? (uint64_t)usec : 0;
+    int bucket = 0;
+    while (bucket < METRICS_LATENCY_BUCKETS && value > latency_bounds[bucket]) {
+        bucket++;
+    }
+    __atomic_fetch_add(&h->buckets[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum_usec, value, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * flock(fd, LOCK_EX), counting contention and the time spent waiting
+ */
+int metrics_flock(int fd, enum metrics_counter contended) {
+    if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+        return 0;
+    }
+    if (errno != EWOULDBLOCK) {
+        return -1;
+    }
+
+    metrics_count(contended);
+    long long started = monotonic_usec();
+    int rc;
+    do {
+        rc = flock(fd, LOCK_EX);
+    } while (rc != 0 && errno == EINTR);
+    metrics_observe(METRIC_LOCK_WAIT, monotonic_usec() - started);
+    return rc;
+}
+
+/**
+ * Load a snapshot of the segment for rendering
+ */
+static int metrics_snapshot(struct metrics_segment *snap) {
+    memset(snap, 0, sizeof(*snap));
+    if (metrics_open() != 0) {
+        return -1;
+    }
+
+    snap->created = metrics->created;
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        snap->counters[i] = __atomic_load_n(&metrics->counters[i], __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+        /* Count first: buckets incremented since are at least as large */
+        snap->histograms[i].count = __atomic_load_n(&metrics->histograms[i].count, __ATOMIC_RELAXED);
+        snap->histograms[i].sum_usec = __atomic_load_n(&metrics->histograms[i].sum_usec, __ATOMIC_RELAXED);
+        for (int b = 0; b <= METRICS_LATENCY_BUCKETS; b++) {
+            snap->histograms[i].buckets[b] =
+                __atomic_load_n(&metrics->histograms[i].buckets[b], __ATOMIC_RELAXED);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Write all metrics in the Prometheus text exposition format
+ */
+int render_metrics(FILE *out) {
+    struct metrics_segment snap;
+
+    if (!out || metrics_snapshot(&snap) != 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < METRIC_COUNTER_COUNT; i++) {
+        if (counter_info[i].help) {
+            fprintf(out, "# HELP %s %s\n# TYPE %s counter\n",
+                    counter_info[i].name, counter_info[i].help, counter_info[i].name);
+        }
+        fprintf(out, "%s{%s} %llu\n", counter_info[i].name, counter_info[i].labels,
+                (unsigned long long)snap.counters[i]);
+    }
+
+    for (int i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+        const struct metrics_histogram_data *h = &snap.histograms[i];
+        const char *name = histogram_info[i].name;
+        uint64_t cumulative = 0;
+
+        fprintf(out, "# HELP %s %s\n# TYPE %s histogram\n", name, histogram_info[i].help, name);
+        for (int b = 0; b < METRICS_LATENCY_BUCKETS; b++) {
+            cumulative += h->buckets[b];
+            fprintf(out, "%s_bucket{le=\"%g\"} %llu\n", name, (double)latency_bounds[b] / 1e6,
+                    (unsigned long long)cumulative);
+        }
+        cumulative += h->buckets[METRICS_LATENCY_BUCKETS];
+        /* +Inf must equal _count even if a sample landed between the loads */
+        uint64_t count = cumulative > h->count ? cumulative : h->count;
+        fprintf(out, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)count);
+        fprintf(out, "%s_sum %.6f\n", name, (double)h->sum_usec / 1e6);
+        fprintf(out, "%s_count %llu\n", name, (unsigned long long)count);
+    }
+
+    fprintf(out, "# HELP sudosh_metrics_start_time_seconds When these counters started from zero\n"
+                 "# TYPE sudosh_metrics_start_time_seconds gauge\n"
+                 "sudosh_metrics_start_time_seconds %llu\n", (unsigned long long)snap.created);
+    return ferror(out) ? -1 : 0;
+}
+
+/**
+ * sudosh --metrics: print the host's metrics (root only)
+ */
+int metrics_command(void) {
+    extern int test_mode;
+
+    if (!test_mode && getuid() != 0) {
+        fprintf(stderr, "sudosh: --metrics may only be used by root\n");
+        return EXIT_FAILURE;
+    }
+    if (render_metrics(stdout) != 0 || fflush(stdout) != 0) {
+        fprintf(stderr, "sudosh: metrics unavailable\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Unmap the segment; the next event maps it again
+ */
+void close_metrics(void) {
+    if (metrics) {
+        munmap(metrics, sizeof(struct metrics_segment));
+        metrics = NULL;
+    }
+    metrics_disabled = 0;
+}
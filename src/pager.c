@@ -0,0 +1,759 @@
+/**
+ * pager.c - Built-in Read-Only Pager
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * A small pager used for bare less/more and for long built-in output.
+ * Regular files are mapped rather than read, piped input is buffered in
+ * chunks as the view advances, and lines are indexed only as far as they
+ * are displayed or searched.  It has no shell escapes, editor hand-off or
+ * file commands, so there is nothing to harden.
+ */
+
+#include "sudosh.h"
+
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+
+/* Key codes returned by pager_read_key() beyond plain bytes */
+#define PAGER_KEY_UP     0x101
+#define PAGER_KEY_DOWN   0x102
+#define PAGER_KEY_PGUP   0x103
+#define PAGER_KEY_PGDN   0x104
+#define PAGER_KEY_HOME   0x105
+#define PAGER_KEY_END    0x106
+
+/**
+ * Read more piped input into the buffer
+ *
+ * Returns 1 if data was added, 0 at end of input.
+ */
+static int pager_fill(struct pager_buffer *pb) {
+    if (pb->eof || pb->mapped) {
+        return 0;
+    }
+
+    if (pb->len + PAGER_READ_CHUNK > pb->capacity) {
+        size_t new_cap = pb->capacity ? pb->capacity * 2 : PAGER_READ_CHUNK * 2;
+        if (new_cap > MAX_PAGER_BUFFER) {
+            new_cap = MAX_PAGER_BUFFER;
+        }
+        if (new_cap <= pb->len) {
+            pb->truncated = 1;
+            pb->eof = 1;
+            return 0;
+        }
+        char *grown = realloc(pb->data, new_cap);
+        if (!grown) {
+            pb->truncated = 1;
+            pb->eof = 1;
+            return 0;
+        }
+        pb->data = grown;
+        pb->capacity = new_cap;
+    }
+
+    size_t want = pb->capacity - pb->len;
+    if (want > PAGER_READ_CHUNK) {
+        want = PAGER_READ_CHUNK;
+    }
+
+    for (;;) {
+        ssize_t n = read(pb->fd, pb->data + pb->len, want);
+        if (n > 0) {
+            pb->len += (size_t)n;
+            return 1;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        pb->eof = 1;
+        return 0;
+    }
+}
+
+/**
+ * Append a line start to the index
+ */
+static int pager_add_line(struct pager_buffer *pb, size_t start) {
+    if (pb->line_count == pb->line_capacity) {
+        size_t new_cap = pb->line_capacity ? pb->line_capacity * 2 : 4096;
+        size_t *grown = realloc(pb->line_starts, new_cap * sizeof(size_t));
+        if (!grown) {
+            return -1;
+        }
+        pb->line_starts = grown;
+        pb->line_capacity = new_cap;
+    }
+    pb->line_starts[pb->line_count++] = start;
+    return 0;
+}
+
+/**
+ * Extend the line index until it covers line (and knows where it ends)
+ * or input is exhausted; stop_offset additionally bounds the scan
+ */
+static void pager_index_to(struct pager_buffer *pb, size_t line, size_t stop_offset) {
+    while (!pb->index_complete && pb->line_count <= line + 1 && pb->scanned <= stop_offset) {
+        if (pb->scanned < pb->len) {
+            const char *nl = memchr(pb->data + pb->scanned, '\n', pb->len - pb->scanned);
+            if (nl) {
+                size_t next = (size_t)(nl - pb->data) + 1;
+                pb->scanned = next;
+                if (pager_add_line(pb, next) != 0) {
+                    pb->index_complete = 1;
+                }
+                continue;
+            }
+            pb->scanned = pb->len;
+        }
+        if (!pager_fill(pb)) {
+            /* A final newline does not start another line */
+            if (pb->line_count > 0 && pb->line_starts[pb->line_count - 1] == pb->len) {
+                pb->line_count--;
+            }
+            pb->index_complete = 1;
+        }
+    }
+}
+
+/**
+ * Open pager input on fd
+ *
+ * Regular files are mapped read-only; anything else is read lazily into a
+ * growing buffer.  The caller keeps ownership of fd.
+ */
+int pager_buffer_open(struct pager_buffer *pb, int fd) {
+    struct stat st;
+
+    if (!pb || fd < 0) {
+        return -1;
+    }
+    memset(pb, 0, sizeof(*pb));
+    pb->fd = fd;
+
+    /* Files reporting size 0 (e.g. under /proc) are read like pipes */
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            return -1;
+        }
+        pb->data = map;
+        pb->len = (size_t)st.st_size;
+        pb->mapped = 1;
+        pb->eof = 1;
+    }
+
+    return pager_add_line(pb, 0);
+}
+
+/**
+ * Release pager input
+ */
+void pager_buffer_close(struct pager_buffer *pb) {
+    if (!pb) {
+        return;
+    }
+    if (pb->mapped) {
+        munmap(pb->data, pb->len);
+    } else {
+        free(pb->data);
+    }
+    free(pb->line_starts);
+    memset(pb, 0, sizeof(*pb));
+    pb->fd = -1;
+}
+
+/**
+ * Get the bytes of a line (without its newline)
+ *
+ * Returns 1 if the line exists, 0 past the end of input.
+ */
+int pager_buffer_line(struct pager_buffer *pb, size_t line, const char **start, size_t *len) {
+    if (!pb) {
+        return 0;
+    }
+    pager_index_to(pb, line, SIZE_MAX);
+    if (line >= pb->line_count) {
+        return 0;
+    }
+
+    size_t begin = pb->line_starts[line];
+    size_t end = (line + 1 < pb->line_count) ? pb->line_starts[line + 1] : pb->len;
+    if (end > begin && pb->data[end - 1] == '\n') {
+        end--;
+    }
+    if (start) {
+        *start = pb->data + begin;
+    }
+    if (len) {
+        *len = end - begin;
+    }
+    return 1;
+}
+
+/**
+ * Count all lines, reading and indexing the whole input
+ */
+size_t pager_buffer_total_lines(struct pager_buffer *pb) {
+    if (!pb) {
+        return 0;
+    }
+    pager_index_to(pb, SIZE_MAX - 1, SIZE_MAX);
+    return pb->line_count;
+}
+
+/**
+ * Find the line containing a byte offset
+ */
+size_t pager_buffer_line_of(struct pager_buffer *pb, size_t offset) {
+    if (!pb || pb->line_count == 0) {
+        return 0;
+    }
+    pager_index_to(pb, SIZE_MAX - 1, offset);
+
+    size_t lo = 0, hi = pb->line_count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (pb->line_starts[mid] <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Find the last occurrence of byte c in the first n bytes of s
+ */
+static const char *pager_memrchr(const char *s, int c, size_t n) {
+#ifdef __GLIBC__
+    return memrchr(s, c, n);
+#else
+    while (n > 0) {
+        if ((unsigned char)s[--n] == (unsigned char)c) {
+            return s + n;
+        }
+    }
+    return NULL;
+#endif
+}
+
+/**
+ * Search for a literal pattern
+ *
+ * Forward searches start at from and read more piped input as needed;
+ * backward searches find the last match that starts before from.
+ * Returns the match offset, or -1 if there is none.
+ */
+long long pager_buffer_search(struct pager_buffer *pb, const char *pattern, size_t from, int forward) {
+    if (!pb || !pattern || !*pattern) {
+        return -1;
+    }
+    size_t plen = strlen(pattern);
+
+    if (forward) {
+        for (;;) {
+            if (from < pb->len && pb->len - from >= plen) {
+                const char *hit = memmem(pb->data + from, pb->len - from, pattern, plen);
+                if (hit) {
+                    return (long long)(hit - pb->data);
+                }
+                /* Only a match straddling newly read data can appear next */
+                from = pb->len - plen + 1;
+            }
+            if (!pager_fill(pb)) {
+                return -1;
+            }
+        }
+    }
+
+    size_t limit = from < pb->len ? from : pb->len;
+    while (limit > 0) {
+        const char *hit = pager_memrchr(pb->data, (unsigned char)pattern[0], limit);
+        if (!hit) {
+            break;
+        }
+        size_t off = (size_t)(hit - pb->data);
+        if (pb->len - off >= plen && memcmp(hit, pattern, plen) == 0) {
+            return (long long)off;
+        }
+        limit = off;
+    }
+    return -1;
+}
+
+/* Interactive state */
+struct pager_view {
+    struct pager_buffer *pb;
+    const char *name;
+    int tty_fd;
+    size_t top;             /* First displayed line */
+    int rows;               /* Content rows */
+    int cols;
+    char pattern[MAX_PAGER_PATTERN];
+    int search_forward;
+    char message[128];
+    char *frame;            /* Output assembled per redraw */
+    size_t frame_len;
+    size_t frame_cap;
+};
+
+/**
+ * Append bytes to the frame being drawn
+ */
+static void frame_put(struct pager_view *v, const char *s, size_t n) {
+    if (v->frame_len + n > v->frame_cap) {
+        size_t new_cap = (v->frame_cap ? v->frame_cap : 8192);
+        while (new_cap < v->frame_len + n) {
+            new_cap *= 2;
+        }
+        char *grown = realloc(v->frame, new_cap);
+        if (!grown) {
+            return;
+        }
+        v->frame = grown;
+        v->frame_cap = new_cap;
+    }
+    memcpy(v->frame + v->frame_len, s, n);
+    v->frame_len += n;
+}
+
+/**
+ * Append one line, chopped to the terminal width
+ *
+ * Control characters are shown as ^X so file contents can never send
+ * escape sequences to the terminal.
+ */
+static void frame_put_line(struct pager_view *v, const char *s, size_t n) {
+    int col = 0;
+    for (size_t i = 0; i < n && col < v->cols; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (c == '\t') {
+            int spaces = 8 - (col % 8);
+            while (spaces-- > 0 && col < v->cols) {
+                frame_put(v, " ", 1);
+                col++;
+            }
+        } else if (c < 0x20 || c == 0x7f) {
+            if (col + 2 > v->cols) {
+                break;
+            }
+            char caret[2] = { '^', (char)(c == 0x7f ? '?' : c + '@') };
+            frame_put(v, caret, 2);
+            col += 2;
+        } else {
+            frame_put(v, (const char *)&c, 1);
+            /* UTF-8 continuation bytes do not take a column */
+            if (c < 0x80 || c >= 0xc0) {
+                col++;
+            }
+        }
+    }
+    frame_put(v, "\033[K\r\n", 5);
+}
+
+/**
+ * Refresh the terminal geometry
+ */
+static void pager_update_size(struct pager_view *v) {
+    struct winsize w;
+    int rows = 24, cols = 80;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0) {
+        if (w.ws_row > 1) rows = w.ws_row;
+        if (w.ws_col > 0) cols = w.ws_col;
+    }
+    v->rows = rows - 1;
+    v->cols = cols;
+}
+
+/**
+ * Redraw the screen from v->top
+ */
+static void pager_draw(struct pager_view *v) {
+    const char *line;
+    size_t len;
+    int drawn = 0;
+    char status[256];
+
+    pager_update_size(v);
+    v->frame_len = 0;
+    frame_put(v, "\033[H", 3);
+    for (; drawn < v->rows; drawn++) {
+        if (!pager_buffer_line(v->pb, v->top + (size_t)drawn, &line, &len)) {
+            break;
+        }
+        frame_put_line(v, line, len);
+    }
+    for (; drawn < v->rows; drawn++) {
+        frame_put(v, "~\033[K\r\n", 6);
+    }
+
+    size_t last = v->top + (size_t)v->rows;
+    int at_end = v->pb->index_complete && last >= v->pb->line_count;
+    if (v->message[0]) {
+        snprintf(status, sizeof(status), "%s", v->message);
+        v->message[0] = '\0';
+    } else if (v->pb->index_complete && v->pb->line_count > 0) {
+        snprintf(status, sizeof(status), "%s lines %zu-%zu/%zu %s%s",
+                 v->name ? v->name : "(stdin)", v->top + 1,
+                 at_end ? v->pb->line_count : last, v->pb->line_count,
+                 at_end ? "(END)" : "", v->pb->truncated ? " [truncated]" : "");
+    } else {
+        snprintf(status, sizeof(status), "%s lines %zu-%zu",
+                 v->name ? v->name : "(stdin)", v->top + 1, last);
+    }
+    frame_put(v, "\033[7m", 4);
+    frame_put_line(v, status, strlen(status));
+    v->frame_len -= 2;  /* no newline after the status line */
+    frame_put(v, "\033[m", 3);
+
+    for (size_t off = 0; off < v->frame_len; ) {
+        ssize_t n = write(STDOUT_FILENO, v->frame + off, v->frame_len - off);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        off += (size_t)n;
+    }
+}
+
+/**
+ * Read one key from the terminal, decoding common escape sequences
+ */
+static int pager_read_key(int tty_fd) {
+    unsigned char c;
+    ssize_t n;
+
+    do {
+        n = read(tty_fd, &c, 1);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        return 'q';
+    }
+    if (c != 0x1b) {
+        return c;
+    }
+
+    unsigned char seq[3];
+    if (read(tty_fd, &seq[0], 1) != 1 || (seq[0] != '[' && seq[0] != 'O')) {
+        return 0x1b;
+    }
+    if (read(tty_fd, &seq[1], 1) != 1) {
+        return 0x1b;
+    }
+    switch (seq[1]) {
+        case 'A': return PAGER_KEY_UP;
+        case 'B': return PAGER_KEY_DOWN;
+        case 'H': return PAGER_KEY_HOME;
+        case 'F': return PAGER_KEY_END;
+        default: break;
+    }
+    if (seq[1] >= '0' && seq[1] <= '9' && read(tty_fd, &seq[2], 1) == 1 && seq[2] == '~') {
+        switch (seq[1]) {
+            case '1': case '7': return PAGER_KEY_HOME;
+            case '4': case '8': return PAGER_KEY_END;
+            case '5': return PAGER_KEY_PGUP;
+            case '6': return PAGER_KEY_PGDN;
+            default: break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Prompt for a search pattern on the status line
+ *
+ * Returns 1 if a pattern was entered (an empty entry reuses the last one).
+ */
+static int pager_prompt(struct pager_view *v, char prefix) {
+    char input[MAX_PAGER_PATTERN];
+    size_t len = 0;
+    char out[32];
+
+    snprintf(out, sizeof(out), "\033[%d;1H", v->rows + 1);
+    if (write(STDOUT_FILENO, out, strlen(out)) < 0 ||
+        write(STDOUT_FILENO, "\033[K", 3) < 0 || write(STDOUT_FILENO, &prefix, 1) < 0) {
+        return 0;
+    }
+
+    for (;;) {
+        int key = pager_read_key(v->tty_fd);
+        if (key == '\r' || key == '\n') {
+            break;
+        }
+        if (key == 0x1b || key == 3 || key == 7) {
+            return 0;
+        }
+        if ((key == 0x7f || key == 8) && len > 0) {
+            len--;
+            if (write(STDOUT_FILENO, "\b \b", 3) < 0) {
+                return 0;
+            }
+        } else if (key >= 0x20 && key < 0x7f && len + 1 < sizeof(input)) {
+            char ch = (char)key;
+            input[len++] = ch;
+            if (write(STDOUT_FILENO, &ch, 1) < 0) {
+                return 0;
+            }
+        }
+    }
+
+    if (len > 0) {
+        memcpy(v->pattern, input, len);
+        v->pattern[len] = '\0';
+    }
+    return v->pattern[0] != '\0';
+}
+
+/**
+ * Move the view to the next match of the current pattern
+ */
+static void pager_find(struct pager_view *v, int forward) {
+    size_t from;
+    const char *line;
+    size_t len;
+
+    if (!v->pattern[0]) {
+        snprintf(v->message, sizeof(v->message), "No previous pattern");
+        return;
+    }
+
+    if (!pager_buffer_line(v->pb, v->top, &line, &len)) {
+        from = v->pb->len;
+    } else if (forward) {
+        /* Start after the top line so repeated searches advance */
+        from = (size_t)(line - v->pb->data) + len;
+    } else {
+        from = (size_t)(line - v->pb->data);
+    }
+
+    long long hit = pager_buffer_search(v->pb, v->pattern, from, forward);
+    if (hit < 0) {
+        snprintf(v->message, sizeof(v->message), "Pattern not found: %.100s", v->pattern);
+        return;
+    }
+    v->top = pager_buffer_line_of(v->pb, (size_t)hit);
+}
+
+/**
+ * Scroll the view by delta lines, clamping at both ends
+ */
+static void pager_scroll(struct pager_view *v, long delta) {
+    if (delta < 0) {
+        size_t back = (size_t)(-delta);
+        v->top = (back > v->top) ? 0 : v->top - back;
+        return;
+    }
+
+    size_t target = v->top + (size_t)delta;
+    /* Do not scroll past the point where the last line is on screen */
+    pager_index_to(v->pb, target + (size_t)v->rows, SIZE_MAX);
+    if (v->pb->index_complete) {
+        size_t max_top = v->pb->line_count > (size_t)v->rows ? v->pb->line_count - (size_t)v->rows : 0;
+        if (target > max_top) {
+            target = max_top > v->top ? max_top : v->top;
+        }
+    }
+    v->top = target;
+}
+
+/**
+ * Copy all input to stdout (used when not attached to a terminal)
+ */
+static int pager_copy_out(struct pager_buffer *pb) {
+    size_t off = 0;
+    do {
+        while (off < pb->len) {
+            ssize_t n = write(STDOUT_FILENO, pb->data + off, pb->len - off);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            off += (size_t)n;
+        }
+    } while (pager_fill(pb));
+    return 0;
+}
+
+/**
+ * Page the contents of fd interactively
+ *
+ * Keys are read from /dev/tty so piped input works.  When stdout is not a
+ * terminal the input is copied through unchanged; with
+ * PAGER_QUIT_IF_ONE_SCREEN input that fits on one screen is just printed.
+ */
+int run_pager(int fd, const char *name, int flags) {
+    struct pager_buffer pb;
+    struct pager_view view;
+    struct termios saved, raw;
+
+    if (pager_buffer_open(&pb, fd) != 0) {
+        fprintf(stderr, "sudosh: pager: cannot read %s: %s\n", name ? name : "input", strerror(errno));
+        return -1;
+    }
+
+    fflush(stdout);
+    if (!isatty(STDOUT_FILENO)) {
+        int rc = pager_copy_out(&pb);
+        pager_buffer_close(&pb);
+        return rc;
+    }
+
+    memset(&view, 0, sizeof(view));
+    view.pb = &pb;
+    view.name = name;
+    view.search_forward = 1;
+    pager_update_size(&view);
+
+    if (flags & PAGER_QUIT_IF_ONE_SCREEN) {
+        pager_index_to(&pb, (size_t)view.rows, SIZE_MAX);
+        if (pb.index_complete && pb.line_count <= (size_t)view.rows) {
+            int rc = pager_copy_out(&pb);
+            pager_buffer_close(&pb);
+            return rc;
+        }
+    }
+
+    view.tty_fd = open("/dev/tty", O_RDONLY | O_CLOEXEC);
+    if (view.tty_fd == -1 || tcgetattr(view.tty_fd, &saved) != 0) {
+        if (view.tty_fd != -1) {
+            close(view.tty_fd);
+        }
+        int rc = pager_copy_out(&pb);
+        pager_buffer_close(&pb);
+        return rc;
+    }
+
+    raw = saved;
+    raw.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+    raw.c_iflag &= ~(IXON | ICRNL);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(view.tty_fd, TCSAFLUSH, &raw);
+    if (write(STDOUT_FILENO, "\033[?1049h\033[H\033[2J", 16) < 0) {
+        /* Drawing will fail the same way; fall through to cleanup */
+    }
+
+    int running = 1;
+    while (running) {
+        pager_draw(&view);
+        int key = pager_read_key(view.tty_fd);
+        switch (key) {
+            case 'q': case 'Q': case 3:
+                running = 0;
+                break;
+            case ' ': case 'f': case 6: case PAGER_KEY_PGDN:
+                pager_scroll(&view, view.rows);
+                break;
+            case 'b': case 2: case PAGER_KEY_PGUP:
+                pager_scroll(&view, -(long)view.rows);
+                break;
+            case 'd': case 4:
+                pager_scroll(&view, view.rows / 2);
+                break;
+            case 'u': case 21:
+                pager_scroll(&view, -(long)(view.rows / 2));
+                break;
+            case 'j': case 'e': case '\r': case '\n': case PAGER_KEY_DOWN:
+                pager_scroll(&view, 1);
+                break;
+            case 'k': case 'y': case PAGER_KEY_UP:
+                pager_scroll(&view, -1);
+                break;
+            case 'g': case '<': case PAGER_KEY_HOME:
+                view.top = 0;
+                break;
+            case 'G': case '>': case PAGER_KEY_END:
+                pager_buffer_total_lines(&pb);
+                view.top = pb.line_count > (size_t)view.rows ? pb.line_count - (size_t)view.rows : 0;
+                break;
+            case '/': case '?':
+                if (pager_prompt(&view, (char)key)) {
+                    view.search_forward = (key == '/');
+                    pager_find(&view, view.search_forward);
+                }
+                break;
+            case 'n':
+                pager_find(&view, view.search_forward);
+                break;
+            case 'N':
+                pager_find(&view, !view.search_forward);
+                break;
+            case 'h': case 'H':
+                snprintf(view.message, sizeof(view.message),
+                         "SPACE/b page  j/k line  g/G top/end  /? search  n/N next/prev  q quit");
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (write(STDOUT_FILENO, "\033[?1049l", 8) < 0) {
+        /* Nothing more to do; the terminal is restored below */
+    }
+    tcsetattr(view.tty_fd, TCSAFLUSH, &saved);
+    close(view.tty_fd);
+    free(view.frame);
+    pager_buffer_close(&pb);
+    return 0;
+}
+
+/**
+ * Page a file with the built-in pager
+ */
+int page_file(const char *path) {
+    if (!path) {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC | O_NOCTTY);
+    if (fd == -1) {
+        fprintf(stderr, "sudosh: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "sudosh: %s is a directory\n", path);
+        close(fd);
+        return -1;
+    }
+
+    int rc = run_pager(fd, path, 0);
+    close(fd);
+    return rc;
+}
+
+/**
+ * Decide whether a pager command is served by the built-in pager
+ *
+ * Only bare "less"/"more" qualify, with a single file argument (or none
+ * when reading a pipe), no options or redirection, output to a terminal,
+ * and no unprivileged target user; an absolute path such as /usr/bin/less
+ * always runs the external pager.
+ */
+int should_use_builtin_pager(const struct command_info *cmd, int from_pipe) {
+    if (!cmd || !cmd->argv || !cmd->argv[0]) {
+        return 0;
+    }
+    if (strcmp(cmd->argv[0], "less") != 0 && strcmp(cmd->argv[0], "more") != 0) {
+        return 0;
+    }
+    if (cmd->redirect_type != REDIRECT_NONE || !isatty(STDOUT_FILENO)) {
+        return 0;
+    }
+    if (target_user && strcmp(target_user, "root") != 0) {
+        return 0;
+    }
+
+    if (from_pipe) {
+        return cmd->argc == 1;
+    }
+    return cmd->argc == 2 && cmd->argv[1][0] != '-';
+}
@@ -360,11 +360,36 @@ int is_secure_pager_command(const char *command) {
 
 
 
+/**
+ * Terminate and reap the first started stages of a pipeline
+ */
+static void stop_pipeline_stages(struct pipeline_info *pipeline, int started) {
+    for (int i = 0; i < started; i++) {
+        kill(pipeline->commands[i].pid, SIGTERM);
+    }
+    for (int i = 0; i < started; i++) {
+        while (waitpid(pipeline->commands[i].pid, NULL, 0) == -1 && errno == EINTR) {
+            /* retry */
+        }
+    }
+}
+
+/**
+ * Undo a partially started pipeline: close the pipes and stop the stages
+ * that were already forked
+ */
+static void abort_pipeline_start(struct pipeline_info *pipeline, int started) {
+    for (int i = 0; i < pipeline->num_pipes * 2; i++) {
+        close(pipeline->pipe_fds[i]);
+    }
+    stop_pipeline_stages(pipeline, started);
+}
+
 /**
  * Execute pipeline with security isolation and comprehensive audit logging
  */
-int execute_pipeline(struct pipeline_info *pipeline, struct user_info *user) {
-    (void)user;  /* Suppress unused parameter warning */
+static int run_pipeline(struct pipeline_info *pipeline, struct user_info *user) {
+    long long entered_us = monotonic_usec();
 
     if (!pipeline || !pipeline->commands || pipeline->num_commands == 0) {
         return -1;
@@ -375,6 +400,23 @@ int execute_pipeline(struct pipeline_info *pipeline, struct user_info *user) {
         return -1;
     }
 
+    /* Arguments produced by glob expansion get the same checks as typed ones */
+    for (int i = 0; i < pipeline->num_commands; i++) {
+        if (!validate_glob_expansion(&pipeline->commands[i].cmd)) {
+            return -1;
+        }
+    }
+
+    /* Stages are held to the same binary owner policy as single commands */
+    const struct target_credentials *target_cred = NULL;
+    if (target_user) {
+        target_cred = get_target_credentials(target_user);
+        if (!target_cred) {
+            fprintf(stderr, "sudosh: target user '%s' not found\n", target_user);
+            return -1;
+        }
+    }
+
     /* Log the start of pipeline execution */
     log_pipeline_start(pipeline);
 
@@ -382,6 +424,9 @@ int execute_pipeline(struct pipeline_info *pipeline, struct user_info *user) {
     for (int i = 0; i < pipeline->num_pipes; i++) {
         if (pipe(&pipeline->pipe_fds[i * 2]) == -1) {
             perror("pipe");
+            for (int j = 0; j < i * 2; j++) {
+                close(pipeline->pipe_fds[j]);
+            }
             return -1;
         }
     }
@@ -397,20 +442,51 @@ int execute_pipeline(struct pipeline_info *pipeline, struct user_info *user) {
             command_path = find_command_in_path(cmd->argv[0]);
             if (!command_path) {
                 fprintf(stderr, "sudosh: %s: command not found\n", cmd->argv[0]);
+                abort_pipeline_start(pipeline, i);
                 return -1;
             }
         } else {
             command_path = safe_strdup(cmd->argv[0]);
             if (!command_path) {
+                abort_pipeline_start(pipeline, i);
                 return -1;
             }
         }
 
+        /* Each stage runs the binary that was verified, by descriptor */
+        struct verified_binary binary;
+        if (open_verified_binary(command_path, target_cred, &binary) != 0) {
+            if (binary.reason) {
+                fprintf(stderr, "sudosh: %s: refusing to execute: %s\n", command_path, binary.reason);
+                syslog(LOG_WARNING, "PIPELINE_EXEC_REFUSED: command=%s reason=%s",
+                       command_path, binary.reason);
+            } else {
+                fprintf(stderr, "sudosh: %s: permission denied or not found\n", command_path);
+            }
+            free(command_path);
+            abort_pipeline_start(pipeline, i);
+            return -1;
+        }
+
+        /* Binaries pinned with sha256: in sudoers must match their digest */
+        char *pin_user = user ? NULL : get_current_username();
+        int pin_rc = enforce_command_digest(user ? user->username : pin_user, &binary);
+        free(pin_user);
+        if (pin_rc != 0) {
+            close_verified_binary(&binary);
+            free(command_path);
+            abort_pipeline_start(pipeline, i);
+            return -1;
+        }
+
         /* Fork process for this command */
         pcmd->pid = fork();
+        pcmd->start_us = monotonic_usec();
         if (pcmd->pid == -1) {
             perror("fork");
+            close_verified_binary(&binary);
             free(command_path);
+            abort_pipeline_start(pipeline, i);
             return -1;
         } else if (pcmd->pid == 0) {
             /* Child process */
@@ -481,19 +557,25 @@ int execute_pipeline(struct pipeline_info *pipeline, struct user_info *user) {
                 }
             }
 
+            /* A trailing bare less/more pages the pipe in-process */
+            if (i == pipeline->num_commands - 1 && should_use_builtin_pager(cmd, 1)) {
+                exit(run_pager(STDIN_FILENO, NULL, 0) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+
             /* Setup secure environment for pagers */
             if (is_secure_pager_command(cmd->argv[0])) {
                 setup_secure_pager_environment();
             }
 
-            /* Execute the command */
-            execv(command_path, cmd->argv);
+            /* Execute the verified binary */
+            exec_verified_binary(&binary, cmd->argv);
 
             /* If we get here, exec failed */
-            perror("execv");
+            perror("execve");
             exit(EXIT_FAILURE);
         } else {
             /* Parent process */
+            close_verified_binary(&binary);
             free(command_path);
         }
     }
@@ -502,17 +584,44 @@ int execute_pipeline(struct pipeline_info *pipeline, struct user_info *user) {
     for (int i = 0; i < pipeline->num_pipes * 2; i++) {
         close(pipeline->pipe_fds[i]);
     }
+    session_stats_command(1);
+    session_stats_latency(SESSION_LATENCY_EXEC,
+                          pipeline->commands[pipeline->num_commands - 1].start_us - entered_us);
 
-    /* Wait for all child processes */
-    int final_status = 0;
+    /* Wait for all stages together; the strictest stage limit applies */
+    struct supervised_child *stages = calloc((size_t)pipeline->num_commands, sizeof(*stages));
+    struct supervision_result outcome;
+    int timeout = 0;
+    if (!stages) {
+        stop_pipeline_stages(pipeline, pipeline->num_commands);
+        return -1;
+    }
     for (int i = 0; i < pipeline->num_commands; i++) {
-        int status;
-        waitpid(pipeline->commands[i].pid, &status, 0);
-        if (i == pipeline->num_commands - 1) {
-            /* Use exit status of last command */
-            final_status = WEXITSTATUS(status);
+        stages[i].pid = pipeline->commands[i].pid;
+        stages[i].start_us = pipeline->commands[i].start_us;
+        int limit = get_command_timeout(&pipeline->commands[i].cmd);
+        if (limit > 0 && (timeout == 0 || limit < timeout)) {
+            timeout = limit;
         }
     }
+    supervise_children(stages, pipeline->num_commands, timeout, &outcome);
+
+    for (int i = 0; i < pipeline->num_commands; i++) {
+        pipeline->commands[i].status = stages[i].status;
+        pipeline->commands[i].elapsed_us = stages[i].elapsed_us;
+    }
+
+    /* Use exit status of last command */
+    int final_status = supervised_exit_code(&stages[pipeline->num_commands - 1], &outcome);
+    free(stages);
+    if (outcome.timed_out) {
+        fprintf(stderr, "sudosh: pipeline time limit (%ds) exceeded\n", timeout);
+        syslog(LOG_WARNING, "PIPELINE_TIMEOUT: commands=%d limit=%ds elapsed_ms=%lld",
+               pipeline->num_commands, timeout, outcome.elapsed_us / 1000);
+    } else if (outcome.torn_down) {
+        syslog(LOG_WARNING, "PIPELINE_TEARDOWN: commands=%d a stage terminated abnormally",
+               pipeline->num_commands);
+    }
 
     /* Log pipeline completion */
     log_pipeline_completion(pipeline, final_status);
@@ -520,6 +629,21 @@ int execute_pipeline(struct pipeline_info *pipeline, struct user_info *user) {
     return final_status;
 }
 
+/**
+ * Execute a pipeline (traced by the pipeline__start/pipeline__done probes,
+ * which carry the first stage's command line)
+ */
+int execute_pipeline(struct pipeline_info *pipeline, struct user_info *user) {
+    const char *username = user ? user->username : NULL;
+    const char *command = (pipeline && pipeline->commands && pipeline->num_commands > 0) ?
+                          pipeline->commands[0].cmd.command : NULL;
+
+    SUDOSH_PROBE3(pipeline__start, username, command, pipeline ? pipeline->num_commands : 0);
+    int result = run_pipeline(pipeline, user);
+    SUDOSH_PROBE3(pipeline__done, username, command, result);
+    return result;
+}
+
 /**
  * Free pipeline information structure
  */
@@ -587,12 +711,17 @@ void log_pipeline_completion(struct pipeline_info *pipeline, int exit_code) {
     syslog(LOG_INFO, "PIPELINE_COMPLETE: user=%s commands=%d exit_code=%d",
            username, pipeline->num_commands, exit_code);
 
-    /* Log individual command completions */
+    /* Log individual command completions with their own status and runtime */
     for (int i = 0; i < pipeline->num_commands; i++) {
-        struct command_info *cmd = &pipeline->commands[i].cmd;
+        struct pipeline_command *pcmd = &pipeline->commands[i];
+        struct command_info *cmd = &pcmd->cmd;
         if (cmd->command) {
-            syslog(LOG_INFO, "PIPELINE_CMD_COMPLETE[%d]: user=%s command=%s",
-                   i, username, cmd->command);
+            int status = pcmd->status;
+            syslog(LOG_INFO, "PIPELINE_CMD_COMPLETE[%d]: user=%s command=%s %s=%d elapsed_ms=%lld.%03lld",
+                   i, username, cmd->command,
+                   WIFSIGNALED(status) ? "signal" : "exit_code",
+                   WIFSIGNALED(status) ? WTERMSIG(status) : WEXITSTATUS(status),
+                   pcmd->elapsed_us / 1000, pcmd->elapsed_us % 1000);
         }
     }
 }
@@ -634,3 +763,244 @@ int validate_pipeline_with_permissions(struct pipeline_info *pipeline, const cha
 
     return 1;
 }
+
+/**
+ * Check if input is a command list joined by ';', '&&' or '||'
+ */
+int is_command_list(const char *input) {
+    if (!input) {
+        return 0;
+    }
+
+    char quote_char = 0;
+    for (const char *p = input; *p; p++) {
+        if (*p == '\\' && *(p+1)) {
+            p++;
+        } else if (quote_char) {
+            if (*p == quote_char) {
+                quote_char = 0;
+            }
+        } else if (*p == '"' || *p == '\'') {
+            quote_char = *p;
+        } else if (*p == ';' ||
+                   (*p == '&' && *(p+1) == '&') ||
+                   (*p == '|' && *(p+1) == '|')) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Append one element to a command list being parsed
+ */
+static int add_command_list_element(struct command_list *list, const char *start,
+                                    size_t len, list_op_t op) {
+    while (len > 0 && isspace((unsigned char)*start)) {
+        start++;
+        len--;
+    }
+    while (len > 0 && isspace((unsigned char)start[len - 1])) {
+        len--;
+    }
+    if (len == 0) {
+        return -1;
+    }
+    if (list->num_elements >= MAX_COMMAND_LIST_ELEMENTS) {
+        return -1;
+    }
+
+    char *command = malloc(len + 1);
+    if (!command) {
+        return -1;
+    }
+    memcpy(command, start, len);
+    command[len] = '\0';
+
+    list->elements[list->num_elements].command = command;
+    list->elements[list->num_elements].op = op;
+    list->num_elements++;
+    return 0;
+}
+
+/**
+ * Parse a command list into its elements (simple commands or pipelines)
+ *
+ * Operators inside quotes are left alone.  Empty elements are rejected,
+ * except for a single trailing ';'.
+ */
+int parse_command_list(const char *input, struct command_list *list) {
+    if (!input || !list) {
+        return -1;
+    }
+
+    memset(list, 0, sizeof(struct command_list));
+    list->elements = calloc(MAX_COMMAND_LIST_ELEMENTS, sizeof(struct command_list_element));
+    if (!list->elements) {
+        return -1;
+    }
+
+    const char *start = input;
+    list_op_t next_op = LIST_OP_NONE;
+    char quote_char = 0;
+
+    for (const char *p = input; *p; p++) {
+        list_op_t op;
+        int width;
+
+        if (*p == '\\' && *(p+1)) {
+            p++;
+            continue;
+        } else if (quote_char) {
+            if (*p == quote_char) {
+                quote_char = 0;
+            }
+            continue;
+        } else if (*p == '"' || *p == '\'') {
+            quote_char = *p;
+            continue;
+        } else if (*p == ';') {
+            op = LIST_OP_SEQUENCE;
+            width = 1;
+        } else if (*p == '&' && *(p+1) == '&') {
+            op = LIST_OP_AND;
+            width = 2;
+        } else if (*p == '|' && *(p+1) == '|') {
+            op = LIST_OP_OR;
+            width = 2;
+        } else {
+            continue;
+        }
+
+        if (add_command_list_element(list, start, (size_t)(p - start), next_op) != 0) {
+            free_command_list(list);
+            return -1;
+        }
+        next_op = op;
+        p += width - 1;
+        start = p + 1;
+    }
+
+    if (quote_char) {
+        free_command_list(list);
+        return -1;
+    }
+
+    /* Allow "cmd;" but not "cmd &&" */
+    const char *rest = start;
+    while (*rest && isspace((unsigned char)*rest)) rest++;
+    if (*rest == '\0' && next_op == LIST_OP_SEQUENCE) {
+        return 0;
+    }
+
+    if (add_command_list_element(list, start, strlen(start), next_op) != 0) {
+        free_command_list(list);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Validate every element of a command list before any of it runs
+ */
+int validate_command_list(struct command_list *list) {
+    if (!list || list->num_elements == 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < list->num_elements; i++) {
+        const char *command = list->elements[i].command;
+
+        /* First word must not be a session built-in: they change shell state */
+        const char *builtin = builtin_command_name(command);
+        if (builtin) {
+            fprintf(stderr, "sudosh: built-in '%s' cannot be used in a command list\n", builtin);
+            return 0;
+        }
+
+        /* Shell redirection (validate_command() == 2) is not a plan element */
+        if (validate_command(command) != 1) {
+            fprintf(stderr, "sudosh: command list element rejected: %s\n", command);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Execute a validated command list with short-circuit semantics
+ *
+ * Each element is audited on its own; elements skipped by '&&' or '||'
+ * are recorded as skipped.  Returns the status of the last element run.
+ */
+int execute_command_list(struct command_list *list, struct user_info *user, const char *username) {
+    if (!list || !user || !username) {
+        return -1;
+    }
+
+    int status = 0;
+
+    for (int i = 0; i < list->num_elements; i++) {
+        const struct command_list_element *element = &list->elements[i];
+        char log_message[1024];
+
+        if ((element->op == LIST_OP_AND && status != 0) ||
+            (element->op == LIST_OP_OR && status == 0)) {
+            syslog(LOG_INFO, "COMMAND_LIST: user=%s element=%d/%d skipped command=%s",
+                   username, i + 1, list->num_elements, element->command);
+            continue;
+        }
+
+        if (is_pipeline_command(element->command)) {
+            struct pipeline_info pipeline;
+            if (parse_pipeline(element->command, &pipeline) != 0) {
+                fprintf(stderr, "sudosh: failed to parse pipeline: %s\n", element->command);
+                status = -1;
+            } else {
+                status = execute_pipeline(&pipeline, user);
+                free_pipeline_info(&pipeline);
+            }
+        } else {
+            struct command_info cmd;
+            if (parse_command(element->command, &cmd) != 0) {
+                fprintf(stderr, "sudosh: failed to parse command: %s\n", element->command);
+                status = -1;
+            } else {
+                status = execute_command(&cmd, user);
+                free_command_info(&cmd);
+            }
+        }
+
+        if (target_user) {
+            snprintf(log_message, sizeof(log_message), "list %d/%d: %s (as %s)",
+                     i + 1, list->num_elements, element->command, target_user);
+        } else {
+            snprintf(log_message, sizeof(log_message), "list %d/%d: %s",
+                     i + 1, list->num_elements, element->command);
+        }
+        log_command_with_ansible_context(username, log_message, (status == 0));
+    }
+
+    return status;
+}
+
+/**
+ * Free command list structure
+ */
+void free_command_list(struct command_list *list) {
+    if (!list) {
+        return;
+    }
+
+    if (list->elements) {
+        for (int i = 0; i < list->num_elements; i++) {
+            free(list->elements[i].command);
+        }
+        free(list->elements);
+    }
+
+    memset(list, 0, sizeof(struct command_list));
+}
@@ -0,0 +1,643 @@
+/**
+ * policy.c - Compiled Sudoers Policy Image
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * Parsed sudoers rules are compiled into one position-independent block:
+ * a header, an array of fixed-size rules, the identities of the inputs
+ * and a string table, where every reference is an offset from the start
+ * of the block.  The checks in sudoers.c read the block in place, so it
+ * works the same wherever it is mapped.
+ *
+ * The first session to parse the policy publishes the block as a
+ * root-owned file (POLICY_IMAGE_FILE) and every other session maps that
+ * file read-only and MAP_SHARED: the compiled rules occupy one set of
+ * page-cache pages on the host instead of a heap copy in every session.
+ *
+ * The image records the device, inode, size, mtime and ctime of the
+ * sudoers file, each include directory and each included file, taken
+ * before they were read.  An image whose inputs have changed since is
+ * not used; the session that notices parses again and publishes a new
+ * image with rename(), and mappings of the old one stay valid until
+ * released.  Within a process the current mapping is kept and checked
+ * with one stat() per input each time the policy is asked for.
+ */
+
+#include "sudosh.h"
+
+#include <sys/mman.h>
+
+/* Layout at offset 0 of an image */
+struct policy_image_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;              /* Bytes in the image */
+    uint32_t rule_count;
+    uint32_t rules;             /* Offset of the rule array */
+    uint32_t source_count;
+    uint32_t sources;           /* Offset of the input identities */
+    uint32_t strings;           /* Offset of the string table */
+    uint32_t sudoers_path;      /* Inputs asked for: sudoers file and include directory */
+    uint32_t initial_includedir;
+    uint32_t includedir;        /* Include directory in effect after parsing */
+};
+
+/* A mapped image, shared by the configs handed out from it */
+struct policy_mapping {
+    void *base;
+    size_t size;
+    int refs;                   /* Configs using it, plus one while current */
+};
+
+static struct policy_mapping *policy_current = NULL;
+
+/* String table being written during compilation */
+struct policy_writer {
+    char *image;                /* NULL while measuring */
+    size_t used;
+};
+
+/**
+ * Path of the shared image (SUDOSH_POLICY_IMAGE in test mode), or NULL
+ */
+static const char *policy_image_path(void) {
+    extern int test_mode;
+    const char *override = getenv("SUDOSH_POLICY_IMAGE");
+
+    if (test_mode) {
+        return (override && *override) ? override : NULL;
+    }
+    return POLICY_IMAGE_FILE;
+}
+
+/**
+ * Check an image file: regular, root-owned, writable only by its owner
+ */
+static int policy_file_trusted(int fd, struct stat *st) {
+    extern int test_mode;
+
+    if (fstat(fd, st) != 0 || !S_ISREG(st->st_mode)) {
+        return 0;
+    }
+    if (st->st_uid != (test_mode ? geteuid() : 0)) {
+        return 0;
+    }
+    return (st->st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
+
+/**
+ * Identity of a path now; missing is set when it does not exist
+ */
+static void policy_stamp(const char *path, struct policy_source *out) {
+    struct stat st;
+
+    memset(out, 0, sizeof(*out));
+    if (stat(path, &st) != 0) {
+        out->missing = (errno == ENOENT) ? 1 : 2;  /* 2: cannot tell, never matches */
+        return;
+    }
+    out->dev = (uint64_t)st.st_dev;
+    out->ino = (uint64_t)st.st_ino;
+    out->size = (uint64_t)st.st_size;
+#if defined(__APPLE__)
+    out->mtime_sec = st.st_mtimespec.tv_sec;
+    out->mtime_nsec = st.st_mtimespec.tv_nsec;
+    out->ctime_sec = st.st_ctimespec.tv_sec;
+    out->ctime_nsec = st.st_ctimespec.tv_nsec;
+#else
+    out->mtime_sec = st.st_mtim.tv_sec;
+    out->mtime_nsec = st.st_mtim.tv_nsec;
+    out->ctime_sec = st.st_ctim.tv_sec;
+    out->ctime_nsec = st.st_ctim.tv_nsec;
+#endif
+}
+
+/**
+ * Start collecting a policy
+ */
+void policy_build_init(struct policy_build *build, const char *includedir) {
+    memset(build, 0, sizeof(*build));
+    build->includedir = safe_strdup(includedir);
+    build->incomplete = build->includedir == NULL;
+}
+
+/**
+ * Record an input's identity; call before reading it so a change made
+ * while it is read makes the image stale rather than silently wrong
+ */
+void policy_build_note_source(struct policy_build *build, const char *path) {
+    if (!path) {
+        return;
+    }
+    if (build->source_count == build->source_capacity) {
+        uint32_t capacity = build->source_capacity ? build->source_capacity * 2 : 8;
+        struct policy_source *sources = realloc(build->sources, capacity * sizeof(*sources));
+        if (sources) {
+            build->sources = sources;
+        }
+        char **paths = sources ? realloc(build->source_paths, capacity * sizeof(*paths)) : NULL;
+        if (!paths) {
+            build->incomplete = 1;
+            return;
+        }
+        build->source_paths = paths;
+        build->source_capacity = capacity;
+    }
+
+    char *copy = safe_strdup(path);
+    if (!copy) {
+        build->incomplete = 1;
+        return;
+    }
+    policy_stamp(path, &build->sources[build->source_count]);
+    build->source_paths[build->source_count++] = copy;
+}
+
+/**
+ * Append a parsed rule (the build takes ownership)
+ */
+void policy_build_add_rule(struct policy_build *build, struct sudoers_userspec *spec) {
+    if (!build->first) {
+        build->first = spec;
+    } else {
+        build->last->next = spec;
+    }
+    build->last = spec;
+}
+
+/**
+ * Free everything collected; compiled configs do not refer to it
+ */
+void policy_build_free(struct policy_build *build) {
+    struct sudoers_userspec *spec = build->first;
+    while (spec) {
+        struct sudoers_userspec *next = spec->next;
+        free_sudoers_userspec(spec);
+        spec = next;
+    }
+    for (uint32_t i = 0; i < build->source_count; i++) {
+        free(build->source_paths[i]);
+    }
+    free(build->source_paths);
+    free(build->sources);
+    free(build->includedir);
+    memset(build, 0, sizeof(*build));
+}
+
+/**
+ * Add a string to the table; returns its offset, 0 for NULL
+ */
+static uint32_t policy_put_string(struct policy_writer *w, const char *s) {
+    if (!s) {
+        return 0;
+    }
+    size_t len = strlen(s) + 1;
+    uint32_t offset = (uint32_t)w->used;
+    if (w->image) {
+        memcpy(w->image + w->used, s, len);
+    }
+    w->used += len;
+    return offset;
+}
+
+/**
+ * Add a string list, leaving out empty entries (they match nothing);
+ * returns its offset, 0 when the list is absent
+ */
+static uint32_t policy_put_list(struct policy_writer *w, char **list) {
+    if (!list) {
+        return 0;
+    }
+    uint32_t offset = (uint32_t)w->used;
+    for (int i = 0; list[i]; i++) {
+        if (list[i][0]) {
+            policy_put_string(w, list[i]);
+        }
+    }
+    policy_put_string(w, "");
+    return offset;
+}
+
+/**
+ * Add the pins of a rule's commands, "-" for unpinned ones, in step with
+ * policy_put_list(commands); 0 when no command is pinned
+ */
+static uint32_t policy_put_digests(struct policy_writer *w, const struct sudoers_userspec *spec) {
+    if (!spec->commands || !spec->digests) {
+        return 0;
+    }
+    uint32_t offset = (uint32_t)w->used;
+    for (int i = 0; spec->commands[i]; i++) {
+        if (spec->commands[i][0]) {
+            policy_put_string(w, spec->digests[i] ? spec->digests[i] : "-");
+        }
+    }
+    policy_put_string(w, "");
+    return offset;
+}
+
+/**
+ * Lay out a whole image into w->image (or only measure it when NULL)
+ */
+static void policy_layout(struct policy_writer *w, const struct policy_build *build,
+                          const char *sudoers_path, const char *initial_includedir,
+                          uint32_t rule_count) {
+    struct policy_image_header header;
+    uint32_t rules = (uint32_t)sizeof(header);
+    uint32_t sources = rules + rule_count * (uint32_t)sizeof(struct policy_rule);
+
+    w->used = sources + build->source_count * sizeof(struct policy_source);
+
+    memset(&header, 0, sizeof(header));
+    header.magic = POLICY_IMAGE_MAGIC;
+    header.version = POLICY_IMAGE_VERSION;
+    header.rule_count = rule_count;
+    header.rules = rules;
+    header.source_count = build->source_count;
+    header.sources = sources;
+    header.strings = (uint32_t)w->used;
+    policy_put_string(w, "");   /* Table never starts at an offset read as "absent" */
+    header.sudoers_path = policy_put_string(w, sudoers_path);
+    header.initial_includedir = policy_put_string(w, initial_includedir);
+    header.includedir = policy_put_string(w, build->includedir);
+
+    uint32_t r = 0;
+    for (const struct sudoers_userspec *spec = build->first; spec; spec = spec->next, r++) {
+        struct policy_rule rule;
+        memset(&rule, 0, sizeof(rule));
+        rule.users = policy_put_list(w, spec->users);
+        rule.hosts = policy_put_list(w, spec->hosts);
+        rule.commands = policy_put_list(w, spec->commands);
+        rule.digests = policy_put_digests(w, spec);
+        rule.runas_user = policy_put_string(w, spec->runas_user);
+        rule.source_file = policy_put_string(w, spec->source_file);
+        rule.nopasswd = (uint32_t)spec->nopasswd;
+        if (w->image) {
+            memcpy(w->image + rules + r * sizeof(rule), &rule, sizeof(rule));
+        }
+    }
+
+    for (uint32_t i = 0; i < build->source_count; i++) {
+        struct policy_source source = build->sources[i];
+        source.path = policy_put_string(w, build->source_paths[i]);
+        if (w->image) {
+            memcpy(w->image + sources + i * sizeof(source), &source, sizeof(source));
+        }
+    }
+
+    /* Pad so a following mapping or copy stays 8-byte aligned */
+    while (w->used % 8) {
+        if (w->image) {
+            w->image[w->used] = '\0';
+        }
+        w->used++;
+    }
+    header.size = w->used;
+    if (w->image) {
+        memcpy(w->image, &header, sizeof(header));
+    }
+}
+
+/**
+ * Point a config at an image
+ */
+static void policy_bind(struct sudoers_config *config, const char *image) {
+    const struct policy_image_header *header = (const struct policy_image_header *)image;
+
+    config->image = image;
+    config->rules = (const struct policy_rule *)(image + header->rules);
+    config->rule_count = header->rule_count;
+    config->includedir = policy_string(config, header->includedir);
+}
+
+/**
+ * Compile collected rules into a private image
+ *
+ * The config and its image are one allocation, released by
+ * free_sudoers_config().
+ */
+struct sudoers_config *policy_compile(const struct policy_build *build, const char *sudoers_path,
+                                      const char *initial_includedir) {
+    struct policy_writer w = { NULL, 0 };
+    uint32_t rule_count = 0;
+
+    /* Without every input recorded, a change could go unnoticed */
+    if (build->incomplete) {
+        return NULL;
+    }
+    for (const struct sudoers_userspec *spec = build->first; spec; spec = spec->next) {
+        rule_count++;
+    }
+    policy_layout(&w, build, sudoers_path, initial_includedir, rule_count);
+    if (w.used > UINT32_MAX) {
+        syslog(LOG_ERR, "SUDOERS_POLICY: compiled policy too large (%zu bytes)", w.used);
+        return NULL;
+    }
+
+    size_t head = (sizeof(struct sudoers_config) + 7) & ~(size_t)7;
+    char *block = malloc(head + w.used);
+    if (!block) {
+        return NULL;
+    }
+    struct sudoers_config *config = (struct sudoers_config *)block;
+    memset(config, 0, sizeof(*config));
+    w.image = block + head;
+    policy_layout(&w, build, sudoers_path, initial_includedir, rule_count);
+    policy_bind(config, w.image);
+    return config;
+}
+
+/**
+ * Check that an offset names a NUL-terminated string inside the table
+ */
+static int policy_string_ok(const char *image, const struct policy_image_header *h, uint32_t offset) {
+    if (offset == 0) {
+        return 1;
+    }
+    return offset >= h->strings && offset < h->size &&
+           memchr(image + offset, '\0', h->size - offset) != NULL;
+}
+
+/**
+ * Check that an offset names a string list that ends inside the table;
+ * returns its entry count, or -1
+ */
+static int policy_list_ok(const char *image, const struct policy_image_header *h, uint32_t offset) {
+    int count = 0;
+
+    if (offset == 0) {
+        return 0;
+    }
+    while (policy_string_ok(image, h, offset)) {
+        size_t len = strlen(image + offset);
+        if (len == 0) {
+            return count;
+        }
+        count++;
+        offset += (uint32_t)len + 1;
+        if (offset >= h->size) {
+            return -1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Check an image's structure so that every offset a reader follows
+ * stays inside it
+ */
+static int policy_image_valid(const char *image, size_t size) {
+    const struct policy_image_header *h = (const struct policy_image_header *)image;
+
+    if (size < sizeof(*h) || h->magic != POLICY_IMAGE_MAGIC ||
+        h->version != POLICY_IMAGE_VERSION || h->size != size) {
+        return 0;
+    }
+    uint64_t rules_end = (uint64_t)h->rules + (uint64_t)h->rule_count * sizeof(struct policy_rule);
+    uint64_t sources_end = (uint64_t)h->sources + (uint64_t)h->source_count * sizeof(struct policy_source);
+    if (h->rules < sizeof(*h) || h->rules % 8 || rules_end > h->sources ||
+        h->sources % 8 || sources_end > h->strings || h->strings >= size ||
+        image[size - 1] != '\0') {
+        return 0;
+    }
+    if (!policy_string_ok(image, h, h->sudoers_path) ||
+        !policy_string_ok(image, h, h->initial_includedir) ||
+        !policy_string_ok(image, h, h->includedir)) {
+        return 0;
+    }
+
+    const struct policy_rule *rules = (const struct policy_rule *)(image + h->rules);
+    for (uint32_t i = 0; i < h->rule_count; i++) {
+        int commands = policy_list_ok(image, h, rules[i].commands);
+        if (policy_list_ok(image, h, rules[i].users) < 0 ||
+            policy_list_ok(image, h, rules[i].hosts) < 0 || commands < 0 ||
+            (rules[i].digests && policy_list_ok(image, h, rules[i].digests) != commands) ||
+            !policy_string_ok(image, h, rules[i].runas_user) ||
+            !policy_string_ok(image, h, rules[i].source_file)) {
+            return 0;
+        }
+    }
+
+    const struct policy_source *sources = (const struct policy_source *)(image + h->sources);
+    for (uint32_t i = 0; i < h->source_count; i++) {
+        if (sources[i].path == 0 || !policy_string_ok(image, h, sources[i].path)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * True if an image was compiled from these inputs and none has changed
+ */
+static int policy_image_current(const char *image, const char *sudoers_path, const char *includedir) {
+    const struct policy_image_header *h = (const struct policy_image_header *)image;
+
+    if (!h->sudoers_path || strcmp(image + h->sudoers_path, sudoers_path) != 0 ||
+        !h->initial_includedir || strcmp(image + h->initial_includedir, includedir) != 0) {
+        return 0;
+    }
+
+    const struct policy_source *sources = (const struct policy_source *)(image + h->sources);
+    for (uint32_t i = 0; i < h->source_count; i++) {
+        struct policy_source now;
+        policy_stamp(image + sources[i].path, &now);
+        if (now.missing != sources[i].missing || now.missing == 2 ||
+            now.dev != sources[i].dev || now.ino != sources[i].ino ||
+            now.size != sources[i].size ||
+            now.mtime_sec != sources[i].mtime_sec || now.mtime_nsec != sources[i].mtime_nsec ||
+            now.ctime_sec != sources[i].ctime_sec || now.ctime_nsec != sources[i].ctime_nsec) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * True if a config, mapped or private, was compiled from these inputs
+ * and none has changed since
+ */
+int policy_config_current(const struct sudoers_config *config, const char *sudoers_path,
+                          const char *includedir) {
+    return config && sudoers_path && includedir &&
+           policy_image_current(config->image, sudoers_path, includedir);
+}
+
+/**
+ * Drop one reference to a mapping, unmapping it with the last
+ */
+static void policy_mapping_put(struct policy_mapping *mapping) {
+    if (--mapping->refs == 0) {
+        munmap(mapping->base, mapping->size);
+        free(mapping);
+    }
+}
+
+/**
+ * Map the published image if it is trusted and well formed
+ */
+static struct policy_mapping *policy_map_file(const char *path) {
+    struct stat st;
+
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1) {
+        return NULL;
+    }
+    if (!policy_file_trusted(fd, &st) || st.st_size < (off_t)sizeof(struct policy_image_header)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return NULL;
+    }
+    struct policy_mapping *mapping = malloc(sizeof(*mapping));
+    if (!mapping || !policy_image_valid(base, size)) {
+        if (mapping) {
+            syslog(LOG_WARNING, "SUDOERS_POLICY: ignoring malformed image %s", path);
+        }
+        munmap(base, size);
+        free(mapping);
+        return NULL;
+    }
+    mapping->base = base;
+    mapping->size = size;
+    mapping->refs = 1;
+    return mapping;
+}
+
+/**
+ * Get the shared policy image for these inputs, if one is published and
+ * current; NULL means parse and compile instead
+ */
+struct sudoers_config *policy_image_attach(const char *sudoers_path, const char *includedir) {
+    const char *path = policy_image_path();
+    if (!path || !sudoers_path || !includedir) {
+        return NULL;
+    }
+
+    if (policy_current && !policy_image_current(policy_current->base, sudoers_path, includedir)) {
+        policy_mapping_put(policy_current);
+        policy_current = NULL;
+    }
+    if (!policy_current) {
+        struct policy_mapping *mapping = policy_map_file(path);
+        if (!mapping) {
+            return NULL;
+        }
+        if (!policy_image_current(mapping->base, sudoers_path, includedir)) {
+            policy_mapping_put(mapping);
+            return NULL;
+        }
+        policy_current = mapping;
+    }
+
+    struct sudoers_config *config = malloc(sizeof(*config));
+    if (!config) {
+        return NULL;
+    }
+    memset(config, 0, sizeof(*config));
+    policy_bind(config, policy_current->base);
+    config->mapping = policy_current;
+    policy_current->refs++;
+    return config;
+}
+
+/**
+ * True if every input was last changed long enough ago for its stat()
+ * identity to reveal any later change
+ *
+ * File times advance in clock ticks, so a file rewritten at the same size
+ * within the tick it was read in would look unchanged.  Such a policy is
+ * used privately and published by a later session instead.
+ */
+static int policy_sources_settled(const char *image) {
+    const struct policy_image_header *h = (const struct policy_image_header *)image;
+    const struct policy_source *sources = (const struct policy_source *)(image + h->sources);
+    int64_t settled = (int64_t)time(NULL) - 1;
+
+    for (uint32_t i = 0; i < h->source_count; i++) {
+        if (sources[i].missing == 2) {
+            return 0;
+        }
+        if (!sources[i].missing &&
+            (sources[i].mtime_sec >= settled || sources[i].ctime_sec >= settled)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Publish a privately compiled policy for other sessions and return a
+ * config on the shared mapping of it, or NULL if it cannot be published
+ */
+struct sudoers_config *policy_image_publish(const struct sudoers_config *config) {
+    const struct policy_image_header *h = (const struct policy_image_header *)config->image;
+    char temp_path[PATH_MAX];
+    const char *path = policy_image_path();
+
+    if (!path || config->mapping || !policy_sources_settled(config->image)) {
+        return NULL;
+    }
+    if (strcmp(path, POLICY_IMAGE_FILE) == 0) {
+        mkdir(AUTH_CACHE_DIR, 0700);
+    }
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp.%d", path, (int)getpid());
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        return NULL;
+    }
+    size_t written = 0;
+    while (written < h->size) {
+        ssize_t n = write(fd, config->image + written, h->size - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        written += (size_t)n;
+    }
+    close(fd);
+    if (written != h->size || rename(temp_path, path) != 0) {
+        unlink(temp_path);
+        return NULL;
+    }
+
+    return policy_image_attach(policy_string(config, h->sudoers_path),
+                               policy_string(config, h->initial_includedir));
+}
+
+/**
+ * True if a config's inputs were settled when it was compiled, so that
+ * policy_config_current() will notice any later change to them; ask
+ * right after parse_sudoers_file()
+ */
+int policy_config_settled(const struct sudoers_config *config) {
+    return config && (config->mapping || policy_sources_settled(config->image));
+}
+
+/**
+ * Bytes of compiled policy behind a config
+ */
+size_t policy_image_size(const struct sudoers_config *config) {
+    return config ? (size_t)((const struct policy_image_header *)config->image)->size : 0;
+}
+
+/**
+ * Release a config from policy_compile() or policy_image_attach()
+ */
+void policy_release(struct sudoers_config *config) {
+    if (!config) {
+        return;
+    }
+    if (config->mapping) {
+        policy_mapping_put(config->mapping);
+    }
+    free(config);
+}
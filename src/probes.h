@@ -0,0 +1,97 @@
+#ifndef SUDOSH_PROBES_H
+#define SUDOSH_PROBES_H
+
+/**
+ * USDT (SystemTap SDT) probe points
+ *
+ * SUDOSH_PROBEn(name, args...) marks a static tracepoint in provider
+ * "sudosh" that bpftrace, perf and SystemTap can attach to, e.g.
+ *
+ *     bpftrace -e 'usdt:/usr/bin/sudosh:sudosh:auth__done { printf("%s %d\n", str(arg0), arg1); }'
+ *
+ * A probe is a single nop in the code plus an ELF note (.note.stapsdt)
+ * naming it and describing where its arguments live; nothing is linked
+ * and nothing runs unless a tracer replaces the nop with a breakpoint.
+ * <sys/sdt.h> is used when it is installed; otherwise the same note is
+ * emitted here on x86-64 and AArch64 Linux.  Elsewhere, or when built
+ * with -DSUDOSH_NO_PROBES, the macros evaluate nothing (the arguments
+ * only count as used) and SUDOSH_PROBES_ENABLED is left undefined.
+ *
+ * Every argument is passed as a signed 64-bit value: strings as their
+ * address (use str(argN)), verdicts and statuses as integers.
+ */
+
+#if !defined(SUDOSH_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define SUDOSH_HAVE_SYS_SDT 1
+#endif
+#endif
+
+#define SUDOSH_PROBE_ARG(a) ((long long)(intptr_t)(a))
+
+#if defined(SUDOSH_HAVE_SYS_SDT)
+
+#include <sys/sdt.h>
+#define SUDOSH_PROBES_ENABLED 1
+#define SUDOSH_PROBE1(name, a1) \
+    STAP_PROBE1(sudosh, name, SUDOSH_PROBE_ARG(a1))
+#define SUDOSH_PROBE2(name, a1, a2) \
+    STAP_PROBE2(sudosh, name, SUDOSH_PROBE_ARG(a1), SUDOSH_PROBE_ARG(a2))
+#define SUDOSH_PROBE3(name, a1, a2, a3) \
+    STAP_PROBE3(sudosh, name, SUDOSH_PROBE_ARG(a1), SUDOSH_PROBE_ARG(a2), SUDOSH_PROBE_ARG(a3))
+
+#elif !defined(SUDOSH_NO_PROBES) && defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__)) && defined(__GNUC__)
+
+/*
+ * The note layout read by tracers: the probe address, the address of
+ * _.stapsdt.base (to detect prelink adjustments), a semaphore address (none),
+ * then provider, name and "size@operand" argument descriptions.
+ */
+#define SUDOSH_PROBES_ENABLED 1
+#define SUDOSH_SDT_NOTE(name, args, ...) \
+    __asm__ __volatile__ ( \
+        "990: nop\n" \
+        ".pushsection .note.stapsdt,\"\",\"note\"\n" \
+        ".balign 4\n" \
+        ".4byte 992f-991f, 994f-993f, 3\n" \
+        "991: .asciz \"stapsdt\"\n" \
+        "992: .balign 4\n" \
+        "993: .8byte 990b\n" \
+        ".8byte _.stapsdt.base\n" \
+        ".8byte 0\n" \
+        ".asciz \"sudosh\"\n" \
+        ".asciz \"" #name "\"\n" \
+        ".asciz \"" args "\"\n" \
+        "994: .balign 4\n" \
+        ".popsection\n" \
+        ".ifndef _.stapsdt.base\n" \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+        ".weak _.stapsdt.base\n" \
+        ".hidden _.stapsdt.base\n" \
+        "_.stapsdt.base: .space 1\n" \
+        ".size _.stapsdt.base, 1\n" \
+        ".popsection\n" \
+        ".endif\n" \
+        : : __VA_ARGS__)
+
+#define SUDOSH_PROBE1(name, a1) \
+    SUDOSH_SDT_NOTE(name, "-8@%0", "r"(SUDOSH_PROBE_ARG(a1)))
+#define SUDOSH_PROBE2(name, a1, a2) \
+    SUDOSH_SDT_NOTE(name, "-8@%0 -8@%1", "r"(SUDOSH_PROBE_ARG(a1)), "r"(SUDOSH_PROBE_ARG(a2)))
+#define SUDOSH_PROBE3(name, a1, a2, a3) \
+    SUDOSH_SDT_NOTE(name, "-8@%0 -8@%1 -8@%2", "r"(SUDOSH_PROBE_ARG(a1)), \
+                    "r"(SUDOSH_PROBE_ARG(a2)), "r"(SUDOSH_PROBE_ARG(a3)))
+
+#else
+
+#define SUDOSH_PROBE1(name, a1) \
+    do { (void)sizeof(SUDOSH_PROBE_ARG(a1)); } while (0)
+#define SUDOSH_PROBE2(name, a1, a2) \
+    do { (void)sizeof(SUDOSH_PROBE_ARG(a1)); (void)sizeof(SUDOSH_PROBE_ARG(a2)); } while (0)
+#define SUDOSH_PROBE3(name, a1, a2, a3) \
+    do { (void)sizeof(SUDOSH_PROBE_ARG(a1)); (void)sizeof(SUDOSH_PROBE_ARG(a2)); \
+         (void)sizeof(SUDOSH_PROBE_ARG(a3)); } while (0)
+
+#endif
+
+#endif /* SUDOSH_PROBES_H */
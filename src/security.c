@@ -167,6 +167,9 @@ void sanitize_environment(void) {
 
     /* Set secure umask */
     umask(022);
+
+    /* Prepared editor environments were taken from the old one */
+    invalidate_editor_templates();
 }
 
 /**
@@ -346,37 +349,201 @@ void setup_secure_pager_environment(void) {
     umask(0077);
 }
 
+/* Variables forced on every secure editor launch */
+static const char *const secure_editor_overrides[][2] = {
+    { "SHELL", "/bin/false" },              /* Disable shell command execution */
+    { "VISUAL", "/bin/false" },             /* Disable external commands in vi/vim */
+    { "EDITOR", "/bin/false" },
+    { "VIMINIT", "set nomodeline noexrc secure" },
+    { "PAGER", "/bin/false" },              /* Disable pager and other external programs */
+    { "MANPAGER", "/bin/false" },
+    { NULL, NULL }
+};
+
+/* Variables removed from every secure editor launch (trailing '*' is a prefix) */
+static const char *const secure_editor_removals[] = {
+    "VIMRC", "EXINIT",
+    "BASH_ENV", "BASH_FUNC_*", "BASH_CMDS", "BASH_ALIASES",  /* Shellshock protection */
+    NULL
+};
+
 /**
  * Setup secure environment for editors to prevent shell escapes
  */
 void setup_secure_editor_environment(void) {
-    /* Disable shell command execution */
-    setenv("SHELL", "/bin/false", 1);
+    for (int i = 0; secure_editor_removals[i]; i++) {
+        unsetenv(secure_editor_removals[i]);
+    }
 
-    /* Disable external command execution in vi/vim */
-    setenv("VISUAL", "/bin/false", 1);
-    setenv("EDITOR", "/bin/false", 1);
+    for (int i = 0; secure_editor_overrides[i][0]; i++) {
+        setenv(secure_editor_overrides[i][0], secure_editor_overrides[i][1], 1);
+    }
 
-    /* Disable dangerous vi/vim features */
-    unsetenv("VIMINIT");
-    unsetenv("VIMRC");
-    unsetenv("EXINIT");
+    /* Set restrictive umask */
+    umask(0077);
+}
 
-    /* Set secure vi options */
-    setenv("VIMINIT", "set nomodeline noexrc secure", 1);
+/* Prepared secure editor launches, built on first use in a session */
+static struct editor_template editor_templates[MAX_EDITOR_TEMPLATES];
+static int editor_template_count = 0;
 
-    /* Disable pager and other external programs */
-    setenv("PAGER", "/bin/false", 1);
-    setenv("MANPAGER", "/bin/false", 1);
+/**
+ * Check whether an environment entry is replaced or removed for editors
+ */
+static int is_filtered_editor_env_entry(const char *entry) {
+    size_t name_len = strcspn(entry, "=");
 
-    /* Additional Shellshock protection */
-    unsetenv("BASH_ENV");
-    unsetenv("BASH_FUNC_*");
-    unsetenv("BASH_CMDS");
-    unsetenv("BASH_ALIASES");
+    for (int i = 0; secure_editor_overrides[i][0]; i++) {
+        const char *name = secure_editor_overrides[i][0];
+        if (strlen(name) == name_len && strncmp(entry, name, name_len) == 0) {
+            return 1;
+        }
+    }
 
-    /* Set restrictive umask */
-    umask(0077);
+    for (int i = 0; secure_editor_removals[i]; i++) {
+        const char *name = secure_editor_removals[i];
+        size_t len = strlen(name);
+        if (name[len - 1] == '*') {
+            if (name_len >= len - 1 && strncmp(entry, name, len - 1) == 0) {
+                return 1;
+            }
+        } else if (len == name_len && strncmp(entry, name, name_len) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Build the sanitized environment for secure editors from another one
+ * (the session's for templates, or a command's own)
+ */
+char **build_secure_editor_envp(char *const *source) {
+    size_t env_count = 0;
+    size_t override_count = 0;
+
+    for (char *const *env = source; env && *env; env++) {
+        env_count++;
+    }
+    while (secure_editor_overrides[override_count][0]) {
+        override_count++;
+    }
+
+    char **envp = calloc(env_count + override_count + 1, sizeof(char *));
+    if (!envp) {
+        return NULL;
+    }
+
+    size_t n = 0;
+    for (char *const *env = source; env && *env; env++) {
+        if (is_filtered_editor_env_entry(*env)) {
+            continue;
+        }
+        envp[n] = strdup(*env);
+        if (!envp[n]) {
+            goto fail;
+        }
+        n++;
+    }
+
+    for (size_t i = 0; i < override_count; i++) {
+        size_t len = strlen(secure_editor_overrides[i][0]) + strlen(secure_editor_overrides[i][1]) + 2;
+        envp[n] = malloc(len);
+        if (!envp[n]) {
+            goto fail;
+        }
+        snprintf(envp[n], len, "%s=%s", secure_editor_overrides[i][0], secure_editor_overrides[i][1]);
+        n++;
+    }
+
+    return envp;
+
+fail:
+    for (size_t i = 0; i < n; i++) {
+        free(envp[i]);
+    }
+    free(envp);
+    return NULL;
+}
+
+/**
+ * Release the resources held by an editor template
+ */
+static void free_editor_template(struct editor_template *tmpl) {
+    free(tmpl->name);
+    free(tmpl->binary_path);
+    if (tmpl->envp) {
+        for (char **env = tmpl->envp; *env; env++) {
+            free(*env);
+        }
+        free(tmpl->envp);
+    }
+    memset(tmpl, 0, sizeof(*tmpl));
+}
+
+/**
+ * Get the prepared launch template for a secure editor
+ *
+ * The editor binary is resolved, the sanitized environment built and the
+ * file locking state captured the first time an editor name is used; later
+ * launches only bind the file argument.  Returns NULL when the name is not
+ * a secure editor or cannot be resolved.
+ *
+ * The environment is a snapshot of the session's, so everything that
+ * changes the session environment (sanitize_environment(), export and
+ * unset) calls invalidate_editor_templates().  A command that carries its
+ * own environment (command_info.envp) is launched with one built from
+ * that by build_secure_editor_envp() instead.
+ */
+const struct editor_template *get_editor_template(const char *editor_name) {
+    if (!editor_name || !*editor_name) {
+        return NULL;
+    }
+
+    for (int i = 0; i < editor_template_count; i++) {
+        if (strcmp(editor_templates[i].name, editor_name) == 0) {
+            return &editor_templates[i];
+        }
+    }
+
+    if (editor_template_count >= MAX_EDITOR_TEMPLATES || !is_secure_editor(editor_name)) {
+        return NULL;
+    }
+
+    struct editor_template tmpl;
+    memset(&tmpl, 0, sizeof(tmpl));
+
+    tmpl.name = strdup(editor_name);
+    if (editor_name[0] == '/') {
+        tmpl.binary_path = strdup(editor_name);
+    } else {
+        tmpl.binary_path = find_command_in_path(editor_name);
+    }
+    if (!tmpl.name || !tmpl.binary_path || access(tmpl.binary_path, X_OK) != 0) {
+        free_editor_template(&tmpl);
+        return NULL;
+    }
+
+    tmpl.envp = build_secure_editor_envp(environ);
+    if (!tmpl.envp) {
+        free_editor_template(&tmpl);
+        return NULL;
+    }
+    tmpl.file_locking_available = is_file_locking_available();
+
+    editor_templates[editor_template_count] = tmpl;
+    return &editor_templates[editor_template_count++];
+}
+
+/**
+ * Drop all prepared editor templates (environment or PATH changed)
+ */
+void invalidate_editor_templates(void) {
+    for (int i = 0; i < editor_template_count; i++) {
+        free_editor_template(&editor_templates[i]);
+    }
+    editor_template_count = 0;
 }
 
 /**
@@ -1160,52 +1327,53 @@ int user_has_unrestricted_access(const char *username) {
         snprintf(hostname, sizeof(hostname), "%s", "localhost");
     }
 
-    struct sudoers_userspec *spec = sudoers_config->userspecs;
-    while (spec) {
-        /* Check if this rule applies to the user */
-        if (spec->users) {
-            for (int i = 0; spec->users && spec->users[i]; i++) {
-                int user_matches = 0;
+    for (uint32_t r = 0; r < sudoers_config->rule_count; r++) {
+        const struct policy_rule *rule = &sudoers_config->rules[r];
+        int user_matches = 0;
 
-                /* Direct username match */
-                if (strcmp(spec->users[i], username) == 0) {
-                    user_matches = 1;
-                }
-                /* Group membership check */
-                else if (spec->users[i][0] == '%') {
-                    struct group *grp = getgrnam(spec->users[i] + 1);
-                    if (grp && grp->gr_mem) {
-                        for (char **member = grp->gr_mem; member && *member; member++) {
-                            if (*member && strcmp(*member, username) == 0) {
-                                user_matches = 1;
-                                break;
-                            }
+        /* Check if this rule applies to the user */
+        POLICY_FOREACH(sudoers_config, rule->users, user) {
+            /* Direct username match */
+            if (strcmp(user, username) == 0) {
+                user_matches = 1;
+            }
+            /* Group membership check */
+            else if (user[0] == '%') {
+                struct group *grp = getgrnam(user + 1);
+                if (grp && grp->gr_mem) {
+                    for (char **member = grp->gr_mem; *member; member++) {
+                        if (strcmp(*member, username) == 0) {
+                            user_matches = 1;
+                            break;
                         }
                     }
                 }
+            }
+            if (user_matches) {
+                break;
+            }
+        }
+        if (!user_matches) {
+            continue;
+        }
 
-                if (user_matches) {
-                    /* Check if hostname matches */
-                    if (spec->hosts) {
-                        for (int j = 0; spec->hosts[j]; j++) {
-                            if (strcmp(spec->hosts[j], "ALL") == 0 ||
-                                strcmp(spec->hosts[j], hostname) == 0) {
-                                /* Check if commands include ALL */
-                                if (spec->commands) {
-                                    for (int k = 0; spec->commands[k]; k++) {
-                                        if (strcmp(spec->commands[k], "ALL") == 0) {
-                                            free_sudoers_config(sudoers_config);
-                                            return 1; /* User has unrestricted access */
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
+        /* Check if hostname matches and commands include ALL */
+        int host_matches = 0;
+        POLICY_FOREACH(sudoers_config, rule->hosts, host) {
+            if (strcmp(host, "ALL") == 0 || strcmp(host, hostname) == 0) {
+                host_matches = 1;
+                break;
+            }
+        }
+        if (!host_matches) {
+            continue;
+        }
+        POLICY_FOREACH(sudoers_config, rule->commands, command) {
+            if (strcmp(command, "ALL") == 0) {
+                free_sudoers_config(sudoers_config);
+                return 1; /* User has unrestricted access */
             }
         }
-        spec = spec->next;
     }
 
     free_sudoers_config(sudoers_config);
@@ -1429,13 +1597,17 @@ int validate_command(const char *command) {
     const char *t = command;
     while (*t == ' ' || *t == '\t') t++;
     if (*t == '\0') return 0;
-    return validate_command_with_length(command, strlen(command) + 1);
+
+    long long started = monotonic_usec();
+    int valid = validate_command_with_length(command, strlen(command) + 1);
+    session_stats_latency(SESSION_LATENCY_VALIDATE, monotonic_usec() - started);
+    return valid;
 }
 
 /**
  * Enhanced command validation with buffer length for testing null byte injection
  */
-int validate_command_with_length(const char *command, size_t buffer_len) {
+static int validate_command_buffer(const char *command, size_t buffer_len) {
     if (!command) {
         return 0;
     }
@@ -1855,6 +2027,17 @@ int validate_command_with_length(const char *command, size_t buffer_len) {
     return 1;
 }
 
+/**
+ * Validate a command held in a buffer of buffer_len bytes (traced by the
+ * validate__start/validate__done probes)
+ */
+int validate_command_with_length(const char *command, size_t buffer_len) {
+    SUDOSH_PROBE1(validate__start, command);
+    int verdict = validate_command_buffer(command, buffer_len);
+    SUDOSH_PROBE2(validate__done, command, verdict);
+    return verdict;
+}
+
 /**
  * Initialize security measures
  */
@@ -1903,6 +2086,137 @@ void cleanup_security(void) {
         free(current_username);
         current_username = NULL;
     }
+    invalidate_editor_templates();
+}
+
+/**
+ * Check sudoers permission for a command line after glob expansion
+ */
+static int authorize_expanded_command(const struct command_info *cmd) {
+    size_t size = 1;
+    for (int i = 0; i < cmd->argc; i++) {
+        size += strlen(cmd->argv[i]) + 1;
+    }
+
+    char *line = malloc(size);
+    if (!line) {
+        return 0;
+    }
+    size_t len = 0;
+    for (int i = 0; i < cmd->argc; i++) {
+        len += (size_t)snprintf(line + len, size - len, "%s%s", len ? " " : "", cmd->argv[i]);
+    }
+
+    char *fallback = current_username ? NULL : get_current_username();
+    const char *user = current_username ? current_username :
+                       (fallback ? fallback : "(null)");
+
+    int allowed = is_safe_command(line) || check_command_permission(user, line);
+    if (!allowed) {
+        fprintf(stderr, "sudosh: %s is not allowed to run '%s' according to sudoers configuration\n",
+                user, line);
+        log_security_violation(user, "glob expansion not permitted by sudoers");
+    }
+
+    free(fallback);
+    free(line);
+    return allowed;
+}
+
+/**
+ * Validate arguments produced by glob expansion
+ *
+ * Each match is checked with validate_command() as if it had been typed
+ * together with the command's literal words.  The sudoers check made on
+ * the typed line only saw the pattern, so the expanded command line is
+ * then authorized again the way main.c authorizes typed commands: safe
+ * commands pass, anything else needs check_command_permission().
+ */
+int validate_glob_expansion(const struct command_info *cmd) {
+    if (!cmd || !cmd->glob_matched || !cmd->argv) {
+        return 1;
+    }
+
+    char base[MAX_COMMAND_LENGTH];
+    size_t base_len = 0;
+    base[0] = '\0';
+    for (int i = 0; i < cmd->argc; i++) {
+        if (cmd->glob_matched[i]) {
+            continue;
+        }
+        int n = snprintf(base + base_len, sizeof(base) - base_len, "%s%s",
+                         base_len ? " " : "", cmd->argv[i]);
+        if (n < 0 || (size_t)n >= sizeof(base) - base_len) {
+            return 0;
+        }
+        base_len += (size_t)n;
+    }
+
+    for (int i = 0; i < cmd->argc; i++) {
+        if (!cmd->glob_matched[i]) {
+            continue;
+        }
+
+        char check[MAX_COMMAND_LENGTH];
+        int n = snprintf(check, sizeof(check), "%s %s", base, cmd->argv[i]);
+        if (n < 0 || (size_t)n >= sizeof(check) || validate_command(check) != 1) {
+            char audit_msg[512];
+            snprintf(audit_msg, sizeof(audit_msg), "glob match rejected: %s", cmd->argv[i]);
+            log_security_violation(current_username, audit_msg);
+            fprintf(stderr, "sudosh: glob match rejected: %s\n", cmd->argv[i]);
+            return 0;
+        }
+    }
+
+    return authorize_expanded_command(cmd);
+}
+
+/**
+ * Check whether a path names an interpreter allowed for Ansible pipelining
+ *
+ * Pipelined modules arrive on stdin instead of as a file argument, so the
+ * interpreter is the only thing validate_command() would see, and it rejects
+ * bare interpreters as interactive shells.  Instead only absolute paths to
+ * python, python3, python3.N or platform-python are accepted, and outside
+ * test mode the binary must be root-owned and not group/world writable.
+ */
+int is_pipelining_interpreter(const char *interpreter_path) {
+    struct stat st;
+
+    if (!interpreter_path || interpreter_path[0] != '/' ||
+        strlen(interpreter_path) >= PATH_MAX) {
+        return 0;
+    }
+
+    const char *base = strrchr(interpreter_path, '/') + 1;
+    const char *suffix = NULL;
+    if (strcmp(base, "python") == 0 || strcmp(base, "python3") == 0 ||
+        strcmp(base, "platform-python") == 0) {
+        suffix = "";
+    } else if (strncmp(base, "python3.", 8) == 0 && base[8] != '\0') {
+        suffix = base + 8;
+    }
+    if (!suffix) {
+        return 0;
+    }
+    for (const char *p = suffix; *p; p++) {
+        if (!isdigit((unsigned char)*p)) {
+            return 0;
+        }
+    }
+
+    if (stat(interpreter_path, &st) != 0 || !S_ISREG(st.st_mode) ||
+        !(st.st_mode & S_IXUSR)) {
+        return 0;
+    }
+
+    if (!test_mode && (st.st_uid != 0 || (st.st_mode & (S_IWGRP | S_IWOTH)))) {
+        syslog(LOG_WARNING, "sudosh: pipelining interpreter %s has unsafe ownership",
+               interpreter_path);
+        return 0;
+    }
+
+    return 1;
 }
 
 /**
@@ -0,0 +1,203 @@
+/**
+ * session_stats.c - Per-Session Summary Counters and Latency Histograms
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * A session counts the commands and pipelines it runs, the command lines
+ * it refuses (by reason) and the password prompts it shows, and keeps
+ * latency histograms for command validation, sudoers permission checks
+ * and command launch.  Nothing is logged per command: log_session_end()
+ * writes everything as one summary record.  Commands and denials are also
+ * counted in the host-wide metrics (metrics.c).
+ *
+ * Histograms are log-linear in the style of HdrHistogram: values below
+ * SESSION_HIST_LINEAR microseconds get a bucket each, and every power of
+ * two above that is split into 2^SESSION_HIST_SUB_BITS buckets, so any
+ * value from 1 us to the full 64-bit range is kept within 12.5% in under
+ * 2 KiB.  Recording is a count-leading-zeros and an increment.
+ */
+
+#include "sudosh.h"
+
+/* Counters for this session */
+static struct {
+    unsigned long long commands;
+    unsigned long long pipelines;
+    unsigned long long auth_prompts;
+    unsigned long long denied[SESSION_DENY_COUNT];
+    struct session_histogram latency[SESSION_LATENCY_COUNT];
+} session_stats;
+
+static const char *const latency_names[SESSION_LATENCY_COUNT] = {
+    "validate", "permission", "exec"
+};
+
+static const char *const denial_names[SESSION_DENY_COUNT] = {
+    "validation", "permission", "authentication"
+};
+
+/**
+ * Bucket holding a value
+ */
+static int histogram_bucket(unsigned long long value) {
+    if (value < SESSION_HIST_LINEAR) {
+        return (int)value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int sub = (int)((value >> (msb - SESSION_HIST_SUB_BITS)) & ((1u << SESSION_HIST_SUB_BITS) - 1));
+    return SESSION_HIST_LINEAR + ((msb - SESSION_HIST_SUB_BITS - 1) << SESSION_HIST_SUB_BITS) + sub;
+}
+
+/**
+ * Largest value that falls into a bucket
+ */
+static unsigned long long histogram_bucket_top(int bucket) {
+    if (bucket < SESSION_HIST_LINEAR) {
+        return (unsigned long long)bucket;
+    }
+    int index = bucket - SESSION_HIST_LINEAR;
+    int shift = index >> SESSION_HIST_SUB_BITS;    /* msb - SESSION_HIST_SUB_BITS - 1 */
+    unsigned long long sub = (unsigned long long)(index & ((1 << SESSION_HIST_SUB_BITS) - 1));
+    unsigned long long low = ((1ULL << SESSION_HIST_SUB_BITS) + sub) << (shift + 1);
+    return low + ((1ULL << (shift + 1)) - 1);
+}
+
+/**
+ * Count a command (or pipeline) started by this session
+ */
+void session_stats_command(int pipeline) {
+    if (pipeline) {
+        session_stats.pipelines++;
+    } else {
+        session_stats.commands++;
+    }
+    metrics_count(pipeline ? METRIC_PIPELINES : METRIC_COMMANDS);
+}
+
+/**
+ * Count a command line the session refused to run
+ */
+void session_stats_denied(enum session_denial reason) {
+    if ((int)reason >= 0 && reason < SESSION_DENY_COUNT) {
+        session_stats.denied[reason]++;
+        metrics_count((enum metrics_counter)(METRIC_DENIED_VALIDATION + reason));
+    }
+}
+
+/**
+ * Count a password prompt (cached authentications are not prompts)
+ */
+void session_stats_auth_prompt(void) {
+    session_stats.auth_prompts++;
+}
+
+/**
+ * Record one latency sample in microseconds
+ */
+void session_stats_latency(enum session_latency which, long long usec) {
+    if ((int)which < 0 || which >= SESSION_LATENCY_COUNT) {
+        return;
+    }
+    struct session_histogram *h = &session_stats.latency[which];
+    unsigned long long value = usec > 0 ? (unsigned long long)usec : 0;
+
+    h->buckets[histogram_bucket(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+/**
+ * Value at quantile q (0..1): the top of the bucket holding it, capped at the maximum
+ */
+unsigned long long session_histogram_quantile(const struct session_histogram *h, double q) {
+    if (!h || h->count == 0) {
+        return 0;
+    }
+    if (q < 0) {
+        q = 0;
+    } else if (q > 1) {
+        q = 1;
+    }
+
+    unsigned long long rank = (unsigned long long)(q * (double)h->count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    unsigned long long seen = 0;
+    for (int b = 0; b < SESSION_HIST_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            unsigned long long top = histogram_bucket_top(b);
+            return top < h->max ? top : h->max;
+        }
+    }
+    return h->max;
+}
+
+/**
+ * This session's histogram for one latency
+ */
+const struct session_histogram *session_stats_histogram(enum session_latency which) {
+    if ((int)which < 0 || which >= SESSION_LATENCY_COUNT) {
+        return NULL;
+    }
+    return &session_stats.latency[which];
+}
+
+/**
+ * Format the session summary as one line of key=value fields
+ *
+ * Returns the length written, or -1 if it did not fit.
+ */
+int format_session_summary(char *buf, size_t size) {
+    unsigned long long denied = 0;
+    size_t len;
+    int n;
+
+    if (!buf || size == 0) {
+        return -1;
+    }
+    for (int i = 0; i < SESSION_DENY_COUNT; i++) {
+        denied += session_stats.denied[i];
+    }
+
+    n = snprintf(buf, size, "session summary: commands=%llu pipelines=%llu auth_prompts=%llu denied=%llu",
+                 session_stats.commands, session_stats.pipelines, session_stats.auth_prompts, denied);
+    if (n < 0 || (size_t)n >= size) {
+        return -1;
+    }
+    len = (size_t)n;
+
+    for (int i = 0; i < SESSION_DENY_COUNT; i++) {
+        n = snprintf(buf + len, size - len, " denied_%s=%llu", denial_names[i], session_stats.denied[i]);
+        if (n < 0 || (size_t)n >= size - len) {
+            return -1;
+        }
+        len += (size_t)n;
+    }
+
+    /* Latencies in microseconds: samples, mean, p50/p90/p99 and max */
+    for (int i = 0; i < SESSION_LATENCY_COUNT; i++) {
+        const struct session_histogram *h = &session_stats.latency[i];
+        n = snprintf(buf + len, size - len, " %s_us=n:%llu,mean:%llu,p50:%llu,p90:%llu,p99:%llu,max:%llu",
+                     latency_names[i], h->count, h->count ? h->sum / h->count : 0,
+                     session_histogram_quantile(h, 0.50), session_histogram_quantile(h, 0.90),
+                     session_histogram_quantile(h, 0.99), h->max);
+        if (n < 0 || (size_t)n >= size - len) {
+            return -1;
+        }
+        len += (size_t)n;
+    }
+
+    return (int)len;
+}
+
+/**
+ * Start counting from zero
+ */
+void reset_session_stats(void) {
+    memset(&session_stats, 0, sizeof(session_stats));
+}
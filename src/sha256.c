@@ -0,0 +1,275 @@
+/**
+ * sha256.c - SHA-256 Message Digest
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * Self-contained SHA-256 (FIPS 180-4) used to fingerprint payloads in
+ * audit records and to verify digest-pinned binaries without pulling in
+ * a crypto library.  Bulk data goes through a multi-block compression
+ * function; on x86-64 CPUs with the SHA extensions that is the SHA-NI
+ * instruction sequence, selected once at run time, otherwise portable C.
+ */
+
+#include "sudosh.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SHA256_HAVE_SHANI 1
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define SHA256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * Compress consecutive 64-byte blocks (portable C)
+ */
+static void sha256_blocks_generic(uint32_t state[8], const unsigned char *data, size_t blocks) {
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h;
+
+    for (; blocks > 0; blocks--, data += SHA256_BLOCK_SIZE) {
+        for (int i = 0; i < 16; i++) {
+            w[i] = ((uint32_t)data[i * 4] << 24) | ((uint32_t)data[i * 4 + 1] << 16) |
+                   ((uint32_t)data[i * 4 + 2] << 8) | (uint32_t)data[i * 4 + 3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = SHA256_ROTR(w[i - 15], 7) ^ SHA256_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = SHA256_ROTR(w[i - 2], 17) ^ SHA256_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        a = state[0]; b = state[1]; c = state[2]; d = state[3];
+        e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+        for (int i = 0; i < 64; i++) {
+            uint32_t s1 = SHA256_ROTR(e, 6) ^ SHA256_ROTR(e, 11) ^ SHA256_ROTR(e, 25);
+            uint32_t ch = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+            uint32_t s0 = SHA256_ROTR(a, 2) ^ SHA256_ROTR(a, 13) ^ SHA256_ROTR(a, 22);
+            uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + maj;
+
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+#ifdef SHA256_HAVE_SHANI
+/**
+ * Compress consecutive 64-byte blocks with the x86 SHA extensions
+ *
+ * The state is kept as ABEF/CDGH vectors; each step runs four rounds
+ * (two sha256rnds2) and derives the next four schedule words with
+ * sha256msg1/sha256msg2.
+ */
+__attribute__((target("sha,sse4.1")))
+static void sha256_blocks_shani(uint32_t state[8], const unsigned char *data, size_t blocks) {
+    const __m128i byteswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i tmp = _mm_loadu_si128((const __m128i *)&state[0]);
+    __m128i state1 = _mm_loadu_si128((const __m128i *)&state[4]);
+
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);             /* CDAB */
+    state1 = _mm_shuffle_epi32(state1, 0x1B);       /* EFGH */
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);   /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);    /* CDGH */
+
+    for (; blocks > 0; blocks--, data += SHA256_BLOCK_SIZE) {
+        __m128i abef_save = state0;
+        __m128i cdgh_save = state1;
+        __m128i w[4];
+
+        for (int i = 0; i < 4; i++) {
+            w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + i * 16)), byteswap);
+        }
+
+        for (int i = 0; i < 16; i++) {
+            __m128i msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i *)&sha256_k[i * 4]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+
+            if (i < 12) {
+                /* w[i+4] = msg2(msg1(w[i], w[i+1]) + (w[i+2]:w[i+3] >> 32), w[i+3]) */
+                __m128i next = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+                next = _mm_add_epi32(next, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+                w[i & 3] = _mm_sha256msg2_epu32(next, w[(i + 3) & 3]);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);          /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xB1);       /* DCHG */
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);    /* DCBA */
+    state1 = _mm_alignr_epi8(state1, tmp, 8);       /* HGFE */
+
+    _mm_storeu_si128((__m128i *)&state[0], state0);
+    _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+
+/**
+ * Check CPUID for SHA, SSSE3 and SSE4.1
+ */
+static int cpu_has_sha_extensions(void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) ||
+        !(ecx & (1u << 9)) || !(ecx & (1u << 19))) {
+        return 0;
+    }
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    return (ebx & (1u << 29)) != 0;
+}
+#endif
+
+typedef void (*sha256_blocks_fn)(uint32_t state[8], const unsigned char *data, size_t blocks);
+static sha256_blocks_fn sha256_blocks = NULL;
+
+/**
+ * Pick the block function for this CPU (once)
+ */
+static sha256_blocks_fn select_sha256_blocks(void) {
+    if (!sha256_blocks) {
+        sha256_blocks = sha256_blocks_generic;
+#ifdef SHA256_HAVE_SHANI
+        if (cpu_has_sha_extensions()) {
+            sha256_blocks = sha256_blocks_shani;
+        }
+#endif
+    }
+    return sha256_blocks;
+}
+
+/**
+ * Name of the SHA-256 implementation in use ("sha-ni" or "generic")
+ */
+const char *sha256_implementation(void) {
+#ifdef SHA256_HAVE_SHANI
+    if (select_sha256_blocks() == sha256_blocks_shani) {
+        return "sha-ni";
+    }
+#endif
+    return "generic";
+}
+
+/**
+ * Initialize a SHA-256 context
+ */
+void sha256_init(struct sha256_ctx *ctx) {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    memcpy(ctx->state, initial, sizeof(initial));
+    ctx->bit_count = 0;
+    ctx->buffer_len = 0;
+}
+
+/**
+ * Add data to a SHA-256 context
+ */
+void sha256_update(struct sha256_ctx *ctx, const void *data, size_t len) {
+    const unsigned char *p = data;
+
+    ctx->bit_count += (uint64_t)len * 8;
+
+    if (ctx->buffer_len > 0) {
+        size_t take = SHA256_BLOCK_SIZE - ctx->buffer_len;
+        if (take > len) {
+            take = len;
+        }
+        memcpy(ctx->buffer + ctx->buffer_len, p, take);
+        ctx->buffer_len += take;
+        p += take;
+        len -= take;
+        if (ctx->buffer_len < SHA256_BLOCK_SIZE) {
+            return;
+        }
+        select_sha256_blocks()(ctx->state, ctx->buffer, 1);
+        ctx->buffer_len = 0;
+    }
+
+    if (len >= SHA256_BLOCK_SIZE) {
+        size_t blocks = len / SHA256_BLOCK_SIZE;
+        select_sha256_blocks()(ctx->state, p, blocks);
+        p += blocks * SHA256_BLOCK_SIZE;
+        len -= blocks * SHA256_BLOCK_SIZE;
+    }
+
+    if (len > 0) {
+        memcpy(ctx->buffer, p, len);
+        ctx->buffer_len = len;
+    }
+}
+
+/**
+ * Finish a SHA-256 computation and write the 32-byte digest
+ */
+void sha256_final(struct sha256_ctx *ctx, unsigned char digest[SHA256_DIGEST_LENGTH]) {
+    uint64_t bit_count = ctx->bit_count;
+    unsigned char pad = 0x80;
+    unsigned char zero = 0;
+    unsigned char length[8];
+
+    sha256_update(ctx, &pad, 1);
+    while (ctx->buffer_len != SHA256_BLOCK_SIZE - 8) {
+        sha256_update(ctx, &zero, 1);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        length[i] = (unsigned char)(bit_count >> (56 - i * 8));
+    }
+    sha256_update(ctx, length, 8);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (unsigned char)(ctx->state[i] >> 24);
+        digest[i * 4 + 1] = (unsigned char)(ctx->state[i] >> 16);
+        digest[i * 4 + 2] = (unsigned char)(ctx->state[i] >> 8);
+        digest[i * 4 + 3] = (unsigned char)ctx->state[i];
+    }
+}
+
+/**
+ * Format a digest as lowercase hex (hex must hold SHA256_HEX_LENGTH + 1 bytes)
+ */
+void sha256_to_hex(const unsigned char digest[SHA256_DIGEST_LENGTH], char *hex) {
+    static const char digits[] = "0123456789abcdef";
+
+    for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
+        hex[i * 2] = digits[digest[i] >> 4];
+        hex[i * 2 + 1] = digits[digest[i] & 0x0f];
+    }
+    hex[SHA256_HEX_LENGTH] = '\0';
+}
+
+/**
+ * Compute the hex SHA-256 digest of a buffer in one call
+ */
+void sha256_hex(const void *data, size_t len, char *hex) {
+    struct sha256_ctx ctx;
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, digest);
+    sha256_to_hex(digest, hex);
+}
@@ -12,10 +12,25 @@
 
 /* Global variables for shell enhancements */
 static struct alias_entry *alias_list = NULL;
-static struct dir_stack_entry *dir_stack = NULL;
+/* Directory stack: fixed ring of open directory handles, oldest at head */
+static struct dir_stack_entry dir_stack[MAX_DIR_STACK_DEPTH];
+static int dir_stack_head = 0;
+static int dir_stack_count = 0;
+static struct dir_stack_entry dir_cwd = { NULL, -1 };
+static struct dir_stack_entry dir_oldpwd = { NULL, -1 };
 static int alias_system_initialized = 0;
 static int dir_stack_initialized = 0;
 
+/* Alias journal state: queued records and records already on disk */
+static char *alias_journal_pending = NULL;
+static size_t alias_journal_pending_len = 0;
+static size_t alias_journal_pending_cap = 0;
+static int alias_journal_pending_records = 0;
+static int alias_journal_records = 0;
+static int alias_journal_suspended = 0;
+
+static void queue_alias_journal_record(char op, const char *name, const char *value);
+
 /* External variables */
 extern char *current_username;
 
@@ -36,9 +51,12 @@ int init_alias_system(void) {
     /* Load aliases from file */
     load_aliases_from_file();
 
-    /* Load aliases from user shell rc files if enabled */
+    /* Load aliases from user shell rc files if enabled (re-imported each
+       session, so they are not journaled) */
     if (rc_alias_import_enabled) {
+        alias_journal_suspended++;
         load_aliases_from_shell_rc_files();
+        alias_journal_suspended--;
     }
 
     return 1;
@@ -53,8 +71,14 @@ void cleanup_alias_system(void) {
         return;
     }
 
-    /* Save aliases to file before cleanup */
+    /* Flush queued alias changes before cleanup */
     save_aliases_to_file();
+    free(alias_journal_pending);
+    alias_journal_pending = NULL;
+    alias_journal_pending_len = 0;
+    alias_journal_pending_cap = 0;
+    alias_journal_pending_records = 0;
+    alias_journal_records = 0;
 
     /* Free all aliases */
     struct alias_entry *current = alias_list;
@@ -96,16 +120,8 @@ int validate_alias_name(const char *name) {
     }
 
     /* Don't allow overriding built-in commands */
-    const char *builtins[] = {
-        "help", "commands", "history", "pwd", "path", "cd", "exit", "quit",
-        "rules", "version", "alias", "unalias", "export", "unset", "env",
-        "which", "type", "pushd", "popd", "dirs", NULL
-    };
-
-    for (int i = 0; builtins[i]; i++) {
-        if (strcmp(name, builtins[i]) == 0) {
-            return 0;
-        }
+    if (builtin_command_name(name)) {
+        return 0;
     }
 
     return 1;
@@ -322,7 +338,11 @@ int add_alias(const char *name, const char *value) {
             /* Update existing alias */
             free(current->value);
             current->value = safe_strdup(value);
-            return current->value ? 1 : 0;
+            if (!current->value) {
+                return 0;
+            }
+            queue_alias_journal_record('S', name, value);
+            return 1;
         }
         current = current->next;
     }
@@ -345,6 +365,7 @@ int add_alias(const char *name, const char *value) {
     }
 
     alias_list = new_alias;
+    queue_alias_journal_record('S', name, value);
     return 1;
 }
 
@@ -368,6 +389,7 @@ int remove_alias(const char *name) {
                 alias_list = current->next;
             }
 
+            queue_alias_journal_record('D', name, NULL);
             free(current->name);
             free(current->value);
             free(current);
@@ -441,28 +463,132 @@ int alias_iterate_names_with_prefix(const char *prefix, int (*cb)(const char *na
 }
 
 /**
- * Load aliases from file
+ * CRC-32 (IEEE 802.3) used to checksum alias journal records
  */
-int load_aliases_from_file(void) {
+static uint32_t alias_journal_crc32(const char *data, size_t len) {
+    uint32_t crc = 0xFFFFFFFFu;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (unsigned char)data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (uint32_t)-(int32_t)(crc & 1));
+        }
+    }
+
+    return ~crc;
+}
+
+/**
+ * Build the alias base file and journal paths for the current user.
+ * In test mode, $HOME is preferred so tests never touch the real home.
+ */
+static int get_alias_file_paths(char *base_path, size_t base_len,
+                                char *journal_path, size_t journal_len) {
     char *username = get_current_username();
     if (!username) {
         return 0;
     }
 
     struct passwd *pwd = getpwnam(username);
+    free(username);
     if (!pwd) {
-        free(username);
         return 0;
     }
 
-    char alias_file_path[PATH_MAX];
-    snprintf(alias_file_path, sizeof(alias_file_path), "%s/%s",
-             pwd->pw_dir, ALIAS_FILE_NAME);
+    const char *home = pwd->pw_dir;
+    char *test_env = getenv("SUDOSH_TEST_MODE");
+    if (test_env && strcmp(test_env, "1") == 0) {
+        char *home_env = getenv("HOME");
+        if (home_env && home_env[0] == '/') {
+            home = home_env;
+        }
+    }
+
+    if (snprintf(base_path, base_len, "%s/%s", home, ALIAS_FILE_NAME) >= (int)base_len) {
+        return 0;
+    }
+    if (snprintf(journal_path, journal_len, "%s/%s%s", home, ALIAS_FILE_NAME,
+                 ALIAS_JOURNAL_SUFFIX) >= (int)journal_len) {
+        return 0;
+    }
 
-    FILE *file = fopen(alias_file_path, "r");
+    return 1;
+}
+
+/**
+ * Set an entry in a detached alias list (used while merging files)
+ */
+static int alias_list_put(struct alias_entry **list, const char *name, const char *value) {
+    for (struct alias_entry *cur = *list; cur; cur = cur->next) {
+        if (strcmp(cur->name, name) == 0) {
+            char *copy = safe_strdup(value);
+            if (!copy) {
+                return 0;
+            }
+            free(cur->value);
+            cur->value = copy;
+            return 1;
+        }
+    }
+
+    struct alias_entry *entry = malloc(sizeof(struct alias_entry));
+    if (!entry) {
+        return 0;
+    }
+
+    entry->name = safe_strdup(name);
+    entry->value = safe_strdup(value);
+    if (!entry->name || !entry->value) {
+        free(entry->name);
+        free(entry->value);
+        free(entry);
+        return 0;
+    }
+
+    entry->next = *list;
+    *list = entry;
+    return 1;
+}
+
+/**
+ * Drop an entry from a detached alias list
+ */
+static void alias_list_drop(struct alias_entry **list, const char *name) {
+    struct alias_entry **link = list;
+
+    while (*link) {
+        struct alias_entry *cur = *link;
+        if (strcmp(cur->name, name) == 0) {
+            *link = cur->next;
+            free(cur->name);
+            free(cur->value);
+            free(cur);
+            return;
+        }
+        link = &cur->next;
+    }
+}
+
+/**
+ * Free a detached alias list
+ */
+static void alias_list_free(struct alias_entry *list) {
+    while (list) {
+        struct alias_entry *next = list->next;
+        free(list->name);
+        free(list->value);
+        free(list);
+        list = next;
+    }
+}
+
+/**
+ * Read the compacted base file (name=value lines) into a detached list
+ */
+static void read_alias_base_file(const char *path, struct alias_entry **list) {
+    FILE *file = fopen(path, "r");
     if (!file) {
-        free(username);
-        return 0;  /* File doesn't exist, that's OK */
+        return;  /* File doesn't exist, that's OK */
     }
 
     char line[MAX_ALIAS_VALUE_LENGTH + MAX_ALIAS_NAME_LENGTH + 10];
@@ -482,20 +608,122 @@ int load_aliases_from_file(void) {
         }
 
         *equals = '\0';
-        char *name = line;
-        char *value = equals + 1;
-
-        /* Trim whitespace */
-        name = trim_whitespace(name);
-        value = trim_whitespace(value);
+        char *name = trim_whitespace(line);
+        char *value = trim_whitespace(equals + 1);
 
         if (validate_alias_name(name) && validate_alias_value(value)) {
-            add_alias(name, value);
+            alias_list_put(list, name, value);
         }
     }
 
     fclose(file);
-    free(username);
+}
+
+/**
+ * Replay journal records on top of a detached list.
+ *
+ * Records are "<op> <crc32> <payload>" where op is 'S' (payload name=value)
+ * or 'D' (payload name) and the checksum covers "<op> <payload>". Records with
+ * a bad checksum or no trailing newline (torn writes) are skipped.
+ * Returns the number of records seen.
+ */
+static int replay_alias_journal_fd(int fd, struct alias_entry **list) {
+    int dup_fd = dup(fd);
+    if (dup_fd < 0) {
+        return 0;
+    }
+
+    FILE *file = fdopen(dup_fd, "r");
+    if (!file) {
+        close(dup_fd);
+        return 0;
+    }
+    rewind(file);
+
+    int records = 0;
+    char line[MAX_ALIAS_JOURNAL_RECORD_LENGTH];
+    while (fgets(line, sizeof(line), file)) {
+        size_t len = strlen(line);
+        if (len == 0 || line[len - 1] != '\n') {
+            continue;
+        }
+        line[--len] = '\0';
+        records++;
+
+        /* "<op> <8 hex digits> <payload>" */
+        if (len < 12 || (line[0] != 'S' && line[0] != 'D') || line[1] != ' ' || line[10] != ' ') {
+            continue;
+        }
+
+        char crc_text[9];
+        memcpy(crc_text, line + 2, 8);
+        crc_text[8] = '\0';
+        char *endp = NULL;
+        unsigned long stored_crc = strtoul(crc_text, &endp, 16);
+        if (!endp || *endp != '\0') {
+            continue;
+        }
+
+        char *payload = line + 11;
+        char checked[MAX_ALIAS_JOURNAL_RECORD_LENGTH];
+        int checked_len = snprintf(checked, sizeof(checked), "%c %s", line[0], payload);
+        if (checked_len < 0 || (size_t)checked_len >= sizeof(checked) ||
+            alias_journal_crc32(checked, (size_t)checked_len) != (uint32_t)stored_crc) {
+            continue;
+        }
+
+        if (line[0] == 'S') {
+            char *equals = strchr(payload, '=');
+            if (!equals) {
+                continue;
+            }
+            *equals = '\0';
+            if (validate_alias_name(payload) && validate_alias_value(equals + 1)) {
+                alias_list_put(list, payload, equals + 1);
+            }
+        } else if (validate_alias_name(payload)) {
+            alias_list_drop(list, payload);
+        }
+    }
+
+    fclose(file);
+    return records;
+}
+
+/**
+ * Load aliases from file
+ *
+ * The persisted state is the compacted base file plus the append-only
+ * journal replayed on top of it, read under a shared lock on the journal.
+ */
+int load_aliases_from_file(void) {
+    char base_path[PATH_MAX];
+    char journal_path[PATH_MAX];
+    if (!get_alias_file_paths(base_path, sizeof(base_path), journal_path, sizeof(journal_path))) {
+        return 0;
+    }
+
+    struct alias_entry *merged = NULL;
+    int journal_fd = open(journal_path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (journal_fd >= 0) {
+        flock(journal_fd, LOCK_SH);
+    }
+
+    read_alias_base_file(base_path, &merged);
+    if (journal_fd >= 0) {
+        alias_journal_records = replay_alias_journal_fd(journal_fd, &merged);
+        flock(journal_fd, LOCK_UN);
+        close(journal_fd);
+    }
+
+    /* Re-apply through add_alias so persisted aliases pass full validation */
+    alias_journal_suspended++;
+    for (struct alias_entry *cur = merged; cur; cur = cur->next) {
+        add_alias(cur->name, cur->value);
+    }
+    alias_journal_suspended--;
+
+    alias_list_free(merged);
     return 1;
 }
 
@@ -651,48 +879,164 @@ int load_aliases_from_shell_rc_files(void) {
 }
 
 /**
- * Save aliases to file
+ * Queue a journal record; records are written in batches, not per command
  */
-int save_aliases_to_file(void) {
-    if (!alias_system_initialized || !alias_list) {
-        return 1;  /* Nothing to save */
+static void queue_alias_journal_record(char op, const char *name, const char *value) {
+    if (alias_journal_suspended) {
+        return;
     }
 
-    char *username = get_current_username();
-    if (!username) {
-        return 0;
+    char payload[MAX_ALIAS_JOURNAL_RECORD_LENGTH];
+    int payload_len;
+    if (op == 'S') {
+        payload_len = snprintf(payload, sizeof(payload), "%c %s=%s", op, name, value);
+    } else {
+        payload_len = snprintf(payload, sizeof(payload), "%c %s", op, name);
+    }
+    if (payload_len < 0 || (size_t)payload_len + 10 >= sizeof(payload)) {
+        return;
     }
 
-    struct passwd *pwd = getpwnam(username);
-    if (!pwd) {
-        free(username);
+    size_t record_len = (size_t)payload_len + 10;  /* crc + separator + newline */
+    if (alias_journal_pending_len + record_len + 1 > alias_journal_pending_cap) {
+        size_t new_cap = alias_journal_pending_cap ? alias_journal_pending_cap * 2 : 4096;
+        while (new_cap < alias_journal_pending_len + record_len + 1) {
+            new_cap *= 2;
+        }
+        char *grown = realloc(alias_journal_pending, new_cap);
+        if (!grown) {
+            return;
+        }
+        alias_journal_pending = grown;
+        alias_journal_pending_cap = new_cap;
+    }
+
+    uint32_t crc = alias_journal_crc32(payload, (size_t)payload_len);
+    alias_journal_pending_len += (size_t)snprintf(alias_journal_pending + alias_journal_pending_len,
+                                                  alias_journal_pending_cap - alias_journal_pending_len,
+                                                  "%c %08x %s\n", op, (unsigned int)crc, payload + 2);
+    alias_journal_pending_records++;
+
+    if (alias_journal_pending_records >= ALIAS_JOURNAL_FLUSH_BATCH) {
+        save_aliases_to_file();
+    }
+}
+
+/**
+ * Rewrite the base file from base + journal and truncate the journal.
+ * Caller holds an exclusive lock on journal_fd.
+ */
+static int compact_alias_journal(const char *base_path, int journal_fd) {
+    struct alias_entry *merged = NULL;
+    read_alias_base_file(base_path, &merged);
+    replay_alias_journal_fd(journal_fd, &merged);
+
+    char tmp_path[PATH_MAX];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%d", base_path, (int)getpid()) >= (int)sizeof(tmp_path)) {
+        alias_list_free(merged);
         return 0;
     }
 
-    char alias_file_path[PATH_MAX];
-    snprintf(alias_file_path, sizeof(alias_file_path), "%s/%s",
-             pwd->pw_dir, ALIAS_FILE_NAME);
+    int tmp_fd = open(tmp_path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (tmp_fd < 0) {
+        alias_list_free(merged);
+        return 0;
+    }
 
-    FILE *file = fopen(alias_file_path, "w");
+    FILE *file = fdopen(tmp_fd, "w");
     if (!file) {
-        free(username);
+        close(tmp_fd);
+        unlink(tmp_path);
+        alias_list_free(merged);
         return 0;
     }
 
     fprintf(file, "# Sudosh aliases - automatically generated\n");
     fprintf(file, "# Format: name=value\n\n");
+    for (struct alias_entry *cur = merged; cur; cur = cur->next) {
+        fprintf(file, "%s=%s\n", cur->name, cur->value);
+    }
+    alias_list_free(merged);
 
-    struct alias_entry *current = alias_list;
-    while (current) {
-        fprintf(file, "%s=%s\n", current->name, current->value);
-        current = current->next;
+    int ok = (fflush(file) == 0 && fsync(tmp_fd) == 0);
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    if (!ok || rename(tmp_path, base_path) != 0) {
+        unlink(tmp_path);
+        return 0;
     }
 
-    fclose(file);
-    free(username);
+    /* Base now holds everything; the journal can be emptied */
+    if (ftruncate(journal_fd, 0) != 0) {
+        return 0;
+    }
+    fsync(journal_fd);
+    alias_journal_records = 0;
     return 1;
 }
 
+/**
+ * Save aliases to file
+ *
+ * Appends queued alias changes to the journal in one write and compacts
+ * the journal into the base file once it grows past the threshold. Only
+ * changes are written, so concurrent sessions merge instead of clobbering
+ * each other's aliases.
+ */
+int save_aliases_to_file(void) {
+    if (alias_journal_pending_records == 0 &&
+        alias_journal_records < ALIAS_JOURNAL_COMPACT_RECORDS) {
+        return 1;  /* Nothing to save */
+    }
+
+    char base_path[PATH_MAX];
+    char journal_path[PATH_MAX];
+    if (!get_alias_file_paths(base_path, sizeof(base_path), journal_path, sizeof(journal_path))) {
+        return 0;
+    }
+
+    int journal_fd = open(journal_path, O_RDWR | O_APPEND | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (journal_fd < 0) {
+        return 0;
+    }
+
+    if (flock(journal_fd, LOCK_EX) != 0) {
+        close(journal_fd);
+        return 0;
+    }
+
+    int result = 1;
+    if (alias_journal_pending_len > 0) {
+        /* Terminate a torn record left by a crashed writer so ours stays intact */
+        struct stat st;
+        char last = '\n';
+        if (fstat(journal_fd, &st) == 0 && st.st_size > 0 &&
+            pread(journal_fd, &last, 1, st.st_size - 1) == 1 && last != '\n') {
+            if (write(journal_fd, "\n", 1) != 1) {
+                result = 0;
+            }
+        }
+
+        ssize_t written = write(journal_fd, alias_journal_pending, alias_journal_pending_len);
+        if (written != (ssize_t)alias_journal_pending_len) {
+            result = 0;
+        } else {
+            alias_journal_records += alias_journal_pending_records;
+            alias_journal_pending_len = 0;
+            alias_journal_pending_records = 0;
+        }
+    }
+
+    if (result && alias_journal_records >= ALIAS_JOURNAL_COMPACT_RECORDS) {
+        result = compact_alias_journal(base_path, journal_fd);
+    }
+
+    flock(journal_fd, LOCK_UN);
+    close(journal_fd);
+    return result;
+}
+
 /**
  * Internal alias expansion without security validation (for testing during alias creation)
  */
@@ -907,6 +1251,75 @@ int validate_expanded_alias_command(const char *expanded_command, const char *al
     return 1;
 }
 
+/* Open flags for directory handles: O_PATH skips permission checks on the
+   directory contents and is enough for fchdir() on Linux */
+#ifdef O_PATH
+#define DIR_STACK_OPEN_FLAGS (O_PATH | O_DIRECTORY | O_CLOEXEC)
+#else
+#define DIR_STACK_OPEN_FLAGS (O_RDONLY | O_DIRECTORY | O_CLOEXEC)
+#endif
+
+/**
+ * Release a directory stack entry
+ */
+static void dir_entry_release(struct dir_stack_entry *entry) {
+    if (entry->fd >= 0) {
+        close(entry->fd);
+    }
+    free(entry->path);
+    entry->fd = -1;
+    entry->path = NULL;
+}
+
+/**
+ * Open a directory handle and resolve its display path once
+ */
+static int dir_entry_open(const char *dir, struct dir_stack_entry *entry) {
+    int fd = open(dir, DIR_STACK_OPEN_FLAGS);
+    if (fd < 0) {
+        return 0;
+    }
+
+    if (fchdir(fd) != 0) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return 0;
+    }
+
+    /* One path walk per directory change; the prompt reuses this string */
+    char *path = getcwd(NULL, 0);
+    if (!path) {
+        path = safe_strdup(dir);
+    }
+
+    entry->fd = fd;
+    entry->path = path;
+    return 1;
+}
+
+/**
+ * Capture the current directory as the stack's working entry
+ */
+static void dir_stack_capture_cwd(void) {
+    if (dir_cwd.fd >= 0) {
+        return;
+    }
+
+    int fd = open(".", DIR_STACK_OPEN_FLAGS);
+    char *path = getcwd(NULL, 0);
+    if (fd < 0 || !path) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        free(path);
+        return;
+    }
+
+    dir_cwd.fd = fd;
+    dir_cwd.path = path;
+}
+
 /**
  * Initialize directory stack
  */
@@ -915,8 +1328,19 @@ int init_directory_stack(void) {
         return 1;
     }
 
-    dir_stack = NULL;
+    for (int i = 0; i < MAX_DIR_STACK_DEPTH; i++) {
+        dir_stack[i].path = NULL;
+        dir_stack[i].fd = -1;
+    }
+    dir_stack_head = 0;
+    dir_stack_count = 0;
+    dir_cwd.path = NULL;
+    dir_cwd.fd = -1;
+    dir_oldpwd.path = NULL;
+    dir_oldpwd.fd = -1;
     dir_stack_initialized = 1;
+
+    dir_stack_capture_cwd();
     return 1;
 }
 
@@ -928,83 +1352,106 @@ void cleanup_directory_stack(void) {
         return;
     }
 
-    struct dir_stack_entry *current = dir_stack;
-    while (current) {
-        struct dir_stack_entry *next = current->next;
-        free(current->path);
-        free(current);
-        current = next;
+    for (int i = 0; i < MAX_DIR_STACK_DEPTH; i++) {
+        dir_entry_release(&dir_stack[i]);
     }
+    dir_entry_release(&dir_cwd);
+    dir_entry_release(&dir_oldpwd);
 
-    dir_stack = NULL;
+    dir_stack_head = 0;
+    dir_stack_count = 0;
     dir_stack_initialized = 0;
 }
 
 /**
- * Push directory onto stack
+ * Change directory through the stack so the prompt and "cd -" can reuse
+ * the open handle instead of resolving the path again. "-" returns to the
+ * previous directory with fchdir().
  */
-int pushd(const char *dir) {
+int change_directory(const char *dir) {
     if (!dir_stack_initialized) {
         init_directory_stack();
     }
 
-    /* Get current directory */
-    char *current_dir = getcwd(NULL, 0);
-    if (!current_dir) {
+    if (!dir) {
+        errno = EINVAL;
         return 0;
     }
 
-    /* Validate and change to new directory */
-    if (chdir(dir) != 0) {
-        free(current_dir);
-        return 0;
+    if (strcmp(dir, "-") == 0) {
+        if (dir_oldpwd.fd < 0) {
+            errno = ENOENT;
+            return 0;
+        }
+        if (fchdir(dir_oldpwd.fd) != 0) {
+            return 0;
+        }
+        struct dir_stack_entry swap = dir_cwd;
+        dir_cwd = dir_oldpwd;
+        dir_oldpwd = swap;
+        invalidate_path_cache();
+        printf("%s\n", dir_cwd.path);
+        return 1;
     }
 
-    /* Count current stack depth */
-    int depth = 0;
-    struct dir_stack_entry *current = dir_stack;
-    while (current) {
-        depth++;
-        current = current->next;
+    struct dir_stack_entry next;
+    if (!dir_entry_open(dir, &next)) {
+        return 0;
     }
 
-    if (depth >= MAX_DIR_STACK_DEPTH) {
-        /* Stack is full, remove oldest entry */
-        struct dir_stack_entry *prev = NULL;
-        current = dir_stack;
-        while (current->next) {
-            prev = current;
-            current = current->next;
-        }
+    dir_entry_release(&dir_oldpwd);
+    dir_oldpwd = dir_cwd;
+    dir_cwd = next;
+    invalidate_path_cache();
+    return 1;
+}
 
-        if (prev) {
-            prev->next = NULL;
-        } else {
-            dir_stack = NULL;
-        }
+/**
+ * Current directory as last resolved by a directory change, or NULL when
+ * it is not known (the caller should fall back to getcwd()).
+ */
+const char *get_directory_stack_cwd(void) {
+    if (!dir_stack_initialized) {
+        return NULL;
+    }
+    return dir_cwd.path;
+}
 
-        free(current->path);
-        free(current);
+/**
+ * Push directory onto stack
+ */
+int pushd(const char *dir) {
+    if (!dir_stack_initialized) {
+        init_directory_stack();
     }
 
-    /* Add current directory to stack */
-    struct dir_stack_entry *new_entry = malloc(sizeof(struct dir_stack_entry));
-    if (!new_entry) {
-        free(current_dir);
+    dir_stack_capture_cwd();
+    if (dir_cwd.fd < 0) {
         return 0;
     }
 
-    new_entry->path = current_dir;
-    new_entry->next = dir_stack;
-    dir_stack = new_entry;
+    /* Validate and change to new directory */
+    struct dir_stack_entry next;
+    if (!dir_entry_open(dir, &next)) {
+        return 0;
+    }
 
-    /* Print new directory */
-    char *new_dir = getcwd(NULL, 0);
-    if (new_dir) {
-        printf("%s\n", new_dir);
-        free(new_dir);
+    if (dir_stack_count >= MAX_DIR_STACK_DEPTH) {
+        /* Stack is full, drop the oldest entry */
+        dir_entry_release(&dir_stack[dir_stack_head]);
+        dir_stack_head = (dir_stack_head + 1) % MAX_DIR_STACK_DEPTH;
+        dir_stack_count--;
     }
 
+    /* Keep the previous directory's open handle on the stack */
+    int slot = (dir_stack_head + dir_stack_count) % MAX_DIR_STACK_DEPTH;
+    dir_stack[slot] = dir_cwd;
+    dir_stack_count++;
+    dir_cwd = next;
+    invalidate_path_cache();
+
+    /* Print new directory */
+    printf("%s\n", dir_cwd.path);
     return 1;
 }
 
@@ -1012,26 +1459,30 @@ int pushd(const char *dir) {
  * Pop directory from stack
  */
 int popd(void) {
-    if (!dir_stack_initialized || !dir_stack) {
+    if (!dir_stack_initialized || dir_stack_count == 0) {
         fprintf(stderr, "popd: directory stack empty\n");
         return 0;
     }
 
-    struct dir_stack_entry *top = dir_stack;
-    dir_stack = top->next;
+    int slot = (dir_stack_head + dir_stack_count - 1) % MAX_DIR_STACK_DEPTH;
+    struct dir_stack_entry top = dir_stack[slot];
+    dir_stack[slot].fd = -1;
+    dir_stack[slot].path = NULL;
+    dir_stack_count--;
 
-    /* Change to the popped directory */
-    if (chdir(top->path) != 0) {
+    /* Change to the popped directory without re-resolving its path */
+    if (fchdir(top.fd) != 0) {
         perror("popd");
-        free(top->path);
-        free(top);
+        dir_entry_release(&top);
         return 0;
     }
 
-    printf("%s\n", top->path);
+    printf("%s\n", top.path);
 
-    free(top->path);
-    free(top);
+    dir_entry_release(&dir_oldpwd);
+    dir_oldpwd = dir_cwd;
+    dir_cwd = top;
+    invalidate_path_cache();
     return 1;
 }
 
@@ -1044,17 +1495,19 @@ void print_dirs(void) {
     }
 
     /* Print current directory first */
-    char *current_dir = getcwd(NULL, 0);
-    if (current_dir) {
-        printf("%s", current_dir);
-        free(current_dir);
+    if (dir_cwd.path) {
+        printf("%s", dir_cwd.path);
+    } else {
+        char *current_dir = getcwd(NULL, 0);
+        if (current_dir) {
+            printf("%s", current_dir);
+            free(current_dir);
+        }
     }
 
-    /* Print stack entries */
-    struct dir_stack_entry *current = dir_stack;
-    while (current) {
-        printf(" %s", current->path);
-        current = current->next;
+    /* Print stack entries, most recent first */
+    for (int i = dir_stack_count - 1; i >= 0; i--) {
+        printf(" %s", dir_stack[(dir_stack_head + i) % MAX_DIR_STACK_DEPTH].path);
     }
     printf("\n");
 }
@@ -162,6 +162,7 @@ int handle_export_command(const char *command) {
     
     /* Set the environment variable */
     if (setenv(name, value, 1) == 0) {
+        invalidate_editor_templates();
         printf("export %s=%s\n", name, value);
         free(args_copy);
         return 1;
@@ -213,6 +214,8 @@ int handle_unset_command(const char *command) {
             if (unsetenv(token) != 0) {
                 perror("unset");
                 success = 0;
+            } else {
+                invalidate_editor_templates();
             }
         }
         
@@ -265,19 +268,10 @@ int handle_which_command(const char *command) {
         token = trim_whitespace(token);
         
         /* Check if it's a built-in command */
-        const char *builtins[] = {
-            "help", "commands", "history", "pwd", "path", "cd", "exit", "quit",
-            "rules", "version", "alias", "unalias", "export", "unset", "env",
-            "which", "type", "pushd", "popd", "dirs", NULL
-        };
-        
         int is_builtin = 0;
-        for (int i = 0; builtins[i]; i++) {
-            if (strcmp(token, builtins[i]) == 0) {
-                printf("%s: shell builtin\n", token);
-                is_builtin = 1;
-                break;
-            }
+        if (builtin_command_name(token)) {
+            printf("%s: shell builtin\n", token);
+            is_builtin = 1;
         }
         
         if (!is_builtin) {
@@ -361,20 +355,12 @@ char *find_command_type(const char *command) {
     }
     
     /* Check if it's a built-in command */
-    const char *builtins[] = {
-        "help", "commands", "history", "pwd", "path", "cd", "exit", "quit",
-        "rules", "version", "alias", "unalias", "export", "unset", "env",
-        "which", "type", "pushd", "popd", "dirs", NULL
-    };
-    
-    for (int i = 0; builtins[i]; i++) {
-        if (strcmp(command, builtins[i]) == 0) {
-            char *result = malloc(strlen(command) + 20);
-            if (result) {
-                snprintf(result, strlen(command) + 20, "%s is a shell builtin", command);
-            }
-            return result;
+    if (builtin_command_name(command)) {
+        char *result = malloc(strlen(command) + 20);
+        if (result) {
+            snprintf(result, strlen(command) + 20, "%s is a shell builtin", command);
         }
+        return result;
     }
     
     /* Check if it's an alias */
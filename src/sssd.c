@@ -788,7 +788,7 @@ static int connect_to_sssd_sudo(void) {
  * Minimal TLV protocol client, modeled after sudo's SSSD integration.
  * Note: This implementation vendors only the minimal protocol needed to list commands.
  */
-static struct sss_sudo_result *query_sssd_sudo_rules(const char *username) {
+static struct sss_sudo_result *query_sssd_sudo_responder(const char *username) {
     int fd = -1;
     struct sss_sudo_result *result = NULL;
     char hostname[256];
@@ -1377,6 +1377,20 @@ static int sssd_user_in_group(const char *username, const char *groupname)
     return 0;
 }
 
+/**
+ * Query SSSD sudo rules, timing the query for the host metrics
+ *
+ * The sssd__query__done probe reports the number of rules, or -1 on failure.
+ */
+static struct sss_sudo_result *query_sssd_sudo_rules(const char *username) {
+    SUDOSH_PROBE1(sssd__query__start, username);
+    long long started = monotonic_usec();
+    struct sss_sudo_result *result = query_sssd_sudo_responder(username);
+    metrics_observe(METRIC_SSSD_QUERY, monotonic_usec() - started);
+    SUDOSH_PROBE2(sssd__query__done, username, result ? (long long)result->num_rules : -1);
+    return result;
+}
+
 
 /**
  * Free SSSD sudo result structure
@@ -27,6 +27,7 @@ static struct sudoers_userspec *create_userspec(void) {
     spec->users = NULL;
     spec->hosts = NULL;
     spec->commands = NULL;
+    spec->digests = NULL;
     spec->nopasswd = 0;
     spec->runas_user = safe_strdup("root");  /* Default runas user */
     spec->source_file = NULL;
@@ -38,7 +39,7 @@ static struct sudoers_userspec *create_userspec(void) {
 /**
  * Free a userspec entry
  */
-static void free_userspec(struct sudoers_userspec *spec) {
+void free_sudoers_userspec(struct sudoers_userspec *spec) {
     if (!spec) {
         return;
     }
@@ -60,10 +61,14 @@ static void free_userspec(struct sudoers_userspec *spec) {
 
     if (spec->commands) {
         for (int i = 0; spec->commands[i]; i++) {
+            if (spec->digests) {
+                free(spec->digests[i]);
+            }
             free(spec->commands[i]);
         }
         free(spec->commands);
     }
+    free(spec->digests);
 
     free(spec->runas_user);
     free(spec->source_file);
@@ -134,6 +139,56 @@ static char **parse_list(const char *list_str) {
     return array;
 }
 
+/**
+ * Split "sha256:DIGEST command" entries into a pin and the plain command
+ *
+ * The digest may be hex or base64, as in sudoers(5).  Other algorithms and
+ * malformed digests leave the entry untouched, which never matches a
+ * command, so a pin that cannot be checked fails closed.
+ */
+static int parse_command_digests(struct sudoers_userspec *spec, const char *source_file) {
+    int count = 0;
+    while (spec->commands[count]) {
+        count++;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const char *entry = spec->commands[i];
+        unsigned char digest[SHA256_DIGEST_LENGTH];
+        const char *command = NULL;
+
+        int r = parse_digest_spec(entry, digest, &command);
+        if (r == 0) {
+            continue;
+        }
+        if (r < 0) {
+            syslog(LOG_WARNING, "SUDOERS_DIGEST_UNSUPPORTED: file=%s entry=%s",
+                   source_file ? source_file : "unknown", entry);
+            continue;
+        }
+
+        if (!spec->digests) {
+            spec->digests = calloc((size_t)count + 1, sizeof(char *));
+            if (!spec->digests) {
+                return -1;
+            }
+        }
+        char *hex = malloc(SHA256_HEX_LENGTH + 1);
+        char *plain = safe_strdup(command);
+        if (!hex || !plain) {
+            free(hex);
+            free(plain);
+            return -1;
+        }
+        sha256_to_hex(digest, hex);
+        free(spec->commands[i]);
+        spec->commands[i] = plain;
+        spec->digests[i] = hex;
+    }
+
+    return 0;
+}
+
 /**
  * Parse a simple sudoers line
  * Format: user host = (runas_user) command
@@ -172,7 +227,7 @@ static struct sudoers_userspec *parse_sudoers_line(const char *line, const char
     /* Find the '=' separator */
     char *equals = strchr(p, '=');
     if (!equals) {
-        free_userspec(spec);
+        free_sudoers_userspec(spec);
         free(line_copy);
         return NULL;
     }
@@ -246,6 +301,11 @@ static struct sudoers_userspec *parse_sudoers_line(const char *line, const char
 
     /* Parse commands */
     spec->commands = parse_list(right_side);
+    if (spec->commands && parse_command_digests(spec, source_file) != 0) {
+        free_sudoers_userspec(spec);
+        free(line_copy);
+        return NULL;
+    }
 
     /* Set source file */
     if (source_file) {
@@ -322,7 +382,7 @@ static int is_valid_sudoers_file(const char *filename) {
 /**
  * Parse all files in an include directory
  */
-static void parse_sudoers_directory(const char *dirname, struct sudoers_config *config, struct sudoers_userspec **last_spec) {
+static void parse_sudoers_directory(const char *dirname, struct policy_build *build) {
     DIR *dir;
     struct dirent *entry;
     char filepath[PATH_MAX];
@@ -333,13 +393,15 @@ static void parse_sudoers_directory(const char *dirname, struct sudoers_config *
     uid_t saved_euid = geteuid();  /* Initialize to current euid */
     int escalated;
 
-    if (!dirname || !config) {
+    if (!dirname || !build) {
         return;
     }
 
     /* Temporarily escalate privileges to read sudoers directory */
     escalated = escalate_for_sudoers_read(&saved_euid);
 
+    /* A file added to or removed from the directory changes its mtime */
+    policy_build_note_source(build, dirname);
     dir = opendir(dirname);
     if (!dir) {
         /* Drop privileges and return */
@@ -362,6 +424,7 @@ static void parse_sudoers_directory(const char *dirname, struct sudoers_config *
         snprintf(filepath, sizeof(filepath), "%s/%s", dirname, entry->d_name);
 
         /* Try to open the file */
+        policy_build_note_source(build, filepath);
         fp = fopen(filepath, "r");
         if (!fp) {
             continue;  /* Skip files we can't read */
@@ -376,13 +439,7 @@ static void parse_sudoers_directory(const char *dirname, struct sudoers_config *
 
             struct sudoers_userspec *spec = parse_sudoers_line(line, filepath);
             if (spec) {
-                if (!config->userspecs) {
-                    config->userspecs = spec;
-                    *last_spec = spec;
-                } else {
-                    (*last_spec)->next = spec;
-                    *last_spec = spec;
-                }
+                policy_build_add_rule(build, spec);
             }
         }
 
@@ -398,51 +455,30 @@ static void parse_sudoers_directory(const char *dirname, struct sudoers_config *
     drop_after_sudoers_read(escalated, saved_euid);
 }
 
-
-
 /**
- * Parse sudoers file
+ * Read the sudoers file and its include directories into a build
  */
-struct sudoers_config *parse_sudoers_file(const char *filename) {
+static void collect_sudoers_rules(const char *filename, struct policy_build *build) {
     FILE *fp;
     char *line = NULL;
     size_t len = 0;
     ssize_t read;
-    struct sudoers_config *config;
-    struct sudoers_userspec *last_spec = NULL;
     uid_t saved_euid = geteuid();
     int escalated;
 
-    /* Allow test harness to override sudoers path */
-    if (!filename) {
-        const char *env_path = getenv("SUDOSH_SUDOERS_PATH");
-        filename = (env_path && *env_path) ? env_path : SUDOERS_PATH;
-    }
-
-    config = malloc(sizeof(struct sudoers_config));
-    if (!config) {
-        return NULL;
-    }
-
-    config->userspecs = NULL;
-    /* Allow test harness to override includedir */
-    {
-        const char *env_dir = getenv("SUDOSH_SUDOERS_DIR");
-        config->includedir = safe_strdup((env_dir && *env_dir) ? env_dir : SUDOERS_DIR);
-    }
-
     /* Also parse the sudoers.d directory if it exists (honors override) */
-    parse_sudoers_directory(config->includedir, config, &last_spec);
+    parse_sudoers_directory(build->includedir, build);
 
     /* Temporarily escalate privileges to read sudoers file */
     escalated = escalate_for_sudoers_read(&saved_euid);
 
+    policy_build_note_source(build, filename);
     fp = fopen(filename, "r");
     if (!fp) {
         /* Drop privileges before returning */
         drop_after_sudoers_read(escalated, saved_euid);
-        /* If we can't read sudoers, return empty config */
-        return config;
+        /* If we can't read sudoers, the policy is empty */
+        return;
     }
 
     while ((read = getline(&line, &len, fp)) != -1) {
@@ -465,23 +501,17 @@ struct sudoers_config *parse_sudoers_file(const char *filename) {
             }
 
             if (*dir_path) {
-                /* Update the includedir in config and parse the directory */
-                free(config->includedir);
-                config->includedir = safe_strdup(dir_path);
-                parse_sudoers_directory(dir_path, config, &last_spec);
+                /* Update the includedir in effect and parse the directory */
+                free(build->includedir);
+                build->includedir = safe_strdup(dir_path);
+                parse_sudoers_directory(dir_path, build);
             }
             continue;
         }
 
         struct sudoers_userspec *spec = parse_sudoers_line(line, filename);
         if (spec) {
-            if (!config->userspecs) {
-                config->userspecs = spec;
-                last_spec = spec;
-            } else {
-                last_spec->next = spec;
-                last_spec = spec;
-            }
+            policy_build_add_rule(build, spec);
         }
     }
 
@@ -490,7 +520,72 @@ struct sudoers_config *parse_sudoers_file(const char *filename) {
 
     /* Drop privileges back to original level */
     drop_after_sudoers_read(escalated, saved_euid);
+}
+
+/**
+ * Resolve the sudoers file (when *filename is NULL) and include directory
+ */
+static void sudoers_inputs(const char **filename, const char **includedir) {
+    /* Allow test harness to override sudoers path and includedir */
+    if (!*filename) {
+        const char *env_path = getenv("SUDOSH_SUDOERS_PATH");
+        *filename = (env_path && *env_path) ? env_path : SUDOERS_PATH;
+    }
+    const char *env_dir = getenv("SUDOSH_SUDOERS_DIR");
+    *includedir = (env_dir && *env_dir) ? env_dir : SUDOERS_DIR;
+}
+
+/**
+ * Parse sudoers file (body of parse_sudoers_file())
+ *
+ * Uses the shared policy image when one is published for the same inputs
+ * and none of them has changed; otherwise parses, compiles and publishes.
+ */
+static struct sudoers_config *parse_sudoers_path(const char *filename) {
+    struct sudoers_config *config;
+    struct policy_build build;
+    uid_t saved_euid = geteuid();
+    int escalated;
+    const char *includedir;
+
+    sudoers_inputs(&filename, &includedir);
+
+    /* Checking the image's inputs needs the same access as reading them */
+    escalated = escalate_for_sudoers_read(&saved_euid);
+    config = policy_image_attach(filename, includedir);
+    drop_after_sudoers_read(escalated, saved_euid);
+    if (config) {
+        return config;
+    }
+
+    policy_build_init(&build, includedir);
+    collect_sudoers_rules(filename, &build);
+    config = policy_compile(&build, filename, includedir);
+    policy_build_free(&build);
+    if (!config) {
+        return NULL;
+    }
+
+    escalated = escalate_for_sudoers_read(&saved_euid);
+    struct sudoers_config *shared = policy_image_publish(config);
+    drop_after_sudoers_read(escalated, saved_euid);
+    if (shared) {
+        policy_release(config);
+        config = shared;
+    }
+
+    return config;
+}
 
+/**
+ * Parse sudoers file, timing the parse for the host metrics
+ */
+struct sudoers_config *parse_sudoers_file(const char *filename) {
+    SUDOSH_PROBE1(policy__parse__start, filename);
+    long long started = monotonic_usec();
+    struct sudoers_config *config = parse_sudoers_path(filename);
+    metrics_observe(METRIC_POLICY_PARSE, monotonic_usec() - started);
+    SUDOSH_PROBE2(policy__parse__done, filename, config != NULL);
     return config;
 }
 
@@ -510,21 +605,22 @@ static int match_pattern(const char *pattern, const char *string) {
 }
 
 /**
- * Check if user matches userspec
+ * Check if user matches a compiled rule
  */
-static int user_matches_spec(const char *username, struct sudoers_userspec *spec) {
-    if (!username || !spec || !spec->users) {
+static int user_matches_spec(const char *username, const struct sudoers_config *config,
+                             const struct policy_rule *rule) {
+    if (!username || !rule) {
         return 0;
     }
 
-    for (int i = 0; spec->users[i]; i++) {
-        if (match_pattern(spec->users[i], username)) {
+    POLICY_FOREACH(config, rule->users, user) {
+        if (match_pattern(user, username)) {
             return 1;
         }
 
         /* Check for group membership (groups start with %) */
-        if (spec->users[i][0] == '%') {
-            const char *group_name = spec->users[i] + 1;
+        if (user[0] == '%') {
+            const char *group_name = user + 1;
 
             /* First try getgrnam() for local groups */
             struct group *grp = getgrnam(group_name);
@@ -587,11 +683,23 @@ static int user_matches_spec(const char *username, struct sudoers_userspec *spec
     return 0;
 }
 
+/**
+ * Check if a compiled rule applies to a host (exact name or ALL)
+ */
+static int host_matches_spec(const char *hostname, const struct sudoers_config *config,
+                             const struct policy_rule *rule) {
+    POLICY_FOREACH(config, rule->hosts, host) {
+        if (match_pattern(host, hostname)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 /**
  * Check if a specific command is allowed for a user according to sudoers configuration
  */
 int check_sudoers_command_permission(const char *username, const char *hostname, const char *command, struct sudoers_config *sudoers) {
-    struct sudoers_userspec *spec;
     char *cmd_copy, *cmd_name, *saveptr;
     int is_allowed = 0;
 
@@ -611,71 +719,59 @@ int check_sudoers_command_permission(const char *username, const char *hostname,
         return 0;
     }
 
-    /* Check each userspec */
-    for (spec = sudoers->userspecs; spec && !is_allowed; spec = spec->next) {
+    /* Check each rule */
+    for (uint32_t r = 0; r < sudoers->rule_count && !is_allowed; r++) {
+        const struct policy_rule *rule = &sudoers->rules[r];
+
         /* Check if this rule applies to the user (including group membership) */
-        if (!user_matches_spec(username, spec)) {
+        if (!user_matches_spec(username, sudoers, rule)) {
             continue;
         }
 
         /* Check if this rule applies to the host */
-        int host_matches = 0;
-        if (spec->hosts) {
-            for (int i = 0; spec->hosts[i] && !host_matches; i++) {
-                if (strcmp(spec->hosts[i], hostname) == 0 ||
-                    strcmp(spec->hosts[i], "ALL") == 0) {
-                    host_matches = 1;
-                }
-            }
-        }
-
-        if (!host_matches) {
+        if (!host_matches_spec(hostname, sudoers, rule)) {
             continue;
         }
 
         /* Check if the command is allowed */
-        if (spec->commands) {
-            for (int i = 0; spec->commands[i] && !is_allowed; i++) {
-                const char *allowed_cmd = spec->commands[i];
+        POLICY_FOREACH(sudoers, rule->commands, allowed_cmd) {
+            /* Handle ALL commands */
+            if (strcmp(allowed_cmd, "ALL") == 0) {
+                is_allowed = 1;
+                break;
+            }
 
-                /* Handle ALL commands */
-                if (strcmp(allowed_cmd, "ALL") == 0) {
-                    is_allowed = 1;
-                    break;
-                }
+            /* Handle exact command name matches (basename) */
+            if (strcmp(allowed_cmd, cmd_name) == 0) {
+                is_allowed = 1;
+                break;
+            }
 
-                /* Handle exact command name matches (basename) */
-                if (strcmp(allowed_cmd, cmd_name) == 0) {
+            /* Handle full path matches (exact) */
+            if (allowed_cmd[0] == '/' && strcmp(allowed_cmd, command) == 0) {
+                is_allowed = 1;
+                break;
+            }
+
+            /* Handle basename match when allowed is a full path */
+            if (allowed_cmd[0] == '/') {
+                const char *slash = strrchr(allowed_cmd, '/');
+                const char *base = slash ? slash + 1 : allowed_cmd;
+                if (strcmp(base, cmd_name) == 0) {
                     is_allowed = 1;
                     break;
                 }
+            }
 
-                /* Handle full path matches (exact) */
-                if (allowed_cmd[0] == '/' && strcmp(allowed_cmd, command) == 0) {
+            /* Handle wildcard patterns (prefix*) against cmd_name and command */
+            if (strchr(allowed_cmd, '*')) {
+                const char *star = strchr(allowed_cmd, '*');
+                size_t prefix_len = (size_t)(star - allowed_cmd);
+                if (strncmp(allowed_cmd, cmd_name, prefix_len) == 0 ||
+                    strncmp(allowed_cmd, command, prefix_len) == 0) {
                     is_allowed = 1;
                     break;
                 }
-
-                /* Handle basename match when allowed is a full path */
-                if (allowed_cmd[0] == '/') {
-                    const char *slash = strrchr(allowed_cmd, '/');
-                    const char *base = slash ? slash + 1 : allowed_cmd;
-                    if (strcmp(base, cmd_name) == 0) {
-                        is_allowed = 1;
-                        break;
-                    }
-                }
-
-                /* Handle wildcard patterns (prefix*) against cmd_name and command */
-                if (strchr(allowed_cmd, '*')) {
-                    const char *star = strchr(allowed_cmd, '*');
-                    size_t prefix_len = (size_t)(star - allowed_cmd);
-                    if (strncmp(allowed_cmd, cmd_name, prefix_len) == 0 ||
-                        strncmp(allowed_cmd, command, prefix_len) == 0) {
-                        is_allowed = 1;
-                        break;
-                    }
-                }
             }
         }
     }
@@ -685,22 +781,119 @@ int check_sudoers_command_permission(const char *username, const char *hostname,
 }
 
 /**
- * Free sudoers configuration
+ * Check whether a sudoers command entry names a binary, by path or basename
  */
-void free_sudoers_config(struct sudoers_config *config) {
-    if (!config) {
-        return;
+static int entry_names_binary(const char *entry, const char *path) {
+    size_t len = strcspn(entry, " \t");
+    const char *slash = strrchr(path, '/');
+    const char *base = slash ? slash + 1 : path;
+
+    if (len == 3 && strncmp(entry, "ALL", 3) == 0) {
+        return 1;
     }
+    if (entry[0] == '/') {
+        if (strlen(path) == len && strncmp(entry, path, len) == 0) {
+            return 1;
+        }
+        const char *entry_base = entry;
+        for (size_t i = 0; i < len; i++) {
+            if (entry[i] == '/') {
+                entry_base = entry + i + 1;
+            }
+        }
+        len -= (size_t)(entry_base - entry);
+        entry = entry_base;
+    }
+    if (memchr(entry, '*', len)) {
+        size_t prefix_len = (size_t)((const char *)memchr(entry, '*', len) - entry);
+        return strncmp(entry, base, prefix_len) == 0 || strncmp(entry, path, prefix_len) == 0;
+    }
+    return strlen(base) == len && strncmp(entry, base, len) == 0;
+}
 
-    struct sudoers_userspec *spec = config->userspecs;
-    while (spec) {
-        struct sudoers_userspec *next = spec->next;
-        free_userspec(spec);
-        spec = next;
+/**
+ * Collect the sha256 pins that apply to a binary for a user
+ *
+ * Returns the number of digests written (at most max_digests).  Returns 0
+ * when no rule mentions the binary or when an unpinned rule also allows it
+ * (for example ALL), in which case no digest is required.
+ */
+int get_sudoers_command_digests(const char *username, const char *hostname, const char *path,
+                                struct sudoers_config *sudoers,
+                                char digests[][SHA256_HEX_LENGTH + 1], int max_digests) {
+    int found = 0;
+
+    if (!username || !hostname || !path || !sudoers) {
+        return 0;
     }
 
-    free(config->includedir);
-    free(config);
+    for (uint32_t r = 0; r < sudoers->rule_count; r++) {
+        const struct policy_rule *rule = &sudoers->rules[r];
+        if (!rule->commands || !user_matches_spec(username, sudoers, rule) ||
+            !host_matches_spec(hostname, sudoers, rule)) {
+            continue;
+        }
+
+        /* Pins run in step with the commands, "-" where a command has none */
+        const char *pin = policy_list(sudoers, rule->digests);
+        POLICY_FOREACH(sudoers, rule->commands, command) {
+            const char *this_pin = pin;
+            if (*pin) {
+                pin += strlen(pin) + 1;
+            }
+            if (!entry_names_binary(command, path)) {
+                continue;
+            }
+            if (!*this_pin || strcmp(this_pin, "-") == 0) {
+                /* An unpinned rule allows this binary outright */
+                return 0;
+            }
+            if (found < max_digests) {
+                memcpy(digests[found], this_pin, SHA256_HEX_LENGTH + 1);
+                found++;
+            }
+        }
+    }
+
+    return found;
+}
+
+/**
+ * Check whether any rule carries a sha256 pin
+ */
+int sudoers_has_command_digests(const struct sudoers_config *sudoers) {
+    if (!sudoers) {
+        return 0;
+    }
+    for (uint32_t r = 0; r < sudoers->rule_count; r++) {
+        if (sudoers->rules[r].digests) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Check that a config from parse_sudoers_file(NULL) still matches the
+ * sudoers inputs it would be read from now (one stat() per input)
+ */
+int sudoers_config_current(const struct sudoers_config *config) {
+    const char *filename = NULL;
+    const char *includedir;
+    uid_t saved_euid = geteuid();
+
+    sudoers_inputs(&filename, &includedir);
+    int escalated = escalate_for_sudoers_read(&saved_euid);
+    int current = policy_config_current(config, filename, includedir);
+    drop_after_sudoers_read(escalated, saved_euid);
+    return current;
+}
+
+/**
+ * Free sudoers configuration
+ */
+void free_sudoers_config(struct sudoers_config *config) {
+    policy_release(config);
 }
 
 
@@ -718,19 +911,12 @@ int check_sudoers_privileges(const char *username, const char *hostname, struct
         hostname = "localhost";  /* Default hostname */
     }
 
-    struct sudoers_userspec *spec = sudoers->userspecs;
-    while (spec) {
-        if (user_matches_spec(username, spec)) {
-            /* Check hostname match */
-            if (spec->hosts) {
-                for (int i = 0; spec->hosts[i]; i++) {
-                    if (match_pattern(spec->hosts[i], hostname)) {
-                        return 1;  /* User has privileges */
-                    }
-                }
-            }
+    for (uint32_t r = 0; r < sudoers->rule_count; r++) {
+        const struct policy_rule *rule = &sudoers->rules[r];
+        if (user_matches_spec(username, sudoers, rule) &&
+            host_matches_spec(hostname, sudoers, rule)) {
+            return 1;  /* User has privileges */
         }
-        spec = spec->next;
     }
 
     return 0;
@@ -748,24 +934,13 @@ int check_sudoers_nopasswd(const char *username, const char *hostname, struct su
         hostname = "localhost";  /* Default hostname */
     }
 
-    struct sudoers_userspec *spec = sudoers->userspecs;
-    while (spec) {
-        if (user_matches_spec(username, spec)) {
-            /* Check hostname match */
-            if (spec->hosts) {
-                for (int i = 0; spec->hosts[i]; i++) {
-                    if (match_pattern(spec->hosts[i], hostname)) {
-                        /* If this rule has NOPASSWD, return YES immediately */
-                        if (spec->nopasswd) {
-                            return 1;
-                        }
-                        /* If this rule doesn't have NOPASSWD, continue checking other rules */
-                        /* Don't return 0 here - there might be other rules with NOPASSWD */
-                    }
-                }
-            }
+    for (uint32_t r = 0; r < sudoers->rule_count; r++) {
+        const struct policy_rule *rule = &sudoers->rules[r];
+        /* A matching rule without NOPASSWD doesn't decide: a later one may have it */
+        if (rule->nopasswd && user_matches_spec(username, sudoers, rule) &&
+            host_matches_spec(hostname, sudoers, rule)) {
+            return 1;
         }
-        spec = spec->next;
     }
 
     return 0;  /* No matching rule with NOPASSWD found */
@@ -784,45 +959,86 @@ int check_sudoers_global_nopasswd(const char *username, const char *hostname, st
         hostname = "localhost";  /* Default hostname */
     }
 
-    struct sudoers_userspec *spec = sudoers->userspecs;
-    while (spec) {
-        if (user_matches_spec(username, spec)) {
-            /* Check hostname match */
-            int host_ok = 0;
-            if (spec->hosts) {
-                for (int i = 0; spec->hosts[i]; i++) {
-                    if (match_pattern(spec->hosts[i], hostname)) {
-                        host_ok = 1;
-                        break;
-                    }
-                }
-            }
-            if (!host_ok) {
-                spec = spec->next;
-                continue;
-            }
+    for (uint32_t r = 0; r < sudoers->rule_count; r++) {
+        const struct policy_rule *rule = &sudoers->rules[r];
 
-            /* Must have NOPASSWD flag */
-            if (!spec->nopasswd) {
-                spec = spec->next;
-                continue;
-            }
+        /* Must have NOPASSWD flag and match user and host */
+        if (!rule->nopasswd || !user_matches_spec(username, sudoers, rule) ||
+            !host_matches_spec(hostname, sudoers, rule)) {
+            continue;
+        }
 
-            /* Check commands include ALL */
-            if (spec->commands) {
-                for (int i = 0; spec->commands[i]; i++) {
-                    if (strcmp(spec->commands[i], "ALL") == 0) {
-                        return 1;  /* Global NOPASSWD */
-                    }
-                }
+        /* Check commands include ALL */
+        POLICY_FOREACH(sudoers, rule->commands, command) {
+            if (strcmp(command, "ALL") == 0) {
+                return 1;  /* Global NOPASSWD */
             }
         }
-        spec = spec->next;
     }
 
     return 0;
 }
 
+/**
+ * Print a rule's hosts, runas user, NOPASSWD tag and commands
+ *
+ * With summarize set, a rule allowing ALL commands prints as ALL when it
+ * needs no password and ANY otherwise.
+ */
+static void print_sudoers_rule(const struct sudoers_config *config, const struct policy_rule *rule,
+                               int summarize) {
+    const char *runas = policy_string(config, rule->runas_user);
+    const char *separator = "";
+
+    printf("    ");
+
+    /* Print hosts */
+    POLICY_FOREACH(config, rule->hosts, host) {
+        printf("%s%s", separator, host);
+        separator = ", ";
+    }
+
+    /* Print runas user and NOPASSWD if applicable */
+    printf(" = (%s) ", runas ? runas : "root");
+    if (rule->nopasswd) {
+        printf("NOPASSWD: ");
+    }
+
+    /* Print commands with summary indicators */
+    if (summarize) {
+        POLICY_FOREACH(config, rule->commands, command) {
+            if (strcmp(command, "ALL") == 0) {
+                printf("%s", rule->nopasswd ? "ALL" : "ANY");  /* Unrestricted, or any with password */
+                return;
+            }
+        }
+    }
+    separator = "";
+    POLICY_FOREACH(config, rule->commands, command) {
+        printf("%s%s", separator, command);
+        separator = ", ";
+    }
+}
+
+/**
+ * Print the sudoers rules that apply to a user, with their source
+ * Returns 1 if any rule applies
+ */
+static int print_direct_sudoers_rules(const char *username, const struct sudoers_config *config) {
+    int found = 0;
+
+    for (uint32_t r = 0; r < config->rule_count; r++) {
+        const struct policy_rule *rule = &config->rules[r];
+        if (user_matches_spec(username, config, rule)) {
+            const char *source = policy_string(config, rule->source_file);
+            print_sudoers_rule(config, rule, 1);
+            printf("  [Source: %s]\n", source ? source : "sudoers file");
+            found = 1;
+        }
+    }
+    return found;
+}
+
 /**
  * List available commands for a user - basic version (just rules)
  * Shows sudo rules and permissions without command categories
@@ -868,75 +1084,11 @@ void list_available_commands_basic(const char *username) {
 
     /* Show direct sudoers rules */
     printf("Direct Sudoers Rules (from /etc/sudoers):\n");
-    sudoers_config = parse_sudoers_file(NULL);
     if (sudoers_config) {
-        struct sudoers_userspec *spec = sudoers_config->userspecs;
-        int found_direct_rules = 0;
-
-        while (spec) {
-            /* Check if this rule applies to the user */
-            if (user_matches_spec(username, spec)) {
-                found_direct_rules = 1;
-                found_direct_sudoers = 1;
-                found_any_rules = 1;
-
-                /* Print the rule with source indication */
-                printf("    ");
-
-                /* Print hosts */
-                if (spec->hosts) {
-                    for (int i = 0; spec->hosts && spec->hosts[i]; i++) {
-                        if (i > 0) printf(", ");
-                        printf("%s", spec->hosts[i]);
-                    }
-                }
-
-                printf(" = ");
-
-                /* Print runas user */
-                if (spec->runas_user) {
-                    printf("(%s) ", spec->runas_user);
-                } else {
-                    printf("(root) ");
-                }
-
-                /* Print NOPASSWD if applicable */
-                if (spec->nopasswd) {
-                    printf("NOPASSWD: ");
-                }
-
-                /* Print commands with summary indicators */
-                if (spec->commands) {
-                    /* Check if user has ALL commands */
-                    int has_all_commands = 0;
-                    for (int i = 0; spec->commands && spec->commands[i]; i++) {
-                        if (strcmp(spec->commands[i], "ALL") == 0) {
-                            has_all_commands = 1;
-                            break;
-                        }
-                    }
-
-                    if (has_all_commands) {
-                        if (spec->nopasswd) {
-                            printf("ALL");  /* Unrestricted access */
-                        } else {
-                            printf("ANY");  /* Any command with password */
-                        }
-                    } else {
-                        /* Show specific commands */
-                        for (int i = 0; spec->commands && spec->commands[i]; i++) {
-                            if (i > 0) printf(", ");
-                            printf("%s", spec->commands[i]);
-                        }
-                    }
-                }
-
-                printf("  [Source: %s]\n", spec->source_file ? spec->source_file : "sudoers file");
-            }
-            spec = spec->next;
-        }
-
-        if (!found_direct_rules) {
+        if (print_direct_sudoers_rules(username, sudoers_config)) {
+            found_direct_sudoers = 1;
+            found_any_rules = 1;
+        } else {
             printf("    No direct sudoers rules found for user %s\n", username);
         }
     } else {
@@ -1028,75 +1180,11 @@ void list_available_commands(const char *username) {
 
     /* Show direct sudoers rules */
     printf("Direct Sudoers Rules (from /etc/sudoers):\n");
-    sudoers_config = parse_sudoers_file(NULL);
     if (sudoers_config) {
-        struct sudoers_userspec *spec = sudoers_config->userspecs;
-        int found_direct_rules = 0;
-
-        while (spec) {
-            /* Check if this rule applies to the user */
-            if (user_matches_spec(username, spec)) {
-                found_direct_rules = 1;
-                found_direct_sudoers = 1;
-                found_any_rules = 1;
-
-                /* Print the rule with source indication */
-                printf("    ");
-
-                /* Print hosts */
-                if (spec->hosts) {
-                    for (int i = 0; spec->hosts && spec->hosts[i]; i++) {
-                        if (i > 0) printf(", ");
-                        printf("%s", spec->hosts[i]);
-                    }
-                }
-
-                printf(" = ");
-
-                /* Print runas user */
-                if (spec->runas_user) {
-                    printf("(%s) ", spec->runas_user);
-                } else {
-                    printf("(root) ");
-                }
-
-                /* Print NOPASSWD if applicable */
-                if (spec->nopasswd) {
-                    printf("NOPASSWD: ");
-                }
-
-                /* Print commands with summary indicators */
-                if (spec->commands) {
-                    /* Check if user has ALL commands */
-                    int has_all_commands = 0;
-                    for (int i = 0; spec->commands && spec->commands[i]; i++) {
-                        if (strcmp(spec->commands[i], "ALL") == 0) {
-                            has_all_commands = 1;
-                            break;
-                        }
-                    }
-
-                    if (has_all_commands) {
-                        if (spec->nopasswd) {
-                            printf("ALL");  /* Unrestricted access */
-                        } else {
-                            printf("ANY");  /* Any command with password */
-                        }
-                    } else {
-                        /* Show specific commands */
-                        for (int i = 0; spec->commands && spec->commands[i]; i++) {
-                            if (i > 0) printf(", ");
-                            printf("%s", spec->commands[i]);
-                        }
-                    }
-                }
-
-                printf("  [Source: %s]\n", spec->source_file ? spec->source_file : "sudoers file");
-            }
-            spec = spec->next;
-        }
-
-        if (!found_direct_rules) {
+        if (print_direct_sudoers_rules(username, sudoers_config)) {
+            found_direct_sudoers = 1;
+            found_any_rules = 1;
+        } else {
             printf("    No direct sudoers rules found for user %s\n", username);
         }
     } else {
@@ -1109,67 +1197,33 @@ void list_available_commands(const char *username) {
     /* Show system-wide sudoers rules that might apply through groups */
     printf("System-Wide Group Rules:\n");
     if (sudoers_config) {
-        struct sudoers_userspec *spec = sudoers_config->userspecs;
         int found_group_rules = 0;
 
-        while (spec) {
+        for (uint32_t r = 0; r < sudoers_config->rule_count; r++) {
+            const struct policy_rule *rule = &sudoers_config->rules[r];
+
             /* Check if this rule applies to groups the user is in */
-            if (spec->users) {
-                for (int i = 0; spec->users && spec->users[i]; i++) {
-                    if (spec->users[i] && spec->users[i][0] == '%') {
-                        /* This is a group rule */
-                        char *group_name = spec->users[i] + 1;
-                        if (group_name && *group_name) {
-                            struct group *grp = getgrnam(group_name);
-                            if (grp && grp->gr_mem) {
-                                for (char **member = grp->gr_mem; member && *member; member++) {
-                                    if (*member && strcmp(*member, username) == 0) {
-                                        found_group_rules = 1;
-                                        found_any_rules = 1;
-
-                                        printf("    ");
-
-                                        /* Print hosts */
-                                        if (spec->hosts) {
-                                            for (int j = 0; spec->hosts[j]; j++) {
-                                                if (j > 0) printf(", ");
-                                                printf("%s", spec->hosts[j]);
-                                            }
-                                        }
-
-                                        printf(" = ");
-
-                                        /* Print runas user */
-                                        if (spec->runas_user) {
-                                            printf("(%s) ", spec->runas_user);
-                                        } else {
-                                            printf("(root) ");
-                                        }
-
-                                        /* Print NOPASSWD if applicable */
-                                        if (spec->nopasswd) {
-                                            printf("NOPASSWD: ");
-                                        }
-
-                                        /* Print commands */
-                                        if (spec->commands) {
-                                            for (int j = 0; spec->commands && spec->commands[j]; j++) {
-                                                if (j > 0) printf(", ");
-                                                printf("%s", spec->commands[j]);
-                                            }
-                                        }
-
-                                        printf("  [Source: %%%s group rule in %s]\n", group_name,
-                                               spec->source_file ? spec->source_file : "sudoers file");
-                                        break;
-                                    }
-                                }
-                            }
+            POLICY_FOREACH(sudoers_config, rule->users, user) {
+                if (user[0] != '%' || !user[1]) {
+                    continue;  /* Not a group rule */
+                }
+                const char *group_name = user + 1;
+                struct group *grp = getgrnam(group_name);
+                if (grp && grp->gr_mem) {
+                    for (char **member = grp->gr_mem; *member; member++) {
+                        if (strcmp(*member, username) == 0) {
+                            const char *source = policy_string(sudoers_config, rule->source_file);
+                            found_group_rules = 1;
+                            found_any_rules = 1;
+
+                            print_sudoers_rule(sudoers_config, rule, 0);
+                            printf("  [Source: %%%s group rule in %s]\n", group_name,
+                                   source ? source : "sudoers file");
+                            break;
                         }
                     }
                 }
             }
-            spec = spec->next;
         }
 
         if (!found_group_rules) {
@@ -29,6 +29,7 @@
 #include <limits.h>
 #include <time.h>
 #include <fcntl.h>
+#include <stdint.h>
 #include "ai_detection.h"
 #include <sys/select.h>
 #include <dirent.h>
@@ -54,6 +55,7 @@
 
 /* Include common utilities and error handling */
 #include "sudosh_common.h"
+#include "probes.h"
 
 /* External environment variable - declared in unistd.h */
 extern char **environ;
@@ -88,6 +90,24 @@ extern int sudo_compat_mode_flag;     /* argv[0]=="sudo" */
 
 /* Configuration constants */
 #define MAX_COMMAND_LENGTH 4096
+#define MAX_COMMAND_LIST_ELEMENTS 32
+#define MAX_GLOB_EXPANSION_ARGS 1024        /* arguments produced by globs per command */
+#define MAX_GLOB_EXPANSION_BYTES 65536      /* bytes produced by globs per command */
+#define MAX_GLOB_CACHED_DIRS 8              /* directory listings kept per command */
+#define MAX_PIPELINED_PAYLOAD (32 * 1024 * 1024) /* module source accepted over stdin */
+#define MAX_COMMAND_TIMEOUTS 32              /* per-command wall-clock limits */
+#define SUPERVISE_KILL_GRACE_MS 2000        /* SIGTERM to SIGKILL during teardown */
+#define MAX_JOBS 16                          /* background jobs per session */
+#define JOB_POLL_INTERVAL_MS 50             /* fg/wait output and status polling */
+#define PAGER_READ_CHUNK (1024 * 1024)      /* piped input read per refill */
+#define MAX_PAGER_BUFFER (1024UL * 1024 * 1024) /* piped input buffered by the pager */
+#define MAX_PAGER_PATTERN 256               /* search pattern length */
+#define PAGER_QUIT_IF_ONE_SCREEN 0x01       /* run_pager(): print short input and return */
+
+/* SHA-256 */
+#define SHA256_BLOCK_SIZE 64
+#define SHA256_DIGEST_LENGTH 32
+#define SHA256_HEX_LENGTH 64
 #define MAX_USERNAME_LENGTH 256
 #define MAX_PASSWORD_LENGTH 256
 #ifndef SUDOSH_VERSION
@@ -100,13 +120,66 @@ extern int sudo_compat_mode_flag;     /* argv[0]=="sudo" */
 #define LOCK_TIMEOUT 1800  /* 30 minutes (1800 seconds) */
 #define MAX_LOCK_PATH_LENGTH 512
 #define LOCK_FILE_EXTENSION ".lock"
+#define LOCK_INDEX_FILE_NAME "index"  /* binary index of active locks */
 
 /* Authentication cache constants */
 #define AUTH_CACHE_TIMEOUT 900  /* 15 minutes (900 seconds) - same as sudo default */
 #define AUTH_CACHE_DIR "/var/run/sudosh"
 #define AUTH_CACHE_FILE_PREFIX "auth_cache_"
+#define AUTH_CACHE_SWEEP_STAMP ".sweep"
+#define AUTH_CACHE_SWEEP_INTERVAL 60  /* Seconds between expired-cache sweeps */
+#define DIGEST_CACHE_FILE AUTH_CACHE_DIR "/digest_cache"
+#define MAX_DIGEST_CACHE_ENTRIES 256  /* binaries whose digest is kept in memory */
+#define MAX_DIGEST_PINS 8             /* sudoers pins considered per binary */
 #define MAX_CACHE_PATH_LENGTH 512
 
+/* Audit journal constants */
+#define AUDIT_LOG_DIR "/var/log/sudosh"
+#define AUDIT_LOG_FILE AUDIT_LOG_DIR "/audit.log"
+#define AUDIT_BATCH_RECORDS 32        /* violations batched per process before a commit */
+#define AUDIT_BATCH_USEC 200000       /* oldest batched record waits at most this long */
+#define AUDIT_MAX_FIELD 2048          /* escaped bytes kept per field */
+#define AUDIT_MAX_RECORD 8192
+
+/* Audit forwarding constants */
+#define AUDIT_FORWARD_MAGIC 0x46414453u          /* "SDAF" */
+#define AUDIT_FORWARD_VERSION 1
+#define AUDIT_FORWARD_BATCH 64                   /* records queued before a frame is sent */
+#define AUDIT_FORWARD_USEC 100000                /* oldest queued record waits at most this long */
+#define AUDIT_FORWARD_QUEUE_BYTES (256 * 1024)   /* held in memory before spilling to disk */
+#define AUDIT_FORWARD_FRAME_MAX (32 * 1024)      /* payload bytes per frame */
+#define AUDIT_FORWARD_RETRY_USEC 1000000         /* between attempts to reach the collector */
+
+/* Security violation rate limiting (per session) */
+#define VIOLATION_LOG_BURST 10        /* violations logged back to back before limiting */
+#define VIOLATION_LOG_RATE 2          /* tokens added per second */
+#define VIOLATION_LOG_SLOTS 32        /* distinct violations tracked for coalescing */
+#define VIOLATION_LOG_EVICTED 256     /* evicted violations still recognized as repeats */
+
+/* Host metrics constants */
+#define METRICS_FILE AUTH_CACHE_DIR "/metrics"
+#define METRICS_MAGIC 0x4d445353u            /* "SSDM" */
+#define METRICS_VERSION 1
+#define METRICS_LATENCY_BUCKETS 12           /* finite histogram bounds, see metrics.c */
+
+/* Compiled sudoers policy constants */
+#define POLICY_IMAGE_FILE AUTH_CACHE_DIR "/policy"
+#define POLICY_IMAGE_MAGIC 0x59504453u       /* "SDPY" */
+#define POLICY_IMAGE_VERSION 1
+
+/* Session summary constants */
+#define SESSION_HIST_SUB_BITS 3       /* sub-buckets per power of two: 2^3, within 12.5% */
+#define SESSION_HIST_LINEAR (2 << SESSION_HIST_SUB_BITS)   /* values below this are exact */
+#define SESSION_HIST_BUCKETS (SESSION_HIST_LINEAR + (64 - SESSION_HIST_SUB_BITS - 1) * (1 << SESSION_HIST_SUB_BITS))
+
+/* Session watch constants */
+#define WATCH_DIR AUTH_CACHE_DIR "/watch"
+#define WATCH_RING_SIZE (256 * 1024)  /* bytes of recent activity kept per session */
+#define WATCH_MAX_FRAME 4096          /* payload bytes per ring frame */
+#define WATCH_FRAME_INPUT 1           /* command line typed in the session */
+#define WATCH_FRAME_OUTPUT 2          /* terminal output of a command */
+#define WATCH_FRAME_EVENT 3           /* exit status and session notices */
+
 /* Color support constants */
 #define MAX_COLOR_CODE_LENGTH 32
 #define MAX_PS1_LENGTH 1024
@@ -121,7 +194,12 @@ extern int sudo_compat_mode_flag;     /* argv[0]=="sudo" */
 #define ANSIBLE_ENV_VAR_COUNT 20
 #define MAX_ALIASES 256
 #define ALIAS_FILE_NAME ".sudosh_aliases"
+#define ALIAS_JOURNAL_SUFFIX ".journal"
+#define ALIAS_JOURNAL_FLUSH_BATCH 16        /* queued records before a write */
+#define ALIAS_JOURNAL_COMPACT_RECORDS 128   /* journal records before compaction */
+#define MAX_ALIAS_JOURNAL_RECORD_LENGTH (MAX_ALIAS_NAME_LENGTH + MAX_ALIAS_VALUE_LENGTH + 16)
 #define MAX_DIR_STACK_DEPTH 32
+#define MAX_EDITOR_TEMPLATES 8              /* prepared secure editor launches per session */
 
 /* ANSI color codes */
 #define ANSI_RESET "\033[0m"
@@ -171,6 +249,7 @@ extern int sudo_compat_mode_flag;     /* argv[0]=="sudo" */
 #define EXIT_SUCCESS 0
 #define EXIT_FAILURE 1
 #define EXIT_AUTH_FAILURE 2
+#define EXIT_COMMAND_TIMEOUT 124
 #define EXIT_COMMAND_NOT_FOUND 127
 
 /* Logging priorities */
@@ -206,6 +285,8 @@ struct command_info {
     redirect_type_t redirect_type;
     char *redirect_file;
     int redirect_append;
+    /* Per-argv flags for arguments produced by glob expansion */
+    unsigned char *glob_matched;
 };
 
 /* Structure to hold pipeline information */
@@ -214,6 +295,50 @@ struct pipeline_command {
     int input_fd;   /* File descriptor for input */
     int output_fd;  /* File descriptor for output */
     pid_t pid;      /* Process ID when running */
+    int status;     /* waitpid() status once finished */
+    long long start_us;   /* monotonic_usec() at fork */
+    long long elapsed_us; /* Wall-clock runtime */
+};
+
+/* A child being waited for by supervise_children() */
+struct supervised_child {
+    pid_t pid;
+    long long start_us;     /* monotonic_usec() at fork */
+    long long elapsed_us;   /* Runtime once exited */
+    int status;             /* waitpid() status */
+    int exited;
+};
+
+/* How a supervised wait ended */
+struct supervision_result {
+    int timed_out;          /* Wall-clock limit expired */
+    int interrupted;        /* sudosh received SIGINT/SIGQUIT/SIGTERM */
+    int torn_down;          /* Remaining children were terminated */
+    long long elapsed_us;
+};
+
+/* Background job states */
+typedef enum {
+    JOB_FREE = 0,
+    JOB_RUNNING,
+    JOB_STOPPED,
+    JOB_DONE
+} job_state_t;
+
+/* A command started with a trailing '&' */
+struct background_job {
+    int id;                 /* %N job number */
+    pid_t pid;              /* Job runner; also its process group */
+    job_state_t state;
+    char *command;          /* Command line without the '&' */
+    char *username;
+    char *target_user;      /* -u target, NULL for root */
+    char *output_path;      /* Captured stdout/stderr */
+    off_t output_shown;     /* Bytes already copied to the terminal by fg */
+    int status;             /* waitpid() status once done */
+    int notified;           /* "Done" already reported */
+    long long start_us;
+    long long elapsed_us;
 };
 
 struct pipeline_info {
@@ -223,6 +348,25 @@ struct pipeline_info {
     int num_pipes;  /* Number of pipes (num_commands - 1) */
 };
 
+/* Operators joining the elements of a command list */
+typedef enum {
+    LIST_OP_NONE = 0,   /* First element */
+    LIST_OP_SEQUENCE,   /* ; */
+    LIST_OP_AND,        /* && */
+    LIST_OP_OR          /* || */
+} list_op_t;
+
+/* Structure to hold a command list (plan of commands and pipelines) */
+struct command_list_element {
+    char *command;      /* Simple command or pipeline */
+    list_op_t op;       /* Operator joining it to the previous element */
+};
+
+struct command_list {
+    struct command_list_element *elements;
+    int num_elements;
+};
+
 /* Structure to hold file lock information */
 struct file_lock_info {
     char *file_path;        /* Canonical path of the locked file */
@@ -232,6 +376,194 @@ struct file_lock_info {
     char *lock_file_path;   /* Path to the lock file */
 };
 
+/* Prepared launch of a secure editor (see get_editor_template) */
+struct editor_template {
+    char *name;                 /* Editor name as typed (argv[0]) */
+    char *binary_path;          /* Resolved executable */
+    char **envp;                /* Sanitized session environment for the child */
+    int file_locking_available; /* Lock manager state at preparation */
+};
+
+/* Resolved identity of a file path (see resolve_path_identity) */
+struct path_identity {
+    char *canonical_path;   /* Canonical absolute path */
+    int exists;             /* Whether the target existed when resolved */
+    dev_t dev;              /* Target device (if exists) */
+    ino_t ino;              /* Target inode (if exists) */
+    int parent_known;       /* Whether the containing directory resolved */
+    dev_t parent_dev;       /* Containing directory device */
+    ino_t parent_ino;       /* Containing directory inode */
+};
+
+/* Incremental SHA-256 state */
+struct sha256_ctx {
+    uint32_t state[8];
+    uint64_t bit_count;
+    unsigned char buffer[SHA256_BLOCK_SIZE];
+    size_t buffer_len;
+};
+
+/* A command binary opened once, checked with fstat() and executed by descriptor */
+struct verified_binary {
+    int fd;                 /* O_PATH descriptor (O_RDONLY without O_PATH) */
+    char *path;             /* Resolved path, for messages and script fallback */
+    dev_t dev;              /* Identity of the checked file */
+    ino_t ino;
+    const char *reason;     /* Why verification failed, NULL for errno failures */
+};
+
+/* Target user identity, resolved once per session and applied without NSS */
+struct target_credentials {
+    char *name;
+    uid_t uid;
+    gid_t gid;
+    gid_t *groups;          /* Supplementary groups, as initgroups() would set */
+    int ngroups;
+    char *home;
+    char *shell;
+};
+
+/* Outcome of verifying the audit journal's hash chain */
+struct audit_verify_result {
+    unsigned long long records;     /* Records verified before any problem */
+    unsigned long long last_seq;
+    unsigned long long durable_seq; /* Last record the sync state says was committed */
+    unsigned long long syncs;       /* fdatasync() calls made by all sessions */
+    long long error_offset;         /* Byte offset of the first problem, -1 if none */
+    char error[160];
+    int threads;
+};
+
+/* Filters for searching the audit journal; NULL or 0 means any */
+struct audit_query {
+    const char *user;
+    const char *host;
+    const char *command;            /* Basename of any command on the line */
+    const char *type;               /* COMMAND, AUTH, SESSION or VIOLATION */
+    time_t since;
+    time_t until;
+    int failed_only;
+    unsigned long limit;
+};
+
+/* What a search cost */
+struct audit_query_stats {
+    unsigned long long scanned;     /* Index entries (or records) examined */
+    unsigned long long read;        /* Records read from the journal */
+    unsigned long long matched;
+    int indexed;                    /* 1 if the sidecar index was used */
+};
+
+/* Header of each frame sent to the audit collector; records follow */
+struct audit_forward_frame {
+    uint32_t magic;                 /* AUDIT_FORWARD_MAGIC */
+    uint16_t version;
+    uint16_t records;               /* Newline-terminated records in the payload */
+    uint32_t length;                /* Payload bytes after this header */
+    uint32_t pid;                   /* Sending session */
+};
+
+/* Audit forwarding counters for this process */
+struct audit_forward_stats {
+    unsigned long long frames;      /* Frames fully handed to the collector */
+    unsigned long long records;
+    unsigned long long spilled;     /* Records written to the spill file */
+    unsigned long long replayed;    /* Spilled records taken back for sending */
+    unsigned long long dropped;     /* Records lost: no spill file available */
+    size_t queued;                  /* Bytes waiting in memory */
+    int connected;
+};
+
+/* Host-wide counters shared by every sudosh process */
+enum metrics_counter {
+    METRIC_INVOCATIONS_INTERACTIVE,
+    METRIC_INVOCATIONS_COMMAND,
+    METRIC_INVOCATIONS_ANSIBLE,
+    METRIC_COMMANDS,
+    METRIC_PIPELINES,
+    METRIC_DENIED_VALIDATION,       /* Same order as enum session_denial */
+    METRIC_DENIED_PERMISSION,
+    METRIC_DENIED_AUTHENTICATION,
+    METRIC_AUTH_SUCCESS,
+    METRIC_AUTH_FAILURE,
+    METRIC_LOCK_CONTENDED_AUDIT_JOURNAL,
+    METRIC_LOCK_CONTENDED_AUDIT_SYNC,
+    METRIC_LOCK_CONTENDED_EDITOR_FILE,
+    METRIC_COUNTER_COUNT
+};
+
+/* Host-wide latency histograms */
+enum metrics_histogram {
+    METRIC_SSSD_QUERY,              /* SSSD sudo rules query */
+    METRIC_POLICY_PARSE,            /* parse_sudoers_file() */
+    METRIC_LOCK_WAIT,               /* Waiting for a contended audit lock */
+    METRIC_HISTOGRAM_COUNT
+};
+
+/* Heap totals kept by the allocation accounting build */
+struct alloc_totals {
+    unsigned long long allocations;     /* malloc/calloc/strdup calls (and realloc of NULL) */
+    unsigned long long reallocs;
+    unsigned long long frees;           /* Of counted blocks */
+    unsigned long long bytes;           /* Requested, including reallocs */
+    unsigned long long live_blocks;
+    unsigned long long live_bytes;
+    unsigned long long peak_bytes;      /* High-water mark of live_bytes */
+    unsigned long long untracked_frees; /* Blocks libc allocated */
+};
+
+/* Latencies kept in the per-session summary */
+enum session_latency {
+    SESSION_LATENCY_VALIDATE,       /* validate_command() */
+    SESSION_LATENCY_PERMISSION,     /* check_command_permission() */
+    SESSION_LATENCY_EXEC,           /* execute_command()/execute_pipeline() entry to last fork */
+    SESSION_LATENCY_COUNT
+};
+
+/* Why a command line was refused, for the per-session summary */
+enum session_denial {
+    SESSION_DENY_VALIDATION,        /* Rejected by security validation */
+    SESSION_DENY_PERMISSION,        /* Not allowed by sudoers */
+    SESSION_DENY_AUTHENTICATION,    /* Authentication required and failed */
+    SESSION_DENY_COUNT
+};
+
+/* Log-linear latency histogram in microseconds (HDR style) */
+struct session_histogram {
+    unsigned long long count;
+    unsigned long long sum;
+    unsigned long long max;
+    uint32_t buckets[SESSION_HIST_BUCKETS];
+};
+
+typedef void (*audit_query_emit)(const char *record, size_t len, void *ctx);
+
+/* An observer's read-only view of a session's watch ring */
+struct watch_reader {
+    int fd;
+    void *map;
+    size_t map_size;
+    pid_t pid;
+    uint64_t pos;           /* Next frame to read */
+    uint64_t lost;          /* Bytes overwritten before they were read */
+};
+
+/* Read-only pager input: a mapped file or buffered pipe, with a lazy line index */
+struct pager_buffer {
+    char *data;             /* Mapped file or heap buffer */
+    size_t len;             /* Bytes available in data */
+    size_t capacity;        /* Heap buffer size (0 when mapped) */
+    int mapped;             /* data is an mmap() of a regular file */
+    int fd;                 /* Source of further input for pipes */
+    int eof;                /* No more input will arrive */
+    int truncated;          /* Input exceeded MAX_PAGER_BUFFER */
+    size_t *line_starts;    /* Offset of each indexed line */
+    size_t line_count;      /* Lines indexed so far */
+    size_t line_capacity;
+    size_t scanned;         /* Bytes already scanned for newlines */
+    int index_complete;     /* line_starts covers all input */
+};
+
 /* Structure to hold color configuration */
 struct color_config {
     char username_color[MAX_COLOR_CODE_LENGTH];
@@ -260,10 +592,11 @@ struct alias_entry {
     struct alias_entry *next;
 };
 
-/* Structure to hold directory stack for pushd/popd */
+/* Directory stack entry for pushd/popd: display path plus an open
+   directory handle so returning to it uses fchdir() */
 struct dir_stack_entry {
     char *path;
-    struct dir_stack_entry *next;
+    int fd;
 };
 
 /* NSS source types */
@@ -316,18 +649,80 @@ struct sudoers_userspec {
     char **users;           /* List of users this rule applies to */
     char **hosts;           /* List of hosts this rule applies to */
     char **commands;        /* List of commands allowed */
+    char **digests;         /* Per-command sha256 pin (hex), NULL if unpinned */
     int nopasswd;           /* Whether password is required */
     char *runas_user;       /* User to run as (default: root) */
     char *source_file;      /* Source file where this rule was found */
     struct sudoers_userspec *next;
 };
 
-/* Sudoers configuration */
+/* A compiled sudoers rule (policy.c); every field is an offset into the policy image */
+struct policy_rule {
+    uint32_t users;         /* String lists ("a\0b\0\0"): users and %groups, */
+    uint32_t hosts;         /* hosts, */
+    uint32_t commands;      /* and commands allowed */
+    uint32_t digests;       /* Parallel to commands: sha256 pin (hex) or "-"; 0 if none pinned */
+    uint32_t runas_user;    /* Strings, 0 if absent */
+    uint32_t source_file;
+    uint32_t nopasswd;
+    uint32_t reserved;
+};
+
+/* Identity of a sudoers input (file or include directory) before it was read */
+struct policy_source {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t ctime_sec;
+    int64_t ctime_nsec;
+    uint32_t path;          /* Offset of the path in the image */
+    uint32_t missing;       /* Did not exist */
+};
+
+/* Rules and inputs collected while parsing sudoers, before compiling */
+struct policy_build {
+    struct sudoers_userspec *first;
+    struct sudoers_userspec *last;
+    char *includedir;       /* Include directory in effect */
+    struct policy_source *sources;
+    char **source_paths;
+    uint32_t source_count;
+    uint32_t source_capacity;
+    int incomplete;         /* An input could not be recorded */
+};
+
+struct policy_mapping;
+
+/* Sudoers configuration: a compiled policy image, mapped shared from
+   POLICY_IMAGE_FILE when it is current or held privately otherwise */
 struct sudoers_config {
-    struct sudoers_userspec *userspecs;
-    char *includedir;       /* Directory for included files */
+    const char *image;                  /* Base of every offset */
+    const struct policy_rule *rules;
+    uint32_t rule_count;
+    const char *includedir;             /* Directory for included files */
+    struct policy_mapping *mapping;     /* Shared mapping held, NULL if private */
 };
 
+/**
+ * String at an offset in a compiled policy, NULL for offset 0
+ */
+static inline const char *policy_string(const struct sudoers_config *config, uint32_t offset) {
+    return offset ? config->image + offset : NULL;
+}
+
+/**
+ * First entry of a compiled string list; an absent list is empty
+ */
+static inline const char *policy_list(const struct sudoers_config *config, uint32_t offset) {
+    return offset ? config->image + offset : "";
+}
+
+/* Walk a compiled string list: for each entry s (never empty) */
+#define POLICY_FOREACH(config, list, s) \
+    for (const char *s = policy_list((config), (list)); *s; s += strlen(s) + 1)
+
 /* Function prototypes */
 
 /* Authentication functions */
@@ -380,10 +775,31 @@ int check_command_permission_nss(const char *username, const char *command);
 /* Sudoers parsing functions */
 struct sudoers_config *parse_sudoers_file(const char *filename);
 void free_sudoers_config(struct sudoers_config *config);
+void free_sudoers_userspec(struct sudoers_userspec *spec);
 int check_sudoers_privileges(const char *username, const char *hostname, struct sudoers_config *sudoers);
 int check_sudoers_nopasswd(const char *username, const char *hostname, struct sudoers_config *sudoers);
 int check_sudoers_global_nopasswd(const char *username, const char *hostname, struct sudoers_config *sudoers);
 int check_sudoers_command_permission(const char *username, const char *hostname, const char *command, struct sudoers_config *sudoers);
+int get_sudoers_command_digests(const char *username, const char *hostname, const char *path,
+                                struct sudoers_config *sudoers,
+                                char digests[][SHA256_HEX_LENGTH + 1], int max_digests);
+int sudoers_has_command_digests(const struct sudoers_config *sudoers);
+int sudoers_config_current(const struct sudoers_config *config);
+
+/* Compiled sudoers policy (policy.c) */
+void policy_build_init(struct policy_build *build, const char *includedir);
+void policy_build_note_source(struct policy_build *build, const char *path);
+void policy_build_add_rule(struct policy_build *build, struct sudoers_userspec *spec);
+void policy_build_free(struct policy_build *build);
+struct sudoers_config *policy_compile(const struct policy_build *build, const char *sudoers_path,
+                                      const char *initial_includedir);
+struct sudoers_config *policy_image_attach(const char *sudoers_path, const char *includedir);
+struct sudoers_config *policy_image_publish(const struct sudoers_config *config);
+int policy_config_current(const struct sudoers_config *config, const char *sudoers_path,
+                          const char *includedir);
+int policy_config_settled(const struct sudoers_config *config);
+size_t policy_image_size(const struct sudoers_config *config);
+void policy_release(struct sudoers_config *config);
 
 /* SSSD integration functions */
 int check_sssd_privileges(const char *username);
@@ -448,6 +864,85 @@ void execute_with_pager(void (*func)(const char*), const char *arg);
 int parse_command(const char *input, struct command_info *cmd);
 int execute_command(struct command_info *cmd, struct user_info *user);
 char *find_command_in_path(const char *command);
+int open_verified_binary(const char *path, const struct target_credentials *target, struct verified_binary *vb);
+void exec_verified_binary(const struct verified_binary *vb, char *const argv[]);
+void close_verified_binary(struct verified_binary *vb);
+
+/* Audit journal functions */
+void audit_record(const char *type, const char *username, const char *status,
+                  const char *message, int durable);
+void audit_flush(void);
+void close_audit_journal(void);
+int verify_audit_log(const char *path, int threads, struct audit_verify_result *result);
+int verify_audit_command(const char *path);
+const char *audit_log_path(void);
+int audit_file_trusted(int fd);
+
+/* Audit forwarding functions */
+void audit_forward_configure(const char *socket_path);
+int audit_forward_enabled(void);
+void audit_forward_record(const char *fields, int urgent);
+void audit_forward_flush(int final);
+void close_audit_forward(void);
+void audit_forward_get_stats(struct audit_forward_stats *stats);
+
+/* Audit index functions */
+int audit_index_extend(int index_fd, int journal_fd, const char *buf, size_t len, uint64_t base);
+int audit_query_run(const char *path, const struct audit_query *query, audit_query_emit emit,
+                    void *ctx, struct audit_query_stats *stats);
+int parse_audit_time(const char *text, time_t now, time_t *out);
+int audit_query_command(int argc, char *argv[]);
+
+/* Host metrics functions */
+void metrics_count(enum metrics_counter which);
+void metrics_observe(enum metrics_histogram which, long long usec);
+int metrics_flock(int fd, enum metrics_counter contended);
+int render_metrics(FILE *out);
+int metrics_command(void);
+void close_metrics(void);
+
+/* Allocation accounting functions (all zero unless built with ALLOC_STATS=1) */
+int alloc_stats_enabled(void);
+void alloc_stats_get(struct alloc_totals *totals);
+void alloc_stats_reset_peak(void);
+int alloc_stats_report(FILE *out, int limit);
+
+/* Session summary functions */
+void session_stats_command(int pipeline);
+void session_stats_denied(enum session_denial reason);
+void session_stats_auth_prompt(void);
+void session_stats_latency(enum session_latency which, long long usec);
+unsigned long long session_histogram_quantile(const struct session_histogram *h, double q);
+const struct session_histogram *session_stats_histogram(enum session_latency which);
+int format_session_summary(char *buf, size_t size);
+void reset_session_stats(void);
+
+/* Session watch functions */
+int watch_session_start(const char *username, const char *target);
+void watch_session_end(void);
+void watch_record_input(const char *line);
+int watch_begin_output(const char *command_line);
+void watch_end_output(int status);
+int watch_publish(int type, const void *data, size_t length);
+int watch_open(pid_t session, struct watch_reader *reader);
+int watch_read_frame(struct watch_reader *reader, int *type, char *buf, size_t size,
+                     size_t *length, long long *usec);
+void watch_wait(struct watch_reader *reader, int timeout_ms);
+void watch_close(struct watch_reader *reader);
+int watch_session_command(const char *session_arg);
+
+/* Target credential functions */
+const struct target_credentials *get_target_credentials(const char *name);
+int apply_target_credentials(const struct target_credentials *cred);
+int set_target_environment(const struct target_credentials *cred);
+void clear_target_credentials(void);
+
+/* Digest pinning functions */
+int parse_digest_spec(const char *entry, unsigned char digest[SHA256_DIGEST_LENGTH], const char **command);
+int get_binary_digest(const struct verified_binary *vb, unsigned char digest[SHA256_DIGEST_LENGTH],
+                      int *from_cache);
+int enforce_command_digest(const char *username, const struct verified_binary *vb);
+void reset_digest_cache(void);
 char *expand_equals_expression(const char *arg);
 void free_command_info(struct command_info *cmd);
 int validate_ansible_command(const char *command, const char *username);
@@ -459,6 +954,7 @@ int parse_command_with_shell_operators(const char *input, struct command_info *c
 int parse_command_with_redirection(const char *input, struct command_info *cmd);
 int tokenize_command_line(const char *input, char ***argv, int *argc, int *argv_size);
 char *trim_whitespace_inplace(char *str);
+int expand_command_globs(struct command_info *cmd);
 
 /* Pipeline execution functions */
 int is_pipeline_command(const char *input);
@@ -473,6 +969,59 @@ int validate_pipeline_with_permissions(struct pipeline_info *pipeline, const cha
 void log_pipeline_start(struct pipeline_info *pipeline);
 void log_pipeline_completion(struct pipeline_info *pipeline, int exit_code);
 
+/* Command list (;, &&, ||) functions */
+int is_command_list(const char *input);
+int parse_command_list(const char *input, struct command_list *list);
+int validate_command_list(struct command_list *list);
+int execute_command_list(struct command_list *list, struct user_info *user, const char *username);
+void free_command_list(struct command_list *list);
+
+/* Ansible pipelining functions */
+int is_pipelining_interpreter(const char *interpreter_path);
+int capture_pipelined_payload(int in_fd, int *spool_fd, size_t *payload_len, char *sha256_hex);
+int execute_pipelined_module(const char *interpreter_path, int spool_fd, struct user_info *user);
+
+/* Child supervision functions */
+long long monotonic_usec(void);
+int set_command_timeout(const char *command, int seconds);
+void clear_command_timeouts(void);
+int get_command_timeout(const struct command_info *cmd);
+int supervise_children(struct supervised_child *children, int count, int timeout_seconds,
+                       struct supervision_result *result);
+int supervised_exit_code(const struct supervised_child *child, const struct supervision_result *result);
+
+/* Background job functions */
+int strip_background_operator(char *command_line);
+int can_run_in_background(const char *command_line);
+int start_background_job(const char *command_line, struct user_info *user, const char *username);
+struct background_job *find_job(const char *spec);
+void notify_finished_jobs(void);
+int count_active_jobs(void);
+void list_jobs(int long_format);
+int foreground_job(const char *spec);
+int resume_job_in_background(const char *spec);
+int wait_for_jobs(const char *spec);
+void cleanup_jobs(void);
+
+/* Built-in pager functions */
+int pager_buffer_open(struct pager_buffer *pb, int fd);
+void pager_buffer_close(struct pager_buffer *pb);
+int pager_buffer_line(struct pager_buffer *pb, size_t line, const char **start, size_t *len);
+size_t pager_buffer_total_lines(struct pager_buffer *pb);
+size_t pager_buffer_line_of(struct pager_buffer *pb, size_t offset);
+long long pager_buffer_search(struct pager_buffer *pb, const char *pattern, size_t from, int forward);
+int run_pager(int fd, const char *name, int flags);
+int page_file(const char *path);
+int should_use_builtin_pager(const struct command_info *cmd, int from_pipe);
+
+/* SHA-256 functions */
+void sha256_init(struct sha256_ctx *ctx);
+void sha256_update(struct sha256_ctx *ctx, const void *data, size_t len);
+void sha256_final(struct sha256_ctx *ctx, unsigned char digest[SHA256_DIGEST_LENGTH]);
+void sha256_to_hex(const unsigned char digest[SHA256_DIGEST_LENGTH], char *hex);
+void sha256_hex(const void *data, size_t len, char *hex);
+const char *sha256_implementation(void);
+
 /* Logging functions */
 void init_logging(void);
 void log_command(const char *username, const char *command, int success);
@@ -481,6 +1030,7 @@ void log_session_start(const char *username);
 void log_session_end(const char *username);
 /* void log_error(const char *message); */ /* Already declared in sudosh_common.h */
 void log_security_violation(const char *username, const char *violation);
+void flush_security_violations(void);
 
 /* Ansible-aware logging functions */
 void log_command_with_ansible_context(const char *username, const char *command, int exit_status);
@@ -495,6 +1045,7 @@ void log_session_output(const char *output);
 void close_session_logging(void);
 
 /* Command history functions */
+void get_history_path(const char *home_dir, char *buf, size_t size);
 int init_command_history(const char *username);
 void log_command_history(const char *command);
 void close_command_history(void);
@@ -519,6 +1070,7 @@ int validate_command(const char *command);
 int validate_command_with_length(const char *command, size_t buffer_len);
 int validate_secure_pipeline(const char *command);
 int validate_command_for_pipeline(const char *command);
+int validate_glob_expansion(const struct command_info *cmd);
 int validate_safe_redirection(const char *command);
 int validate_safe_redirection_with_length(const char *command, size_t buffer_len);
 int is_safe_redirection_target(const char *target);
@@ -540,6 +1092,9 @@ int is_secure_pager(const char *command);
 void setup_secure_pager_environment(void);
 int is_secure_editor(const char *command);
 void setup_secure_editor_environment(void);
+const struct editor_template *get_editor_template(const char *editor_name);
+char **build_secure_editor_envp(char *const *source);
+void invalidate_editor_templates(void);
 int is_interactive_editor(const char *command);
 int is_safe_command(const char *command);
 int is_dangerous_command(const char *command);
@@ -572,7 +1127,13 @@ int acquire_file_lock(const char *file_path, const char *username, pid_t pid);
 int release_file_lock(const char *file_path, const char *username, pid_t pid);
 struct file_lock_info *check_file_lock(const char *file_path);
 void free_file_lock_info(struct file_lock_info *lock_info);
+struct file_lock_info **list_active_file_locks(int *count);
+void free_file_lock_list(struct file_lock_info **locks, int count);
+int print_file_locks(void);
 char *resolve_canonical_path(const char *file_path);
+int resolve_path_identity(const char *file_path, struct path_identity *out);
+void free_path_identity(struct path_identity *identity);
+void invalidate_path_cache(void);
 int cleanup_stale_locks(void);
 int is_editing_command(const char *command);
 char *extract_file_argument(const char *command);
@@ -588,11 +1149,13 @@ char *trim_whitespace(char *str);
 int is_empty_command(const char *command);
 char *read_command(void);
 int handle_builtin_command(const char *command);
+extern const char *const sudosh_builtins[];     /* Session built-in names, NULL-terminated */
+const char *builtin_command_name(const char *command_line);
 uid_t get_real_uid(void);
 char *get_current_username(void);
 struct user_info *get_real_user_info(void);
 int is_whitespace_only(const char *str);
-char *safe_strdup(const char *str);
+char *(safe_strdup)(const char *str);
 
 /* History search helper for reverse-i-search (non-interactive core) */
 int history_search_last_index(const char *needle);
@@ -646,6 +1209,8 @@ void cleanup_directory_stack(void);
 int pushd(const char *dir);
 int popd(void);
 void print_dirs(void);
+int change_directory(const char *dir);
+const char *get_directory_stack_cwd(void);
 
 /* Environment variable management */
 int handle_export_command(const char *command);
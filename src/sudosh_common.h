@@ -74,6 +74,30 @@ typedef enum {
 /* Forward declarations */
 void log_error(const char *message);
 
+/*
+ * Allocation accounting build (make ALLOC_STATS=1): the allocator calls
+ * below and the safe_* helpers are charged to their call sites by
+ * alloc_stats.c.  A normal build is unchanged.
+ */
+#ifdef SUDOSH_ALLOC_STATS
+void *sudosh_alloc_malloc(size_t size, const char *file, int line);
+void *sudosh_alloc_calloc(size_t count, size_t size, const char *file, int line);
+void *sudosh_alloc_zalloc(size_t size, const char *file, int line);
+void *sudosh_alloc_realloc(void *ptr, size_t size, const char *file, int line);
+char *sudosh_alloc_strdup(const char *str, const char *file, int line);
+char *sudosh_alloc_strndup(const char *str, size_t n, const char *file, int line);
+void sudosh_alloc_free(void *ptr);
+
+#undef strdup
+#undef strndup
+#define malloc(size) sudosh_alloc_malloc((size), __FILE__, __LINE__)
+#define calloc(count, size) sudosh_alloc_calloc((count), (size), __FILE__, __LINE__)
+#define realloc(ptr, size) sudosh_alloc_realloc((ptr), (size), __FILE__, __LINE__)
+#define strdup(str) sudosh_alloc_strdup((str), __FILE__, __LINE__)
+#define strndup(str, n) sudosh_alloc_strndup((str), (n), __FILE__, __LINE__)
+#define free(ptr) sudosh_alloc_free(ptr)
+#endif
+
 /* Memory management utilities */
 
 /**
@@ -145,6 +169,14 @@ static inline void sudosh_safe_free(void **ptr) {
     }
 }
 
+#ifdef SUDOSH_ALLOC_STATS
+/* Charge the helpers' allocations to their callers, not to this header */
+#define sudosh_safe_strdup(str) sudosh_alloc_strdup((str), __FILE__, __LINE__)
+#define sudosh_safe_malloc(size) sudosh_alloc_zalloc((size), __FILE__, __LINE__)
+#define sudosh_safe_realloc(ptr, size) sudosh_alloc_realloc((ptr), (size), __FILE__, __LINE__)
+#define safe_strdup(str) sudosh_alloc_strdup((str), __FILE__, __LINE__)
+#endif
+
 /* String utilities */
 
 /**
@@ -298,6 +330,15 @@ typedef struct {
 
     /* Shell enhancements */
     int rc_alias_import_enabled; /* allow importing aliases from user rc files */
+
+    /* Child supervision */
+    int command_timeout;         /* default wall-clock limit in seconds, 0 = none */
+
+    /* Live observation */
+    int session_watch;           /* publish interactive sessions for sudosh --watch */
+
+    /* Audit forwarding */
+    char *audit_forward_socket;  /* collector's Unix socket, NULL = not forwarded */
 } sudosh_config_t;
 
 /* Configuration management functions */
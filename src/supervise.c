@@ -0,0 +1,449 @@
+/**
+ * supervise.c - Child Process Supervision
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * Waits for the children of a command or pipeline in one event loop
+ * instead of blocking in waitpid() per child.  On Linux the loop polls
+ * pidfds, a signalfd and a timerfd with epoll, which gives wall-clock
+ * limits, forwarding of signals sent to sudosh, teardown of a pipeline
+ * when a stage dies, and per-child timing.  Elsewhere it falls back to
+ * blocking waits without time limits.
+ */
+
+#include "sudosh.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#endif
+
+/* Per-command wall-clock limits (seconds, 0 = unlimited) */
+struct command_timeout_entry {
+    char name[64];
+    int seconds;
+};
+
+static int default_command_timeout = 0;
+static struct command_timeout_entry command_timeouts[MAX_COMMAND_TIMEOUTS];
+static int num_command_timeouts = 0;
+
+/**
+ * Current monotonic time in microseconds
+ */
+long long monotonic_usec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/**
+ * Set the wall-clock limit for a command name, or the default when NULL
+ */
+int set_command_timeout(const char *command, int seconds) {
+    if (seconds < 0) {
+        return -1;
+    }
+    if (!command) {
+        default_command_timeout = seconds;
+        return 0;
+    }
+    if (strlen(command) >= sizeof(command_timeouts[0].name) || strchr(command, '/')) {
+        return -1;
+    }
+
+    for (int i = 0; i < num_command_timeouts; i++) {
+        if (strcmp(command_timeouts[i].name, command) == 0) {
+            command_timeouts[i].seconds = seconds;
+            return 0;
+        }
+    }
+    if (num_command_timeouts >= MAX_COMMAND_TIMEOUTS) {
+        return -1;
+    }
+    snprintf(command_timeouts[num_command_timeouts].name,
+             sizeof(command_timeouts[0].name), "%s", command);
+    command_timeouts[num_command_timeouts].seconds = seconds;
+    num_command_timeouts++;
+    return 0;
+}
+
+/**
+ * Forget all configured limits
+ */
+void clear_command_timeouts(void) {
+    default_command_timeout = 0;
+    num_command_timeouts = 0;
+}
+
+/**
+ * Look up the wall-clock limit for a command (by basename of argv[0])
+ */
+int get_command_timeout(const struct command_info *cmd) {
+    if (!cmd || !cmd->argv || !cmd->argv[0]) {
+        return default_command_timeout;
+    }
+
+    const char *name = strrchr(cmd->argv[0], '/');
+    name = name ? name + 1 : cmd->argv[0];
+    for (int i = 0; i < num_command_timeouts; i++) {
+        if (strcmp(command_timeouts[i].name, name) == 0) {
+            return command_timeouts[i].seconds;
+        }
+    }
+    return default_command_timeout;
+}
+
+/**
+ * Record a child's exit
+ */
+static void record_exit(struct supervised_child *child, int status) {
+    child->status = status;
+    child->exited = 1;
+    child->elapsed_us = monotonic_usec() - child->start_us;
+}
+
+/**
+ * Send a signal to every child still running
+ */
+static void signal_live_children(struct supervised_child *children, int count, int sig) {
+    for (int i = 0; i < count; i++) {
+        if (!children[i].exited && children[i].pid > 0) {
+            kill(children[i].pid, sig);
+        }
+    }
+}
+
+/**
+ * Whether a child's end should take the rest of its pipeline down
+ */
+static int is_abnormal_exit(int status) {
+    return WIFSIGNALED(status) && WTERMSIG(status) != SIGPIPE;
+}
+
+/**
+ * Wait for children with blocking waitpid() (no time limit)
+ */
+static int supervise_blocking(struct supervised_child *children, int count,
+                              struct supervision_result *result) {
+    struct sigaction ignore_action, old_sigint, old_sigquit;
+
+    ignore_action.sa_handler = SIG_IGN;
+    sigemptyset(&ignore_action.sa_mask);
+    ignore_action.sa_flags = 0;
+    sigaction(SIGINT, &ignore_action, &old_sigint);
+    sigaction(SIGQUIT, &ignore_action, &old_sigquit);
+
+    int rc = 0;
+    for (int i = 0; i < count; i++) {
+        int status;
+        pid_t r;
+        if (children[i].exited) {
+            continue;
+        }
+        do {
+            r = waitpid(children[i].pid, &status, 0);
+        } while (r == -1 && errno == EINTR);
+        if (r == -1) {
+            children[i].exited = 1;
+            children[i].status = 0;
+            rc = -1;
+            continue;
+        }
+        record_exit(&children[i], status);
+        if (is_abnormal_exit(status) && !result->torn_down) {
+            result->torn_down = 1;
+            signal_live_children(children, count, SIGTERM);
+        }
+    }
+
+    sigaction(SIGINT, &old_sigint, NULL);
+    sigaction(SIGQUIT, &old_sigquit, NULL);
+    return rc;
+}
+
+#ifdef __linux__
+
+/* epoll tags beyond child indexes */
+#define SUPERVISE_TAG_SIGNAL 0xfffffff0u
+#define SUPERVISE_TAG_TIMER  0xfffffff1u
+
+/**
+ * Open a pidfd for a child, or -1 when unsupported
+ */
+static int open_pidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/**
+ * Arm the timer to fire once after the given number of milliseconds
+ */
+static int arm_timer(int tfd, long long ms) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = ms / 1000;
+    its.it_value.tv_nsec = (ms % 1000) * 1000000L;
+    return timerfd_settime(tfd, 0, &its, NULL);
+}
+
+/**
+ * Reap any children that have exited; returns the number still running
+ */
+static int reap_exited(struct supervised_child *children, int count, int *abnormal) {
+    int live = 0;
+    for (int i = 0; i < count; i++) {
+        if (children[i].exited) {
+            continue;
+        }
+        int status;
+        pid_t r = waitpid(children[i].pid, &status, WNOHANG);
+        if (r == children[i].pid) {
+            record_exit(&children[i], status);
+            if (is_abnormal_exit(status)) {
+                *abnormal = 1;
+            }
+        } else if (r == -1 && errno == ECHILD) {
+            /* Reaped elsewhere; nothing more to learn */
+            children[i].exited = 1;
+        } else {
+            live++;
+        }
+    }
+    return live;
+}
+
+/**
+ * Supervise children with epoll over pidfds, a signalfd and a timerfd
+ *
+ * SIGINT, SIGQUIT, SIGTERM and SIGCHLD are blocked for the duration and
+ * read from the signalfd.  Terminal-generated SIGINT/SIGQUIT already
+ * reach the children through the process group, so only signals sent to
+ * sudosh directly are forwarded; SIGTERM tears the children down.
+ *
+ * Returns 0 on success, -1 if the loop could not be set up (the caller
+ * then falls back to blocking waits).
+ */
+static int supervise_epoll(struct supervised_child *children, int count, int timeout_seconds,
+                           struct supervision_result *result) {
+    sigset_t mask, old_mask;
+    int ep = -1, sfd = -1, tfd = -1;
+    int *pidfds = NULL;
+    int need_sigchld_sweep = 0;
+    int got_sigterm = 0;
+    int rc = -1;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGQUIT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &mask, &old_mask) != 0) {
+        return -1;
+    }
+
+    pidfds = malloc((size_t)count * sizeof(int));
+    if (pidfds) {
+        for (int i = 0; i < count; i++) {
+            pidfds[i] = -1;
+        }
+    }
+    ep = epoll_create1(EPOLL_CLOEXEC);
+    sfd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (!pidfds || ep == -1 || sfd == -1) {
+        goto out;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = SUPERVISE_TAG_SIGNAL;
+    if (epoll_ctl(ep, EPOLL_CTL_ADD, sfd, &ev) != 0) {
+        goto out;
+    }
+
+    for (int i = 0; i < count; i++) {
+        pidfds[i] = open_pidfd(children[i].pid);
+        if (pidfds[i] == -1) {
+            /* Old kernel: fall back to SIGCHLD plus WNOHANG sweeps */
+            need_sigchld_sweep = 1;
+            continue;
+        }
+        ev.data.u32 = (uint32_t)i;
+        epoll_ctl(ep, EPOLL_CTL_ADD, pidfds[i], &ev);
+    }
+
+    tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (tfd == -1) {
+        goto out;
+    }
+    ev.data.u32 = SUPERVISE_TAG_TIMER;
+    if (epoll_ctl(ep, EPOLL_CTL_ADD, tfd, &ev) != 0) {
+        goto out;
+    }
+    if (timeout_seconds > 0) {
+        arm_timer(tfd, (long long)timeout_seconds * 1000);
+    }
+
+    /* Children may have exited before the signals were blocked */
+    int abnormal = 0;
+    int live = reap_exited(children, count, &abnormal);
+    int kill_pending = 0;
+
+    while (live > 0) {
+        if (abnormal && !result->torn_down) {
+            result->torn_down = 1;
+            signal_live_children(children, count, SIGTERM);
+            arm_timer(tfd, SUPERVISE_KILL_GRACE_MS);
+            kill_pending = 1;
+        }
+
+        struct epoll_event events[8];
+        int n = epoll_wait(ep, events, 8, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            goto out;
+        }
+
+        int sweep = 0;
+        for (int e = 0; e < n; e++) {
+            uint32_t tag = events[e].data.u32;
+            if (tag == SUPERVISE_TAG_SIGNAL) {
+                struct signalfd_siginfo si;
+                while (read(sfd, &si, sizeof(si)) == (ssize_t)sizeof(si)) {
+                    if (si.ssi_signo == SIGCHLD) {
+                        sweep |= need_sigchld_sweep;
+                    } else if (si.ssi_signo == SIGTERM) {
+                        result->interrupted = 1;
+                        got_sigterm = 1;
+                        abnormal = 1;
+                    } else {
+                        result->interrupted = 1;
+                        /* Keyboard signals already went to the process group */
+                        if (si.ssi_code != SI_KERNEL) {
+                            signal_live_children(children, count, (int)si.ssi_signo);
+                        }
+                    }
+                }
+            } else if (tag == SUPERVISE_TAG_TIMER) {
+                uint64_t expirations;
+                if (read(tfd, &expirations, sizeof(expirations)) < 0) {
+                    /* Spurious wakeup; the timer state is unchanged */
+                }
+                if (kill_pending) {
+                    signal_live_children(children, count, SIGKILL);
+                } else {
+                    result->timed_out = 1;
+                    abnormal = 1;
+                }
+            } else if (tag < (uint32_t)count) {
+                sweep = 1;
+                epoll_ctl(ep, EPOLL_CTL_DEL, pidfds[tag], NULL);
+            }
+        }
+
+        if (sweep) {
+            live = reap_exited(children, count, &abnormal);
+        }
+    }
+    rc = 0;
+
+out:
+    if (tfd != -1) close(tfd);
+    if (sfd != -1) close(sfd);
+    if (ep != -1) close(ep);
+    if (pidfds) {
+        for (int i = 0; i < count; i++) {
+            if (pidfds[i] != -1) {
+                close(pidfds[i]);
+            }
+        }
+        free(pidfds);
+    }
+
+    /* Discard signals consumed on the children's behalf before unblocking */
+    struct timespec zero = {0, 0};
+    int sig;
+    while ((sig = sigtimedwait(&mask, NULL, &zero)) > 0) {
+        if (sig == SIGTERM) {
+            got_sigterm = 1;
+        }
+    }
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+
+    /* SIGTERM was meant for sudosh too; let its handler see it */
+    if (got_sigterm) {
+        raise(SIGTERM);
+    }
+    return rc;
+}
+
+#endif /* __linux__ */
+
+/**
+ * Wait for a set of children, enforcing an optional wall-clock limit
+ *
+ * Each child's start_us must be set by the caller right after fork().
+ * When a child is killed by a signal other than SIGPIPE, or the limit
+ * expires, or sudosh receives SIGTERM, the remaining children get
+ * SIGTERM and then SIGKILL after SUPERVISE_KILL_GRACE_MS.  Exit status
+ * and elapsed time are stored in each child.
+ */
+int supervise_children(struct supervised_child *children, int count, int timeout_seconds,
+                       struct supervision_result *result) {
+    struct supervision_result local;
+
+    if (!children || count <= 0) {
+        return -1;
+    }
+    if (!result) {
+        result = &local;
+    }
+    memset(result, 0, sizeof(*result));
+    long long started = monotonic_usec();
+
+#ifdef __linux__
+    if (supervise_epoll(children, count, timeout_seconds, result) == 0) {
+        result->elapsed_us = monotonic_usec() - started;
+        return 0;
+    }
+    /* Children reaped before setup failed keep their recorded status */
+    syslog(LOG_WARNING, "sudosh: event-driven supervision unavailable, waiting without limits");
+#else
+    if (timeout_seconds > 0) {
+        syslog(LOG_INFO, "sudosh: command time limits are not supported on this platform");
+    }
+#endif
+
+    int rc = supervise_blocking(children, count, result);
+    result->elapsed_us = monotonic_usec() - started;
+    return rc;
+}
+
+/**
+ * Convert a wait status into a shell-style exit code
+ */
+int supervised_exit_code(const struct supervised_child *child, const struct supervision_result *result) {
+    if (result && result->timed_out) {
+        return EXIT_COMMAND_TIMEOUT;
+    }
+    if (!child || !child->exited) {
+        return -1;
+    }
+    if (WIFEXITED(child->status)) {
+        return WEXITSTATUS(child->status);
+    }
+    if (WIFSIGNALED(child->status)) {
+        return 128 + WTERMSIG(child->status);
+    }
+    return -1;
+}
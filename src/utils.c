@@ -190,7 +190,7 @@ void print_help(void) {
     printf("  rules         - Show sudo rules, safe commands, and blocked commands\n");
     printf("  history       - Show command history\n");
     printf("  version       - Show version information\n");
-    printf("  cd <dir>      - Change current directory\n");
+    printf("  cd <dir>      - Change current directory (cd - returns to the previous one)\n");
     printf("  pwd           - Print current working directory\n");
     printf("  path          - Show PATH environment variable and inaccessible directories\n");
     printf("  alias [name[=value]] - Create or show aliases\n");
@@ -203,6 +203,11 @@ void print_help(void) {
     printf("  pushd <dir>   - Push directory onto stack and change to it\n");
     printf("  popd          - Pop directory from stack and change to it\n");
     printf("  dirs          - Show directory stack\n");
+    printf("  <command> &   - Run command as a background job\n");
+    printf("  jobs [-l]     - List background jobs\n");
+    printf("  fg [%%n]       - Follow a job's output until it finishes\n");
+    printf("  bg [%%n]       - Continue a stopped job in the background\n");
+    printf("  wait [%%n]     - Wait for background jobs to finish\n");
     printf("  exit, quit    - Exit sudosh\n");
     printf("  <command>     - Execute command as root\n\n");
     printf("Examples:\n");
@@ -236,6 +241,11 @@ void print_commands(void) {
     printf("  cd            - Change current directory\n");
     printf("  commands      - List all available commands\n");
     printf("  dirs          - Show directory stack\n");
+    printf("  <command> &   - Run command as a background job\n");
+    printf("  jobs [-l]     - List background jobs\n");
+    printf("  fg [%%n]       - Follow a job's output until it finishes\n");
+    printf("  bg [%%n]       - Continue a stopped job in the background\n");
+    printf("  wait [%%n]     - Wait for background jobs to finish\n");
     printf("  env           - Show environment variables\n");
     printf("  exit          - Exit sudosh\n");
     printf("  export        - Set or show environment variables\n");
@@ -387,7 +397,7 @@ void print_history(void) {
     }
 
     /* Build history file path */
-    snprintf(history_path, sizeof(history_path), "%s/.sudosh_history", pwd->pw_dir);
+    get_history_path(pwd->pw_dir, history_path, sizeof(history_path));
 
     /* Open history file */
     history_file = fopen(history_path, "r");
@@ -501,31 +511,27 @@ static char *expand_tilde_path(const char *path) {
  * Get current working directory for prompt with ~user expansion
  */
 static char *get_prompt_cwd(void) {
-    char *cwd = getcwd(NULL, 0);
+    /* Prefer the path resolved at the last directory change */
+    const char *stack_cwd = get_directory_stack_cwd();
+    char *cwd = stack_cwd ? safe_strdup(stack_cwd) : getcwd(NULL, 0);
     char *result;
-    struct passwd *pwd;
+    const struct target_credentials *cred;
     const char *effective_user;
 
     if (!cwd) {
         return safe_strdup("unknown");
     }
 
-    /* Determine which user's home directory to check */
-    if (target_user) {
-        effective_user = target_user;
-        pwd = getpwnam(target_user);
-    } else {
-        /* For root operations, check root's home directory */
-        effective_user = "root";
-        pwd = getpwnam("root");
-    }
+    /* Determine which user's home directory to check (root by default) */
+    effective_user = target_user ? target_user : "root";
+    cred = get_target_credentials(effective_user);
 
     /* If we can get the user's home directory, check if cwd is within it */
-    if (pwd && pwd->pw_dir) {
-        size_t home_len = strlen(pwd->pw_dir);
+    if (cred) {
+        size_t home_len = strlen(cred->home);
 
         /* Check if current directory is exactly the home directory */
-        if (strcmp(cwd, pwd->pw_dir) == 0) {
+        if (strcmp(cwd, cred->home) == 0) {
             result = malloc(strlen(effective_user) + 3); /* ~user + null */
             if (result) {
                 snprintf(result, strlen(effective_user) + 2, "~%s", effective_user);
@@ -534,7 +540,7 @@ static char *get_prompt_cwd(void) {
             }
         }
         /* Check if current directory is a subdirectory of home */
-        else if (strncmp(cwd, pwd->pw_dir, home_len) == 0 && cwd[home_len] == '/') {
+        else if (strncmp(cwd, cred->home, home_len) == 0 && cwd[home_len] == '/') {
             /* Replace home directory path with ~user */
             const char *subpath = cwd + home_len; /* Points to the '/' after home dir */
             result = malloc(strlen(effective_user) + strlen(subpath) + 2); /* ~user + subpath + null */
@@ -1337,6 +1343,32 @@ void print_path_info(void) {
     free(path_copy);
 }
 
+/* Session built-ins handled by handle_builtin_command(); aliases, command
+   lists, background jobs, type/which and completion all use this table */
+const char *const sudosh_builtins[] = {
+    "help", "commands", "history", "pwd", "path", "cd", "exit", "quit",
+    "rules", "version", "alias", "unalias", "export", "unset", "env",
+    "which", "type", "pushd", "popd", "dirs", "jobs", "fg", "bg", "wait", NULL
+};
+
+/**
+ * Return the built-in named by the first word of a command line, or NULL
+ */
+const char *builtin_command_name(const char *command_line) {
+    if (!command_line) {
+        return NULL;
+    }
+
+    size_t name_len = strcspn(command_line, " \t");
+    for (int i = 0; sudosh_builtins[i]; i++) {
+        if (strlen(sudosh_builtins[i]) == name_len &&
+            strncmp(command_line, sudosh_builtins[i], name_len) == 0) {
+            return sudosh_builtins[i];
+        }
+    }
+    return NULL;
+}
+
 /**
  * Check if command is a built-in command
  */
@@ -1423,8 +1455,10 @@ int handle_builtin_command(const char *command) {
             }
         }
 
-        if (chdir(expanded_dir) == 0) {
+        if (change_directory(expanded_dir)) {
             /* Successfully changed directory - silent operation per Unix philosophy */
+        } else if (strcmp(expanded_dir, "-") == 0 && errno == ENOENT) {
+            fprintf(stderr, "cd: OLDPWD not set\n");
         } else {
             fprintf(stderr, "cd: %s: %s\n", expanded_dir, strerror(errno));
         }
@@ -1516,6 +1550,24 @@ cd_cleanup:
     } else if (strcmp(token, "dirs") == 0) {
         print_dirs();
         handled = 1;
+    } else if (strcmp(token, "jobs") == 0) {
+        char *arg = strtok_r(NULL, " \t", &saveptr);
+        list_jobs(arg && strcmp(arg, "-l") == 0);
+        handled = 1;
+    } else if (strcmp(token, "fg") == 0) {
+        char *spec = strtok_r(NULL, " \t", &saveptr);
+        int status = foreground_job(spec);
+        last_exit_status = status < 0 ? 1 : status;
+        handled = 1;
+    } else if (strcmp(token, "bg") == 0) {
+        char *spec = strtok_r(NULL, " \t", &saveptr);
+        last_exit_status = resume_job_in_background(spec) == 0 ? 0 : 1;
+        handled = 1;
+    } else if (strcmp(token, "wait") == 0) {
+        char *spec = strtok_r(NULL, " \t", &saveptr);
+        int status = wait_for_jobs(spec);
+        last_exit_status = status < 0 ? 1 : status;
+        handled = 1;
     } else if (strcmp(token, "exit") == 0 || strcmp(token, "quit") == 0) {
         /* Silent exit per Unix philosophy */
         free(trimmed);
@@ -1606,8 +1658,11 @@ int is_whitespace_only(const char *str) {
 
 /**
  * Safe string copy
+ *
+ * The name is parenthesised so the accounting build's safe_strdup() macro
+ * leaves the definition alone.
  */
-char *safe_strdup(const char *str) {
+char *(safe_strdup)(const char *str) {
     char *copy;
 
     if (!str) {
@@ -1829,9 +1884,7 @@ char **complete_command(const char *text) {
     free(path_copy);
 
     /* Add built-in commands that match */
-    const char *builtins[] = {"help", "commands", "history", "pwd", "path", "cd", "exit", "quit",
-                              "alias", "unalias", "export", "unset", "env", "which", "type",
-                              "pushd", "popd", "dirs", "version", "rules", NULL};
+    const char *const *builtins = sudosh_builtins;
     for (int i = 0; builtins[i]; i++) {
         if (strncmp(builtins[i], text, text_len) == 0) {
             /* Check if we already have this command */
@@ -2913,6 +2966,29 @@ int get_terminal_height(void) {
  * Execute function with pager if output is too long
  */
 void execute_with_pager(void (*func)(const char*), const char *arg) {
-    /* For now, just execute directly - paging can be added later if needed */
+    if (!isatty(STDOUT_FILENO)) {
+        func(arg);
+        return;
+    }
+
+    /* Capture the output in an unlinked file, then page it if it is long */
+    FILE *spool = tmpfile();
+    int saved_stdout = dup(STDOUT_FILENO);
+    if (!spool || saved_stdout == -1) {
+        if (spool) fclose(spool);
+        if (saved_stdout != -1) close(saved_stdout);
+        func(arg);
+        return;
+    }
+
+    fflush(stdout);
+    dup2(fileno(spool), STDOUT_FILENO);
     func(arg);
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    rewind(spool);
+    run_pager(fileno(spool), NULL, PAGER_QUIT_IF_ONE_SCREEN);
+    fclose(spool);
 }
@@ -0,0 +1,819 @@
+/**
+ * watch.c - Live Session Observation
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * When session_watch is enabled, an interactive session publishes its
+ * activity (command lines, command output and exit statuses) as frames in
+ * a shared-memory ring: a root-only file in WATCH_DIR mapped by the session
+ * and, read-only, by any number of "sudosh --watch" observers.
+ *
+ * The session is the only writer and never waits for readers.  Frames are
+ * appended at 'head'; before bytes are overwritten 'tail' is advanced past
+ * the frames they held, so a reader copies a frame and then checks that
+ * 'tail' has not passed it (a seqlock-style validation) and resynchronises
+ * at 'tail' if it was lapped.  Observers hold a shared flock() on the ring
+ * while attached and sleep on a futex over the frame counter.
+ *
+ * Command output is only captured while someone is watching: at the start
+ * of each command the session tests for observers with a non-blocking
+ * flock(), and only then runs the command on a pty whose master side is
+ * relayed to the real terminal and into the ring.  Unwatched sessions pay
+ * one flock() per command line and a memcpy() per frame.
+ */
+
+#include "sudosh.h"
+
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#define WATCH_RING_MAGIC 0x53445752u   /* "SDWR" */
+#define WATCH_RING_VERSION 1
+#define WATCH_HEADER_SIZE 4096          /* Frame data starts on its own page */
+#define WATCH_FRAME_ALIGN 16
+#define WATCH_FRAME_PAD 0               /* Fills the end of the ring before a wrap */
+#define WATCH_DRAIN_MS 50               /* Relay idle time allowed once a command ends */
+
+/* Shared ring header; head, tail, seq and closed are accessed atomically */
+struct watch_ring_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;      /* Frame data bytes, a power of two */
+    int32_t pid;
+    uint32_t closed;        /* Set once the session has ended */
+    int64_t started;
+    uint64_t head;          /* Bytes published; frames end here */
+    uint64_t tail;          /* Oldest frame that is still intact */
+    uint32_t seq;           /* Futex word, bumped for every frame */
+    uint32_t reserved;
+    char username[64];
+    char target[64];
+    char tty[64];
+};
+
+struct watch_frame_header {
+    uint32_t length;        /* Payload bytes */
+    uint16_t type;
+    uint16_t flags;
+    int64_t usec;           /* Wall-clock time the frame was written */
+};
+
+/* Writer state: one ring per session process */
+static int ring_fd = -1;
+static struct watch_ring_header *ring = NULL;
+static size_t ring_map_size = 0;
+static char ring_path[PATH_MAX];
+static int ring_watched = 0;
+
+/* Output relay for the command currently being mirrored */
+static pid_t relay_pid = -1;
+static int relay_control_fd = -1;
+static int saved_stdout_fd = -1;
+static int saved_stderr_fd = -1;
+
+/**
+ * Directory holding session rings (overridable in test mode only)
+ */
+static const char *watch_dir(void) {
+    extern int test_mode;
+    const char *override = getenv("SUDOSH_WATCH_DIR");
+
+    if (test_mode && override && *override) {
+        return override;
+    }
+    return WATCH_DIR;
+}
+
+static size_t frame_span(uint32_t length) {
+    return (sizeof(struct watch_frame_header) + length + WATCH_FRAME_ALIGN - 1) &
+           ~(size_t)(WATCH_FRAME_ALIGN - 1);
+}
+
+static unsigned char *ring_data(const struct watch_ring_header *header) {
+    return (unsigned char *)header + WATCH_HEADER_SIZE;
+}
+
+static long long realtime_usec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/**
+ * Wake observers sleeping on the frame counter
+ */
+static void wake_watchers(void) {
+#ifdef __linux__
+    syscall(SYS_futex, &ring->seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+/**
+ * Check whether any observer currently holds the ring
+ */
+static int ring_has_watchers(void) {
+    if (flock(ring_fd, LOCK_EX | LOCK_NB) == 0) {
+        flock(ring_fd, LOCK_UN);
+        return 0;
+    }
+    return errno == EWOULDBLOCK;
+}
+
+/**
+ * Bytes occupied in the ring by the frame starting at pos
+ */
+static uint64_t ring_frame_size(uint64_t pos) {
+    uint64_t offset = pos & (ring->capacity - 1);
+    struct watch_frame_header frame;
+
+    memcpy(&frame, ring_data(ring) + offset, sizeof(frame));
+    if (frame.type == WATCH_FRAME_PAD) {
+        return ring->capacity - offset;
+    }
+    return frame_span(frame.length);
+}
+
+/**
+ * Retire the oldest frames until bytes [head, head + size) can be written
+ */
+static void ring_reserve(uint64_t head, uint64_t size) {
+    uint64_t tail = ring->tail;
+    uint64_t new_tail = tail;
+
+    while (head + size - new_tail > ring->capacity) {
+        new_tail += ring_frame_size(new_tail);
+    }
+    if (new_tail != tail) {
+        /* Readers must see the frames retired before their bytes change */
+        __atomic_store_n(&ring->tail, new_tail, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+}
+
+/**
+ * Append one frame of at most WATCH_MAX_FRAME bytes
+ */
+static void ring_append(int type, const void *data, uint32_t length) {
+    struct watch_frame_header frame = { length, (uint16_t)type, 0, realtime_usec() };
+    uint64_t head = ring->head;
+    uint64_t offset = head & (ring->capacity - 1);
+    uint64_t size = frame_span(length);
+
+    /* Frames never straddle the end of the ring */
+    if (ring->capacity - offset < size) {
+        struct watch_frame_header pad = { 0, WATCH_FRAME_PAD, 0, frame.usec };
+        ring_reserve(head, ring->capacity - offset);
+        memcpy(ring_data(ring) + offset, &pad, sizeof(pad));
+        head += ring->capacity - offset;
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+        offset = 0;
+    }
+
+    ring_reserve(head, size);
+    memcpy(ring_data(ring) + offset, &frame, sizeof(frame));
+    if (length > 0) {
+        memcpy(ring_data(ring) + offset + sizeof(frame), data, length);
+    }
+    __atomic_store_n(&ring->head, head + size, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&ring->seq, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Publish data to the session's ring, splitting it into frames as needed
+ *
+ * Returns 0 on success, -1 if the session has no ring.
+ */
+int watch_publish(int type, const void *data, size_t length) {
+    const unsigned char *bytes = data;
+
+    if (!ring) {
+        return -1;
+    }
+    do {
+        uint32_t chunk = length > WATCH_MAX_FRAME ? WATCH_MAX_FRAME : (uint32_t)length;
+        ring_append(type, bytes, chunk);
+        bytes += chunk;
+        length -= chunk;
+    } while (length > 0);
+
+    if (ring_watched) {
+        wake_watchers();
+    }
+    return 0;
+}
+
+/**
+ * Create the session's ring; called once an interactive session has started
+ *
+ * Returns 0 on success, -1 if the ring could not be created (the session
+ * continues unobservable).
+ */
+int watch_session_start(const char *username, const char *target) {
+    const char *dir = watch_dir();
+    struct stat st;
+
+    if (ring) {
+        return 0;
+    }
+    if (strcmp(dir, WATCH_DIR) == 0) {
+        mkdir(AUTH_CACHE_DIR, 0700);
+    }
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        syslog(LOG_WARNING, "WATCH_RING: cannot create %s: %m", dir);
+        return -1;
+    }
+
+    snprintf(ring_path, sizeof(ring_path), "%s/session-%d", dir, (int)getpid());
+    unlink(ring_path);  /* Left behind by an earlier process with this pid */
+
+    ring_map_size = WATCH_HEADER_SIZE + WATCH_RING_SIZE;
+    ring_fd = open(ring_path, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (ring_fd == -1 || fstat(ring_fd, &st) != 0 || ftruncate(ring_fd, (off_t)ring_map_size) != 0) {
+        syslog(LOG_WARNING, "WATCH_RING: cannot create %s: %m", ring_path);
+        if (ring_fd != -1) {
+            close(ring_fd);
+            unlink(ring_path);
+            ring_fd = -1;
+        }
+        return -1;
+    }
+
+    void *map = mmap(NULL, ring_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring_fd, 0);
+    if (map == MAP_FAILED) {
+        syslog(LOG_WARNING, "WATCH_RING: cannot map %s: %m", ring_path);
+        close(ring_fd);
+        unlink(ring_path);
+        ring_fd = -1;
+        return -1;
+    }
+
+    ring = map;
+    ring->version = WATCH_RING_VERSION;
+    ring->capacity = WATCH_RING_SIZE;
+    ring->pid = (int32_t)getpid();
+    ring->started = (int64_t)time(NULL);
+    snprintf(ring->username, sizeof(ring->username), "%s", username ? username : "unknown");
+    snprintf(ring->target, sizeof(ring->target), "%s", target ? target : "root");
+    const char *tty = ttyname(STDIN_FILENO);
+    snprintf(ring->tty, sizeof(ring->tty), "%s", tty ? tty : "none");
+    __atomic_store_n(&ring->magic, WATCH_RING_MAGIC, __ATOMIC_RELEASE);
+
+    syslog(LOG_INFO, "WATCH_RING: session=%d user=%s path=%s", ring->pid, ring->username, ring_path);
+    return 0;
+}
+
+/**
+ * Mark the ring closed, wake observers and remove it
+ */
+void watch_session_end(void) {
+    if (!ring) {
+        return;
+    }
+    watch_publish(WATCH_FRAME_EVENT, "session ended", strlen("session ended"));
+    __atomic_store_n(&ring->closed, 1, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&ring->seq, 1, __ATOMIC_RELEASE);
+    wake_watchers();
+
+    /* Attached observers keep their mapping and drain what is left */
+    unlink(ring_path);
+    munmap(ring, ring_map_size);
+    close(ring_fd);
+    ring = NULL;
+    ring_fd = -1;
+}
+
+/**
+ * Publish a command line typed in the session
+ */
+void watch_record_input(const char *line) {
+    if (!ring || !line) {
+        return;
+    }
+    ring_watched = ring_has_watchers();
+    watch_publish(WATCH_FRAME_INPUT, line, strlen(line));
+}
+
+/**
+ * Check whether a command takes over the terminal and cannot be mirrored
+ */
+static int is_full_screen_command(const char *command_line) {
+    static const char *full_screen[] = { "top", "htop", "atop", "iotop", "watch", NULL };
+    size_t name_len = strcspn(command_line, " \t");
+    const char *name = command_line;
+
+    for (size_t i = 0; i < name_len; i++) {
+        if (command_line[i] == '/') {
+            name = command_line + i + 1;
+        }
+    }
+    name_len -= (size_t)(name - command_line);
+    for (int i = 0; full_screen[i]; i++) {
+        if (strlen(full_screen[i]) == name_len && strncmp(name, full_screen[i], name_len) == 0) {
+            return 1;
+        }
+    }
+    return is_editing_command(command_line) || is_secure_pager(command_line);
+}
+
+/**
+ * Write a buffer completely, retrying on short writes
+ */
+static void write_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+}
+
+/**
+ * Relay process: copy pty output to the terminal and into the ring
+ *
+ * Runs until the session closes the control pipe, then drains whatever
+ * the command left in the pty and exits.
+ */
+static void run_output_relay(int master, int terminal, int control) {
+    char buf[WATCH_MAX_FRAME];
+    int draining = 0;
+
+    signal(SIGINT, SIG_IGN);
+    signal(SIGQUIT, SIG_IGN);
+    signal(SIGTSTP, SIG_IGN);
+
+    for (;;) {
+        struct pollfd fds[2] = { { master, POLLIN, 0 }, { control, POLLIN, 0 } };
+        int ready = poll(fds, draining ? 1 : 2, draining ? WATCH_DRAIN_MS : -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (ready == 0) {
+            break;  /* Drained, or a leftover process is still holding the pty */
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t n = read(master, buf, sizeof(buf));
+            if (n > 0) {
+                write_all(terminal, buf, (size_t)n);
+                watch_publish(WATCH_FRAME_OUTPUT, buf, (size_t)n);
+            } else if (n == 0 || errno != EINTR) {
+                break;  /* EIO: every slave descriptor is closed */
+            }
+        }
+        if (!draining && (fds[1].revents & (POLLIN | POLLHUP))) {
+            draining = 1;
+        }
+    }
+}
+
+/**
+ * Open a pty whose slave side mimics the session's terminal
+ */
+static int open_mirror_pty(int *master_out, int *slave_out) {
+    struct termios tio;
+    struct winsize ws;
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master == -1) {
+        return -1;
+    }
+    fcntl(master, F_SETFD, FD_CLOEXEC);
+    char *name = (grantpt(master) == 0 && unlockpt(master) == 0) ? ptsname(master) : NULL;
+    int slave = name ? open(name, O_RDWR | O_NOCTTY | O_CLOEXEC) : -1;
+    if (slave == -1) {
+        close(master);
+        return -1;
+    }
+
+    if (tcgetattr(STDOUT_FILENO, &tio) == 0) {
+        tcsetattr(slave, TCSANOW, &tio);
+    }
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0) {
+        ioctl(slave, TIOCSWINSZ, &ws);
+    }
+
+    *master_out = master;
+    *slave_out = slave;
+    return 0;
+}
+
+/**
+ * Start mirroring a command's output if the session is being watched
+ *
+ * While mirroring, stdout and stderr point at a pty relayed to the real
+ * terminal and the ring; watch_end_output() restores them.  Returns 1 if
+ * output is being mirrored, 0 otherwise.
+ */
+int watch_begin_output(const char *command_line) {
+    int master, slave, control[2];
+
+    if (!ring || !ring_watched || !command_line || !isatty(STDOUT_FILENO)) {
+        return 0;
+    }
+    if (is_full_screen_command(command_line)) {
+        const char *note = "interactive command output is not mirrored";
+        watch_publish(WATCH_FRAME_EVENT, note, strlen(note));
+        return 0;
+    }
+    if (open_mirror_pty(&master, &slave) != 0) {
+        syslog(LOG_WARNING, "WATCH_RING: cannot open pty for mirroring: %m");
+        return 0;
+    }
+    if (pipe(control) != 0) {
+        close(master);
+        close(slave);
+        return 0;
+    }
+    fcntl(control[0], F_SETFD, FD_CLOEXEC);
+    fcntl(control[1], F_SETFD, FD_CLOEXEC);
+
+    fflush(stdout);
+    fflush(stderr);
+    saved_stdout_fd = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 3);
+    saved_stderr_fd = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 3);
+
+    relay_pid = fork();
+    if (relay_pid == 0) {
+        close(slave);
+        close(control[1]);
+        run_output_relay(master, saved_stdout_fd, control[0]);
+        _exit(0);
+    }
+    close(master);
+    close(control[0]);
+    if (relay_pid < 0 || saved_stdout_fd == -1 || saved_stderr_fd == -1) {
+        close(slave);
+        close(control[1]);
+        if (saved_stdout_fd != -1) close(saved_stdout_fd);
+        if (saved_stderr_fd != -1) close(saved_stderr_fd);
+        saved_stdout_fd = saved_stderr_fd = -1;
+        relay_pid = -1;
+        return 0;
+    }
+
+    dup2(slave, STDOUT_FILENO);
+    dup2(slave, STDERR_FILENO);
+    close(slave);
+    relay_control_fd = control[1];
+    return 1;
+}
+
+/**
+ * Finish a command: restore the terminal if it was mirrored and publish
+ * its exit status
+ */
+void watch_end_output(int status) {
+    if (!ring) {
+        return;
+    }
+
+    if (relay_pid > 0) {
+        fflush(stdout);
+        fflush(stderr);
+        dup2(saved_stdout_fd, STDOUT_FILENO);
+        dup2(saved_stderr_fd, STDERR_FILENO);
+        close(saved_stdout_fd);
+        close(saved_stderr_fd);
+        close(relay_control_fd);
+        saved_stdout_fd = saved_stderr_fd = relay_control_fd = -1;
+
+        /* The relay is the only writer until it exits */
+        while (waitpid(relay_pid, NULL, 0) == -1 && errno == EINTR) {
+        }
+        relay_pid = -1;
+    }
+
+    char event[64];
+    snprintf(event, sizeof(event), "exit status %d", status);
+    watch_publish(WATCH_FRAME_EVENT, event, strlen(event));
+}
+
+/**
+ * Check that a ring file was created by a session and not planted
+ */
+static int watch_ring_trusted(int fd, size_t *size) {
+    extern int test_mode;
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return 0;
+    }
+    if (st.st_uid != (test_mode ? geteuid() : 0) || (st.st_mode & (S_IRWXG | S_IRWXO))) {
+        return 0;
+    }
+    if ((size_t)st.st_size < WATCH_HEADER_SIZE + WATCH_FRAME_ALIGN) {
+        return 0;
+    }
+    *size = (size_t)st.st_size;
+    return 1;
+}
+
+/**
+ * Attach to a session's ring read-only
+ *
+ * The reader starts at the oldest frame still held, so recent history is
+ * replayed before live output.  Returns 0 on success, -1 with errno set.
+ */
+int watch_open(pid_t session, struct watch_reader *reader) {
+    char path[PATH_MAX];
+    size_t size = 0;
+
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+    snprintf(path, sizeof(path), "%s/session-%d", watch_dir(), (int)session);
+
+    int fd = open(path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    if (!watch_ring_trusted(fd, &size)) {
+        close(fd);
+        errno = EPERM;
+        return -1;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+
+    const struct watch_ring_header *header = map;
+    uint64_t capacity = header->capacity;
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != WATCH_RING_MAGIC ||
+        header->version != WATCH_RING_VERSION || capacity == 0 ||
+        (capacity & (capacity - 1)) != 0 || capacity != size - WATCH_HEADER_SIZE) {
+        munmap(map, size);
+        close(fd);
+        errno = EPROTO;
+        return -1;
+    }
+
+    /* Observers hold a shared lock; the session tests for it to decide whether to mirror */
+    flock(fd, LOCK_SH);
+
+    reader->fd = fd;
+    reader->map = map;
+    reader->map_size = size;
+    reader->pid = session;
+    reader->pos = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE);
+    return 0;
+}
+
+/**
+ * Read the next frame from a session's ring
+ *
+ * Copies up to size bytes of payload into buf.  Returns 1 when a frame was
+ * read, 0 when none is available yet and -1 when the session has ended and
+ * every frame has been read (or the ring is corrupt).  Bytes lost because
+ * the writer lapped the reader are added to reader->lost.
+ */
+int watch_read_frame(struct watch_reader *reader, int *type, char *buf, size_t size,
+                     size_t *length, long long *usec) {
+    const struct watch_ring_header *header = reader->map;
+    const unsigned char *data = ring_data(header);
+    uint64_t capacity = header->capacity;
+
+    for (;;) {
+        int closed = __atomic_load_n(&header->closed, __ATOMIC_ACQUIRE);
+        uint64_t head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+        if (reader->pos >= head) {
+            return closed ? -1 : 0;
+        }
+
+        uint64_t tail = __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE);
+        if (reader->pos < tail) {
+            reader->lost += tail - reader->pos;
+            reader->pos = tail;
+            continue;
+        }
+
+        uint64_t offset = reader->pos & (capacity - 1);
+        struct watch_frame_header frame;
+        memcpy(&frame, data + offset, sizeof(frame));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (reader->pos < __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE)) {
+            continue;  /* Overwritten while copying */
+        }
+
+        if (frame.type == WATCH_FRAME_PAD) {
+            reader->pos += capacity - offset;
+            continue;
+        }
+        if (frame.length > WATCH_MAX_FRAME || frame_span(frame.length) > capacity - offset) {
+            errno = EPROTO;
+            return -1;
+        }
+
+        size_t n = frame.length < size ? frame.length : size;
+        memcpy(buf, data + offset + sizeof(frame), n);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (reader->pos < __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+
+        *type = frame.type;
+        *length = n;
+        if (usec) {
+            *usec = frame.usec;
+        }
+        reader->pos += frame_span(frame.length);
+        return 1;
+    }
+}
+
+/**
+ * Sleep until the session publishes a frame or timeout_ms passes
+ */
+void watch_wait(struct watch_reader *reader, int timeout_ms) {
+    const struct watch_ring_header *header = reader->map;
+    uint32_t seq = __atomic_load_n(&header->seq, __ATOMIC_ACQUIRE);
+
+    if (reader->pos < __atomic_load_n(&header->head, __ATOMIC_ACQUIRE) ||
+        __atomic_load_n(&header->closed, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+#ifdef __linux__
+    struct timespec ts = { timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L };
+    syscall(SYS_futex, &header->seq, FUTEX_WAIT, seq, &ts, NULL, 0);
+#else
+    (void)seq;
+    usleep(1000);
+#endif
+}
+
+/**
+ * Detach from a session's ring
+ */
+void watch_close(struct watch_reader *reader) {
+    if (reader->map) {
+        munmap(reader->map, reader->map_size);
+        reader->map = NULL;
+    }
+    if (reader->fd != -1) {
+        close(reader->fd);  /* Releases the observer lock */
+        reader->fd = -1;
+    }
+}
+
+static volatile sig_atomic_t watch_stop = 0;
+
+static void watch_stop_handler(int sig) {
+    (void)sig;
+    watch_stop = 1;
+}
+
+/**
+ * List sessions that can be watched
+ */
+static int list_watch_sessions(void) {
+    DIR *dir = opendir(watch_dir());
+    struct dirent *entry;
+    int found = 0;
+
+    if (!dir) {
+        printf("No watchable sessions.\n");
+        return EXIT_SUCCESS;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        struct watch_reader reader;
+        char started[32];
+        int pid;
+
+        if (sscanf(entry->d_name, "session-%d", &pid) != 1 || pid <= 0) {
+            continue;
+        }
+        if (kill(pid, 0) != 0 && errno == ESRCH) {
+            continue;  /* Session crashed before removing its ring */
+        }
+        if (watch_open(pid, &reader) != 0) {
+            continue;
+        }
+        const struct watch_ring_header *header = reader.map;
+        if (!__atomic_load_n(&header->closed, __ATOMIC_ACQUIRE)) {
+            time_t when = (time_t)header->started;
+            strftime(started, sizeof(started), "%Y-%m-%d %H:%M:%S", localtime(&when));
+            if (!found) {
+                printf("%-8s %-16s %-16s %-14s %s\n", "SESSION", "USER", "RUNAS", "TTY", "STARTED");
+            }
+            printf("%-8d %-16s %-16s %-14s %s\n", pid, header->username, header->target,
+                   header->tty, started);
+            found++;
+        }
+        watch_close(&reader);
+    }
+    closedir(dir);
+
+    if (!found) {
+        printf("No watchable sessions.\n");
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Print one frame for an observer
+ */
+static void render_frame(int type, const char *buf, size_t length, long long usec, const char *user) {
+    char stamp[16];
+    time_t when = (time_t)(usec / 1000000LL);
+
+    strftime(stamp, sizeof(stamp), "%H:%M:%S", localtime(&when));
+    if (type == WATCH_FRAME_OUTPUT) {
+        fwrite(buf, 1, length, stdout);
+    } else if (type == WATCH_FRAME_INPUT) {
+        printf("[%s] %s$ %.*s\n", stamp, user, (int)length, buf);
+    } else if (type == WATCH_FRAME_EVENT) {
+        printf("[%s] (%.*s)\n", stamp, (int)length, buf);
+    }
+    fflush(stdout);
+}
+
+/**
+ * Implement "sudosh --watch [SESSION]": follow a session live, or list
+ * sessions when no session is given
+ */
+int watch_session_command(const char *session_arg) {
+    extern int test_mode;
+    struct watch_reader reader;
+    char buf[WATCH_MAX_FRAME];
+    char user[64];
+    char *end = NULL;
+
+    if (!test_mode && getuid() != 0) {
+        fprintf(stderr, "sudosh: --watch may only be used by root\n");
+        syslog(LOG_WARNING, "WATCH_DENIED: uid=%d", (int)getuid());
+        return EXIT_FAILURE;
+    }
+    if (!session_arg) {
+        return list_watch_sessions();
+    }
+
+    long pid = strtol(session_arg, &end, 10);
+    if (!end || *end != '\0' || pid <= 0 || pid > INT_MAX) {
+        fprintf(stderr, "sudosh: invalid session id '%s'\n", session_arg);
+        return EXIT_FAILURE;
+    }
+    if (watch_open((pid_t)pid, &reader) != 0) {
+        fprintf(stderr, "sudosh: cannot watch session %ld: %s\n", pid,
+                errno == ENOENT ? "no such session" : strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    const struct watch_ring_header *header = reader.map;
+    snprintf(user, sizeof(user), "%s", header->username);
+    printf("sudosh: watching session %ld (%s on %s); press Ctrl-C to stop\n", pid, user, header->tty);
+    fflush(stdout);
+    syslog(LOG_NOTICE, "WATCH_ATTACH: observer_uid=%d session=%ld user=%s",
+           (int)getuid(), pid, user);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = watch_stop_handler;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    uint64_t reported_lost = 0;
+    int ended = 0;
+    while (!watch_stop) {
+        int type;
+        size_t length;
+        long long usec;
+        int r = watch_read_frame(&reader, &type, buf, sizeof(buf), &length, &usec);
+
+        if (reader.lost != reported_lost) {
+            printf("\n[sudosh: %llu bytes of session activity skipped]\n",
+                   (unsigned long long)(reader.lost - reported_lost));
+            reported_lost = reader.lost;
+        }
+        if (r == 1) {
+            render_frame(type, buf, length, usec, user);
+        } else if (r == 0) {
+            watch_wait(&reader, 250);
+        } else {
+            ended = 1;
+            break;
+        }
+    }
+
+    printf("\nsudosh: %s watching session %ld\n", ended ? "session ended;" : "stopped", pid);
+    syslog(LOG_NOTICE, "WATCH_DETACH: observer_uid=%d session=%ld", (int)getuid(), pid);
+    watch_close(&reader);
+    return EXIT_SUCCESS;
+}
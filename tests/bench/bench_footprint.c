@@ -0,0 +1,344 @@
+/**
+ * bench_footprint.c - Per-session memory footprint of the sudoers policy
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * Starts N sessions at once against a generated sudoers policy of R rules
+ * and, while every session holds its policy, reads each one's
+ * /proc/self/smaps_rollup.  It does this three times: with no policy
+ * loaded (the baseline), with each session parsing sudoers privately, and
+ * with the sessions mapping the shared compiled policy image, and reports
+ * per-session private and proportional (PSS) memory for each.  The
+ * private-memory difference between the last two rows is what every
+ * additional session saves.
+ *
+ * Sessions are forked from a parent that never loads the policy itself,
+ * so nothing is shared copy-on-write behind the measurement's back.  The
+ * fake root (test mode) holds SUDOSH_SUDOERS_PATH, SUDOSH_SUDOERS_DIR and
+ * SUDOSH_POLICY_IMAGE.
+ *
+ *     make bench-footprint
+ *     bin/bench_footprint -n 16 -r 20000
+ */
+
+#include "sudosh.h"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+enum mode {
+    MODE_BASELINE,          /* Sessions do not load the policy */
+    MODE_PRIVATE,           /* Each session parses and compiles its own copy */
+    MODE_SHARED,            /* Sessions map the published image */
+    MODE_COUNT
+};
+
+static const char *const mode_names[MODE_COUNT] = { "baseline", "private", "shared" };
+
+/* What a session measured, in kB except for the image */
+struct footprint {
+    long rss;
+    long pss;
+    long private_kb;        /* Private_Clean + Private_Dirty */
+    long image_bytes;
+    int mapped;
+    int ok;
+};
+
+/* Options */
+static int sessions = 8;
+static int rules = 10000;
+static int keep_root = 0;
+
+static char fake_root[64];         /* Holds the mkdtemp() template */
+static char image_path[PATH_MAX];
+static const char *username;
+
+static struct footprint *results;      /* One per session, shared with the parent */
+
+/**
+ * Write the generated policy: R rules over several users, hosts and
+ * commands, split between sudoers and one included file (no %groups, so
+ * the checks measure the policy rather than group lookups)
+ */
+static int write_policy(void) {
+    char path[PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s/sudoers.d", fake_root);
+    if (mkdir(path, 0700) != 0) {
+        return -1;
+    }
+    setenv("SUDOSH_SUDOERS_DIR", path, 1);
+
+    for (int part = 0; part < 2; part++) {
+        if (part == 0) {
+            snprintf(path, sizeof(path), "%s/sudoers", fake_root);
+            setenv("SUDOSH_SUDOERS_PATH", path, 1);
+        } else {
+            snprintf(path, sizeof(path), "%s/sudoers.d/generated", fake_root);
+        }
+        FILE *f = fopen(path, "w");
+        if (!f) {
+            return -1;
+        }
+        if (part == 0) {
+            fprintf(f, "root ALL=(ALL:ALL) ALL\n%s ALL=(root) /usr/bin/id\n", username);
+        }
+        for (int i = part; i < rules; i += 2) {
+            fprintf(f, "svc%05d,ops%03d web%03d,db%03d=(app%02d) NOPASSWD: "
+                    "/usr/local/bin/deploy-%05d, /usr/bin/systemctl restart unit%05d, /opt/tools/bin/report%03d\n",
+                    i, i % 500, i % 100, i % 50, i % 20, i, i, i % 300);
+        }
+        fclose(f);
+        chmod(path, 0600);
+    }
+    return 0;
+}
+
+/**
+ * Remove the fake root
+ */
+static void remove_fake_root(void) {
+    char command[PATH_MAX + 16];
+
+    if (keep_root) {
+        printf("fake root kept at %s\n", fake_root);
+        return;
+    }
+    snprintf(command, sizeof(command), "rm -rf '%s'", fake_root);
+    if (system(command) != 0) {
+        fprintf(stderr, "bench_footprint: could not remove %s\n", fake_root);
+    }
+}
+
+/**
+ * Read this process's memory totals from /proc/self/smaps_rollup
+ */
+static int read_rollup(struct footprint *out) {
+    char line[256];
+    long value;
+    FILE *f = fopen("/proc/self/smaps_rollup", "r");
+
+    if (!f) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "Rss: %ld kB", &value) == 1) {
+            out->rss = value;
+        } else if (sscanf(line, "Pss: %ld kB", &value) == 1) {
+            out->pss = value;
+        } else if (sscanf(line, "Private_Clean: %ld kB", &value) == 1 ||
+                   sscanf(line, "Private_Dirty: %ld kB", &value) == 1) {
+            out->private_kb += value;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+/**
+ * One session: load the policy, answer questions that visit every rule,
+ * then hold it until the parent says every session is loaded
+ */
+static void run_session(int session, enum mode mode, int ready_fd, int measure_fd) {
+    struct footprint *mine = &results[session];
+    struct sudoers_config *config = NULL;
+    char go;
+
+    if (mode != MODE_BASELINE) {
+        config = parse_sudoers_file(NULL);
+        if (!config) {
+            _exit(1);
+        }
+        /* No rule allows this, so every rule is looked at */
+        check_sudoers_command_permission(username, "localhost", "/usr/bin/nothing", config);
+        check_sudoers_privileges("svc09999", "web099", config);
+        mine->image_bytes = (long)policy_image_size(config);
+        mine->mapped = config->mapping != NULL;
+    }
+
+    if (write(ready_fd, "r", 1) != 1 || read(measure_fd, &go, 1) < 0) {
+        _exit(2);
+    }
+    mine->ok = read_rollup(mine) == 0;
+    free_sudoers_config(config);
+    _exit(mine->ok ? 0 : 3);
+}
+
+/**
+ * Run every session in one mode and print its row
+ */
+static int run_mode(enum mode mode, double *private_kb) {
+    int ready_pipe[2], measure_pipe[2];
+    pid_t *pids = calloc((size_t)sessions, sizeof(pid_t));
+    int failed = 0;
+
+    if (!pids || pipe(ready_pipe) != 0 || pipe(measure_pipe) != 0) {
+        free(pids);
+        return -1;
+    }
+    memset(results, 0, (size_t)sessions * sizeof(*results));
+
+    for (int s = 0; s < sessions; s++) {
+        pids[s] = fork();
+        if (pids[s] == 0) {
+            close(ready_pipe[0]);
+            close(measure_pipe[1]);
+            run_session(s, mode, ready_pipe[1], measure_pipe[0]);
+        }
+        if (pids[s] < 0) {
+            perror("fork");
+            sessions = s;
+            failed = 1;
+            break;
+        }
+    }
+    close(ready_pipe[1]);
+    close(measure_pipe[0]);
+
+    /* Measure only once every session holds its policy */
+    char byte;
+    for (int s = 0; s < sessions; s++) {
+        if (read(ready_pipe[0], &byte, 1) != 1) {
+            failed = 1;
+            break;
+        }
+    }
+    close(ready_pipe[0]);
+    close(measure_pipe[1]);
+    for (int s = 0; s < sessions; s++) {
+        int status;
+        if (waitpid(pids[s], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed = 1;
+        }
+    }
+    free(pids);
+
+    double rss = 0, pss = 0, priv = 0;
+    int mapped = 0;
+    for (int s = 0; s < sessions; s++) {
+        rss += (double)results[s].rss;
+        pss += (double)results[s].pss;
+        priv += (double)results[s].private_kb;
+        mapped += results[s].mapped;
+    }
+    rss /= sessions;
+    pss /= sessions;
+    priv /= sessions;
+    *private_kb = priv;
+
+    printf("%-9s %8d %10.0f %10.0f %12.0f %12.1f %7d%s\n", mode_names[mode], sessions, rss, pss, priv,
+           (double)results[0].image_bytes / 1024.0, mapped, failed ? "  (session failed)" : "");
+    fflush(stdout);
+    return failed ? -1 : 0;
+}
+
+/**
+ * Publish the image from a throwaway session, as the first real one would
+ */
+static int prime_image(void) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        struct sudoers_config *config = parse_sudoers_file(NULL);
+        _exit(config && config->mapping ? 0 : 1);
+    }
+    int status;
+    return (pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+            WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: bench_footprint [-n SESSIONS] [-r RULES] [-k]\n"
+            "  -n  concurrent sessions (default 8)\n"
+            "  -r  sudoers rules to generate (default 10000)\n"
+            "  -k  keep the fake root for inspection\n");
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    int result = 0;
+    double private_kb[MODE_COUNT] = { 0 };
+
+    while ((opt = getopt(argc, argv, "n:r:kh")) != -1) {
+        switch (opt) {
+        case 'n':
+            sessions = atoi(optarg);
+            break;
+        case 'r':
+            rules = atoi(optarg);
+            break;
+        case 'k':
+            keep_root = 1;
+            break;
+        default:
+            usage();
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (sessions <= 0 || sessions > 4096 || rules < 0) {
+        usage();
+        return 2;
+    }
+    if (access("/proc/self/smaps_rollup", R_OK) != 0) {
+        fprintf(stderr, "bench_footprint: /proc/self/smaps_rollup not available\n");
+        return 1;
+    }
+
+    test_mode = 1;
+    setenv("SUDOSH_TEST_MODE", "1", 1);
+    struct passwd *pwd = getpwuid(getuid());
+    if (!pwd) {
+        fprintf(stderr, "bench_footprint: unknown uid\n");
+        return 1;
+    }
+    username = safe_strdup(pwd->pw_name);
+    setenv("USER", username, 1);
+
+    snprintf(fake_root, sizeof(fake_root), "/tmp/sudosh-footprint.XXXXXX");
+    if (!mkdtemp(fake_root)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    if (write_policy() != 0) {
+        perror("write policy");
+        remove_fake_root();
+        return 1;
+    }
+    snprintf(image_path, sizeof(image_path), "%s/policy", fake_root);
+
+    results = mmap(NULL, (size_t)sessions * sizeof(*results), PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED) {
+        perror("mmap");
+        remove_fake_root();
+        return 1;
+    }
+
+    /* Just-written inputs are not published until they are settled */
+    sleep(2);
+
+    printf("sudoers rules: %d, sessions: %d\n", rules, sessions);
+    printf("%-9s %8s %10s %10s %12s %12s %7s\n", "mode", "sessions", "rss_kB", "pss_kB",
+           "private_kB", "image_kB", "mapped");
+    if (run_mode(MODE_BASELINE, &private_kb[MODE_BASELINE]) != 0 ||
+        run_mode(MODE_PRIVATE, &private_kb[MODE_PRIVATE]) != 0) {
+        result = 1;
+    }
+    setenv("SUDOSH_POLICY_IMAGE", image_path, 1);
+    if (prime_image() != 0) {
+        fprintf(stderr, "bench_footprint: policy image not published\n");
+        result = 1;
+    } else if (run_mode(MODE_SHARED, &private_kb[MODE_SHARED]) != 0) {
+        result = 1;
+    }
+
+    double policy_private = private_kb[MODE_PRIVATE] - private_kb[MODE_BASELINE];
+    double policy_shared = private_kb[MODE_SHARED] - private_kb[MODE_BASELINE];
+    printf("policy private memory per session: %.0f kB private, %.0f kB shared image (%.0f kB saved per session)\n",
+           policy_private, policy_shared, policy_private - policy_shared);
+
+    munmap(results, (size_t)sessions * sizeof(*results));
+    remove_fake_root();
+    return result;
+}
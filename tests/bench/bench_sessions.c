@@ -0,0 +1,506 @@
+/**
+ * bench_sessions.c - Concurrent session scalability harness
+ *
+ * Author: Branson Matheson <branson@sandsite.org>
+ *
+ * Runs N scripted sudosh sessions at once, for a series of N, and reports
+ * command throughput and command latency percentiles for each.  Every
+ * session is a forked process that goes through the same steps as the
+ * interactive loop in main.c for each command line (history, aliases,
+ * validation, sudoers check, parsing, cached authentication, audit and
+ * syslog logging, and every few lines an editor file lock), so the
+ * sessions contend on exactly what real ones share: the auth cache
+ * directory, the lock directory, the user's history file, the audit
+ * journal, the metrics segment and syslog.
+ *
+ * Everything lives under a private fake root (test mode, MOCK_AUTH):
+ * SUDOSH_SUDOERS_PATH, SUDOSH_AUTH_CACHE_DIR, SUDOSH_LOCK_DIR,
+ * SUDOSH_HISTORY_FILE, SUDOSH_AUDIT_LOG and SUDOSH_METRICS_FILE all point
+ * into it.  Commands are not executed unless -x is given, so the numbers
+ * are sudosh's own cost rather than fork/exec.
+ *
+ *     make bench-sessions
+ *     bin/bench_sessions -n 1,2,4,8,16,32,64 -c 200
+ */
+
+#include "sudosh.h"
+
+#include <sys/mman.h>
+#include <sys/time.h>
+
+/* Command lines each session cycles through */
+static const char *script[] = {
+    "ls -la /tmp",
+    "cat /etc/hostname",
+    "systemctl status sshd",
+    "ps aux | grep sshd",
+    "grep root /etc/passwd",
+    "id",
+    "tail -n 20 /var/log/messages",
+    "df -h",
+};
+#define SCRIPT_LINES ((int)(sizeof(script) / sizeof(script[0])))
+
+#define MAX_LEVELS 32
+
+/* Where a command line's time goes (-v) */
+enum phase {
+    PHASE_HISTORY,          /* History and alias expansion, history file append */
+    PHASE_VALIDATE,         /* validate_command() */
+    PHASE_PERMISSION,       /* check_command_permission() */
+    PHASE_PARSE,            /* Parsing, cached authentication, execution with -x */
+    PHASE_LOG,              /* syslog, audit journal, metrics */
+    PHASE_EDIT_LOCK,        /* Editor file lock and release */
+    PHASE_COUNT
+};
+
+static const char *const phase_names[PHASE_COUNT] = {
+    "history", "validate", "permission", "parse", "log", "edit_lock"
+};
+
+/* Options */
+static int levels[MAX_LEVELS];
+static int level_count = 0;
+static int commands_per_session = 200;
+static int edit_every = 10;            /* Take an editor lock every this many lines (0: never) */
+static int execute = 0;
+static int keep_root = 0;
+static int verbose = 0;
+
+static char fake_root[64];         /* Holds the mkdtemp() template */
+static const char *username;
+
+/* Per-command latencies in nanoseconds, written by the sessions */
+static uint64_t *samples;
+static uint64_t *start_samples;        /* Session start-up, one per session */
+static uint64_t *phase_totals;         /* Nanoseconds per phase, summed over all sessions */
+
+/**
+ * Monotonic clock in nanoseconds
+ */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Write a file under the fake root
+ */
+static int write_file(const char *name, const char *content, char *path, size_t size) {
+    if (snprintf(path, size, "%s/%s", fake_root, name) >= (int)size) {
+        return -1;
+    }
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        return -1;
+    }
+    fputs(content, f);
+    fclose(f);
+    return chmod(path, 0600);
+}
+
+/**
+ * Create the fake root and point sudosh at it
+ */
+static int setup_fake_root(void) {
+    char path[PATH_MAX];
+    char sudoers[1024];
+
+    snprintf(fake_root, sizeof(fake_root), "/tmp/sudosh-bench.XXXXXX");
+    if (!mkdtemp(fake_root)) {
+        perror("mkdtemp");
+        return -1;
+    }
+
+    snprintf(sudoers, sizeof(sudoers),
+             "Defaults env_reset\n"
+             "Cmnd_Alias SERVICES = /usr/bin/systemctl, /usr/sbin/service\n"
+             "root ALL=(ALL:ALL) ALL\n"
+             "%s ALL=(ALL) SERVICES, /bin/ls, /usr/bin/ls, /bin/cat, /usr/bin/cat, /usr/bin/tail, /bin/grep,"
+             " /usr/bin/grep, /bin/ps, /usr/bin/ps, /usr/bin/id, /bin/df, /usr/bin/df, /usr/bin/vi\n",
+             username);
+    if (write_file("sudoers", sudoers, path, sizeof(path)) != 0) {
+        return -1;
+    }
+    setenv("SUDOSH_SUDOERS_PATH", path, 1);
+    snprintf(path, sizeof(path), "%s/sudoers.d", fake_root);
+    mkdir(path, 0700);
+    setenv("SUDOSH_SUDOERS_DIR", path, 1);
+
+    snprintf(path, sizeof(path), "%s/run", fake_root);
+    mkdir(path, 0700);
+    setenv("SUDOSH_AUTH_CACHE_DIR", path, 1);
+    snprintf(path, sizeof(path), "%s/run/locks", fake_root);
+    mkdir(path, 0755);
+    setenv("SUDOSH_LOCK_DIR", path, 1);
+    snprintf(path, sizeof(path), "%s/run/metrics", fake_root);
+    setenv("SUDOSH_METRICS_FILE", path, 1);
+    snprintf(path, sizeof(path), "%s/audit.log", fake_root);
+    setenv("SUDOSH_AUDIT_LOG", path, 1);
+    snprintf(path, sizeof(path), "%s/home", fake_root);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/home/.sudosh_history", fake_root);
+    setenv("SUDOSH_HISTORY_FILE", path, 1);
+
+    return 0;
+}
+
+/**
+ * Remove the fake root
+ */
+static void remove_fake_root(void) {
+    char command[PATH_MAX + 16];
+
+    if (keep_root) {
+        printf("fake root kept at %s\n", fake_root);
+        return;
+    }
+    snprintf(command, sizeof(command), "rm -rf '%s'", fake_root);
+    if (system(command) != 0) {
+        fprintf(stderr, "bench_sessions: could not remove %s\n", fake_root);
+    }
+}
+
+/**
+ * Charge the time since *mark to a phase and move the mark
+ */
+static void phase_done(enum phase which, uint64_t *mark) {
+    uint64_t now = now_ns();
+    __atomic_add_fetch(&phase_totals[which], now - *mark, __ATOMIC_RELAXED);
+    *mark = now;
+}
+
+/**
+ * One command line, as main_loop() handles it
+ */
+static void run_line(const char *input, struct user_info *user, int session, int line) {
+    uint64_t mark = now_ns();
+    char *command_line = safe_strdup(input);
+    char *expanded = expand_history(command_line);
+    if (expanded) {
+        free(command_line);
+        command_line = expanded;
+    }
+    char *aliased = expand_aliases(command_line);
+    if (aliased) {
+        free(command_line);
+        command_line = aliased;
+    }
+
+    log_command_history(command_line);
+    add_to_history_buffer(command_line);
+    phase_done(PHASE_HISTORY, &mark);
+
+    int valid = validate_command(command_line);
+    phase_done(PHASE_VALIDATE, &mark);
+    int allowed = valid && (is_safe_command(command_line) || check_command_permission(username, command_line));
+    phase_done(PHASE_PERMISSION, &mark);
+    if (!allowed) {
+        free(command_line);
+        return;
+    }
+
+    int result = 0;
+    if (is_pipeline_command(command_line)) {
+        struct pipeline_info pipeline;
+        if (parse_pipeline(command_line, &pipeline) == 0) {
+            if (execute) {
+                result = execute_pipeline(&pipeline, user);
+            }
+            free_pipeline_info(&pipeline);
+        }
+    } else {
+        struct command_info cmd;
+        memset(&cmd, 0, sizeof(cmd));
+        if (parse_command(command_line, &cmd) == 0) {
+            if (should_require_authentication(username, command_line)) {
+                authenticate_user_cached(username);
+            }
+            if (execute) {
+                result = execute_command(&cmd, user);
+            }
+            free_command_info(&cmd);
+        }
+    }
+    phase_done(PHASE_PARSE, &mark);
+    log_command_with_ansible_context(username, command_line, result == 0);
+    phase_done(PHASE_LOG, &mark);
+
+    /* An editor session on this session's own file: lock it for its duration */
+    if (edit_every > 0 && line % edit_every == edit_every - 1) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/home/file%d.conf", fake_root, session);
+        if (acquire_file_lock(path, username, getpid()) == 0) {
+            release_file_lock(path, username, getpid());
+        }
+        phase_done(PHASE_EDIT_LOCK, &mark);
+    }
+    free(command_line);
+}
+
+/**
+ * One session: start-up as main_loop() does it, the script, and shutdown
+ */
+static void run_session(int session, int read_fd) {
+    char go;
+    uint64_t *mine = samples + (size_t)session * (size_t)commands_per_session;
+
+    if (!execute) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDOUT_FILENO);
+            close(devnull);
+        }
+    }
+
+    /* Wait until every session has been forked */
+    if (read(read_fd, &go, 1) < 0) {
+        _exit(2);
+    }
+    close(read_fd);
+
+    /* The file this session "edits" */
+    char name[64], path[PATH_MAX];
+    snprintf(name, sizeof(name), "home/file%d.conf", session);
+    write_file(name, "key = value\n", path, sizeof(path));
+
+    uint64_t started = now_ns();
+    if (!check_nopasswd_privileges_enhanced(username)) {
+        authenticate_user_cached(username);
+    }
+    struct user_info *user = get_user_info(username);
+    init_file_locking();
+    init_command_history(username);
+    load_history_buffer();
+    init_alias_system();
+    log_session_start_with_ansible_context(username);
+    start_samples[session] = now_ns() - started;
+
+    for (int i = 0; i < commands_per_session; i++) {
+        uint64_t t0 = now_ns();
+        run_line(script[(session + i) % SCRIPT_LINES], user, session, i);
+        mine[i] = now_ns() - t0;
+    }
+
+    log_session_end(username);
+    close_command_history();
+    close_logging();
+    free_history_buffer();
+    cleanup_alias_system();
+    cleanup_auth_cache();
+    cleanup_file_locking();
+    free_user_info(user);
+    _exit(0);
+}
+
+/**
+ * Sort helper for latencies
+ */
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Value at quantile q of a sorted array, in microseconds
+ */
+static double quantile_us(const uint64_t *sorted, size_t n, double q) {
+    if (n == 0) {
+        return 0;
+    }
+    size_t i = (size_t)(q * (double)(n - 1) + 0.5);
+    return (double)sorted[i] / 1000.0;
+}
+
+/**
+ * Run one concurrency level and print its row
+ */
+static int run_level(int sessions, double *base_rate) {
+    int go_pipe[2];
+    pid_t *pids = calloc((size_t)sessions, sizeof(pid_t));
+    size_t total = (size_t)sessions * (size_t)commands_per_session;
+    int failed = 0;
+
+    if (!pids || pipe(go_pipe) != 0) {
+        free(pids);
+        return -1;
+    }
+    memset(samples, 0, total * sizeof(uint64_t));
+    memset(phase_totals, 0, PHASE_COUNT * sizeof(uint64_t));
+
+    for (int s = 0; s < sessions; s++) {
+        pids[s] = fork();
+        if (pids[s] == 0) {
+            close(go_pipe[1]);
+            run_session(s, go_pipe[0]);
+        }
+        if (pids[s] < 0) {
+            perror("fork");
+            sessions = s;
+            failed = 1;
+            break;
+        }
+    }
+    close(go_pipe[0]);
+
+    /* Closing the pipe releases every session at once */
+    uint64_t started = now_ns();
+    close(go_pipe[1]);
+    for (int s = 0; s < sessions; s++) {
+        int status;
+        if (waitpid(pids[s], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed = 1;
+        }
+    }
+    double wall = (double)(now_ns() - started) / 1e9;
+    free(pids);
+
+    total = (size_t)sessions * (size_t)commands_per_session;
+    qsort(samples, total, sizeof(uint64_t), compare_u64);
+    qsort(start_samples, (size_t)sessions, sizeof(uint64_t), compare_u64);
+
+    double rate = (double)total / wall;
+    if (*base_rate == 0) {
+        *base_rate = rate;
+    }
+    printf("%8d %9zu %8.2f %10.0f %7.2fx %9.0f %9.0f %9.0f %9.0f %10.0f%s\n",
+           sessions, total, wall, rate, rate / *base_rate,
+           quantile_us(samples, total, 0.50), quantile_us(samples, total, 0.99),
+           quantile_us(samples, total, 0.999), quantile_us(samples, total, 1.0),
+           quantile_us(start_samples, (size_t)sessions, 0.99), failed ? "  (session failed)" : "");
+    if (verbose) {
+        printf("%8s mean us per line:", "");
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            printf(" %s=%.0f", phase_names[p], (double)phase_totals[p] / 1000.0 / (double)total);
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+    return failed ? -1 : 0;
+}
+
+/**
+ * Parse "1,2,4,8" into levels[]
+ */
+static int parse_levels(const char *list) {
+    char *copy = safe_strdup(list);
+    char *save = NULL;
+
+    level_count = 0;
+    for (char *tok = strtok_r(copy, ",", &save); tok && level_count < MAX_LEVELS;
+         tok = strtok_r(NULL, ",", &save)) {
+        int n = atoi(tok);
+        if (n <= 0 || n > 4096) {
+            free(copy);
+            return -1;
+        }
+        levels[level_count++] = n;
+    }
+    free(copy);
+    return level_count > 0 ? 0 : -1;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: bench_sessions [-n N,N,...] [-c COMMANDS] [-e EVERY] [-x] [-k]\n"
+            "  -n  concurrent sessions per run (default 1,2,4,... up to 4 x online CPUs)\n"
+            "  -c  command lines per session (default 200)\n"
+            "  -e  take an editor file lock every EVERY lines, 0 for never (default 10)\n"
+            "  -x  also execute the commands (measures fork/exec too)\n"
+            "  -k  keep the fake root for inspection\n"
+            "  -v  break each line's time down by phase\n");
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    int max_sessions = 0;
+    double base_rate = 0;
+    int result = 0;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    while ((opt = getopt(argc, argv, "n:c:e:xkvh")) != -1) {
+        switch (opt) {
+        case 'n':
+            if (parse_levels(optarg) != 0) {
+                usage();
+                return 2;
+            }
+            break;
+        case 'c':
+            commands_per_session = atoi(optarg);
+            break;
+        case 'e':
+            edit_every = atoi(optarg);
+            break;
+        case 'x':
+            execute = 1;
+            break;
+        case 'k':
+            keep_root = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            usage();
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (commands_per_session <= 0) {
+        usage();
+        return 2;
+    }
+    if (level_count == 0) {
+        for (int n = 1; n <= 4 * (cpus > 0 ? cpus : 1) && level_count < MAX_LEVELS; n *= 2) {
+            levels[level_count++] = n;
+        }
+    }
+    for (int i = 0; i < level_count; i++) {
+        if (levels[i] > max_sessions) {
+            max_sessions = levels[i];
+        }
+    }
+
+    test_mode = 1;
+    setenv("SUDOSH_TEST_MODE", "1", 1);
+    struct passwd *pwd = getpwuid(getuid());
+    if (!pwd) {
+        fprintf(stderr, "bench_sessions: unknown uid\n");
+        return 1;
+    }
+    username = safe_strdup(pwd->pw_name);
+    setenv("USER", username, 1);
+    if (setup_fake_root() != 0) {
+        return 1;
+    }
+
+    size_t bytes = (size_t)max_sessions * (size_t)commands_per_session * sizeof(uint64_t);
+    samples = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    start_samples = mmap(NULL, (size_t)max_sessions * sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    phase_totals = mmap(NULL, PHASE_COUNT * sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (samples == MAP_FAILED || start_samples == MAP_FAILED || phase_totals == MAP_FAILED) {
+        perror("mmap");
+        remove_fake_root();
+        return 1;
+    }
+
+    printf("sudosh concurrent sessions: %ld CPUs, %d command lines per session, editor lock every %d, %s\n",
+           cpus, commands_per_session, edit_every, execute ? "executing commands" : "not executing commands");
+    printf("%8s %9s %8s %10s %8s %9s %9s %9s %9s %10s\n", "sessions", "commands", "wall_s", "cmds/s",
+           "scaling", "p50_us", "p99_us", "p999_us", "max_us", "start_p99");
+    for (int i = 0; i < level_count; i++) {
+        if (run_level(levels[i], &base_rate) != 0) {
+            result = 1;
+        }
+    }
+
+    munmap(samples, bytes);
+    munmap(start_samples, (size_t)max_sessions * sizeof(uint64_t));
+    munmap(phase_totals, PHASE_COUNT * sizeof(uint64_t));
+    remove_fake_root();
+    return result;
+}
@@ -6,6 +6,7 @@
 #include <string.h>
 #include <assert.h>
 #include <unistd.h>
+#include <limits.h>
 #include <sys/wait.h>
 
 /* Test framework macros */
@@ -172,6 +173,22 @@ static inline void remove_temp_file(char *filename) {
     }
 }
 
+void close_logging(void);   /* sudosh.h; used by reset_audit_journal() */
+
+/**
+ * Close logging and remove an audit journal with its .sync and .idx files
+ */
+static inline void reset_audit_journal(const char *journal_path) {
+    char path[PATH_MAX + 8];
+
+    close_logging();
+    unlink(journal_path);
+    snprintf(path, sizeof(path), "%s.sync", journal_path);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s.idx", journal_path);
+    unlink(path);
+}
+
 /**
  * Capture stdout/stderr from a function call
  */
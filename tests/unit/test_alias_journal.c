@@ -0,0 +1,141 @@
+#include "test_framework.h"
+#include "sudosh.h"
+#include <sys/stat.h>
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char test_home[256];
+
+static void alias_path(char *buf, size_t len, const char *suffix) {
+    snprintf(buf, len, "%s/%s%s", test_home, ALIAS_FILE_NAME, suffix);
+}
+
+static int count_lines(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int lines = 0;
+    int c;
+    while ((c = fgetc(f)) != EOF) {
+        if (c == '\n') lines++;
+    }
+    fclose(f);
+    return lines;
+}
+
+static void reset_alias_files(void) {
+    char path[PATH_MAX];
+    alias_path(path, sizeof(path), "");
+    unlink(path);
+    alias_path(path, sizeof(path), ALIAS_JOURNAL_SUFFIX);
+    unlink(path);
+}
+
+int test_changes_are_journaled_not_rewritten() {
+    printf("Running test_changes_are_journaled_not_rewritten... ");
+    reset_alias_files();
+
+    init_alias_system();
+    TEST_ASSERT_EQ(1, add_alias("jl", "ls -la"), "should add alias");
+    TEST_ASSERT_EQ(1, add_alias("jd", "date"), "should add alias");
+    TEST_ASSERT_EQ(1, remove_alias("jd"), "should remove alias");
+    cleanup_alias_system();
+
+    char base[PATH_MAX], journal[PATH_MAX];
+    alias_path(base, sizeof(base), "");
+    alias_path(journal, sizeof(journal), ALIAS_JOURNAL_SUFFIX);
+    TEST_ASSERT_EQ(3, count_lines(journal), "journal should hold one record per change");
+    TEST_ASSERT_EQ(-1, count_lines(base), "base file should not be rewritten below threshold");
+
+    init_alias_system();
+    TEST_ASSERT_NOT_NULL(get_alias_value("jl"), "journaled alias should be restored");
+    TEST_ASSERT_NULL(get_alias_value("jd"), "removed alias should stay removed");
+    cleanup_alias_system();
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_concurrent_sessions_merge() {
+    printf("Running test_concurrent_sessions_merge... ");
+    reset_alias_files();
+
+    /* Session A loads, then session B appends its own change underneath it */
+    init_alias_system();
+    TEST_ASSERT_EQ(1, add_alias("mine", "ls -l"), "should add alias");
+
+    char journal[PATH_MAX];
+    alias_path(journal, sizeof(journal), ALIAS_JOURNAL_SUFFIX);
+    FILE *f = fopen(journal, "a");
+    TEST_ASSERT_NOT_NULL(f, "should open journal");
+    /* CRC-32 of "S theirs=pwd" */
+    fprintf(f, "S ac19547a theirs=pwd\n");
+    /* A record with a bad checksum is ignored */
+    fprintf(f, "S 00000000 forged=id\n");
+    /* A torn record without a newline is ignored */
+    fprintf(f, "S 12345678 torn=who");
+    fclose(f);
+
+    cleanup_alias_system();
+
+    init_alias_system();
+    TEST_ASSERT_NOT_NULL(get_alias_value("mine"), "our alias should survive");
+    TEST_ASSERT_NOT_NULL(get_alias_value("theirs"), "other session's alias should survive");
+    TEST_ASSERT_NULL(get_alias_value("forged"), "bad checksum record should be skipped");
+    TEST_ASSERT_NULL(get_alias_value("torn"), "torn record should be skipped");
+    cleanup_alias_system();
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_compaction_renames_base() {
+    printf("Running test_compaction_renames_base... ");
+    reset_alias_files();
+
+    init_alias_system();
+    for (int i = 0; i < ALIAS_JOURNAL_COMPACT_RECORDS; i++) {
+        TEST_ASSERT_EQ(1, add_alias("churn", (i % 2) ? "ls -l" : "ls -a"), "should update alias");
+    }
+    TEST_ASSERT_EQ(1, add_alias("kept", "uptime"), "should add alias");
+    cleanup_alias_system();
+
+    char base[PATH_MAX], journal[PATH_MAX];
+    alias_path(base, sizeof(base), "");
+    alias_path(journal, sizeof(journal), ALIAS_JOURNAL_SUFFIX);
+    TEST_ASSERT(count_lines(journal) < ALIAS_JOURNAL_FLUSH_BATCH, "journal should be truncated by compaction");
+    TEST_ASSERT(count_lines(base) > 0, "base file should be rewritten by compaction");
+
+    init_alias_system();
+    TEST_ASSERT_NOT_NULL(get_alias_value("kept"), "compacted alias should load");
+    TEST_ASSERT_STR_EQ("ls -l", get_alias_value("churn"), "last write should win");
+    cleanup_alias_system();
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    snprintf(test_home, sizeof(test_home), "/tmp/sudosh_alias_journal_%d", (int)getpid());
+    mkdir(test_home, 0700);
+    setenv("HOME", test_home, 1);
+    setenv("SUDOSH_TEST_MODE", "1", 1);
+    rc_alias_import_enabled = 0;
+
+    printf("=== Alias Journal Tests ===\n");
+    test_passes += test_changes_are_journaled_not_rewritten();
+    test_passes += test_concurrent_sessions_merge();
+    test_passes += test_compaction_renames_base();
+    test_count = 3;
+
+    reset_alias_files();
+    rmdir(test_home);
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
@@ -0,0 +1,240 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+/*
+ * Allocation budgets for representative workloads, checked when built
+ * with `make test-alloc` (ALLOC_STATS=1).  They are the counts measured
+ * when the budget was last set: a change that allocates more fails here.
+ * If the extra allocations are deliberate, raise the budget in the same
+ * change; if a change allocates less, lower it.
+ */
+#define BUDGET_SUDOERS_PARSE 110        /* Parse, compile and free the fixture below */
+#define BUDGET_SUDOERS_MAPPED 1         /* Same fixture from the shared policy image */
+#define BUDGET_COMMAND_PARSE 8          /* parse_command() + free_command_info(), per command */
+#define BUDGET_PIPELINE_PARSE 24        /* parse_pipeline() + free_pipeline_info() */
+#define BUDGET_VALIDATE 12              /* validate_command_with_length(), per command */
+
+static const char *sudoers_fixture =
+    "Defaults env_reset\n"
+    "User_Alias ADMINS = alice, bob, carol\n"
+    "Cmnd_Alias SERVICES = /usr/bin/systemctl, /usr/sbin/service\n"
+    "root ALL=(ALL:ALL) ALL\n"
+    "%wheel ALL=(ALL) ALL\n"
+    "ADMINS ALL=(ALL) NOPASSWD: SERVICES\n"
+    "deploy web1,web2=(www-data) NOPASSWD: /usr/bin/rsync, /bin/ls, /usr/bin/head\n"
+    "backup ALL=(root) /usr/bin/tar, /usr/bin/gzip\n";
+
+static const char *commands[] = {
+    "ls -la /tmp",
+    "cat /etc/hostname",
+    "grep -r pattern /var/log/messages",
+    "systemctl status sshd",
+};
+
+/* Totals at the start of a measured section */
+static struct alloc_totals before;
+
+static void measure_start(void) {
+    alloc_stats_get(&before);
+    alloc_stats_reset_peak();
+}
+
+/* Allocations since measure_start() */
+static unsigned long long measured_allocations(void) {
+    struct alloc_totals now;
+    alloc_stats_get(&now);
+    return (now.allocations + now.reallocs) - (before.allocations + before.reallocs);
+}
+
+/* Blocks allocated since measure_start() and still live */
+static long long measured_leaks(void) {
+    struct alloc_totals now;
+    alloc_stats_get(&now);
+    return (long long)now.live_blocks - (long long)before.live_blocks;
+}
+
+int test_wrappers_are_counted() {
+    printf("Running test_wrappers_are_counted... ");
+
+    struct alloc_totals t0, t1;
+    alloc_stats_get(&t0);
+    alloc_stats_reset_peak();
+
+    char *a = malloc(100);
+    char *b = calloc(4, 25);
+    char *c = safe_strdup("accounted");
+    a = realloc(a, 300);
+    char *d = sudosh_safe_malloc(50);
+    alloc_stats_get(&t1);
+
+    TEST_ASSERT_EQ(4, (int)(t1.allocations - t0.allocations), "malloc, calloc, strdup and zeroed malloc counted");
+    TEST_ASSERT_EQ(1, (int)(t1.reallocs - t0.reallocs), "realloc counted");
+    TEST_ASSERT_EQ(300 + 100 + 10 + 50, (int)(t1.live_bytes - t0.live_bytes), "live bytes");
+    TEST_ASSERT_EQ(300 + 100 + 10 + 50, (int)(t1.peak_bytes - t0.live_bytes), "peak bytes");
+
+    free(a);
+    free(b);
+    free(c);
+    free(d);
+    alloc_stats_get(&t1);
+    TEST_ASSERT_EQ(4, (int)(t1.frees - t0.frees), "frees counted");
+    TEST_ASSERT_EQ(0, (int)(t1.live_bytes - t0.live_bytes), "nothing left live");
+
+    /* getcwd() allocates inside libc: freeing it is untracked, not a crash */
+    char *cwd = getcwd(NULL, 0);
+    free(cwd);
+    alloc_stats_get(&t1);
+    TEST_ASSERT_EQ(1, (int)(t1.untracked_frees - t0.untracked_frees), "libc block freed untracked");
+
+    /* The report names this file as a call site */
+    char *report = NULL;
+    size_t report_len = 0;
+    FILE *out = open_memstream(&report, &report_len);
+    TEST_ASSERT_NOT_NULL(out, "memstream");
+    TEST_ASSERT(alloc_stats_report(out, 0) > 0, "sites reported");
+    fclose(out);
+    TEST_ASSERT(strstr(report, "allocation accounting: allocations=") != NULL, "totals line");
+    TEST_ASSERT(strstr(report, "test_alloc_stats.c:") != NULL, "call sites listed");
+    free(report);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_sudoers_parse_budget() {
+    printf("Running test_sudoers_parse_budget... ");
+
+    char *path = create_temp_file(sudoers_fixture);
+    TEST_ASSERT_NOT_NULL(path, "fixture written");
+
+    measure_start();
+    struct sudoers_config *config = parse_sudoers_file(path);
+    TEST_ASSERT_NOT_NULL(config, "fixture parsed");
+    free_sudoers_config(config);
+    unsigned long long used = measured_allocations();
+    long long leaked = measured_leaks();
+    remove_temp_file(path);
+
+    printf("(%llu allocations) ", used);
+    TEST_ASSERT(used <= BUDGET_SUDOERS_PARSE, "sudoers parse within allocation budget");
+    TEST_ASSERT_EQ(0, (int)leaked, "sudoers parse frees everything");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_sudoers_mapped_budget() {
+    printf("Running test_sudoers_mapped_budget... ");
+
+    char image[] = "/tmp/sudosh-alloc-policy.XXXXXX";
+    int fd = mkstemp(image);
+    TEST_ASSERT(fd >= 0, "image path");
+    close(fd);
+    unlink(image);
+    setenv("SUDOSH_POLICY_IMAGE", image, 1);
+
+    /* Inputs changed within the last second are not published */
+    char *path = create_temp_file(sudoers_fixture);
+    TEST_ASSERT_NOT_NULL(path, "fixture written");
+    sleep(2);
+    free_sudoers_config(parse_sudoers_file(path));
+
+    /* Later parses only wrap the mapping */
+    measure_start();
+    struct sudoers_config *config = parse_sudoers_file(path);
+    TEST_ASSERT_NOT_NULL(config, "fixture mapped");
+    free_sudoers_config(config);
+    unsigned long long used = measured_allocations();
+    long long leaked = measured_leaks();
+    remove_temp_file(path);
+    unlink(image);
+    unsetenv("SUDOSH_POLICY_IMAGE");
+
+    printf("(%llu allocations) ", used);
+    TEST_ASSERT(used <= BUDGET_SUDOERS_MAPPED, "mapped policy within allocation budget");
+    TEST_ASSERT_EQ(0, (int)leaked, "mapped policy released");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_command_parse_budget() {
+    printf("Running test_command_parse_budget... ");
+
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        struct command_info cmd;
+        memset(&cmd, 0, sizeof(cmd));
+
+        measure_start();
+        TEST_ASSERT_EQ(0, parse_command(commands[i], &cmd), "command parsed");
+        free_command_info(&cmd);
+        unsigned long long used = measured_allocations();
+
+        TEST_ASSERT(used <= BUDGET_COMMAND_PARSE, commands[i]);
+        TEST_ASSERT_EQ(0, (int)measured_leaks(), "command parse frees everything");
+    }
+
+    struct pipeline_info pipeline;
+    memset(&pipeline, 0, sizeof(pipeline));
+    measure_start();
+    TEST_ASSERT_EQ(0, parse_pipeline("ps aux | grep sshd | head -5", &pipeline), "pipeline parsed");
+    free_pipeline_info(&pipeline);
+    unsigned long long used = measured_allocations();
+
+    printf("(pipeline: %llu allocations) ", used);
+    TEST_ASSERT(used <= BUDGET_PIPELINE_PARSE, "pipeline parse within allocation budget");
+    TEST_ASSERT_EQ(0, (int)measured_leaks(), "pipeline parse frees everything");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_validation_budget() {
+    printf("Running test_validation_budget... ");
+
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        measure_start();
+        TEST_ASSERT_EQ(1, validate_command_with_length(commands[i], strlen(commands[i]) + 1), "command valid");
+        unsigned long long used = measured_allocations();
+
+        TEST_ASSERT(used <= BUDGET_VALIDATE, commands[i]);
+        TEST_ASSERT_EQ(0, (int)measured_leaks(), "validation frees everything");
+    }
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+
+    printf("=== Allocation Accounting Tests ===\n");
+    if (!alloc_stats_enabled()) {
+        printf("Allocation accounting not built in (make test-alloc); skipping\n");
+    } else {
+        test_count = 5;
+        test_passes += test_wrappers_are_counted();
+        test_passes += test_sudoers_parse_budget();
+        test_passes += test_sudoers_mapped_budget();
+        test_passes += test_command_parse_budget();
+        test_passes += test_validation_budget();
+
+        printf("\n");
+        alloc_stats_report(stdout, 15);
+    }
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+int test_sha256_known_vectors() {
+    printf("Running test_sha256_known_vectors... ");
+
+    char hex[SHA256_HEX_LENGTH + 1];
+    sha256_hex("", 0, hex);
+    TEST_ASSERT_STR_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", hex,
+                       "empty input digest");
+    sha256_hex("abc", 3, hex);
+    TEST_ASSERT_STR_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", hex,
+                       "abc digest");
+
+    /* Two-block message split across several updates */
+    const char *msg = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    struct sha256_ctx ctx;
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    sha256_init(&ctx);
+    sha256_update(&ctx, msg, 5);
+    sha256_update(&ctx, msg + 5, strlen(msg) - 5);
+    sha256_final(&ctx, digest);
+    sha256_to_hex(digest, hex);
+    TEST_ASSERT_STR_EQ("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1", hex,
+                       "incremental digest");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_interpreter_whitelist() {
+    printf("Running test_interpreter_whitelist... ");
+
+    char *python = find_command_in_path("python3");
+    if (python) {
+        char *real = realpath(python, NULL);
+        /* The resolved binary may be named python3.N; both forms are allowed */
+        TEST_ASSERT_EQ(1, is_pipelining_interpreter(real ? real : python), "python3 should be allowed");
+        free(real);
+        free(python);
+    }
+
+    TEST_ASSERT_EQ(0, is_pipelining_interpreter("python3"), "relative path rejected");
+    TEST_ASSERT_EQ(0, is_pipelining_interpreter("/bin/sh"), "shell rejected");
+    TEST_ASSERT_EQ(0, is_pipelining_interpreter("/usr/bin/perl"), "other interpreter rejected");
+    TEST_ASSERT_EQ(0, is_pipelining_interpreter("/usr/bin/python3.x"), "bad version suffix rejected");
+    TEST_ASSERT_EQ(0, is_pipelining_interpreter("/nonexistent/python3"), "missing binary rejected");
+    TEST_ASSERT_EQ(0, is_pipelining_interpreter(NULL), "NULL rejected");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_payload_capture_round_trip() {
+    printf("Running test_payload_capture_round_trip... ");
+
+    int fds[2];
+    TEST_ASSERT_EQ(0, pipe(fds), "pipe");
+    const char *module = "print('hello from module')\n";
+    TEST_ASSERT_EQ((ssize_t)strlen(module), write(fds[1], module, strlen(module)), "write module");
+    close(fds[1]);
+
+    int spool_fd = -1;
+    size_t len = 0;
+    char hex[SHA256_HEX_LENGTH + 1];
+    TEST_ASSERT_EQ(0, capture_pipelined_payload(fds[0], &spool_fd, &len, hex), "capture succeeds");
+    close(fds[0]);
+
+    char expected[SHA256_HEX_LENGTH + 1];
+    sha256_hex(module, strlen(module), expected);
+    TEST_ASSERT_EQ(strlen(module), len, "payload length");
+    TEST_ASSERT_STR_EQ(expected, hex, "payload digest");
+
+    char readback[128] = {0};
+    TEST_ASSERT_EQ((ssize_t)len, read(spool_fd, readback, sizeof(readback) - 1), "spool is rewound");
+    TEST_ASSERT_STR_EQ(module, readback, "spool holds payload");
+    TEST_ASSERT(fcntl(spool_fd, F_GETFD) & FD_CLOEXEC, "spool is close-on-exec");
+    close(spool_fd);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_module_runs_from_spool() {
+    printf("Running test_module_runs_from_spool... ");
+
+    char *python = find_command_in_path("python3");
+    if (!python) {
+        printf("SKIP (python3 not found)\n");
+        return 1;
+    }
+
+    char out_path[PATH_MAX];
+    snprintf(out_path, sizeof(out_path), "/tmp/sudosh_pipeline_%d", (int)getpid());
+    char module[PATH_MAX + 64];
+    snprintf(module, sizeof(module), "open('%s', 'w').write('ran')\n", out_path);
+
+    int fds[2];
+    TEST_ASSERT_EQ(0, pipe(fds), "pipe");
+    TEST_ASSERT_EQ((ssize_t)strlen(module), write(fds[1], module, strlen(module)), "write module");
+    close(fds[1]);
+
+    int spool_fd = -1;
+    size_t len = 0;
+    char hex[SHA256_HEX_LENGTH + 1];
+    TEST_ASSERT_EQ(0, capture_pipelined_payload(fds[0], &spool_fd, &len, hex), "capture succeeds");
+    close(fds[0]);
+
+    struct user_info *user = get_user_info(getenv("USER"));
+    TEST_ASSERT_NOT_NULL(user, "user info");
+    TEST_ASSERT_EQ(0, execute_pipelined_module(python, spool_fd, user), "module exits cleanly");
+    free_user_info(user);
+    close(spool_fd);
+    free(python);
+
+    char buf[8] = {0};
+    FILE *f = fopen(out_path, "r");
+    TEST_ASSERT_NOT_NULL(f, "module should have written its output");
+    TEST_ASSERT(fgets(buf, sizeof(buf), f) != NULL, "read output");
+    fclose(f);
+    unlink(out_path);
+    TEST_ASSERT_STR_EQ("ran", buf, "module ran with payload on stdin");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+
+    printf("=== Ansible Pipelining Tests ===\n");
+    test_passes += test_sha256_known_vectors();
+    test_passes += test_interpreter_whitelist();
+    test_passes += test_payload_capture_round_trip();
+    test_passes += test_module_runs_from_spool();
+    test_count = 4;
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
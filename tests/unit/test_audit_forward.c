@@ -0,0 +1,402 @@
+#include "test_framework.h"
+#include "sudosh.h"
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char test_dir[] = "/tmp/sudosh-forward-XXXXXX";
+static char journal_path[PATH_MAX];
+static char socket_path[PATH_MAX];
+static char spill_path[PATH_MAX];
+
+/* What a collector received */
+struct collected {
+    int frames;
+    int records;
+    int bad_frames;
+    pid_t last_pid;
+    char *payload;          /* All records, in order */
+    size_t len;
+    char stream[256 * 1024];
+    size_t stream_len;
+};
+
+static void reset_files(void) {
+    reset_audit_journal(journal_path);
+    unlink(spill_path);
+    unlink(socket_path);
+}
+
+static int start_collector(int type) {
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, type, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path) >= (int)sizeof(addr.sun_path)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    unlink(socket_path);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0) {
+        return -1;
+    }
+    return fd;
+}
+
+/* Accept the forwarder's connection if one is waiting */
+static int accept_forwarder(int listener, int timeout_ms) {
+    struct pollfd p = { listener, POLLIN, 0 };
+    if (poll(&p, 1, timeout_ms) != 1) {
+        return -1;
+    }
+    return accept(listener, NULL, NULL);
+}
+
+static void add_frame(struct collected *c, const struct audit_forward_frame *frame, const char *payload) {
+    if (frame->magic != AUDIT_FORWARD_MAGIC || frame->version != AUDIT_FORWARD_VERSION) {
+        c->bad_frames++;
+        return;
+    }
+    c->frames++;
+    c->records += frame->records;
+    c->last_pid = (pid_t)frame->pid;
+    c->payload = realloc(c->payload, c->len + frame->length + 1);
+    memcpy(c->payload + c->len, payload, frame->length);
+    c->len += frame->length;
+    c->payload[c->len] = '\0';
+}
+
+/* Read whatever has arrived, waiting up to timeout_ms for the first byte */
+static void drain(int conn, int stream, struct collected *c, int timeout_ms) {
+    char buf[sizeof(struct audit_forward_frame) + AUDIT_FORWARD_FRAME_MAX];
+    struct pollfd p = { conn, POLLIN, 0 };
+
+    while (poll(&p, 1, timeout_ms) == 1) {
+        timeout_ms = 0;
+        if (!stream) {
+            ssize_t n = recv(conn, buf, sizeof(buf), 0);
+            if (n <= 0) {
+                return;
+            }
+            add_frame(c, (const struct audit_forward_frame *)buf, buf + sizeof(struct audit_forward_frame));
+            continue;
+        }
+        ssize_t n = recv(conn, c->stream + c->stream_len, sizeof(c->stream) - c->stream_len, 0);
+        if (n <= 0) {
+            return;
+        }
+        c->stream_len += (size_t)n;
+        size_t pos = 0;
+        while (c->stream_len - pos >= sizeof(struct audit_forward_frame)) {
+            struct audit_forward_frame frame;
+            memcpy(&frame, c->stream + pos, sizeof(frame));
+            if (c->stream_len - pos < sizeof(frame) + frame.length) {
+                break;
+            }
+            add_frame(c, &frame, c->stream + pos + sizeof(frame));
+            pos += sizeof(frame) + frame.length;
+        }
+        memmove(c->stream, c->stream + pos, c->stream_len - pos);
+        c->stream_len -= pos;
+    }
+}
+
+/* Check that records carry msg=<prefix>0 .. <prefix>count-1 in order */
+static int records_in_order(const struct collected *c, const char *prefix, int count) {
+    char want[64];
+    const char *p = c->payload;
+    for (int i = 0; i < count; i++) {
+        snprintf(want, sizeof(want), "\tmsg=%s%d\n", prefix, i);
+        p = p ? strstr(p, want) : NULL;
+        if (!p) {
+            return 0;
+        }
+        p += strlen(want);
+    }
+    return 1;
+}
+
+int test_records_are_batched_into_frames() {
+    printf("Running test_records_are_batched_into_frames... ");
+
+    struct collected c;
+    struct audit_forward_stats stats;
+    char msg[32];
+    reset_files();
+    memset(&c, 0, sizeof(c));
+
+    int listener = start_collector(SOCK_SEQPACKET);
+    TEST_ASSERT(listener >= 0, "collector listening");
+    audit_forward_configure(socket_path);
+
+    for (int i = 0; i < 10; i++) {
+        snprintf(msg, sizeof(msg), "violation %d", i);
+        audit_record("VIOLATION", "alice", "INTERACTIVE_SESSION", msg, 0);
+    }
+    audit_forward_get_stats(&stats);
+    TEST_ASSERT_EQ(0, (int)stats.frames, "violations wait for the batch");
+    TEST_ASSERT(stats.queued > 0, "violations queued");
+
+    log_command("alice", "systemctl restart nginx", 1);
+    int conn = accept_forwarder(listener, 1000);
+    TEST_ASSERT(conn >= 0, "forwarder connected");
+    drain(conn, 0, &c, 1000);
+    TEST_ASSERT_EQ(1, c.frames, "one frame for the batch");
+    TEST_ASSERT_EQ(11, c.records, "violations sent with the command");
+    TEST_ASSERT_EQ(0, c.bad_frames, "frame header valid");
+    TEST_ASSERT_EQ((int)getpid(), (int)c.last_pid, "sender pid");
+    TEST_ASSERT(strstr(c.payload, "type=COMMAND\t") != NULL, "structured fields");
+    TEST_ASSERT(strstr(c.payload, "\tuser=alice\t") != NULL, "user field");
+    TEST_ASSERT(strstr(c.payload, "\tmsg=systemctl restart nginx\n") != NULL, "command last");
+
+    audit_forward_get_stats(&stats);
+    TEST_ASSERT_EQ(11, (int)stats.records, "sent records counted");
+    TEST_ASSERT_EQ(1, stats.connected, "still connected");
+
+    close_audit_forward();
+    close(conn);
+    close(listener);
+    free(c.payload);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_stream_collector() {
+    printf("Running test_stream_collector... ");
+
+    struct collected c;
+    char msg[32];
+    reset_files();
+    memset(&c, 0, sizeof(c));
+
+    int listener = start_collector(SOCK_STREAM);
+    TEST_ASSERT(listener >= 0, "collector listening");
+    audit_forward_configure(socket_path);
+
+    /* Enough records for several frames */
+    char filler[400];
+    memset(filler, 'f', sizeof(filler) - 1);
+    filler[sizeof(filler) - 1] = '\0';
+    for (int i = 0; i < 300; i++) {
+        snprintf(msg, sizeof(msg), "stream %d", i);
+        audit_record("VIOLATION", filler, "INTERACTIVE_SESSION", msg, 0);
+    }
+    audit_forward_flush(0);
+
+    int conn = accept_forwarder(listener, 1000);
+    TEST_ASSERT(conn >= 0, "forwarder connected over a stream socket");
+    for (int i = 0; i < 50 && c.records < 300; i++) {
+        drain(conn, 1, &c, 100);
+        audit_forward_flush(0);
+    }
+    TEST_ASSERT_EQ(300, c.records, "every record delivered");
+    TEST_ASSERT(c.frames > 1, "split into several frames");
+    TEST_ASSERT_EQ(0, c.bad_frames, "frames delimited correctly");
+    TEST_ASSERT(records_in_order(&c, "stream ", 300), "in order");
+
+    close_audit_forward();
+    close(conn);
+    close(listener);
+    free(c.payload);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_collector_down_spills_and_replays() {
+    printf("Running test_collector_down_spills_and_replays... ");
+
+    struct audit_forward_stats stats;
+    struct collected c;
+    struct stat st;
+    char msg[32];
+    reset_files();
+    memset(&c, 0, sizeof(c));
+
+    audit_forward_configure(socket_path);
+    char filler[200];
+    memset(filler, 'x', sizeof(filler) - 1);
+    filler[sizeof(filler) - 1] = '\0';
+
+    /* No collector: the queue fills and spills instead of blocking */
+    long long slowest = 0;
+    for (int i = 0; i < 5000; i++) {
+        snprintf(msg, sizeof(msg), "down %d", i);
+        long long started = monotonic_usec();
+        audit_record("VIOLATION", filler, "INTERACTIVE_SESSION", msg, 0);
+        long long took = monotonic_usec() - started;
+        slowest = took > slowest ? took : slowest;
+    }
+    audit_forward_get_stats(&stats);
+    TEST_ASSERT(stats.spilled > 0, "records spilled");
+    TEST_ASSERT(stats.queued <= AUDIT_FORWARD_QUEUE_BYTES, "memory bounded");
+    TEST_ASSERT_EQ(0, (int)stats.frames, "nothing sent");
+    TEST_ASSERT(slowest < 100000, "no call waited on the collector");
+
+    close_audit_forward();
+    audit_forward_get_stats(&stats);
+    TEST_ASSERT_EQ(5000, (int)stats.spilled, "the rest spilled at session end");
+    TEST_ASSERT_EQ(0, stat(spill_path, &st), "spill file exists");
+    TEST_ASSERT_EQ(0600, st.st_mode & 0777, "spill file is private");
+
+    /* The collector comes back: spilled records arrive first, then new ones */
+    int listener = start_collector(SOCK_SEQPACKET);
+    audit_forward_configure(socket_path);
+    audit_record("COMMAND", "alice", "ok", "back 0", 1);
+    int conn = accept_forwarder(listener, 1000);
+    TEST_ASSERT(conn >= 0, "reconnected");
+    for (int i = 0; i < 200 && c.records < 5001; i++) {
+        drain(conn, 0, &c, 50);
+        audit_forward_flush(0);
+    }
+    TEST_ASSERT_EQ(5001, c.records, "every record delivered once");
+    TEST_ASSERT(records_in_order(&c, "down ", 5000), "spilled records in order");
+    TEST_ASSERT(strstr(c.payload + c.len - 200, "\tmsg=back 0\n") != NULL, "new record after the replay");
+
+    audit_forward_get_stats(&stats);
+    TEST_ASSERT(stats.replayed >= 5000, "replayed from the spill file");
+    TEST_ASSERT_EQ(0, stat(spill_path, &st), "spill file kept");
+    TEST_ASSERT_EQ(16, (int)st.st_size, "spill file emptied");
+
+    close_audit_forward();
+    close(conn);
+    close(listener);
+    free(c.payload);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_stalled_collector_never_blocks() {
+    printf("Running test_stalled_collector_never_blocks... ");
+
+    struct audit_forward_stats stats;
+    char msg[32];
+    reset_files();
+
+    /* Accepts but never reads */
+    int listener = start_collector(SOCK_SEQPACKET);
+    audit_forward_configure(socket_path);
+
+    long long slowest = 0;
+    for (int i = 0; i < 20000; i++) {
+        snprintf(msg, sizeof(msg), "stalled %d", i);
+        long long started = monotonic_usec();
+        audit_forward_record(msg, 1);
+        long long took = monotonic_usec() - started;
+        slowest = took > slowest ? took : slowest;
+    }
+    audit_forward_get_stats(&stats);
+    TEST_ASSERT(stats.records > 0, "some records sent before the socket filled");
+    TEST_ASSERT(stats.spilled > 0, "the rest spilled");
+    TEST_ASSERT(slowest < 100000, "no call waited on the collector");
+
+    close_audit_forward();
+    audit_forward_get_stats(&stats);
+    TEST_ASSERT_EQ(20000, (int)(stats.records + stats.spilled), "every record sent or spilled");
+    TEST_ASSERT_EQ(0, (int)stats.dropped, "nothing dropped");
+
+    close(listener);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_child_and_untrusted_socket() {
+    printf("Running test_child_and_untrusted_socket... ");
+
+    struct audit_forward_stats stats;
+    struct collected c;
+    reset_files();
+    memset(&c, 0, sizeof(c));
+
+    int listener = start_collector(SOCK_SEQPACKET);
+    audit_forward_configure(socket_path);
+    for (int i = 0; i < 5; i++) {
+        audit_record("VIOLATION", "alice", "INTERACTIVE_SESSION", "parent", 0);
+    }
+
+    /* A forked child sends only its own records */
+    fflush(stdout);
+    pid_t child = fork();
+    if (child == 0) {
+        audit_record("VIOLATION", "alice", "INTERACTIVE_SESSION", "child", 0);
+        _exit(0);
+    }
+    waitpid(child, NULL, 0);
+    int conn = accept_forwarder(listener, 1000);
+    TEST_ASSERT(conn >= 0, "child connected");
+    drain(conn, 0, &c, 500);
+    TEST_ASSERT_EQ(1, c.records, "child's record only");
+    TEST_ASSERT_EQ((int)child, (int)c.last_pid, "sent by the child");
+    close(conn);
+
+    close_audit_forward();
+    conn = accept_forwarder(listener, 1000);
+    TEST_ASSERT(conn >= 0, "parent connected");
+    drain(conn, 0, &c, 500);
+    TEST_ASSERT_EQ(6, c.records, "parent's records sent once");
+    close(conn);
+    close(listener);
+    free(c.payload);
+
+    /* Something that is not a socket is never written to */
+    reset_files();
+    int fd = open(socket_path, O_CREAT | O_WRONLY, 0600);
+    close(fd);
+    audit_forward_configure(socket_path);
+    audit_record("COMMAND", "alice", "ok", "/usr/bin/id", 1);
+    audit_forward_get_stats(&stats);
+    TEST_ASSERT_EQ(0, stats.connected, "not connected");
+    close_audit_forward();
+    audit_forward_get_stats(&stats);
+    TEST_ASSERT_EQ(1, (int)stats.spilled, "record kept for later");
+
+    audit_forward_configure(NULL);
+    TEST_ASSERT_EQ(0, audit_forward_enabled(), "forwarding off");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+    if (!mkdtemp(test_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(journal_path, sizeof(journal_path), "%s/audit.log", test_dir);
+    snprintf(spill_path, sizeof(spill_path), "%s/audit.log.spill", test_dir);
+    snprintf(socket_path, sizeof(socket_path), "%s/collector.sock", test_dir);
+    setenv("SUDOSH_AUDIT_LOG", journal_path, 1);
+
+    printf("=== Audit Forwarding Tests ===\n");
+    test_passes += test_records_are_batched_into_frames();
+    test_passes += test_stream_collector();
+    test_passes += test_collector_down_spills_and_replays();
+    test_passes += test_stalled_collector_never_blocks();
+    test_passes += test_child_and_untrusted_socket();
+    test_count = 5;
+
+    reset_files();
+    rmdir(test_dir);
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
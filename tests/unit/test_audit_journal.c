@@ -0,0 +1,265 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char test_dir[] = "/tmp/sudosh-audit-XXXXXX";
+static char journal_path[PATH_MAX];
+static char index_path[PATH_MAX];
+
+static int count_lines(const char *path) {
+    FILE *fp = fopen(path, "r");
+    int c, lines = 0;
+    if (!fp) {
+        return 0;
+    }
+    while ((c = fgetc(fp)) != EOF) {
+        lines += (c == '\n');
+    }
+    fclose(fp);
+    return lines;
+}
+
+/* Read the whole journal into memory */
+static char *read_journal(size_t *len) {
+    FILE *fp = fopen(journal_path, "r");
+    if (!fp) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    rewind(fp);
+    char *buf = malloc((size_t)size + 1);
+    *len = fread(buf, 1, (size_t)size, fp);
+    buf[*len] = '\0';
+    fclose(fp);
+    return buf;
+}
+
+static void write_journal(const char *buf, size_t len) {
+    FILE *fp = fopen(journal_path, "w");
+    fwrite(buf, 1, len, fp);
+    fclose(fp);
+}
+
+int test_records_are_chained() {
+    printf("Running test_records_are_chained... ");
+
+    struct audit_verify_result result;
+    struct stat st;
+    reset_audit_journal(journal_path);
+
+    log_command("alice", "systemctl restart nginx", 1);
+    TEST_ASSERT_EQ(1, count_lines(journal_path), "command committed immediately");
+    log_security_violation("alice", "tab\tand\nnewline");
+    TEST_ASSERT_EQ(1, count_lines(journal_path), "violation batched");
+    log_authentication("alice", 0);
+    TEST_ASSERT_EQ(3, count_lines(journal_path), "durable record flushes the batch");
+
+    TEST_ASSERT_EQ(0, stat(journal_path, &st), "journal exists");
+    TEST_ASSERT_EQ(0600, st.st_mode & 0777, "journal is private");
+
+    size_t len;
+    char *buf = read_journal(&len);
+    TEST_ASSERT_NOT_NULL(buf, "journal read");
+    TEST_ASSERT(strncmp(buf, "seq=1\t", 6) == 0, "sequence starts at 1");
+    TEST_ASSERT(strstr(buf, "prev=0000000000000000000000000000000000000000000000000000000000000000") != NULL,
+                "first record chains to genesis");
+    TEST_ASSERT(strstr(buf, "msg=systemctl restart nginx\t") != NULL, "command recorded");
+    TEST_ASSERT(strstr(buf, "msg=tab\\tand\\nnewline\t") != NULL, "control characters escaped");
+    TEST_ASSERT(strstr(buf, "type=AUTH\t") != NULL && strstr(buf, "status=failed\t") != NULL, "auth recorded");
+    free(buf);
+
+    TEST_ASSERT_EQ(0, verify_audit_log(journal_path, 2, &result), "chain verifies");
+    TEST_ASSERT_EQ(3, (int)result.records, "three records");
+    TEST_ASSERT_EQ(3, (int)result.durable_seq, "sync state reached the last record");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_tampering_detected() {
+    printf("Running test_tampering_detected... ");
+
+    struct audit_verify_result result;
+    size_t len;
+    reset_audit_journal(journal_path);
+    for (int i = 0; i < 5; i++) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "/usr/bin/id %d", i);
+        log_command("alice", msg, 1);
+    }
+    char *original = read_journal(&len);
+    TEST_ASSERT_NOT_NULL(original, "journal read");
+    TEST_ASSERT_EQ(0, verify_audit_log(journal_path, 1, &result), "untouched journal verifies");
+
+    /* Edit a command in place */
+    char *edited = safe_strdup(original);
+    char *target = strstr(edited, "/usr/bin/id 2");
+    target[10] = 'x';
+    write_journal(edited, len);
+    TEST_ASSERT_EQ(1, verify_audit_log(journal_path, 1, &result), "edit detected");
+    TEST_ASSERT(strstr(result.error, "hash mismatch") != NULL, "reported as modified");
+    TEST_ASSERT_EQ((long long)(strstr(original, "seq=3\t") - original), result.error_offset, "offset of record 3");
+    TEST_ASSERT_EQ(2, (int)result.records, "records before the edit counted");
+    free(edited);
+
+    /* Remove the third record entirely */
+    char *third = strstr(original, "seq=3\t");
+    char *fourth = strstr(original, "seq=4\t");
+    char *removed = malloc(len);
+    size_t head = (size_t)(third - original);
+    memcpy(removed, original, head);
+    memcpy(removed + head, fourth, len - (size_t)(fourth - original));
+    write_journal(removed, len - (size_t)(fourth - third));
+    TEST_ASSERT_EQ(1, verify_audit_log(journal_path, 1, &result), "removal detected");
+    TEST_ASSERT(strstr(result.error, "chain broken") != NULL, "reported as broken chain");
+    free(removed);
+
+    /* Cut the last record off */
+    char *fifth = strstr(original, "seq=5\t");
+    write_journal(original, (size_t)(fifth - original));
+    TEST_ASSERT_EQ(1, verify_audit_log(journal_path, 1, &result), "truncation detected");
+    TEST_ASSERT(strstr(result.error, "truncated") != NULL, "reported as truncated");
+
+    write_journal(original, len);
+    TEST_ASSERT_EQ(0, verify_audit_log(journal_path, 1, &result), "restored journal verifies");
+    free(original);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_concurrent_sessions_group_commit() {
+    printf("Running test_concurrent_sessions_group_commit... ");
+
+    struct audit_verify_result result;
+    const int writers = 8, per_writer = 50;
+    reset_audit_journal(journal_path);
+
+    fflush(stdout);
+    for (int w = 0; w < writers; w++) {
+        if (fork() == 0) {
+            close_audit_journal();
+            for (int i = 0; i < per_writer; i++) {
+                char msg[64];
+                snprintf(msg, sizeof(msg), "writer %d command %d", w, i);
+                log_command("alice", msg, 1);
+            }
+            _exit(0);
+        }
+    }
+    for (int w = 0; w < writers; w++) {
+        wait(NULL);
+    }
+
+    TEST_ASSERT_EQ(writers * per_writer, count_lines(journal_path), "every record written once");
+    TEST_ASSERT_EQ(0, verify_audit_log(journal_path, 4, &result), "interleaved writers form one chain");
+    TEST_ASSERT_EQ(writers * per_writer, (int)result.last_seq, "sequence is gapless");
+    TEST_ASSERT(result.syncs > 0 && result.syncs <= (unsigned long long)(writers * per_writer),
+                "at most one fsync per record");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_parallel_verify_of_large_journal() {
+    printf("Running test_parallel_verify_of_large_journal... ");
+
+    struct audit_verify_result single, parallel;
+    char msg[256];
+    size_t len;
+    reset_audit_journal(journal_path);
+
+    /* Batched violations: about 6 MB, several verifier chunks */
+    memset(msg, 'v', sizeof(msg) - 1);
+    msg[sizeof(msg) - 1] = '\0';
+    for (int i = 0; i < 15000; i++) {
+        audit_record("VIOLATION", "alice", "INTERACTIVE_SESSION", msg, 0);
+    }
+    audit_flush();
+
+    TEST_ASSERT_EQ(0, verify_audit_log(journal_path, 1, &single), "single-threaded verify");
+    TEST_ASSERT_EQ(0, verify_audit_log(journal_path, 4, &parallel), "parallel verify");
+    TEST_ASSERT_EQ(15000, (int)parallel.records, "all records");
+    TEST_ASSERT(parallel.threads > 1, "several threads used");
+    TEST_ASSERT(parallel.syncs < 15000 / 8, "batched into few commits");
+
+    /* A change deep in the file is found by whichever thread owns it */
+    char *buf = read_journal(&len);
+    char *victim = strstr(buf + len / 2, "\nseq=") + 1;
+    long long offset = victim - buf;
+    victim[strlen("seq=") + 40] ^= 1;
+    write_journal(buf, len);
+    TEST_ASSERT_EQ(1, verify_audit_log(journal_path, 4, &parallel), "tampering found");
+    TEST_ASSERT_EQ(offset, parallel.error_offset, "exact record reported");
+    free(buf);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_torn_record_is_discarded() {
+    printf("Running test_torn_record_is_discarded... ");
+
+    struct audit_verify_result result;
+    reset_audit_journal(journal_path);
+    log_command("alice", "/usr/bin/true", 1);
+    close_audit_journal();
+
+    /* A crash mid-write leaves half a record */
+    FILE *fp = fopen(journal_path, "a");
+    fputs("seq=2\ttime=1.0\ttype=COMM", fp);
+    fclose(fp);
+    TEST_ASSERT_EQ(1, verify_audit_log(journal_path, 1, &result), "torn record flagged");
+
+    log_command("alice", "/usr/bin/false", 0);
+    TEST_ASSERT_EQ(0, verify_audit_log(journal_path, 1, &result), "chain continues after the torn record");
+    TEST_ASSERT_EQ(2, (int)result.records, "torn record replaced");
+
+    /* Untrusted journals are not written */
+    reset_audit_journal(journal_path);
+    int fd = open(journal_path, O_CREAT | O_WRONLY, 0666);
+    fchmod(fd, 0666);
+    close(fd);
+    log_command("alice", "/usr/bin/true", 1);
+    TEST_ASSERT_EQ(0, count_lines(journal_path), "world-writable journal ignored");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+    if (!mkdtemp(test_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(journal_path, sizeof(journal_path), "%s/audit.log", test_dir);
+    snprintf(index_path, sizeof(index_path), "%s/audit.log.idx", test_dir);
+    setenv("SUDOSH_AUDIT_LOG", journal_path, 1);
+
+    printf("=== Audit Journal Tests ===\n");
+    test_passes += test_records_are_chained();
+    test_passes += test_tampering_detected();
+    test_passes += test_concurrent_sessions_group_commit();
+    test_passes += test_parallel_verify_of_large_journal();
+    test_passes += test_torn_record_is_discarded();
+    test_count = 5;
+
+    reset_audit_journal(journal_path);
+    rmdir(test_dir);
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
@@ -0,0 +1,303 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char test_dir[] = "/tmp/sudosh-audit-query-XXXXXX";
+static char journal_path[PATH_MAX];
+static char index_path[PATH_MAX];
+
+/* Collected search results */
+struct hits {
+    int count;
+    char last[AUDIT_MAX_RECORD];
+};
+
+static void collect(const char *record, size_t len, void *ctx) {
+    struct hits *hits = ctx;
+    hits->count++;
+    snprintf(hits->last, sizeof(hits->last), "%.*s", (int)len, record);
+}
+
+static int run_query(const struct audit_query *query, struct audit_query_stats *stats, struct hits *hits) {
+    memset(hits, 0, sizeof(*hits));
+    return audit_query_run(journal_path, query, collect, hits, stats);
+}
+
+/* Append a hand-made record; the index does not check the hash chain */
+static void append_record(int seq, long when, const char *type, const char *user, const char *host,
+                          const char *status, const char *msg) {
+    FILE *fp = fopen(journal_path, "a");
+    fprintf(fp, "seq=%d\ttime=%ld.000000\ttype=%s\thost=%s\tuser=%s\trunas=root\ttty=pts/0\t"
+                "status=%s\tpwd=/root\tmsg=%s\tprev=x\thash=y\n", seq, when, type, host, user, status, msg);
+    fclose(fp);
+    chmod(journal_path, 0600);
+}
+
+static long index_entries(void) {
+    struct stat st;
+    if (stat(index_path, &st) != 0) {
+        return -1;
+    }
+    return (long)((st.st_size - 64) / 40);
+}
+
+int test_writers_maintain_index() {
+    printf("Running test_writers_maintain_index... ");
+
+    struct audit_query query;
+    struct audit_query_stats stats;
+    struct hits hits;
+    struct stat st;
+    reset_audit_journal(journal_path);
+
+    log_command("alice", "systemctl restart nginx", 1);
+    log_command("bob", "/usr/bin/systemctl status sshd", 1);
+    log_command("alice", "pipeline: ps aux | grep sshd", 1);
+    log_command("alice", "/bin/false", 0);
+    log_security_violation("bob", "blocked shell");
+    close_audit_journal();
+
+    TEST_ASSERT_EQ(0, stat(index_path, &st), "index created");
+    TEST_ASSERT_EQ(0600, st.st_mode & 0777, "index is private");
+    TEST_ASSERT_EQ(5, (int)index_entries(), "one entry per record");
+
+    memset(&query, 0, sizeof(query));
+    query.command = "systemctl";
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "query ran");
+    TEST_ASSERT_EQ(2, hits.count, "systemctl by name and by path");
+    TEST_ASSERT_EQ(1, stats.indexed, "answered from the index");
+
+    query.user = "alice";
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "query ran");
+    TEST_ASSERT_EQ(1, hits.count, "user and command combined");
+    TEST_ASSERT(strstr(hits.last, "msg=systemctl restart nginx\t") != NULL, "right record");
+    TEST_ASSERT_EQ(1, (int)stats.read, "only the match was read from the journal");
+
+    memset(&query, 0, sizeof(query));
+    query.command = "grep";
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "query ran");
+    TEST_ASSERT_EQ(1, hits.count, "later pipeline stages are indexed");
+
+    memset(&query, 0, sizeof(query));
+    query.failed_only = 1;
+    query.type = "COMMAND";
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "query ran");
+    TEST_ASSERT_EQ(1, hits.count, "failed commands");
+    TEST_ASSERT(strstr(hits.last, "msg=/bin/false\t") != NULL, "the failed command");
+
+    memset(&query, 0, sizeof(query));
+    query.type = "VIOLATION";
+    query.user = "bob";
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "query ran");
+    TEST_ASSERT_EQ(1, hits.count, "batched violation indexed at flush");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_time_range_uses_index_order() {
+    printf("Running test_time_range_uses_index_order... ");
+
+    struct audit_query query;
+    struct audit_query_stats stats;
+    struct hits hits;
+    reset_audit_journal(journal_path);
+
+    /* 1000 records one minute apart, plus a batched record written late */
+    for (int i = 0; i < 1000; i++) {
+        append_record(i + 1, 1000000 + i * 60L, "COMMAND", i % 2 ? "alice" : "bob", "web01",
+                      "ok", i % 10 ? "/usr/bin/id" : "systemctl reload nginx");
+        if (i == 500) {
+            append_record(10001, 1000000 + 100 * 60L, "VIOLATION", "alice", "web01", "x", "late");
+        }
+    }
+
+    memset(&query, 0, sizeof(query));
+    query.since = 1000000 + 900 * 60L;
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "query ran");
+    TEST_ASSERT_EQ(100, hits.count, "last 100 minutes");
+    TEST_ASSERT(stats.scanned <= 101, "binary search skipped older entries");
+    TEST_ASSERT_EQ(1001, (int)index_entries(), "index built on first query");
+
+    /* The late record sorts by its own time even though it was written after newer ones */
+    query.since = 1000000 + 100 * 60L;
+    query.until = 1000000 + 100 * 60L;
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "query ran");
+    TEST_ASSERT_EQ(2, hits.count, "both records of that second");
+
+    query.since = 1000000 + 95 * 60L;
+    query.until = 1000000 + 104 * 60L;
+    query.user = "bob";
+    query.command = "systemctl";
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "query ran");
+    TEST_ASSERT_EQ(1, hits.count, "bob's reload at minute 100");
+
+    memset(&query, 0, sizeof(query));
+    query.host = "web01";
+    query.limit = 7;
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "query ran");
+    TEST_ASSERT_EQ(7, hits.count, "limit honored");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_index_recovers() {
+    printf("Running test_index_recovers... ");
+
+    struct audit_query query;
+    struct audit_query_stats stats;
+    struct hits hits;
+    reset_audit_journal(journal_path);
+
+    for (int i = 0; i < 50; i++) {
+        append_record(i + 1, 2000000 + i, "COMMAND", "alice", "db01", "ok", "/usr/bin/systemctl status");
+    }
+    memset(&query, 0, sizeof(query));
+    query.command = "systemctl";
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "index built");
+    TEST_ASSERT_EQ(50, hits.count, "all records");
+
+    /* Records written while the index was not maintained are caught up */
+    for (int i = 50; i < 60; i++) {
+        append_record(i + 1, 2000000 + i, "COMMAND", "alice", "db01", "ok", "/usr/bin/systemctl status");
+    }
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "query ran");
+    TEST_ASSERT_EQ(60, hits.count, "index caught up");
+    TEST_ASSERT_EQ(60, (int)index_entries(), "no duplicate entries");
+
+    /* A half-written record is left for later */
+    FILE *fp = fopen(journal_path, "a");
+    fputs("seq=61\ttime=2000060.0\ttype=COMMAND\tuser=alice\tmsg=systemctl", fp);
+    fclose(fp);
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "query ran");
+    TEST_ASSERT_EQ(60, hits.count, "torn record not indexed");
+
+    /* Garbage appended to the index is discarded */
+    fp = fopen(index_path, "a");
+    fputs("garbage", fp);
+    fclose(fp);
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "query ran");
+    TEST_ASSERT_EQ(60, hits.count, "index repaired");
+
+    /* A replaced journal invalidates the index */
+    unlink(journal_path);
+    for (int i = 0; i < 3; i++) {
+        append_record(i + 1, 3000000 + i, "COMMAND", "carol", "db02", "ok", "systemctl stop x");
+    }
+    TEST_ASSERT_EQ(0, run_query(&query, &stats, &hits), "query ran");
+    TEST_ASSERT_EQ(3, hits.count, "index rebuilt for the new journal");
+    TEST_ASSERT(strstr(hits.last, "user=carol") != NULL, "new records");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_untrusted_index_falls_back_to_scan() {
+    printf("Running test_untrusted_index_falls_back_to_scan... ");
+
+    struct audit_query query;
+    struct audit_query_stats indexed, scanned;
+    struct hits a, b;
+    reset_audit_journal(journal_path);
+
+    for (int i = 0; i < 200; i++) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "/usr/sbin/cmd%d arg", i % 13);
+        append_record(i + 1, 4000000 + i * 7L, i % 3 ? "COMMAND" : "AUTH", i % 5 ? "alice" : "bob",
+                      i % 2 ? "a" : "b", i % 4 ? "ok" : "failed", msg);
+    }
+    memset(&query, 0, sizeof(query));
+    query.user = "alice";
+    query.command = "cmd7";
+    query.since = 4000000 + 300;
+
+    TEST_ASSERT_EQ(0, run_query(&query, &indexed, &a), "indexed query");
+    TEST_ASSERT_EQ(1, indexed.indexed, "index used");
+
+    /* An index others can write is never used */
+    chmod(index_path, 0666);
+    TEST_ASSERT_EQ(0, run_query(&query, &scanned, &b), "scanned query");
+    TEST_ASSERT_EQ(0, scanned.indexed, "index ignored");
+    TEST_ASSERT_EQ(200, (int)scanned.scanned, "every record parsed");
+    TEST_ASSERT(a.count > 0, "matches found");
+    TEST_ASSERT_EQ(a.count, b.count, "index and scan agree");
+    TEST_ASSERT_STR_EQ(a.last, b.last, "same last match");
+
+    TEST_ASSERT_EQ(-1, audit_query_run("/nonexistent/audit.log", &query, collect, &a, &scanned),
+                   "missing journal reported");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_parse_audit_time() {
+    printf("Running test_parse_audit_time... ");
+
+    time_t now = 1700000000, t;
+    struct tm tm;
+
+    TEST_ASSERT_EQ(0, parse_audit_time("@12345", now, &t), "epoch");
+    TEST_ASSERT_EQ(12345, (long)t, "epoch value");
+    TEST_ASSERT_EQ(0, parse_audit_time("15m", now, &t), "minutes");
+    TEST_ASSERT_EQ((long)(now - 900), (long)t, "minutes value");
+    TEST_ASSERT_EQ(0, parse_audit_time("7d", now, &t), "days");
+    TEST_ASSERT_EQ((long)(now - 7 * 86400), (long)t, "days value");
+
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = 2026 - 1900;
+    tm.tm_mon = 9;
+    tm.tm_mday = 18;
+    tm.tm_hour = 14;
+    tm.tm_min = 3;
+    tm.tm_isdst = -1;
+    time_t expected = mktime(&tm);
+    TEST_ASSERT_EQ(0, parse_audit_time("2026-10-18 14:03", now, &t), "local date and time");
+    TEST_ASSERT_EQ((long)expected, (long)t, "date value");
+    TEST_ASSERT_EQ(0, parse_audit_time("2026-10-18T14:03:00", now, &t), "ISO separator");
+    TEST_ASSERT_EQ((long)expected, (long)t, "ISO value");
+
+    TEST_ASSERT_EQ(-1, parse_audit_time("yesterday", now, &t), "words rejected");
+    TEST_ASSERT_EQ(-1, parse_audit_time("2026-13-01", now, &t), "bad month rejected");
+    TEST_ASSERT_EQ(-1, parse_audit_time("5x", now, &t), "bad unit rejected");
+    TEST_ASSERT_EQ(-1, parse_audit_time("2026-10-18 14:03 extra", now, &t), "trailing text rejected");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+    if (!mkdtemp(test_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(journal_path, sizeof(journal_path), "%s/audit.log", test_dir);
+    snprintf(index_path, sizeof(index_path), "%s/audit.log.idx", test_dir);
+    setenv("SUDOSH_AUDIT_LOG", journal_path, 1);
+
+    printf("=== Audit Query Tests ===\n");
+    test_passes += test_writers_maintain_index();
+    test_passes += test_time_range_uses_index_order();
+    test_passes += test_index_recovers();
+    test_passes += test_untrusted_index_falls_back_to_scan();
+    test_passes += test_parse_audit_time();
+    test_count = 5;
+
+    reset_audit_journal(journal_path);
+    rmdir(test_dir);
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char marker_dir[256];
+
+static int marker_exists(const char *name) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", marker_dir, name);
+    return access(path, F_OK) == 0;
+}
+
+int test_parse_splits_on_operators() {
+    printf("Running test_parse_splits_on_operators... ");
+
+    struct command_list list;
+    TEST_ASSERT_EQ(0, parse_command_list("ls -l ; id && whoami || date", &list), "should parse list");
+    TEST_ASSERT_EQ(4, list.num_elements, "should have four elements");
+    TEST_ASSERT_STR_EQ("ls -l", list.elements[0].command, "first element");
+    TEST_ASSERT_EQ(LIST_OP_NONE, list.elements[0].op, "first element has no operator");
+    TEST_ASSERT_EQ(LIST_OP_SEQUENCE, list.elements[1].op, "second joined by ;");
+    TEST_ASSERT_EQ(LIST_OP_AND, list.elements[2].op, "third joined by &&");
+    TEST_ASSERT_EQ(LIST_OP_OR, list.elements[3].op, "fourth joined by ||");
+    free_command_list(&list);
+
+    TEST_ASSERT_EQ(0, parse_command_list("ps aux | grep ssh && uptime", &list), "should parse pipeline element");
+    TEST_ASSERT_EQ(2, list.num_elements, "pipeline stays one element");
+    TEST_ASSERT_STR_EQ("ps aux | grep ssh", list.elements[0].command, "pipeline element text");
+    free_command_list(&list);
+
+    TEST_ASSERT_EQ(0, parse_command_list("uptime;", &list), "trailing ; is allowed");
+    TEST_ASSERT_EQ(1, list.num_elements, "trailing ; adds no element");
+    free_command_list(&list);
+
+    TEST_ASSERT_EQ(-1, parse_command_list("uptime &&", &list), "dangling && is rejected");
+    TEST_ASSERT_EQ(-1, parse_command_list("; uptime", &list), "leading ; is rejected");
+    TEST_ASSERT_EQ(-1, parse_command_list("id ;; uptime", &list), "empty element is rejected");
+
+    TEST_ASSERT(is_command_list("id && uptime"), "&& makes a list");
+    TEST_ASSERT(!is_command_list("ps aux | grep x"), "single pipe is not a list");
+    TEST_ASSERT(!is_command_list("grep 'a;b' file"), "quoted ; is not a list");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_validation_rejects_whole_plan() {
+    printf("Running test_validation_rejects_whole_plan... ");
+
+    struct command_list list;
+    TEST_ASSERT_EQ(0, parse_command_list("ls && whoami", &list), "should parse");
+    TEST_ASSERT_EQ(1, validate_command_list(&list), "safe plan should validate");
+    free_command_list(&list);
+
+    TEST_ASSERT_EQ(0, parse_command_list("ls ; rm -rf /", &list), "should parse");
+    TEST_ASSERT_EQ(0, validate_command_list(&list), "one bad element rejects the plan");
+    free_command_list(&list);
+
+    TEST_ASSERT_EQ(0, parse_command_list("cd /tmp && ls", &list), "should parse");
+    TEST_ASSERT_EQ(0, validate_command_list(&list), "built-ins cannot be planned");
+    free_command_list(&list);
+
+    TEST_ASSERT_EQ(0, parse_command_list("ls && bash", &list), "should parse");
+    TEST_ASSERT_EQ(0, validate_command_list(&list), "shells cannot be planned");
+    free_command_list(&list);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_execution_short_circuits() {
+    printf("Running test_execution_short_circuits... ");
+
+    struct user_info *user = get_user_info(getpwuid(getuid())->pw_name);
+    TEST_ASSERT_NOT_NULL(user, "should get user info");
+
+    char line[1024];
+    snprintf(line, sizeof(line),
+             "/bin/false && /usr/bin/touch %s/a ; /bin/true || /usr/bin/touch %s/b ; "
+             "/bin/false || /usr/bin/touch %s/c",
+             marker_dir, marker_dir, marker_dir);
+
+    struct command_list list;
+    TEST_ASSERT_EQ(0, parse_command_list(line, &list), "should parse");
+    int status = execute_command_list(&list, user, user->username);
+    free_command_list(&list);
+
+    TEST_ASSERT_EQ(0, status, "status is the last element run");
+    TEST_ASSERT(!marker_exists("a"), "&& after failure is skipped");
+    TEST_ASSERT(!marker_exists("b"), "|| after success is skipped");
+    TEST_ASSERT(marker_exists("c"), "|| after failure runs");
+
+    TEST_ASSERT_EQ(0, parse_command_list("/bin/true && /bin/false", &list), "should parse");
+    TEST_ASSERT(execute_command_list(&list, user, user->username) != 0, "failing last element is reported");
+    free_command_list(&list);
+
+    free_user_info(user);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    char path[PATH_MAX];
+
+    setenv("SUDOSH_TEST_MODE", "1", 1);
+    setenv("USER", getpwuid(getuid())->pw_name, 0);
+    test_mode = 1;
+    snprintf(marker_dir, sizeof(marker_dir), "/tmp/sudosh_command_list_%d", (int)getpid());
+    mkdir(marker_dir, 0700);
+
+    printf("=== Command List Tests ===\n");
+    test_passes += test_parse_splits_on_operators();
+    test_passes += test_validation_rejects_whole_plan();
+    test_passes += test_execution_short_circuits();
+    test_count = 3;
+
+    snprintf(path, sizeof(path), "%s/c", marker_dir);
+    unlink(path);
+    rmdir(marker_dir);
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
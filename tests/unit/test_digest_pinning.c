@@ -0,0 +1,318 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char test_dir[] = "/tmp/sudosh-digest-XXXXXX";
+static char tool_path[PATH_MAX];
+static char sudoers_path[PATH_MAX];
+static char cache_path[PATH_MAX];
+
+static void write_file(const char *path, const char *content, mode_t mode) {
+    FILE *fp = fopen(path, "w");
+    if (fp) {
+        fputs(content, fp);
+        fclose(fp);
+    }
+    chmod(path, mode);
+}
+
+static void file_digest_hex(const char *path, char *hex) {
+    char buf[4096];
+    FILE *fp = fopen(path, "r");
+    size_t n = fp ? fread(buf, 1, sizeof(buf), fp) : 0;
+    if (fp) {
+        fclose(fp);
+    }
+    sha256_hex(buf, n, hex);
+}
+
+static void write_sudoers(const char *pin_hex) {
+    char rule[PATH_MAX + 1024];
+    if (snprintf(rule, sizeof(rule), "%s ALL = NOPASSWD: sha256:%s %s, /usr/bin/id\n",
+                 getenv("USER"), pin_hex, tool_path) >= (int)sizeof(rule)) {
+        return;
+    }
+    write_file(sudoers_path, rule, 0600);
+}
+
+int test_sha256_vectors() {
+    printf("Running test_sha256_vectors... ");
+
+    char hex[SHA256_HEX_LENGTH + 1];
+    sha256_hex("abc", 3, hex);
+    TEST_ASSERT_STR_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", hex, "abc");
+
+    /* One million 'a' exercises the multi-block path and odd-sized updates */
+    struct sha256_ctx ctx;
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    char chunk[1001];
+    memset(chunk, 'a', sizeof(chunk));
+    sha256_init(&ctx);
+    for (int i = 0; i < 1000; i++) {
+        sha256_update(&ctx, chunk, (i % 2) ? 999 : 1001);
+    }
+    sha256_final(&ctx, digest);
+    sha256_to_hex(digest, hex);
+    TEST_ASSERT_STR_EQ("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", hex, "million a");
+    TEST_ASSERT_NOT_NULL(sha256_implementation(), "implementation reported");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_parse_digest_spec() {
+    printf("Running test_parse_digest_spec... ");
+
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    char hex[SHA256_HEX_LENGTH + 1];
+    const char *command = NULL;
+
+    TEST_ASSERT_EQ(1, parse_digest_spec("sha256:ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad /usr/bin/abc",
+                                        digest, &command), "hex digest");
+    TEST_ASSERT_STR_EQ("/usr/bin/abc", command, "command after digest");
+    sha256_to_hex(digest, hex);
+    TEST_ASSERT_STR_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", hex, "hex decoded");
+
+    TEST_ASSERT_EQ(1, parse_digest_spec("sha256:ungWv48Bz+pBQUDeXa4iI7ADYaOWF3qctBD/YfIAFa0= /usr/bin/abc",
+                                        digest, &command), "base64 digest");
+    sha256_to_hex(digest, hex);
+    TEST_ASSERT_STR_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", hex, "base64 decoded");
+
+    TEST_ASSERT_EQ(0, parse_digest_spec("/usr/bin/abc", digest, &command), "no digest");
+    TEST_ASSERT_EQ(-1, parse_digest_spec("sha512:abcd /usr/bin/abc", digest, &command), "unsupported algorithm");
+    TEST_ASSERT_EQ(-1, parse_digest_spec("sha256:xyz /usr/bin/abc", digest, &command), "malformed digest");
+    TEST_ASSERT_EQ(-1, parse_digest_spec("sha256:ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+                                         digest, &command), "digest without command");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_sudoers_pins() {
+    printf("Running test_sudoers_pins... ");
+
+    char hex[SHA256_HEX_LENGTH + 1];
+    char pins[MAX_DIGEST_PINS][SHA256_HEX_LENGTH + 1];
+    file_digest_hex(tool_path, hex);
+    write_sudoers(hex);
+
+    struct sudoers_config *sudoers = parse_sudoers_file(sudoers_path);
+    TEST_ASSERT_NOT_NULL(sudoers, "sudoers parsed");
+    TEST_ASSERT_EQ(1, check_sudoers_command_permission(getenv("USER"), "localhost", tool_path, sudoers),
+                   "pinned command still authorized by path");
+    TEST_ASSERT_EQ(1, get_sudoers_command_digests(getenv("USER"), "localhost", tool_path, sudoers,
+                                                  pins, MAX_DIGEST_PINS), "one pin");
+    TEST_ASSERT_STR_EQ(hex, pins[0], "pin value");
+    TEST_ASSERT_EQ(0, get_sudoers_command_digests(getenv("USER"), "localhost", "/usr/bin/id", sudoers,
+                                                  pins, MAX_DIGEST_PINS), "unpinned command");
+    free_sudoers_config(sudoers);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_digest_cache() {
+    printf("Running test_digest_cache... ");
+
+    struct verified_binary vb;
+    unsigned char digest[SHA256_DIGEST_LENGTH];
+    char hex[SHA256_HEX_LENGTH + 1], expected[SHA256_HEX_LENGTH + 1];
+    int cached = -1;
+
+    reset_digest_cache();
+    unlink(cache_path);
+    file_digest_hex(tool_path, expected);
+
+    TEST_ASSERT_EQ(0, open_verified_binary(tool_path, NULL, &vb), "verified");
+    TEST_ASSERT_EQ(0, get_binary_digest(&vb, digest, &cached), "digest computed");
+    TEST_ASSERT_EQ(0, cached, "first lookup hashes");
+    sha256_to_hex(digest, hex);
+    TEST_ASSERT_STR_EQ(expected, hex, "digest value");
+
+    TEST_ASSERT_EQ(0, get_binary_digest(&vb, digest, &cached), "digest again");
+    TEST_ASSERT_EQ(1, cached, "second lookup is a cache hit");
+
+    /* A new process (fresh memory) finds it in the shared file */
+    struct stat st;
+    TEST_ASSERT_EQ(0, stat(cache_path, &st), "cache file written");
+    TEST_ASSERT_EQ(0600, st.st_mode & 0777, "cache file is private");
+    reset_digest_cache();
+    TEST_ASSERT_EQ(0, get_binary_digest(&vb, digest, &cached), "digest after reload");
+    TEST_ASSERT_EQ(1, cached, "loaded from cache file");
+    close_verified_binary(&vb);
+
+    /* Rewriting the file in place changes its identity and misses */
+    write_file(tool_path, "#!/bin/sh\nexit 3\n", 0755);
+    file_digest_hex(tool_path, expected);
+    TEST_ASSERT_EQ(0, open_verified_binary(tool_path, NULL, &vb), "verified again");
+    TEST_ASSERT_EQ(0, get_binary_digest(&vb, digest, &cached), "digest after change");
+    TEST_ASSERT_EQ(0, cached, "changed file is rehashed");
+    sha256_to_hex(digest, hex);
+    TEST_ASSERT_STR_EQ(expected, hex, "new digest");
+    close_verified_binary(&vb);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_pins_follow_sudoers() {
+    printf("Running test_pins_follow_sudoers... ");
+
+    char hex[SHA256_HEX_LENGTH + 1];
+    char zeros[SHA256_HEX_LENGTH + 1];
+    struct verified_binary vb;
+
+    file_digest_hex(tool_path, hex);
+    memset(zeros, '0', SHA256_HEX_LENGTH);
+    zeros[SHA256_HEX_LENGTH] = '\0';
+    write_sudoers(hex);
+    sleep(2);           /* Settled inputs: the loaded pins are reused */
+
+    TEST_ASSERT_EQ(0, open_verified_binary(tool_path, NULL, &vb), "verified");
+    TEST_ASSERT_EQ(0, enforce_command_digest(getenv("USER"), &vb), "matching pin");
+    TEST_ASSERT_EQ(0, enforce_command_digest(getenv("USER"), &vb), "matching pin again");
+
+    /* Same size, new pin: the sudoers identity changes and is reread */
+    write_sudoers(zeros);
+    fflush(stdout);
+    TEST_ASSERT_EQ(-1, enforce_command_digest(getenv("USER"), &vb), "new pin enforced");
+    write_sudoers(hex);
+    TEST_ASSERT_EQ(0, enforce_command_digest(getenv("USER"), &vb), "pin restored");
+    close_verified_binary(&vb);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_execution_enforces_pin() {
+    printf("Running test_execution_enforces_pin... ");
+
+    char hex[SHA256_HEX_LENGTH + 1];
+    struct command_info cmd;
+    struct user_info *user = get_user_info(getenv("USER"));
+    TEST_ASSERT_NOT_NULL(user, "user info");
+
+    write_file(tool_path, "#!/bin/sh\nexit 5\n", 0755);
+    file_digest_hex(tool_path, hex);
+    write_sudoers(hex);
+
+    TEST_ASSERT_EQ(0, parse_command(tool_path, &cmd), "parse");
+    fflush(stdout);
+    TEST_ASSERT_EQ(5, execute_command(&cmd, user), "matching digest runs");
+
+    /* Same path, different contents: refused */
+    write_file(tool_path, "#!/bin/sh\nexit 6\n", 0755);
+    fflush(stdout);
+    TEST_ASSERT_EQ(EXIT_COMMAND_NOT_FOUND, execute_command(&cmd, user), "mismatch refused");
+    free_command_info(&cmd);
+
+    /* Pipelines check every stage: pin cat to a digest it cannot have */
+    char *cat_path = find_command_in_path("cat");
+    TEST_ASSERT_NOT_NULL(cat_path, "cat found");
+    char rule[1024];
+    snprintf(rule, sizeof(rule), "%s ALL = NOPASSWD: sha256:%064d %s\n", getenv("USER"), 0, cat_path);
+    write_file(sudoers_path, rule, 0600);
+    free(cat_path);
+
+    struct pipeline_info pipeline;
+    TEST_ASSERT_EQ(0, parse_pipeline("echo pinned | cat", &pipeline), "parse pipeline");
+    fflush(stdout);
+    TEST_ASSERT(execute_pipeline(&pipeline, user) != 0, "pipeline refused");
+    free_pipeline_info(&pipeline);
+
+    free_user_info(user);
+    printf("PASS\n");
+    return 1;
+}
+
+int test_builtin_pager_honors_pin() {
+    printf("Running test_builtin_pager_honors_pin... ");
+
+    char *less_path = find_command_in_path("less");
+    if (!less_path) {
+        printf("SKIP (less not installed)\n");
+        return 1;
+    }
+    char rule[PATH_MAX + 256];
+    snprintf(rule, sizeof(rule), "%s ALL = NOPASSWD: sha256:%064d %s\n", getenv("USER"), 0, less_path);
+    write_file(sudoers_path, rule, 0600);
+    free(less_path);
+
+    /* Bare "less FILE" on a terminal would be paged in-process */
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+            _exit(2);
+        }
+        int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+        if (slave < 0 || dup2(slave, STDOUT_FILENO) < 0) {
+            _exit(2);
+        }
+        alarm(5);       /* A pager that starts would wait for keys */
+        struct command_info cmd;
+        struct user_info *user = get_user_info(getenv("USER"));
+        char command[PATH_MAX + 8];
+        snprintf(command, sizeof(command), "less %s", sudoers_path);
+        if (!user || parse_command(command, &cmd) != 0) {
+            _exit(2);
+        }
+        _exit(execute_command(&cmd, user) == EXIT_COMMAND_NOT_FOUND ? 0 : 1);
+    }
+    int status;
+    TEST_ASSERT(pid > 0 && waitpid(pid, &status, 0) == pid, "child ran");
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0, "pinned pager refused before paging");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+    if (!mkdtemp(test_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    char sudoers_dir[PATH_MAX];
+    snprintf(tool_path, sizeof(tool_path), "%s/tool", test_dir);
+    snprintf(sudoers_path, sizeof(sudoers_path), "%s/sudoers", test_dir);
+    snprintf(sudoers_dir, sizeof(sudoers_dir), "%s/sudoers.d", test_dir);
+    snprintf(cache_path, sizeof(cache_path), "%s/digest_cache", test_dir);
+    mkdir(sudoers_dir, 0700);
+    write_file(tool_path, "#!/bin/sh\nexit 0\n", 0755);
+    setenv("SUDOSH_SUDOERS_PATH", sudoers_path, 1);
+    setenv("SUDOSH_SUDOERS_DIR", sudoers_dir, 1);
+    setenv("SUDOSH_DIGEST_CACHE", cache_path, 1);
+
+    printf("=== Digest Pinning Tests ===\n");
+    test_passes += test_sha256_vectors();
+    test_passes += test_parse_digest_spec();
+    test_passes += test_sudoers_pins();
+    test_passes += test_digest_cache();
+    test_passes += test_pins_follow_sudoers();
+    test_passes += test_execution_enforces_pin();
+    test_passes += test_builtin_pager_honors_pin();
+    test_count = 7;
+
+    unlink(tool_path);
+    unlink(sudoers_path);
+    unlink(cache_path);
+    rmdir(sudoers_dir);
+    rmdir(test_dir);
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#include "test_framework.h"
+#include "sudosh.h"
+#include <sys/stat.h>
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char base_dir[256];
+
+static int cwd_is(const char *expected) {
+    char *cwd = getcwd(NULL, 0);
+    int same = cwd && strcmp(cwd, expected) == 0;
+    free(cwd);
+    return same;
+}
+
+int test_pushd_popd_use_handles() {
+    printf("Running test_pushd_popd_use_handles... ");
+
+    char a[PATH_MAX], b[PATH_MAX], renamed[PATH_MAX];
+    snprintf(a, sizeof(a), "%s/a", base_dir);
+    snprintf(b, sizeof(b), "%s/b", base_dir);
+    snprintf(renamed, sizeof(renamed), "%s/a-renamed", base_dir);
+
+    TEST_ASSERT_EQ(1, change_directory(a), "cd into a");
+    TEST_ASSERT_EQ(1, pushd(b), "pushd b");
+    TEST_ASSERT(cwd_is(b), "cwd should be b after pushd");
+    TEST_ASSERT_STR_EQ(b, get_directory_stack_cwd(), "stack cwd should track pushd");
+
+    /* The saved handle still reaches the directory after it is renamed */
+    TEST_ASSERT_EQ(0, rename(a, renamed), "rename a");
+    TEST_ASSERT_EQ(1, popd(), "popd back to a");
+    TEST_ASSERT(cwd_is(renamed), "popd should follow the open handle");
+    TEST_ASSERT_EQ(0, rename(renamed, a), "rename back");
+
+    TEST_ASSERT_EQ(0, popd(), "popd on empty stack fails");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_cd_dash_returns() {
+    printf("Running test_cd_dash_returns... ");
+
+    char a[PATH_MAX], b[PATH_MAX];
+    snprintf(a, sizeof(a), "%s/a", base_dir);
+    snprintf(b, sizeof(b), "%s/b", base_dir);
+
+    TEST_ASSERT_EQ(1, change_directory(a), "cd a");
+    TEST_ASSERT_EQ(1, change_directory(b), "cd b");
+    TEST_ASSERT_EQ(1, change_directory("-"), "cd - to a");
+    TEST_ASSERT(cwd_is(a), "cd - should return to a");
+    TEST_ASSERT_EQ(1, change_directory("-"), "cd - to b");
+    TEST_ASSERT(cwd_is(b), "cd - should toggle back to b");
+    TEST_ASSERT_EQ(0, change_directory("/nonexistent/sudosh/dir"), "missing dir fails");
+    TEST_ASSERT(cwd_is(b), "failed cd keeps cwd");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_ring_drops_oldest() {
+    printf("Running test_ring_drops_oldest... ");
+
+    char a[PATH_MAX];
+    snprintf(a, sizeof(a), "%s/a", base_dir);
+
+    for (int i = 0; i < MAX_DIR_STACK_DEPTH + 4; i++) {
+        TEST_ASSERT_EQ(1, pushd(a), "pushd should succeed when stack is full");
+    }
+
+    int pops = 0;
+    while (popd()) {
+        pops++;
+    }
+    TEST_ASSERT_EQ(MAX_DIR_STACK_DEPTH, pops, "stack depth should be capped");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    char path[PATH_MAX];
+
+    snprintf(base_dir, sizeof(base_dir), "/tmp/sudosh_dirstack_%d", (int)getpid());
+    mkdir(base_dir, 0700);
+    snprintf(path, sizeof(path), "%s/a", base_dir);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/b", base_dir);
+    mkdir(path, 0700);
+
+    /* Resolve symlinks (e.g. /tmp on macOS) so path comparisons are stable */
+    char *real = realpath(base_dir, NULL);
+    if (real) {
+        snprintf(base_dir, sizeof(base_dir), "%s", real);
+        free(real);
+    }
+
+    printf("=== Directory Stack Tests ===\n");
+    init_directory_stack();
+    test_passes += test_pushd_popd_use_handles();
+    test_passes += test_cd_dash_returns();
+    test_passes += test_ring_drops_oldest();
+    test_count = 3;
+    cleanup_directory_stack();
+
+    if (chdir("/") == 0) {
+        snprintf(path, sizeof(path), "%s/a", base_dir);
+        rmdir(path);
+        snprintf(path, sizeof(path), "%s/b", base_dir);
+        rmdir(path);
+        rmdir(base_dir);
+    }
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static const char *envp_get(char **envp, const char *name) {
+    size_t len = strlen(name);
+    for (char **env = envp; env && *env; env++) {
+        if (strncmp(*env, name, len) == 0 && (*env)[len] == '=') {
+            return *env + len + 1;
+        }
+    }
+    return NULL;
+}
+
+int test_template_is_prepared_once() {
+    printf("Running test_template_is_prepared_once... ");
+
+    const struct editor_template *first = get_editor_template("vi");
+    if (!first) {
+        /* No vi in this environment; nothing to prepare */
+        printf("SKIP\n");
+        return 1;
+    }
+    TEST_ASSERT(first->binary_path[0] == '/', "editor binary should be resolved");
+    TEST_ASSERT(get_editor_template("vi") == first, "second launch should reuse the template");
+
+    invalidate_editor_templates();
+    const struct editor_template *again = get_editor_template("vi");
+    TEST_ASSERT_NOT_NULL(again, "template should be rebuilt after invalidation");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_template_environment_is_sanitized() {
+    printf("Running test_template_environment_is_sanitized... ");
+
+    setenv("BASH_ENV", "/tmp/evil", 1);
+    setenv("BASH_FUNC_evil%%", "() { :; }", 1);
+    setenv("EXINIT", "!sh", 1);
+    setenv("EDITOR", "emacs", 1);
+    setenv("SUDOSH_TEMPLATE_MARKER", "kept", 1);
+    invalidate_editor_templates();
+
+    const struct editor_template *tmpl = get_editor_template("vi");
+    if (!tmpl) {
+        printf("SKIP\n");
+        return 1;
+    }
+    TEST_ASSERT_STR_EQ("/bin/false", envp_get(tmpl->envp, "SHELL"), "SHELL should be disabled");
+    TEST_ASSERT_STR_EQ("/bin/false", envp_get(tmpl->envp, "EDITOR"), "EDITOR should be overridden");
+    TEST_ASSERT_STR_EQ("set nomodeline noexrc secure", envp_get(tmpl->envp, "VIMINIT"), "VIMINIT should be secure");
+    TEST_ASSERT_NULL(envp_get(tmpl->envp, "BASH_ENV"), "BASH_ENV should be removed");
+    TEST_ASSERT_NULL(envp_get(tmpl->envp, "BASH_FUNC_evil%%"), "exported functions should be removed");
+    TEST_ASSERT_NULL(envp_get(tmpl->envp, "EXINIT"), "EXINIT should be removed");
+    TEST_ASSERT_STR_EQ("kept", envp_get(tmpl->envp, "SUDOSH_TEMPLATE_MARKER"), "other variables should pass through");
+
+    /* The session environment itself is left alone */
+    TEST_ASSERT_STR_EQ("emacs", getenv("EDITOR"), "session EDITOR should be unchanged");
+
+    unsetenv("BASH_ENV");
+    unsetenv("BASH_FUNC_evil%%");
+    unsetenv("EXINIT");
+    unsetenv("SUDOSH_TEMPLATE_MARKER");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_export_invalidates_template() {
+    printf("Running test_export_invalidates_template... ");
+
+    const struct editor_template *tmpl = get_editor_template("vi");
+    if (!tmpl) {
+        printf("SKIP\n");
+        return 1;
+    }
+    TEST_ASSERT_EQ(1, handle_export_command("export LANG=C"), "export should succeed");
+    tmpl = get_editor_template("vi");
+    TEST_ASSERT_NOT_NULL(tmpl, "template should be rebuilt");
+    TEST_ASSERT_STR_EQ("C", envp_get(tmpl->envp, "LANG"), "rebuilt template should see exported value");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_sanitize_invalidates_template() {
+    printf("Running test_sanitize_invalidates_template... ");
+
+    if (!get_editor_template("vi")) {
+        printf("SKIP\n");
+        return 1;
+    }
+    /* Changed behind the template's back, then sanitized */
+    setenv("SUDOSH_TEMPLATE_MARKER", "changed", 1);
+    sanitize_environment();
+    const struct editor_template *tmpl = get_editor_template("vi");
+    TEST_ASSERT_NOT_NULL(tmpl, "template should be rebuilt");
+    TEST_ASSERT_STR_EQ("changed", envp_get(tmpl->envp, "SUDOSH_TEMPLATE_MARKER"), "rebuilt from the new environment");
+    unsetenv("SUDOSH_TEMPLATE_MARKER");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_command_environment_is_sanitized() {
+    printf("Running test_command_environment_is_sanitized... ");
+
+    char *source[] = { "LANG=de_DE.UTF-8", "BASH_ENV=/tmp/evil", "EDITOR=emacs", NULL };
+    char **envp = build_secure_editor_envp(source);
+    TEST_ASSERT_NOT_NULL(envp, "environment built");
+    TEST_ASSERT_STR_EQ("de_DE.UTF-8", envp_get(envp, "LANG"), "command's own variables pass through");
+    TEST_ASSERT_NULL(envp_get(envp, "BASH_ENV"), "BASH_ENV should be removed");
+    TEST_ASSERT_STR_EQ("/bin/false", envp_get(envp, "EDITOR"), "EDITOR should be overridden");
+    TEST_ASSERT_NULL(envp_get(envp, "PATH"), "nothing taken from the session");
+    for (char **env = envp; *env; env++) {
+        free(*env);
+    }
+    free(envp);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_non_editors_have_no_template() {
+    printf("Running test_non_editors_have_no_template... ");
+
+    TEST_ASSERT_NULL(get_editor_template("ls"), "ls is not a secure editor");
+    TEST_ASSERT_NULL(get_editor_template("emacs"), "emacs is not a secure editor");
+    TEST_ASSERT_NULL(get_editor_template(""), "empty name has no template");
+    TEST_ASSERT_NULL(get_editor_template(NULL), "NULL name has no template");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    setenv("SUDOSH_TEST_MODE", "1", 1);
+
+    printf("=== Editor Template Tests ===\n");
+    test_passes += test_template_is_prepared_once();
+    test_passes += test_template_environment_is_sanitized();
+    test_passes += test_export_invalidates_template();
+    test_passes += test_sanitize_invalidates_template();
+    test_passes += test_command_environment_is_sanitized();
+    test_passes += test_non_editors_have_no_template();
+    test_count = 6;
+
+    invalidate_editor_templates();
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
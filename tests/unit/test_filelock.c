@@ -77,9 +77,218 @@ static int test_check_file_lock_info() {
     return 1;
 }
 
+static int test_list_active_locks_from_index() {
+    setenv("SUDOSH_TEST_MODE", "1", 1);
+    (void)init_file_locking();
+
+    const char *file_a = "/tmp/sudosh_lock_index_a.txt";
+    const char *file_b = "/tmp/sudosh_lock_index_b.txt";
+    int fd = open(file_a, O_CREAT | O_WRONLY, 0644);
+    if (fd >= 0) close(fd);
+    fd = open(file_b, O_CREAT | O_WRONLY, 0644);
+    if (fd >= 0) close(fd);
+
+    pid_t pid = getpid();
+    TEST_ASSERT(acquire_file_lock(file_a, "indexuser", pid) == 0, "acquire a");
+    TEST_ASSERT(acquire_file_lock(file_b, "indexuser", pid) == 0, "acquire b");
+
+    int count = 0;
+    struct file_lock_info **locks = list_active_file_locks(&count);
+    TEST_ASSERT(locks != NULL && count == 2, "index lists both active locks");
+    int saw_a = 0;
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT(locks[i]->pid == pid, "index records pid");
+        TEST_ASSERT(strcmp(locks[i]->username, "indexuser") == 0, "index records owner");
+        TEST_ASSERT(locks[i]->timestamp > 0, "index records start time");
+        if (strcmp(locks[i]->file_path, file_a) == 0) saw_a = 1;
+    }
+    TEST_ASSERT(saw_a, "index records canonical path");
+    free_file_lock_list(locks, count);
+
+    TEST_ASSERT(release_file_lock(file_a, "indexuser", pid) == 0, "release a");
+    locks = list_active_file_locks(&count);
+    TEST_ASSERT(locks != NULL && count == 1, "release removes index entry");
+    TEST_ASSERT(strcmp(locks[0]->file_path, file_b) == 0, "remaining entry is b");
+    free_file_lock_list(locks, count);
+
+    TEST_ASSERT(release_file_lock(file_b, "indexuser", pid) == 0, "release b");
+    locks = list_active_file_locks(&count);
+    TEST_ASSERT(locks == NULL && count == 0, "index empty after releases");
+
+    cleanup_file_locking();
+    unsetenv("SUDOSH_TEST_MODE");
+    unlink(file_a);
+    unlink(file_b);
+    return 1;
+}
+
+static int test_sweep_keeps_concurrent_index_updates() {
+    setenv("SUDOSH_TEST_MODE", "1", 1);
+    (void)init_file_locking();
+
+    enum { WORKERS = 4, FILES = 8, ROUNDS = 60 };
+    pid_t owner = getpid();     /* Alive throughout, so no lock is stale */
+    pid_t workers[WORKERS];
+
+    pid_t sweeper = fork();
+    if (sweeper == 0) {
+        for (;;) {
+            cleanup_stale_locks();
+        }
+    }
+    for (int w = 0; w < WORKERS; w++) {
+        workers[w] = fork();
+        if (workers[w] == 0) {
+            char path[64];
+            for (int round = 0; round < ROUNDS; round++) {
+                for (int f = 0; f < FILES; f++) {
+                    snprintf(path, sizeof(path), "/tmp/sudosh_lock_race_%d_%d.txt", w, f);
+                    if (acquire_file_lock(path, "raceuser", owner) != 0) {
+                        _exit(1);
+                    }
+                    /* Every lock is left held after the last round */
+                    if (round < ROUNDS - 1 && release_file_lock(path, "raceuser", owner) != 0) {
+                        _exit(1);
+                    }
+                }
+            }
+            _exit(0);
+        }
+    }
+
+    int workers_ok = 1;
+    for (int w = 0; w < WORKERS; w++) {
+        int status;
+        if (waitpid(workers[w], &status, 0) != workers[w] || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            workers_ok = 0;
+        }
+    }
+    kill(sweeper, SIGKILL);
+    waitpid(sweeper, NULL, 0);
+    TEST_ASSERT(workers_ok, "every acquire and release succeeded");
+
+    int count = 0;
+    struct file_lock_info **locks = list_active_file_locks(&count);
+    TEST_ASSERT_EQ(WORKERS * FILES, count, "index lists exactly the held locks");
+    free_file_lock_list(locks, count);
+
+    char path[64];
+    for (int w = 0; w < WORKERS; w++) {
+        for (int f = 0; f < FILES; f++) {
+            snprintf(path, sizeof(path), "/tmp/sudosh_lock_race_%d_%d.txt", w, f);
+            release_file_lock(path, "raceuser", owner);
+        }
+    }
+    cleanup_file_locking();
+    unsetenv("SUDOSH_TEST_MODE");
+    return 1;
+}
+
+static int test_lock_follows_directory_entry() {
+    setenv("SUDOSH_TEST_MODE", "1", 1);
+    (void)init_file_locking();
+
+    const char *file = "/tmp/sudosh_lock_identity.txt";
+    const char *tmp = "/tmp/sudosh_lock_identity.txt.tmp";
+    unlink(file);
+
+    pid_t pid = getpid();
+    TEST_ASSERT(acquire_file_lock(file, "identityuser", pid) == 0, "acquire lock on new file");
+
+    /* The editor creates the file after the lock was taken */
+    int fd = open(file, O_CREAT | O_WRONLY, 0644);
+    if (fd >= 0) close(fd);
+    struct file_lock_info *info = check_file_lock(file);
+    TEST_ASSERT(info != NULL, "lock survives file creation");
+    free_file_lock_info(info);
+
+    /* Save-by-rename replaces the inode but not the directory entry */
+    fd = open(tmp, O_CREAT | O_WRONLY, 0644);
+    if (fd >= 0) close(fd);
+    TEST_ASSERT(rename(tmp, file) == 0, "rename replacement over file");
+    info = check_file_lock(file);
+    TEST_ASSERT(info != NULL, "lock survives rename-replace");
+    free_file_lock_info(info);
+
+    /* Relative spellings resolve to the same lock */
+    TEST_ASSERT(chdir("/tmp") == 0, "chdir /tmp");
+    invalidate_path_cache();
+    info = check_file_lock("sudosh_lock_identity.txt");
+    TEST_ASSERT(info != NULL, "relative path finds the same lock");
+    free_file_lock_info(info);
+
+    struct path_identity identity;
+    TEST_ASSERT(resolve_path_identity("./sudosh_lock_identity.txt", &identity) == 0, "resolve identity");
+    TEST_ASSERT(identity.exists && identity.parent_known, "identity records target and parent");
+    free_path_identity(&identity);
+
+    TEST_ASSERT(release_file_lock(file, "identityuser", pid) == 0, "release lock");
+    TEST_ASSERT(check_file_lock(file) == NULL, "no lock after release");
+
+    cleanup_file_locking();
+    unsetenv("SUDOSH_TEST_MODE");
+    unlink(file);
+    return 1;
+}
+
+static int test_cached_path_follows_symlink() {
+    char dir[] = "/tmp/sudosh_lock_link.XXXXXX";
+    char a[PATH_MAX], b[PATH_MAX], link[PATH_MAX], dir_a[PATH_MAX], dir_b[PATH_MAX];
+    char dir_link[PATH_MAX], new_file[PATH_MAX + 16];
+    struct path_identity identity;
+
+    TEST_ASSERT(mkdtemp(dir) != NULL, "create test directory");
+    snprintf(a, sizeof(a), "%s/a.txt", dir);
+    snprintf(b, sizeof(b), "%s/b.txt", dir);
+    snprintf(link, sizeof(link), "%s/link", dir);
+    snprintf(dir_a, sizeof(dir_a), "%s/da", dir);
+    snprintf(dir_b, sizeof(dir_b), "%s/db", dir);
+    snprintf(dir_link, sizeof(dir_link), "%s/dlink", dir);
+    snprintf(new_file, sizeof(new_file), "%s/new.txt", dir_link);
+    close(open(a, O_CREAT | O_WRONLY, 0644));
+    close(open(b, O_CREAT | O_WRONLY, 0644));
+    mkdir(dir_a, 0755);
+    mkdir(dir_b, 0755);
+    invalidate_path_cache();
+
+    /* Retargeting a symlink does not change the cached target's inode */
+    TEST_ASSERT(symlink(a, link) == 0, "link to a");
+    TEST_ASSERT(resolve_path_identity(link, &identity) == 0, "resolve link");
+    TEST_ASSERT(strstr(identity.canonical_path, "/a.txt") != NULL, "link resolves to a");
+    free_path_identity(&identity);
+    TEST_ASSERT(unlink(link) == 0 && symlink(b, link) == 0, "link to b");
+    TEST_ASSERT(resolve_path_identity(link, &identity) == 0, "resolve link again");
+    TEST_ASSERT(strstr(identity.canonical_path, "/b.txt") != NULL, "cached entry dropped");
+    free_path_identity(&identity);
+
+    /* Nor does a missing file's cached parent change with the directory link */
+    TEST_ASSERT(symlink(dir_a, dir_link) == 0, "directory link to da");
+    TEST_ASSERT(resolve_path_identity(new_file, &identity) == 0, "resolve new file");
+    TEST_ASSERT(strstr(identity.canonical_path, "/da/new.txt") != NULL, "new file under da");
+    free_path_identity(&identity);
+    TEST_ASSERT(unlink(dir_link) == 0 && symlink(dir_b, dir_link) == 0, "directory link to db");
+    TEST_ASSERT(resolve_path_identity(new_file, &identity) == 0, "resolve new file again");
+    TEST_ASSERT(strstr(identity.canonical_path, "/db/new.txt") != NULL, "new file now under db");
+    free_path_identity(&identity);
+
+    invalidate_path_cache();
+    unlink(link);
+    unlink(dir_link);
+    unlink(a);
+    unlink(b);
+    rmdir(dir_a);
+    rmdir(dir_b);
+    rmdir(dir);
+    return 1;
+}
+
 TEST_SUITE_BEGIN("File Locking Unit Tests")
     RUN_TEST(test_init_file_locking_in_test_mode);
     RUN_TEST(test_acquire_and_release_lock);
     RUN_TEST(test_check_file_lock_info);
+    RUN_TEST(test_list_active_locks_from_index);
+    RUN_TEST(test_sweep_keeps_concurrent_index_updates);
+    RUN_TEST(test_lock_follows_directory_entry);
+    RUN_TEST(test_cached_path_follows_symlink);
 TEST_SUITE_END()
 
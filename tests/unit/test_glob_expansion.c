@@ -0,0 +1,186 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char glob_dir[256];
+
+static void make_file(const char *name) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", glob_dir, name);
+    int fd = open(path, O_CREAT | O_WRONLY, 0600);
+    if (fd >= 0) close(fd);
+}
+
+static void remove_file(const char *name) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", glob_dir, name);
+    unlink(path);
+}
+
+int test_glob_expands_sorted_matches() {
+    printf("Running test_glob_expands_sorted_matches... ");
+
+    char line[PATH_MAX], expected[PATH_MAX];
+    snprintf(line, sizeof(line), "ls -l %s/*.gz %s/build-?", glob_dir, glob_dir);
+
+    struct command_info cmd;
+    TEST_ASSERT_EQ(0, parse_command(line, &cmd), "should parse");
+    TEST_ASSERT_EQ(6, cmd.argc, "ls -l plus two .gz and two build-? matches");
+    TEST_ASSERT_STR_EQ("-l", cmd.argv[1], "literal flag is kept");
+    snprintf(expected, sizeof(expected), "%s/a.gz", glob_dir);
+    TEST_ASSERT_STR_EQ(expected, cmd.argv[2], "first match is sorted");
+    snprintf(expected, sizeof(expected), "%s/b.gz", glob_dir);
+    TEST_ASSERT_STR_EQ(expected, cmd.argv[3], "second match is sorted");
+    snprintf(expected, sizeof(expected), "%s/build-1", glob_dir);
+    TEST_ASSERT_STR_EQ(expected, cmd.argv[4], "second pattern expands after the first");
+    TEST_ASSERT_NULL(cmd.argv[6], "argv stays NULL terminated");
+    TEST_ASSERT(cmd.glob_matched && !cmd.glob_matched[1] && cmd.glob_matched[2],
+                "expanded arguments are flagged");
+    free_command_info(&cmd);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_glob_literal_cases() {
+    printf("Running test_glob_literal_cases... ");
+
+    char line[PATH_MAX], expected[PATH_MAX];
+    struct command_info cmd;
+
+    /* No match keeps the pattern literal */
+    snprintf(line, sizeof(line), "ls %s/*.none", glob_dir);
+    TEST_ASSERT_EQ(0, parse_command(line, &cmd), "should parse");
+    snprintf(expected, sizeof(expected), "%s/*.none", glob_dir);
+    TEST_ASSERT_STR_EQ(expected, cmd.argv[1], "unmatched pattern stays literal");
+    TEST_ASSERT_NULL(cmd.glob_matched, "nothing flagged without expansion");
+    free_command_info(&cmd);
+
+    /* Dotfiles need an explicit leading dot */
+    snprintf(line, sizeof(line), "ls %s/*", glob_dir);
+    TEST_ASSERT_EQ(0, parse_command(line, &cmd), "should parse");
+    for (int i = 1; i < cmd.argc; i++) {
+        TEST_ASSERT(strstr(cmd.argv[i], "/.hidden") == NULL, "* does not match dotfiles");
+    }
+    free_command_info(&cmd);
+
+    snprintf(line, sizeof(line), "ls %s/.h*", glob_dir);
+    TEST_ASSERT_EQ(0, parse_command(line, &cmd), "should parse");
+    TEST_ASSERT_EQ(2, cmd.argc, ".h* matches the dotfile");
+    free_command_info(&cmd);
+
+    /* Quoted patterns and directory metacharacters are not expanded */
+    TEST_ASSERT_EQ(0, parse_command("find /tmp -name '*.gz'", &cmd), "should parse");
+    TEST_ASSERT_STR_EQ("'*.gz'", cmd.argv[3], "quoted pattern stays literal");
+    free_command_info(&cmd);
+
+    TEST_ASSERT_EQ(0, parse_command("ls /tm*/x", &cmd), "should parse");
+    TEST_ASSERT_STR_EQ("/tm*/x", cmd.argv[1], "only the last component is expanded");
+    free_command_info(&cmd);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_glob_expansion_is_capped() {
+    printf("Running test_glob_expansion_is_capped... ");
+
+    char name[64];
+    for (int i = 0; i <= MAX_GLOB_EXPANSION_ARGS; i++) {
+        snprintf(name, sizeof(name), "cap-%04d", i);
+        make_file(name);
+    }
+
+    char line[PATH_MAX];
+    snprintf(line, sizeof(line), "ls %s/cap-*", glob_dir);
+    struct command_info cmd;
+    TEST_ASSERT_EQ(-1, parse_command(line, &cmd), "oversized expansion is refused");
+
+    for (int i = 0; i <= MAX_GLOB_EXPANSION_ARGS; i++) {
+        snprintf(name, sizeof(name), "cap-%04d", i);
+        remove_file(name);
+    }
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_glob_matches_are_validated() {
+    printf("Running test_glob_matches_are_validated... ");
+
+    char line[PATH_MAX];
+    struct command_info cmd;
+
+    snprintf(line, sizeof(line), "ls %s/*.gz", glob_dir);
+    TEST_ASSERT_EQ(0, parse_command(line, &cmd), "should parse");
+    TEST_ASSERT_EQ(1, validate_glob_expansion(&cmd), "plain matches pass validation");
+    free_command_info(&cmd);
+
+    /* A file name that would be an injection if typed is rejected */
+    make_file("evil;id");
+    snprintf(line, sizeof(line), "ls %s/evil*", glob_dir);
+    TEST_ASSERT_EQ(0, parse_command(line, &cmd), "should parse");
+    TEST_ASSERT_EQ(0, validate_glob_expansion(&cmd), "match with ; is rejected");
+    free_command_info(&cmd);
+    remove_file("evil;id");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_glob_matches_are_authorized() {
+    printf("Running test_glob_matches_are_authorized... ");
+
+    char line[PATH_MAX];
+    struct command_info cmd;
+
+    /* The typed pattern is permitted, but the test-mode rules deny the expanded name */
+    TEST_ASSERT_EQ(1, check_command_permission("testuser", "stat /tmp/x/*.log"),
+                   "typed pattern is permitted");
+    make_file("rm-me.log");
+    snprintf(line, sizeof(line), "stat %s/*.log", glob_dir);
+    TEST_ASSERT_EQ(0, parse_command(line, &cmd), "should parse");
+    TEST_ASSERT_EQ(2, cmd.argc, "pattern expands to the one match");
+    TEST_ASSERT_EQ(0, validate_glob_expansion(&cmd), "expanded command is authorized again");
+    free_command_info(&cmd);
+    remove_file("rm-me.log");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    const char *files[] = { "a.gz", "b.gz", "build-1", "build-2", "notes.txt", ".hidden", NULL };
+
+    setenv("SUDOSH_TEST_MODE", "1", 1);
+    test_mode = 1;
+    set_current_username("testuser");
+    snprintf(glob_dir, sizeof(glob_dir), "/tmp/sudosh_glob_%d", (int)getpid());
+    mkdir(glob_dir, 0700);
+    for (int i = 0; files[i]; i++) {
+        make_file(files[i]);
+    }
+
+    printf("=== Glob Expansion Tests ===\n");
+    test_passes += test_glob_expands_sorted_matches();
+    test_passes += test_glob_literal_cases();
+    test_passes += test_glob_expansion_is_capped();
+    test_passes += test_glob_matches_are_validated();
+    test_passes += test_glob_matches_are_authorized();
+    test_count = 5;
+
+    for (int i = 0; files[i]; i++) {
+        remove_file(files[i]);
+    }
+    rmdir(glob_dir);
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
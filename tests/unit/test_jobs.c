@@ -0,0 +1,159 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static int file_contains(const char *path, const char *needle) {
+    char buf[4096];
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return 0;
+    }
+    size_t n = fread(buf, 1, sizeof(buf) - 1, fp);
+    fclose(fp);
+    buf[n] = '\0';
+    return strstr(buf, needle) != NULL;
+}
+
+int test_strip_background_operator() {
+    printf("Running test_strip_background_operator... ");
+
+    char line1[] = "rsync -a /srv /backup &";
+    TEST_ASSERT_EQ(1, strip_background_operator(line1), "trailing &");
+    TEST_ASSERT_STR_EQ("rsync -a /srv /backup", line1, "operator and space removed");
+
+    char line2[] = "sleep 60&  ";
+    TEST_ASSERT_EQ(1, strip_background_operator(line2), "& without space");
+    TEST_ASSERT_STR_EQ("sleep 60", line2, "trailing space removed");
+
+    char line3[] = "make && make install";
+    TEST_ASSERT_EQ(0, strip_background_operator(line3), "&& is a list operator");
+    char line4[] = "echo 'a &'";
+    TEST_ASSERT_EQ(0, strip_background_operator(line4), "quoted &");
+    char line5[] = "echo a \\&";
+    TEST_ASSERT_EQ(0, strip_background_operator(line5), "escaped &");
+    char line6[] = "ls &&";
+    TEST_ASSERT_EQ(0, strip_background_operator(line6), "dangling &&");
+    char line7[] = "  &";
+    TEST_ASSERT_EQ(0, strip_background_operator(line7), "nothing to run");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_background_job_captures_output() {
+    printf("Running test_background_job_captures_output... ");
+
+    struct user_info *user = get_user_info(getenv("USER"));
+    TEST_ASSERT_NOT_NULL(user, "user info");
+
+    fflush(stdout);
+    int id = start_background_job("echo background-output", user, user->username);
+    TEST_ASSERT(id > 0, "job started");
+    TEST_ASSERT_EQ(0, wait_for_jobs(NULL), "wait returns job status");
+
+    struct background_job *job = find_job("%1");
+    TEST_ASSERT_NOT_NULL(job, "job with unread output is kept");
+    TEST_ASSERT_EQ(JOB_DONE, job->state, "job finished");
+    TEST_ASSERT(file_contains(job->output_path, "background-output"), "output captured");
+
+    struct stat st;
+    TEST_ASSERT_EQ(0, stat(job->output_path, &st), "output file exists");
+    TEST_ASSERT_EQ(0600, st.st_mode & 0777, "output file is private");
+
+    char *path = safe_strdup(job->output_path);
+    fflush(stdout);
+    TEST_ASSERT_EQ(0, foreground_job(NULL), "fg returns exit status");
+    TEST_ASSERT_NULL(find_job("%1"), "job released after fg");
+    TEST_ASSERT(access(path, F_OK) != 0, "output removed after fg");
+    free(path);
+
+    free_user_info(user);
+    printf("PASS\n");
+    return 1;
+}
+
+int test_job_exit_status() {
+    printf("Running test_job_exit_status... ");
+
+    struct user_info *user = get_user_info(getenv("USER"));
+    TEST_ASSERT_NOT_NULL(user, "user info");
+
+    fflush(stdout);
+    int id = start_background_job("ls /nonexistent-sudosh-job-dir", user, user->username);
+    TEST_ASSERT(id > 0, "job started");
+    char spec[16];
+    snprintf(spec, sizeof(spec), "%%%d", id);
+    TEST_ASSERT(wait_for_jobs(spec) != 0, "failure status reported");
+    TEST_ASSERT_EQ(127, wait_for_jobs("%9"), "unknown job");
+    TEST_ASSERT_NULL(find_job("bogus"), "bad spec");
+
+    cleanup_jobs();
+    free_user_info(user);
+    printf("PASS\n");
+    return 1;
+}
+
+int test_interactive_commands_rejected() {
+    printf("Running test_interactive_commands_rejected... ");
+
+    struct user_info *user = get_user_info(getenv("USER"));
+    TEST_ASSERT_NOT_NULL(user, "user info");
+
+    TEST_ASSERT_EQ(-1, start_background_job("cd /tmp", user, user->username), "built-in");
+    TEST_ASSERT_EQ(-1, start_background_job("fg %1", user, user->username), "job built-in");
+    TEST_ASSERT_EQ(-1, start_background_job("vi /etc/hosts", user, user->username), "editor");
+    TEST_ASSERT_EQ(0, count_active_jobs(), "nothing started");
+
+    free_user_info(user);
+    printf("PASS\n");
+    return 1;
+}
+
+int test_session_end_terminates_jobs() {
+    printf("Running test_session_end_terminates_jobs... ");
+
+    struct user_info *user = get_user_info(getenv("USER"));
+    TEST_ASSERT_NOT_NULL(user, "user info");
+
+    fflush(stdout);
+    TEST_ASSERT(start_background_job("sleep 30", user, user->username) > 0, "first job");
+    TEST_ASSERT(start_background_job("sleep 30", user, user->username) > 0, "second job");
+    TEST_ASSERT_EQ(2, count_active_jobs(), "both running");
+    TEST_ASSERT_EQ(0, resume_job_in_background(NULL), "bg on a running job");
+
+    long long started = monotonic_usec();
+    cleanup_jobs();
+    TEST_ASSERT(monotonic_usec() - started < 3000000, "jobs terminated promptly");
+    TEST_ASSERT_EQ(0, count_active_jobs(), "no jobs left");
+    TEST_ASSERT_NULL(find_job(NULL), "table empty");
+
+    free_user_info(user);
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+
+    printf("=== Background Job Tests ===\n");
+    test_passes += test_strip_background_operator();
+    test_passes += test_background_job_captures_output();
+    test_passes += test_job_exit_status();
+    test_passes += test_interactive_commands_rejected();
+    test_passes += test_session_end_terminates_jobs();
+    test_count = 5;
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
@@ -0,0 +1,289 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+#include <sys/file.h>
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char test_dir[] = "/tmp/sudosh-metrics-XXXXXX";
+static char metrics_path[PATH_MAX];
+static char rendered[64 * 1024];
+
+static void reset_metrics(void) {
+    close_metrics();
+    unlink(metrics_path);
+}
+
+/* Render the metrics into 'rendered'; returns render_metrics()'s result */
+static int render(void) {
+    FILE *fp = tmpfile();
+    if (!fp) {
+        return -1;
+    }
+    int rc = render_metrics(fp);
+    size_t n = 0;
+    if (rc == 0) {
+        rewind(fp);
+        n = fread(rendered, 1, sizeof(rendered) - 1, fp);
+    }
+    rendered[n] = '\0';
+    fclose(fp);
+    return rc;
+}
+
+/* Value of the sample "series value" in the rendered text, or -1 */
+static double sample(const char *series) {
+    char needle[256];
+    snprintf(needle, sizeof(needle), "\n%s ", series);
+    const char *p = strstr(rendered, needle);
+    return p ? strtod(p + strlen(needle), NULL) : -1;
+}
+
+static int occurrences(const char *needle) {
+    int n = 0;
+    for (const char *p = rendered; (p = strstr(p, needle)) != NULL; p++) {
+        n++;
+    }
+    return n;
+}
+
+int test_counters_render_as_prometheus_text() {
+    printf("Running test_counters_render_as_prometheus_text... ");
+
+    struct stat st;
+    reset_metrics();
+
+    TEST_ASSERT_EQ(0, render(), "renders before anything was counted");
+    TEST_ASSERT_EQ(0, (int)sample("sudosh_invocations_total{mode=\"interactive\"}"), "starts at zero");
+
+    metrics_count(METRIC_INVOCATIONS_INTERACTIVE);
+    metrics_count(METRIC_INVOCATIONS_COMMAND);
+    metrics_count(METRIC_INVOCATIONS_COMMAND);
+    metrics_count(METRIC_DENIED_PERMISSION);
+    metrics_count(METRIC_LOCK_CONTENDED_EDITOR_FILE);
+    metrics_count(METRIC_COUNTER_COUNT);
+    session_stats_command(1);
+    session_stats_denied(SESSION_DENY_AUTHENTICATION);
+
+    TEST_ASSERT_EQ(0, render(), "rendered");
+    TEST_ASSERT_EQ(1, (int)sample("sudosh_invocations_total{mode=\"interactive\"}"), "interactive");
+    TEST_ASSERT_EQ(2, (int)sample("sudosh_invocations_total{mode=\"command\"}"), "command");
+    TEST_ASSERT_EQ(0, (int)sample("sudosh_invocations_total{mode=\"ansible_pipeline\"}"), "ansible");
+    TEST_ASSERT_EQ(1, (int)sample("sudosh_denials_total{reason=\"permission\"}"), "permission denial");
+    TEST_ASSERT_EQ(1, (int)sample("sudosh_denials_total{reason=\"authentication\"}"), "session denial counted");
+    TEST_ASSERT_EQ(1, (int)sample("sudosh_commands_total{kind=\"pipeline\"}"), "session pipeline counted");
+    TEST_ASSERT_EQ(1, (int)sample("sudosh_lock_contentions_total{lock=\"editor_file\"}"), "lock contention");
+    TEST_ASSERT(sample("sudosh_metrics_start_time_seconds") > 1e9, "start time");
+
+    /* One HELP and TYPE per metric family */
+    TEST_ASSERT_EQ(1, occurrences("# TYPE sudosh_invocations_total counter\n"), "counter TYPE once");
+    TEST_ASSERT_EQ(1, occurrences("# HELP sudosh_denials_total "), "HELP once");
+    TEST_ASSERT_EQ(1, occurrences("# TYPE sudosh_sssd_query_duration_seconds histogram\n"), "histogram TYPE");
+
+    TEST_ASSERT_EQ(0, stat(metrics_path, &st), "segment file exists");
+    TEST_ASSERT_EQ(0600, st.st_mode & 0777, "segment file is private");
+
+    /* Another process maps the same counters */
+    close_metrics();
+    TEST_ASSERT_EQ(0, render(), "re-rendered");
+    TEST_ASSERT_EQ(2, (int)sample("sudosh_invocations_total{mode=\"command\"}"), "counters persist");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_histograms_are_cumulative() {
+    printf("Running test_histograms_are_cumulative... ");
+
+    reset_metrics();
+    metrics_observe(METRIC_POLICY_PARSE, 50);        /* <= 100us */
+    metrics_observe(METRIC_POLICY_PARSE, 100);       /* bounds are inclusive */
+    metrics_observe(METRIC_POLICY_PARSE, 3000);      /* <= 5ms */
+    metrics_observe(METRIC_POLICY_PARSE, 5000000);   /* +Inf */
+    metrics_observe(METRIC_POLICY_PARSE, -7);        /* clock step: counted as zero */
+
+    TEST_ASSERT_EQ(0, render(), "rendered");
+    TEST_ASSERT_EQ(3, (int)sample("sudosh_policy_parse_duration_seconds_bucket{le=\"0.0001\"}"), "first bucket");
+    TEST_ASSERT_EQ(3, (int)sample("sudosh_policy_parse_duration_seconds_bucket{le=\"0.0025\"}"), "cumulative");
+    TEST_ASSERT_EQ(4, (int)sample("sudosh_policy_parse_duration_seconds_bucket{le=\"0.005\"}"), "5ms bucket");
+    TEST_ASSERT_EQ(4, (int)sample("sudosh_policy_parse_duration_seconds_bucket{le=\"1\"}"), "1s bucket");
+    TEST_ASSERT_EQ(5, (int)sample("sudosh_policy_parse_duration_seconds_bucket{le=\"+Inf\"}"), "+Inf bucket");
+    TEST_ASSERT_EQ(5, (int)sample("sudosh_policy_parse_duration_seconds_count"), "count");
+    double sum = sample("sudosh_policy_parse_duration_seconds_sum");
+    TEST_ASSERT(sum > 5.003149 && sum < 5.003151, "sum in seconds");
+    TEST_ASSERT_EQ(0, (int)sample("sudosh_sssd_query_duration_seconds_count"), "other histograms untouched");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_concurrent_processes_lose_nothing() {
+    printf("Running test_concurrent_processes_lose_nothing... ");
+
+    const int workers = 8;
+    const int per_worker = 20000;
+    reset_metrics();
+    metrics_count(METRIC_COMMANDS);     /* Mapped before forking, like a session */
+
+    fflush(stdout);
+    for (int w = 0; w < workers; w++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (w % 2) {
+                close_metrics();        /* Half map it themselves */
+            }
+            for (int i = 0; i < per_worker; i++) {
+                metrics_count(METRIC_COMMANDS);
+                metrics_observe(METRIC_SSSD_QUERY, i % 2000);
+            }
+            _exit(0);
+        }
+    }
+    for (int w = 0; w < workers; w++) {
+        wait(NULL);
+    }
+
+    TEST_ASSERT_EQ(0, render(), "rendered");
+    TEST_ASSERT_EQ(workers * per_worker + 1, (int)sample("sudosh_commands_total{kind=\"command\"}"),
+                   "every increment kept");
+    TEST_ASSERT_EQ(workers * per_worker, (int)sample("sudosh_sssd_query_duration_seconds_count"),
+                   "every observation kept");
+    TEST_ASSERT_EQ(workers * per_worker,
+                   (int)sample("sudosh_sssd_query_duration_seconds_bucket{le=\"+Inf\"}"), "buckets agree");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_instrumented_paths() {
+    printf("Running test_instrumented_paths... ");
+
+    char sudoers[PATH_MAX];
+    char lock_path[PATH_MAX];
+    int ready[2];
+    reset_metrics();
+
+    /* Policy parse */
+    snprintf(sudoers, sizeof(sudoers), "%s/sudoers", test_dir);
+    FILE *fp = fopen(sudoers, "w");
+    TEST_ASSERT(fp != NULL, "sudoers written");
+    fprintf(fp, "alice ALL=(ALL) ALL\n");
+    fclose(fp);
+    struct sudoers_config *config = parse_sudoers_file(sudoers);
+    TEST_ASSERT(config != NULL, "sudoers parsed");
+    free_sudoers_config(config);
+
+    /* Authentication results */
+    log_authentication("alice", 0);
+    log_authentication("alice", 1);
+    log_authentication("alice", 0);
+
+    /* A lock held by another process is counted and its wait timed */
+    snprintf(lock_path, sizeof(lock_path), "%s/lock", test_dir);
+    int fd = open(lock_path, O_RDWR | O_CREAT, 0600);
+    TEST_ASSERT(fd >= 0 && pipe(ready) == 0, "lock file");
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int own = open(lock_path, O_RDWR);
+        flock(own, LOCK_EX);
+        if (write(ready[1], "x", 1) != 1) {
+            _exit(1);
+        }
+        usleep(50000);
+        _exit(0);
+    }
+    char c;
+    TEST_ASSERT_EQ(1, (int)read(ready[0], &c, 1), "child holds the lock");
+    TEST_ASSERT_EQ(0, metrics_flock(fd, METRIC_LOCK_CONTENDED_AUDIT_JOURNAL), "lock taken after waiting");
+    TEST_ASSERT_EQ(0, metrics_flock(fd, METRIC_LOCK_CONTENDED_AUDIT_JOURNAL), "own lock is not contention");
+    waitpid(pid, NULL, 0);
+    close(fd);
+    close(ready[0]);
+    close(ready[1]);
+    unlink(lock_path);
+    unlink(sudoers);
+
+    TEST_ASSERT_EQ(0, render(), "rendered");
+    TEST_ASSERT_EQ(1, (int)sample("sudosh_policy_parse_duration_seconds_count"), "policy parse timed");
+    TEST_ASSERT_EQ(2, (int)sample("sudosh_authentications_total{result=\"failure\"}"), "auth failures");
+    TEST_ASSERT_EQ(1, (int)sample("sudosh_authentications_total{result=\"success\"}"), "auth successes");
+    TEST_ASSERT_EQ(1, (int)sample("sudosh_lock_contentions_total{lock=\"audit_journal\"}"), "contention");
+    TEST_ASSERT_EQ(1, (int)sample("sudosh_lock_wait_duration_seconds_count"), "lock wait timed");
+    TEST_ASSERT(sample("sudosh_lock_wait_duration_seconds_sum") >= 0.01, "wait was measured");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_foreign_and_untrusted_segments() {
+    printf("Running test_foreign_and_untrusted_segments... ");
+
+    char junk[4096];
+    memset(junk, 0xff, sizeof(junk));
+    reset_metrics();
+
+    /* Another layout is reset to zero rather than misread */
+    int fd = open(metrics_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    TEST_ASSERT(fd >= 0 && write(fd, junk, sizeof(junk)) == (ssize_t)sizeof(junk), "junk written");
+    close(fd);
+    metrics_count(METRIC_AUTH_FAILURE);
+    TEST_ASSERT_EQ(0, render(), "rendered");
+    TEST_ASSERT_EQ(1, (int)sample("sudosh_authentications_total{result=\"failure\"}"), "started over");
+    TEST_ASSERT_EQ(0, (int)sample("sudosh_invocations_total{mode=\"command\"}"), "no junk counts");
+
+    /* A segment others can read or write is not used */
+    close_metrics();
+    chmod(metrics_path, 0644);
+    metrics_count(METRIC_AUTH_FAILURE);
+    TEST_ASSERT_EQ(-1, render(), "untrusted segment refused");
+    close_metrics();
+    chmod(metrics_path, 0600);
+    TEST_ASSERT_EQ(0, render(), "trusted again");
+    TEST_ASSERT_EQ(1, (int)sample("sudosh_authentications_total{result=\"failure\"}"), "not counted while untrusted");
+
+    /* Without a configured path nothing is counted */
+    close_metrics();
+    unsetenv("SUDOSH_METRICS_FILE");
+    metrics_count(METRIC_AUTH_FAILURE);
+    TEST_ASSERT_EQ(-1, render(), "disabled");
+    setenv("SUDOSH_METRICS_FILE", metrics_path, 1);
+    close_metrics();
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+    if (!mkdtemp(test_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(metrics_path, sizeof(metrics_path), "%s/metrics", test_dir);
+    setenv("SUDOSH_METRICS_FILE", metrics_path, 1);
+
+    printf("=== Host Metrics Tests ===\n");
+    test_passes += test_counters_render_as_prometheus_text();
+    test_passes += test_histograms_are_cumulative();
+    test_passes += test_concurrent_processes_lose_nothing();
+    test_passes += test_instrumented_paths();
+    test_passes += test_foreign_and_untrusted_segments();
+    test_count = 5;
+
+    reset_metrics();
+    rmdir(test_dir);
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char test_file[256];
+
+static int line_is(struct pager_buffer *pb, size_t n, const char *expected) {
+    const char *start;
+    size_t len;
+    if (!pager_buffer_line(pb, n, &start, &len)) {
+        return 0;
+    }
+    return len == strlen(expected) && memcmp(start, expected, len) == 0;
+}
+
+int test_mapped_file_lines() {
+    printf("Running test_mapped_file_lines... ");
+
+    FILE *f = fopen(test_file, "w");
+    TEST_ASSERT_NOT_NULL(f, "create test file");
+    fputs("first\n\nthird line\nlast without newline", f);
+    fclose(f);
+
+    int fd = open(test_file, O_RDONLY);
+    struct pager_buffer pb;
+    TEST_ASSERT_EQ(0, pager_buffer_open(&pb, fd), "open buffer");
+    TEST_ASSERT_EQ(1, pb.mapped, "regular file is mapped");
+    TEST_ASSERT(line_is(&pb, 0, "first"), "line 0");
+    TEST_ASSERT(line_is(&pb, 1, ""), "empty line 1");
+    TEST_ASSERT(line_is(&pb, 3, "last without newline"), "unterminated last line");
+    TEST_ASSERT_EQ(4, pager_buffer_total_lines(&pb), "line count");
+    TEST_ASSERT_EQ(0, pager_buffer_line(&pb, 4, NULL, NULL), "no line past end");
+    pager_buffer_close(&pb);
+
+    /* A trailing newline does not add an empty line; empty input has none */
+    f = fopen(test_file, "w");
+    fputs("a\nb\n", f);
+    fclose(f);
+    close(fd);
+    fd = open(test_file, O_RDONLY);
+    TEST_ASSERT_EQ(0, pager_buffer_open(&pb, fd), "reopen buffer");
+    TEST_ASSERT_EQ(2, pager_buffer_total_lines(&pb), "trailing newline");
+    pager_buffer_close(&pb);
+    close(fd);
+
+    fd = open("/dev/null", O_RDONLY);
+    TEST_ASSERT_EQ(0, pager_buffer_open(&pb, fd), "open empty input");
+    TEST_ASSERT_EQ(0, pager_buffer_total_lines(&pb), "empty input has no lines");
+    pager_buffer_close(&pb);
+    close(fd);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_pipe_is_read_lazily() {
+    printf("Running test_pipe_is_read_lazily... ");
+
+    const int total_lines = 200000;
+    int fds[2];
+    TEST_ASSERT_EQ(0, pipe(fds), "pipe");
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        FILE *out = fdopen(fds[1], "w");
+        for (int i = 0; i < total_lines; i++) {
+            fprintf(out, "line %06d %s\n", i, (i == 150000) ? "NEEDLE" : "hay");
+        }
+        fclose(out);
+        _exit(0);
+    }
+    close(fds[1]);
+
+    struct pager_buffer pb;
+    TEST_ASSERT_EQ(0, pager_buffer_open(&pb, fds[0]), "open buffer");
+    TEST_ASSERT_EQ(0, pb.mapped, "pipe is buffered");
+    TEST_ASSERT(line_is(&pb, 0, "line 000000 hay"), "first line");
+    TEST_ASSERT(pb.eof == 0, "first screen does not read all input");
+
+    long long hit = pager_buffer_search(&pb, "NEEDLE", 0, 1);
+    TEST_ASSERT(hit > 0, "forward search reads on to the match");
+    TEST_ASSERT_EQ(150000, pager_buffer_line_of(&pb, (size_t)hit), "match line");
+    TEST_ASSERT_EQ(-1, pager_buffer_search(&pb, "NEEDLE", (size_t)hit + 1, 1), "single match");
+    TEST_ASSERT_EQ(total_lines, pager_buffer_total_lines(&pb), "all lines indexed");
+    TEST_ASSERT(line_is(&pb, total_lines - 1, "line 199999 hay"), "last line");
+
+    pager_buffer_close(&pb);
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_backward_search() {
+    printf("Running test_backward_search... ");
+
+    FILE *f = fopen(test_file, "w");
+    fputs("alpha\nbeta error\ngamma\ndelta error\nepsilon\n", f);
+    fclose(f);
+
+    int fd = open(test_file, O_RDONLY);
+    struct pager_buffer pb;
+    TEST_ASSERT_EQ(0, pager_buffer_open(&pb, fd), "open buffer");
+
+    long long last = pager_buffer_search(&pb, "error", pb.len, 0);
+    TEST_ASSERT_EQ(3, pager_buffer_line_of(&pb, (size_t)last), "last match from end");
+    long long prev = pager_buffer_search(&pb, "error", (size_t)last, 0);
+    TEST_ASSERT_EQ(1, pager_buffer_line_of(&pb, (size_t)prev), "previous match");
+    TEST_ASSERT_EQ(-1, pager_buffer_search(&pb, "error", (size_t)prev, 0), "no earlier match");
+    TEST_ASSERT_EQ(-1, pager_buffer_search(&pb, "", 0, 1), "empty pattern");
+
+    pager_buffer_close(&pb);
+    close(fd);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_non_tty_copies_through() {
+    printf("Running test_non_tty_copies_through... ");
+
+    const char *content = "one\ntwo\x1b[31m\n";
+    FILE *f = fopen(test_file, "w");
+    fputs(content, f);
+    fclose(f);
+
+    char out_path[PATH_MAX];
+    snprintf(out_path, sizeof(out_path), "%s.out", test_file);
+    int out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    int saved = dup(STDOUT_FILENO);
+    fflush(stdout);
+    dup2(out_fd, STDOUT_FILENO);
+    int rc = page_file(test_file);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    close(out_fd);
+    TEST_ASSERT_EQ(0, rc, "page_file succeeds");
+
+    char buf[64] = {0};
+    f = fopen(out_path, "r");
+    TEST_ASSERT_NOT_NULL(f, "open output");
+    size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    unlink(out_path);
+    TEST_ASSERT_EQ(strlen(content), n, "output length");
+    TEST_ASSERT_STR_EQ(content, buf, "output copied unchanged");
+
+    TEST_ASSERT_EQ(-1, page_file("/nonexistent/sudosh/file"), "missing file fails");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_builtin_pager_selection() {
+    printf("Running test_builtin_pager_selection... ");
+
+    struct command_info cmd;
+    int tty = isatty(STDOUT_FILENO);
+
+    TEST_ASSERT_EQ(0, parse_command("less /etc/hosts", &cmd), "parse less");
+    TEST_ASSERT_EQ(tty, should_use_builtin_pager(&cmd, 0), "bare less on a file");
+    TEST_ASSERT_EQ(0, should_use_builtin_pager(&cmd, 1), "file argument in a pipe");
+    free_command_info(&cmd);
+
+    TEST_ASSERT_EQ(0, parse_command("less -N /etc/hosts", &cmd), "parse less -N");
+    TEST_ASSERT_EQ(0, should_use_builtin_pager(&cmd, 0), "options use the external pager");
+    free_command_info(&cmd);
+
+    TEST_ASSERT_EQ(0, parse_command("/usr/bin/less /etc/hosts", &cmd), "parse absolute less");
+    TEST_ASSERT_EQ(0, should_use_builtin_pager(&cmd, 0), "absolute path uses the external pager");
+    free_command_info(&cmd);
+
+    TEST_ASSERT_EQ(0, parse_command("more", &cmd), "parse more");
+    TEST_ASSERT_EQ(tty, should_use_builtin_pager(&cmd, 1), "bare more at the end of a pipe");
+    free_command_info(&cmd);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    snprintf(test_file, sizeof(test_file), "/tmp/sudosh_pager_%d", (int)getpid());
+
+    printf("=== Built-in Pager Tests ===\n");
+    test_passes += test_mapped_file_lines();
+    test_passes += test_pipe_is_read_lazily();
+    test_passes += test_backward_search();
+    test_passes += test_non_tty_copies_through();
+    test_passes += test_builtin_pager_selection();
+    test_count = 5;
+
+    unlink(test_file);
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+#include <sys/wait.h>
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+/* Global verbose flag for testing */
+int verbose_mode = 0;
+
+/*
+ * The compiled sudoers policy image: sessions that find a current image
+ * map it instead of parsing, and any change to the inputs, or an image
+ * that is damaged or not trusted, sends them back to the sudoers files.
+ */
+
+#define SETTLE_SECONDS 2    /* Inputs must be older than a second to be published */
+
+#define PIN "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"
+
+static char root[] = "/tmp/sudosh-policy.XXXXXX";
+static char sudoers_path[PATH_MAX];
+static char sudoers_dir[PATH_MAX];
+static char image_path[PATH_MAX];
+
+static const char *sudoers_fixture =
+    "root ALL=(ALL:ALL) ALL\n"
+    "alice ALL=(root) NOPASSWD: ALL\n"
+    "bob web1,web2=(www-data) /usr/bin/rsync, /bin/ls\n"
+    "carol ALL=(root) sha256:" PIN " /usr/bin/tar, /usr/bin/gzip\n";
+
+static void write_file(const char *path, const char *content) {
+    FILE *fp = fopen(path, "w");
+    if (fp) {
+        fputs(content, fp);
+        fclose(fp);
+    }
+}
+
+/* Answers to a fixed set of questions about the fixture, as a bit mask */
+static int policy_answers(struct sudoers_config *config) {
+    char digests[4][SHA256_HEX_LENGTH + 1];
+    int answers = 0;
+
+    answers |= check_sudoers_privileges("alice", "host", config) << 0;
+    answers |= check_sudoers_global_nopasswd("alice", "host", config) << 1;
+    answers |= check_sudoers_nopasswd("bob", "web1", config) << 2;
+    answers |= check_sudoers_command_permission("bob", "web1", "ls -la", config) << 3;
+    answers |= check_sudoers_command_permission("bob", "db1", "ls -la", config) << 4;
+    answers |= check_sudoers_command_permission("bob", "web2", "/usr/bin/rsync -a", config) << 5;
+    answers |= check_sudoers_command_permission("bob", "web2", "cat", config) << 6;
+    answers |= (get_sudoers_command_digests("carol", "host", "/usr/bin/tar", config, digests, 4) == 1) << 7;
+    answers |= (strcmp(digests[0], PIN) == 0) << 8;
+    answers |= check_sudoers_privileges("dave", "host", config) << 9;
+    answers |= check_sudoers_privileges("erin", "host", config) << 10;
+    return answers;
+}
+
+/* Expected policy_answers() for the fixture, with and without erin's rule */
+#define FIXTURE_ANSWERS ((1 << 0) | (1 << 1) | (1 << 3) | (1 << 5) | (1 << 7) | (1 << 8))
+#define WITH_ERIN (FIXTURE_ANSWERS | (1 << 10))
+
+int test_mapped_policy_matches_parsed() {
+    printf("Running test_mapped_policy_matches_parsed... ");
+
+    /* Without an image path every session parses privately */
+    unsetenv("SUDOSH_POLICY_IMAGE");
+    struct sudoers_config *parsed = parse_sudoers_file(NULL);
+    TEST_ASSERT_NOT_NULL(parsed, "fixture parsed");
+    TEST_ASSERT(parsed->mapping == NULL, "private policy");
+    TEST_ASSERT_EQ(FIXTURE_ANSWERS, policy_answers(parsed), "parsed answers");
+
+    /* The first session to parse settled inputs publishes; later ones map */
+    setenv("SUDOSH_POLICY_IMAGE", image_path, 1);
+    struct sudoers_config *published = parse_sudoers_file(NULL);
+    TEST_ASSERT_NOT_NULL(published, "policy published");
+    TEST_ASSERT(published->mapping != NULL, "publisher uses the shared mapping");
+    TEST_ASSERT_EQ(0, access(image_path, R_OK), "image file written");
+
+    struct sudoers_config *mapped = parse_sudoers_file(NULL);
+    TEST_ASSERT_NOT_NULL(mapped, "policy mapped");
+    TEST_ASSERT(mapped->mapping == published->mapping, "one mapping shared");
+    TEST_ASSERT_EQ(FIXTURE_ANSWERS, policy_answers(mapped), "mapped answers match");
+    TEST_ASSERT_EQ((int)policy_image_size(parsed), (int)policy_image_size(mapped), "same image");
+    TEST_ASSERT(memcmp(parsed->image, mapped->image, policy_image_size(parsed)) == 0, "identical bytes");
+
+    free_sudoers_config(parsed);
+    free_sudoers_config(published);
+    free_sudoers_config(mapped);
+
+    printf("PASS\n");
+    return 1;
+}
+
+/* Exit 0 if a fresh session sees `expected` answers; 2 more if it mapped */
+static int child_answers(int expected) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        struct sudoers_config *config = parse_sudoers_file(NULL);
+        int ok = config && policy_answers(config) == expected;
+        _exit(ok ? (config->mapping ? 2 : 0) : 1);
+    }
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+int test_changed_inputs_invalidate() {
+    printf("Running test_changed_inputs_invalidate... ");
+    setenv("SUDOSH_POLICY_IMAGE", image_path, 1);
+
+    /* A new file in the include directory is seen at once */
+    char extra[PATH_MAX + 8];
+    snprintf(extra, sizeof(extra), "%s/erin", sudoers_dir);
+    write_file(extra, "erin ALL=(root) /usr/bin/id\n");
+    struct sudoers_config *config = parse_sudoers_file(NULL);
+    TEST_ASSERT_EQ(WITH_ERIN, policy_answers(config), "included file added");
+    TEST_ASSERT(config->mapping == NULL, "fresh inputs not published yet");
+    free_sudoers_config(config);
+    TEST_ASSERT_EQ(0, child_answers(WITH_ERIN), "other sessions parse too");
+
+    /* Once settled, the next session republishes */
+    sleep(SETTLE_SECONDS);
+    TEST_ASSERT_EQ(2, child_answers(WITH_ERIN), "republished and mapped");
+    TEST_ASSERT_EQ(2, child_answers(WITH_ERIN), "mapped by the next session");
+
+    /* Removing it, or editing sudoers itself, is seen as well */
+    unlink(extra);
+    TEST_ASSERT_EQ(0, child_answers(FIXTURE_ANSWERS), "included file removed");
+    write_file(sudoers_path, "dave ALL=(root) ALL\n");
+    TEST_ASSERT_EQ(0, child_answers((1 << 9)), "sudoers rewritten");
+
+    write_file(sudoers_path, sudoers_fixture);
+    printf("PASS\n");
+    return 1;
+}
+
+int test_bad_image_rejected() {
+    printf("Running test_bad_image_rejected... ");
+    setenv("SUDOSH_POLICY_IMAGE", image_path, 1);
+
+    sleep(SETTLE_SECONDS);
+    TEST_ASSERT_EQ(2, child_answers(FIXTURE_ANSWERS), "current image mapped");
+
+    /* Writable by others: not trusted, and replaced by the session that parses */
+    struct stat st;
+    TEST_ASSERT_EQ(0, chmod(image_path, 0666), "loosen mode");
+    TEST_ASSERT_EQ(2, child_answers(FIXTURE_ANSWERS), "loose image replaced");
+    TEST_ASSERT_EQ(0, stat(image_path, &st), "image present");
+    TEST_ASSERT_EQ(0600, (int)(st.st_mode & 07777), "replacement owner-only");
+
+    /* Offsets pointing outside the image */
+    int fd = open(image_path, O_WRONLY);
+    TEST_ASSERT(fd >= 0, "open image");
+    uint32_t bad = 0xfffffff0u;
+    TEST_ASSERT_EQ(4, (int)pwrite(fd, &bad, sizeof(bad), 16 + 4), "corrupt rule offset");
+    close(fd);
+    TEST_ASSERT_EQ(2, child_answers(FIXTURE_ANSWERS), "corrupt image replaced");
+
+    /* A truncated image */
+    TEST_ASSERT_EQ(0, truncate(image_path, st.st_size / 2), "truncate");
+    TEST_ASSERT_EQ(2, child_answers(FIXTURE_ANSWERS), "short image replaced");
+
+    /* A symlink in its place is neither followed nor written through */
+    char target[PATH_MAX];
+    snprintf(target, sizeof(target), "%s/elsewhere", root);
+    write_file(target, "");
+    unlink(image_path);
+    TEST_ASSERT_EQ(0, symlink(target, image_path), "symlink planted");
+    TEST_ASSERT_EQ(2, child_answers(FIXTURE_ANSWERS), "symlink replaced");
+    TEST_ASSERT_EQ(0, lstat(image_path, &st), "image present");
+    TEST_ASSERT(S_ISREG(st.st_mode), "image is a regular file again");
+    TEST_ASSERT_EQ(0, stat(target, &st), "target kept");
+    TEST_ASSERT_EQ(0, (int)st.st_size, "target untouched");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+
+    printf("=== Policy Image Tests ===\n");
+    if (!mkdtemp(root)) {
+        printf("cannot create %s\n", root);
+        return 1;
+    }
+    snprintf(sudoers_path, sizeof(sudoers_path), "%s/sudoers", root);
+    snprintf(sudoers_dir, sizeof(sudoers_dir), "%s/sudoers.d", root);
+    snprintf(image_path, sizeof(image_path), "%s/policy", root);
+    mkdir(sudoers_dir, 0755);
+    write_file(sudoers_path, sudoers_fixture);
+    setenv("SUDOSH_SUDOERS_PATH", sudoers_path, 1);
+    setenv("SUDOSH_SUDOERS_DIR", sudoers_dir, 1);
+    sleep(SETTLE_SECONDS);
+
+    test_count = 3;
+    test_passes += test_mapped_policy_matches_parsed();
+    test_passes += test_changed_inputs_invalidate();
+    test_passes += test_bad_image_rejected();
+
+    char command[PATH_MAX + 16];
+    snprintf(command, sizeof(command), "rm -rf '%s'", root);
+    if (system(command) != 0) {
+        printf("cannot remove %s\n", root);
+    }
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
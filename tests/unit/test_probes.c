@@ -0,0 +1,194 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+#include <elf.h>
+#include <sys/mman.h>
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+/* A probe as described in .note.stapsdt */
+struct probe_note {
+    const char *provider;
+    const char *name;
+    const char *args;
+    uint64_t location;
+};
+
+#define MAX_NOTES 256
+
+static struct probe_note notes[MAX_NOTES];
+static int note_count = 0;
+static const unsigned char *image = NULL;
+static size_t image_size = 0;
+static const Elf64_Shdr *sections = NULL;
+static int section_count = 0;
+static int have_base_section = 0;
+
+/* Map this test binary and collect its probe notes */
+static int load_notes(void) {
+    struct stat st;
+    int fd = open("/proc/self/exe", O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        return -1;
+    }
+    image_size = (size_t)st.st_size;
+    image = mmap(NULL, image_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        return -1;
+    }
+
+    const Elf64_Ehdr *eh = (const Elf64_Ehdr *)image;
+    if (memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 || eh->e_ident[EI_CLASS] != ELFCLASS64) {
+        return -1;
+    }
+    sections = (const Elf64_Shdr *)(image + eh->e_shoff);
+    section_count = eh->e_shnum;
+    const char *names = (const char *)image + sections[eh->e_shstrndx].sh_offset;
+
+    for (int s = 0; s < section_count; s++) {
+        const char *section_name = names + sections[s].sh_name;
+        if (strcmp(section_name, ".stapsdt.base") == 0) {
+            have_base_section = 1;
+        }
+        if (sections[s].sh_type != SHT_NOTE || strcmp(section_name, ".note.stapsdt") != 0) {
+            continue;
+        }
+        size_t off = sections[s].sh_offset;
+        size_t end = off + sections[s].sh_size;
+        while (off + sizeof(Elf64_Nhdr) <= end && note_count < MAX_NOTES) {
+            const Elf64_Nhdr *nh = (const Elf64_Nhdr *)(image + off);
+            const char *owner = (const char *)(nh + 1);
+            const unsigned char *desc = (const unsigned char *)owner + ((nh->n_namesz + 3) & ~3u);
+            if (nh->n_type == 3 && strcmp(owner, "stapsdt") == 0) {
+                struct probe_note *p = &notes[note_count++];
+                memcpy(&p->location, desc, sizeof(p->location));
+                p->provider = (const char *)desc + 3 * sizeof(uint64_t);
+                p->name = p->provider + strlen(p->provider) + 1;
+                p->args = p->name + strlen(p->name) + 1;
+            }
+            off = (size_t)(desc - image) + ((nh->n_descsz + 3) & ~3u);
+        }
+    }
+    return 0;
+}
+
+static const struct probe_note *find_probe(const char *name) {
+    for (int i = 0; i < note_count; i++) {
+        if (strcmp(notes[i].name, name) == 0) {
+            return &notes[i];
+        }
+    }
+    return NULL;
+}
+
+/* Number of "size@operand" arguments */
+static int count_args(const char *args) {
+    int n = 0;
+    for (const char *p = args; *p; ) {
+        while (*p == ' ') p++;
+        if (!*p) break;
+        n++;
+        if (strncmp(p, "-8@", 3) != 0 && strncmp(p, "8@", 2) != 0) {
+            return -1;  /* Every argument is a 64-bit value */
+        }
+        while (*p && *p != ' ') p++;
+    }
+    return n;
+}
+
+/* Instruction bytes at a probe's address, through the executable section holding it */
+static const unsigned char *code_at(uint64_t address) {
+    for (int s = 0; s < section_count; s++) {
+        const Elf64_Shdr *sh = &sections[s];
+        if ((sh->sh_flags & SHF_EXECINSTR) && sh->sh_type == SHT_PROGBITS &&
+            address >= sh->sh_addr && address < sh->sh_addr + sh->sh_size) {
+            return image + sh->sh_offset + (address - sh->sh_addr);
+        }
+    }
+    return NULL;
+}
+
+int test_probes_are_described() {
+    printf("Running test_probes_are_described... ");
+
+    static const struct {
+        const char *name;
+        int args;
+    } expected[] = {
+        { "policy__parse__start", 1 }, { "policy__parse__done", 2 },
+        { "permission__check__start", 2 }, { "permission__check__done", 3 },
+        { "sssd__query__start", 1 }, { "sssd__query__done", 2 },
+        { "auth__start", 1 }, { "auth__done", 2 },
+        { "validate__start", 1 }, { "validate__done", 2 },
+        { "exec__start", 2 }, { "exec__done", 3 },
+        { "pipeline__start", 3 }, { "pipeline__done", 3 },
+        { "log__command", 3 }, { "log__auth", 2 }, { "log__violation", 2 },
+        { "log__session", 2 }, { "audit__record", 3 },
+    };
+
+    TEST_ASSERT(have_base_section, ".stapsdt.base present");
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        const struct probe_note *p = find_probe(expected[i].name);
+        TEST_ASSERT(p != NULL, expected[i].name);
+        TEST_ASSERT_STR_EQ("sudosh", p->provider, "provider");
+        TEST_ASSERT_EQ(expected[i].args, count_args(p->args), expected[i].name);
+    }
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_probe_sites_are_nops() {
+    printf("Running test_probe_sites_are_nops... ");
+
+    TEST_ASSERT(note_count > 0, "probes found");
+    for (int i = 0; i < note_count; i++) {
+        const unsigned char *code = code_at(notes[i].location);
+        TEST_ASSERT(code != NULL, "probe address inside executable code");
+#if defined(__x86_64__)
+        TEST_ASSERT_EQ(0x90, code[0], "x86-64 nop at probe site");
+#elif defined(__aarch64__)
+        uint32_t insn;
+        memcpy(&insn, code, sizeof(insn));
+        TEST_ASSERT(insn == 0xd503201f, "AArch64 nop at probe site");
+#endif
+    }
+
+    /* Probed functions behave as before */
+    TEST_ASSERT_EQ(1, validate_command_with_length("ls -l", 6), "validation verdict");
+    TEST_ASSERT_EQ(0, validate_command_with_length("ls; rm -rf /", 13), "rejection verdict");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+
+    printf("=== USDT Probe Tests ===\n");
+#ifdef SUDOSH_PROBES_ENABLED
+    if (load_notes() != 0) {
+        printf("cannot read /proc/self/exe\n");
+        return 1;
+    }
+    test_passes += test_probes_are_described();
+    test_passes += test_probe_sites_are_nops();
+    test_count = 2;
+#else
+    printf("Probes are not compiled in on this platform; skipping\n");
+#endif
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char test_dir[] = "/tmp/sudosh-session-stats-XXXXXX";
+static char journal_path[PATH_MAX];
+
+/* Value of " key=" in a summary line, or -1 */
+static long long summary_field(const char *summary, const char *key) {
+    char needle[64];
+    snprintf(needle, sizeof(needle), " %s=", key);
+    const char *p = strstr(summary, needle);
+    return p ? strtoll(p + strlen(needle), NULL, 10) : -1;
+}
+
+int test_histogram_precision() {
+    printf("Running test_histogram_precision... ");
+
+    reset_session_stats();
+    const struct session_histogram *h = session_stats_histogram(SESSION_LATENCY_VALIDATE);
+    TEST_ASSERT(h != NULL, "histogram available");
+    TEST_ASSERT_EQ(0, (int)session_histogram_quantile(h, 0.5), "empty histogram");
+
+    /* Small values are exact */
+    for (int v = 0; v < SESSION_HIST_LINEAR; v++) {
+        session_stats_latency(SESSION_LATENCY_VALIDATE, v);
+    }
+    TEST_ASSERT_EQ(SESSION_HIST_LINEAR / 2 - 1, (int)session_histogram_quantile(h, 0.5), "exact median");
+    TEST_ASSERT_EQ(SESSION_HIST_LINEAR - 1, (int)session_histogram_quantile(h, 1.0), "exact maximum");
+
+    /* Larger values stay within one sub-bucket (12.5%) */
+    reset_session_stats();
+    for (long long v = 1; v <= 100000; v++) {
+        session_stats_latency(SESSION_LATENCY_VALIDATE, v);
+    }
+    TEST_ASSERT_EQ(100000, (int)h->count, "every sample counted");
+    TEST_ASSERT_EQ(100000, (int)h->max, "maximum kept exactly");
+    double qs[] = { 0.5, 0.9, 0.99, 0.999 };
+    for (size_t i = 0; i < sizeof(qs) / sizeof(qs[0]); i++) {
+        double want = qs[i] * 100000;
+        double got = (double)session_histogram_quantile(h, qs[i]);
+        TEST_ASSERT(got >= want && got <= want * 1.125 + 1, "quantile within 12.5%");
+    }
+
+    /* Huge and negative samples do not overflow the buckets */
+    session_stats_latency(SESSION_LATENCY_VALIDATE, LLONG_MAX);
+    session_stats_latency(SESSION_LATENCY_VALIDATE, -5);
+    TEST_ASSERT(session_histogram_quantile(h, 1.0) == (unsigned long long)LLONG_MAX, "largest value");
+    TEST_ASSERT_EQ(0, (int)session_histogram_quantile(h, 0.0), "negative counted as zero");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_counters_and_summary() {
+    printf("Running test_counters_and_summary... ");
+
+    char summary[1024];
+    reset_session_stats();
+
+    session_stats_command(0);
+    session_stats_command(0);
+    session_stats_command(1);
+    session_stats_auth_prompt();
+    session_stats_denied(SESSION_DENY_VALIDATION);
+    session_stats_denied(SESSION_DENY_PERMISSION);
+    session_stats_denied(SESSION_DENY_PERMISSION);
+    session_stats_denied(SESSION_DENY_COUNT);
+    session_stats_latency(SESSION_LATENCY_EXEC, 250);
+    session_stats_latency(SESSION_LATENCY_COUNT, 1);
+
+    int len = format_session_summary(summary, sizeof(summary));
+    TEST_ASSERT(len > 0 && (size_t)len == strlen(summary), "summary formatted");
+    TEST_ASSERT(strncmp(summary, "session summary:", 16) == 0, "summary prefix");
+    TEST_ASSERT_EQ(2, (int)summary_field(summary, "commands"), "commands");
+    TEST_ASSERT_EQ(1, (int)summary_field(summary, "pipelines"), "pipelines");
+    TEST_ASSERT_EQ(1, (int)summary_field(summary, "auth_prompts"), "auth prompts");
+    TEST_ASSERT_EQ(3, (int)summary_field(summary, "denied"), "denials");
+    TEST_ASSERT_EQ(1, (int)summary_field(summary, "denied_validation"), "validation denials");
+    TEST_ASSERT_EQ(2, (int)summary_field(summary, "denied_permission"), "permission denials");
+    TEST_ASSERT_EQ(0, (int)summary_field(summary, "denied_authentication"), "authentication denials");
+    TEST_ASSERT(strstr(summary, " exec_us=n:1,mean:250,") != NULL, "exec histogram");
+    TEST_ASSERT(strstr(summary, ",max:250") != NULL, "exec maximum");
+    TEST_ASSERT(strstr(summary, " validate_us=n:0,") != NULL, "empty validate histogram");
+    TEST_ASSERT(strchr(summary, '\t') == NULL && strchr(summary, '\n') == NULL, "one line");
+
+    TEST_ASSERT_EQ(-1, format_session_summary(summary, 40), "short buffer refused");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_instrumented_paths() {
+    printf("Running test_instrumented_paths... ");
+
+    struct command_info cmd;
+    struct user_info *user = get_user_info(getenv("USER"));
+    reset_session_stats();
+
+    validate_command("ls -l /tmp");
+    validate_command("ls; rm -rf /");
+    TEST_ASSERT_EQ(2, (int)session_stats_histogram(SESSION_LATENCY_VALIDATE)->count,
+                   "validation timed");
+
+    check_command_permission(getenv("USER"), "ls /tmp");
+    TEST_ASSERT_EQ(1, (int)session_stats_histogram(SESSION_LATENCY_PERMISSION)->count,
+                   "permission check timed");
+
+    TEST_ASSERT(user != NULL, "user info");
+    TEST_ASSERT_EQ(0, parse_command("/bin/true", &cmd), "parse");
+    fflush(stdout);
+    TEST_ASSERT_EQ(0, execute_command(&cmd, user), "command ran");
+    free_command_info(&cmd);
+    const struct session_histogram *exec = session_stats_histogram(SESSION_LATENCY_EXEC);
+    TEST_ASSERT_EQ(1, (int)exec->count, "launch timed");
+    TEST_ASSERT(exec->max < 5000000, "launch time is not the run time");
+
+    /* A command that never starts is not counted */
+    TEST_ASSERT_EQ(0, parse_command("sudosh-no-such-command", &cmd), "parse");
+    execute_command(&cmd, user);
+    free_command_info(&cmd);
+    TEST_ASSERT_EQ(1, (int)exec->count, "failed launch not counted");
+
+    free_user_info(user);
+    printf("PASS\n");
+    return 1;
+}
+
+int test_summary_record_at_session_end() {
+    printf("Running test_summary_record_at_session_end... ");
+
+    char line[AUDIT_MAX_RECORD];
+    int summaries = 0;
+    int summary_before_close = 0;
+    reset_audit_journal(journal_path);
+    reset_session_stats();
+
+    session_stats_command(0);
+    session_stats_denied(SESSION_DENY_AUTHENTICATION);
+    log_session_end(getenv("USER"));
+    audit_flush();
+
+    FILE *fp = fopen(journal_path, "r");
+    TEST_ASSERT(fp != NULL, "journal written");
+    while (fgets(line, sizeof(line), fp)) {
+        if (strstr(line, "\ttype=SESSION\t") && strstr(line, "\tstatus=summary\t")) {
+            summaries++;
+            TEST_ASSERT(strstr(line, "\tmsg=session summary: commands=1 ") != NULL, "summary message");
+            TEST_ASSERT(strstr(line, " denied_authentication=1 ") != NULL, "denials by reason");
+        } else if (strstr(line, "\tmsg=session closed\t")) {
+            summary_before_close = summaries;
+        }
+    }
+    fclose(fp);
+    TEST_ASSERT_EQ(1, summaries, "one summary record");
+    TEST_ASSERT_EQ(1, summary_before_close, "summary precedes session close");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+    if (!mkdtemp(test_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(journal_path, sizeof(journal_path), "%s/audit.log", test_dir);
+    setenv("SUDOSH_AUDIT_LOG", journal_path, 1);
+
+    printf("=== Session Summary Tests ===\n");
+    test_passes += test_histogram_precision();
+    test_passes += test_counters_and_summary();
+    test_passes += test_instrumented_paths();
+    test_passes += test_summary_record_at_session_end();
+    test_count = 4;
+
+    reset_audit_journal(journal_path);
+    rmdir(test_dir);
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
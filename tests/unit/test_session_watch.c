@@ -0,0 +1,306 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char test_dir[] = "/tmp/sudosh-watch-XXXXXX";
+
+/* Read frames until one of the given type arrives */
+static int read_frame_of_type(struct watch_reader *reader, int want, char *buf, size_t size, size_t *len) {
+    int type;
+    for (int i = 0; i < 64; i++) {
+        int r = watch_read_frame(reader, &type, buf, size - 1, len, NULL);
+        if (r != 1) {
+            return r;
+        }
+        buf[*len] = '\0';
+        if (type == want) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int test_ring_roundtrip() {
+    printf("Running test_ring_roundtrip... ");
+
+    struct watch_reader reader;
+    char buf[WATCH_MAX_FRAME + 1];
+    size_t len;
+    int type;
+
+    TEST_ASSERT_EQ(0, watch_session_start("alice", NULL), "ring created");
+    TEST_ASSERT_EQ(0, watch_open(getpid(), &reader), "observer attached");
+
+    char path[PATH_MAX];
+    struct stat st;
+    snprintf(path, sizeof(path), "%s/session-%d", test_dir, (int)getpid());
+    TEST_ASSERT_EQ(0, stat(path, &st), "ring file exists");
+    TEST_ASSERT_EQ(0600, st.st_mode & 0777, "ring is private");
+
+    watch_record_input("ls /srv");
+    watch_end_output(2);
+    TEST_ASSERT_EQ(1, watch_read_frame(&reader, &type, buf, sizeof(buf), &len, NULL), "input frame");
+    TEST_ASSERT_EQ(WATCH_FRAME_INPUT, type, "input type");
+    buf[len] = '\0';
+    TEST_ASSERT_STR_EQ("ls /srv", buf, "input payload");
+    TEST_ASSERT_EQ(1, watch_read_frame(&reader, &type, buf, sizeof(buf), &len, NULL), "event frame");
+    buf[len] = '\0';
+    TEST_ASSERT_EQ(WATCH_FRAME_EVENT, type, "event type");
+    TEST_ASSERT_STR_EQ("exit status 2", buf, "exit status published");
+    TEST_ASSERT_EQ(0, watch_read_frame(&reader, &type, buf, sizeof(buf), &len, NULL), "nothing pending");
+
+    /* Output larger than a frame is split, not truncated */
+    char big[WATCH_MAX_FRAME * 2 + 10];
+    memset(big, 'x', sizeof(big));
+    watch_publish(WATCH_FRAME_OUTPUT, big, sizeof(big));
+    size_t total = 0;
+    while (watch_read_frame(&reader, &type, buf, sizeof(buf), &len, NULL) == 1) {
+        total += len;
+    }
+    TEST_ASSERT_EQ((int)sizeof(big), (int)total, "all output delivered");
+
+    watch_session_end();
+    TEST_ASSERT(access(path, F_OK) != 0, "ring removed at session end");
+    TEST_ASSERT_EQ(1, read_frame_of_type(&reader, WATCH_FRAME_EVENT, buf, sizeof(buf), &len), "end notice");
+    TEST_ASSERT_STR_EQ("session ended", buf, "end notice text");
+    TEST_ASSERT_EQ(-1, watch_read_frame(&reader, &type, buf, sizeof(buf), &len, NULL), "closed after drain");
+    watch_close(&reader);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_lapped_reader_resyncs() {
+    printf("Running test_lapped_reader_resyncs... ");
+
+    struct watch_reader reader;
+    char buf[WATCH_MAX_FRAME + 1];
+    char frame[1000];
+    size_t len;
+    int type;
+
+    TEST_ASSERT_EQ(0, watch_session_start("alice", NULL), "ring created");
+    TEST_ASSERT_EQ(0, watch_open(getpid(), &reader), "observer attached");
+
+    /* Write well over the ring's capacity before reading anything */
+    int frames = (WATCH_RING_SIZE / (int)sizeof(frame)) * 3;
+    for (int i = 0; i < frames; i++) {
+        memset(frame, 'a' + i % 26, sizeof(frame));
+        snprintf(frame, sizeof(frame), "%08d", i);
+        watch_publish(WATCH_FRAME_OUTPUT, frame, sizeof(frame));
+    }
+
+    int first = -1, last = -1, ok = 1;
+    while (watch_read_frame(&reader, &type, buf, sizeof(buf), &len, NULL) == 1) {
+        int seq = atoi(buf);
+        if (len != sizeof(frame) || (last >= 0 && seq != last + 1) || buf[len - 1] != 'a' + seq % 26) {
+            ok = 0;
+        }
+        if (first < 0) {
+            first = seq;
+        }
+        last = seq;
+    }
+    TEST_ASSERT(reader.lost > 0, "overrun reported");
+    TEST_ASSERT(first > 0, "oldest frames were overwritten");
+    TEST_ASSERT_EQ(frames - 1, last, "newest frame read");
+    TEST_ASSERT(ok, "frames after resync are intact and in order");
+
+    watch_close(&reader);
+    watch_session_end();
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_concurrent_reader_sees_whole_frames() {
+    printf("Running test_concurrent_reader_sees_whole_frames... ");
+
+    struct watch_reader reader;
+    char buf[WATCH_MAX_FRAME + 1];
+    size_t len;
+    int type;
+
+    TEST_ASSERT_EQ(0, watch_session_start("alice", NULL), "ring created");
+    TEST_ASSERT_EQ(0, watch_open(getpid(), &reader), "observer attached");
+    watch_record_input("stress");
+
+    fflush(stdout);
+    pid_t writer = fork();
+    if (writer == 0) {
+        char frame[WATCH_MAX_FRAME];
+        for (int i = 0; i < 50000; i++) {
+            size_t n = 16 + (size_t)(i * 131) % (sizeof(frame) - 16);
+            memset(frame, 'A' + i % 26, n);
+            watch_publish(WATCH_FRAME_OUTPUT, frame, n);
+        }
+        watch_session_end();
+        _exit(0);
+    }
+
+    int frames = 0, torn = 0, r;
+    while ((r = watch_read_frame(&reader, &type, buf, sizeof(buf), &len, NULL)) >= 0) {
+        if (r == 0) {
+            watch_wait(&reader, 100);
+            continue;
+        }
+        if (type != WATCH_FRAME_OUTPUT) {
+            continue;
+        }
+        for (size_t i = 1; i < len; i++) {
+            if (buf[i] != buf[0]) {
+                torn++;
+                break;
+            }
+        }
+        frames++;
+    }
+    int status = 0;
+    waitpid(writer, &status, 0);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0, "writer finished");
+    TEST_ASSERT(frames > 0, "frames received");
+    TEST_ASSERT_EQ(0, torn, "no torn frames");
+    TEST_ASSERT_EQ(-1, r, "reader saw the session end");
+    watch_close(&reader);
+    watch_session_end();
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_watched_command_output_is_mirrored() {
+    printf("Running test_watched_command_output_is_mirrored... ");
+
+    struct watch_reader reader;
+    struct command_info cmd;
+    char buf[WATCH_MAX_FRAME + 1];
+    size_t len;
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    TEST_ASSERT(master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0, "test pty");
+    int terminal = open(ptsname(master), O_RDWR | O_NOCTTY);
+    TEST_ASSERT(terminal >= 0, "test terminal");
+
+    struct user_info *user = get_user_info(getenv("USER"));
+    TEST_ASSERT_NOT_NULL(user, "user info");
+    TEST_ASSERT_EQ(0, watch_session_start("alice", NULL), "ring created");
+
+    /* Nobody watching: commands run directly on the terminal */
+    watch_record_input("echo quiet");
+    TEST_ASSERT_EQ(0, watch_begin_output("echo quiet"), "unwatched command not mirrored");
+    watch_end_output(0);
+
+    TEST_ASSERT_EQ(0, watch_open(getpid(), &reader), "observer attached");
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    dup2(terminal, STDOUT_FILENO);
+
+    watch_record_input("vi /etc/hosts");
+    int editor_mirrored = watch_begin_output("vi /etc/hosts");
+    watch_end_output(0);
+
+    watch_record_input("echo hello-watch");
+    int mirrored = watch_begin_output("echo hello-watch");
+    int result = -1;
+    if (parse_command("echo hello-watch", &cmd) == 0) {
+        result = execute_command(&cmd, user);
+        free_command_info(&cmd);
+    }
+    watch_end_output(result);
+
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    TEST_ASSERT_EQ(0, editor_mirrored, "full-screen command not mirrored");
+    TEST_ASSERT_EQ(1, mirrored, "watched command mirrored");
+    TEST_ASSERT_EQ(0, result, "command ran");
+
+    int found = 0;
+    while (read_frame_of_type(&reader, WATCH_FRAME_OUTPUT, buf, sizeof(buf), &len) == 1) {
+        if (strstr(buf, "hello-watch")) {
+            found = 1;
+        }
+    }
+    TEST_ASSERT(found, "output published to the ring");
+
+    /* The session's own terminal still got the output */
+    char seen[512];
+    fcntl(master, F_SETFL, O_NONBLOCK);
+    ssize_t n = read(master, seen, sizeof(seen) - 1);
+    seen[n > 0 ? n : 0] = '\0';
+    TEST_ASSERT(strstr(seen, "hello-watch") != NULL, "output relayed to the terminal");
+
+    watch_close(&reader);
+    watch_session_end();
+    close(terminal);
+    close(master);
+    free_user_info(user);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_untrusted_ring_refused() {
+    printf("Running test_untrusted_ring_refused... ");
+
+    struct watch_reader reader;
+    char path[PATH_MAX];
+
+    TEST_ASSERT_EQ(-1, watch_open(999999, &reader), "missing session");
+    TEST_ASSERT_EQ(ENOENT, errno, "ENOENT");
+
+    /* A ring readable by others is not trusted */
+    snprintf(path, sizeof(path), "%s/session-999998", test_dir);
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    TEST_ASSERT(fd >= 0, "planted ring");
+    fchmod(fd, 0644);
+    TEST_ASSERT_EQ(0, ftruncate(fd, 4096 + WATCH_RING_SIZE), "sized");
+    close(fd);
+    TEST_ASSERT_EQ(-1, watch_open(999998, &reader), "group/world-accessible ring refused");
+    TEST_ASSERT_EQ(EPERM, errno, "EPERM");
+
+    /* A private file without a valid header is not a ring */
+    chmod(path, 0600);
+    TEST_ASSERT_EQ(-1, watch_open(999998, &reader), "garbage ring refused");
+    TEST_ASSERT_EQ(EPROTO, errno, "EPROTO");
+    unlink(path);
+
+    TEST_ASSERT_EQ(-1, watch_publish(WATCH_FRAME_EVENT, "x", 1), "no ring, no publish");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+    if (!mkdtemp(test_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    setenv("SUDOSH_WATCH_DIR", test_dir, 1);
+
+    printf("=== Session Watch Tests ===\n");
+    test_passes += test_ring_roundtrip();
+    test_passes += test_lapped_reader_resyncs();
+    test_passes += test_concurrent_reader_sees_whole_frames();
+    test_passes += test_watched_command_output_is_mirrored();
+    test_passes += test_untrusted_ring_refused();
+    test_count = 5;
+
+    rmdir(test_dir);
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
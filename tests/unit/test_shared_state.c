@@ -0,0 +1,241 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+#include <sys/wait.h>
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+/* Global verbose flag for testing */
+int verbose_mode = 0;
+
+/*
+ * State shared by concurrent sessions on one host: the authentication
+ * cache, the editor lock directory and a user's history file.  Each test
+ * points its SUDOSH_* override into a private directory.
+ */
+
+#define SESSIONS 4
+#define ROUNDS 200
+#define SWEEP_AGE 3600      /* Older than any sweep interval */
+
+static char root[] = "/tmp/sudosh-shared.XXXXXX";
+
+/* Run body(i) in `count` child processes; true if every child exited 0 */
+static int run_children(int count, int (*body)(int)) {
+    pid_t pids[SESSIONS];
+    int ok = 1;
+
+    for (int i = 0; i < count; i++) {
+        pids[i] = fork();
+        if (pids[i] == 0) {
+            _exit(body(i) ? 0 : 1);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        int status;
+        if (pids[i] < 0 || waitpid(pids[i], &status, 0) != pids[i] ||
+            !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ok = 0;
+        }
+    }
+    return ok;
+}
+
+/* Check the cache ROUNDS times, refreshing it on every other round */
+static int auth_cache_session(int i) {
+    for (int r = 0; r < ROUNDS; r++) {
+        if (!check_auth_cache("shared_cache_user")) {
+            return 0;
+        }
+        if ((r + i) % 2 == 0 && !update_auth_cache("shared_cache_user")) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int test_auth_cache_concurrent_hits() {
+    printf("Running test_auth_cache_concurrent_hits... ");
+
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%s/auth", root);
+    setenv("SUDOSH_AUTH_CACHE_DIR", dir, 1);
+
+    if (!update_auth_cache("shared_cache_user")) {
+        /* Cache files must be root-owned; nothing to race otherwise */
+        printf("(not root, skipped) PASS\n");
+        return 1;
+    }
+    TEST_ASSERT_EQ(1, check_auth_cache("shared_cache_user"), "cache hit");
+
+    /* Readers take no lock and writers rename, so nobody sees a miss */
+    TEST_ASSERT(run_children(SESSIONS, auth_cache_session), "every check hits while others refresh");
+    TEST_ASSERT_EQ(1, check_auth_cache("shared_cache_user"), "cache still valid");
+
+    /* No temporary files are left behind */
+    DIR *d = opendir(dir);
+    TEST_ASSERT_NOT_NULL(d, "cache directory");
+    struct dirent *entry;
+    int leftovers = 0;
+    while ((entry = readdir(d)) != NULL) {
+        if (strstr(entry->d_name, ".tmp.")) {
+            leftovers++;
+        }
+    }
+    closedir(d);
+    TEST_ASSERT_EQ(0, leftovers, "temporary files renamed into place");
+
+    /* The sweep runs once per interval: a second call leaves the stamp alone */
+    char stamp[PATH_MAX + 16];
+    struct stat st1, st2;
+    snprintf(stamp, sizeof(stamp), "%s/%s", dir, AUTH_CACHE_SWEEP_STAMP);
+    cleanup_auth_cache();
+    TEST_ASSERT_EQ(0, stat(stamp, &st1), "sweep stamp written");
+    struct timespec old[2] = { { st1.st_mtime - 5, 0 }, { st1.st_mtime - 5, 0 } };
+    utimensat(AT_FDCWD, stamp, old, 0);
+    cleanup_auth_cache();
+    TEST_ASSERT_EQ(0, stat(stamp, &st2), "sweep stamp kept");
+    TEST_ASSERT_EQ((int)(st1.st_mtime - 5), (int)st2.st_mtime, "recent sweep not repeated");
+
+    clear_auth_cache("shared_cache_user");
+    unsetenv("SUDOSH_AUTH_CACHE_DIR");
+    printf("PASS\n");
+    return 1;
+}
+
+/* Append ROUNDS history entries as one session */
+static int history_session(int i) {
+    char command[128];
+
+    close_command_history();
+    if (init_command_history(getenv("USER")) != 0) {
+        return 0;
+    }
+    for (int r = 0; r < ROUNDS; r++) {
+        snprintf(command, sizeof(command), "echo session-%d-entry-%d %0*d", i, r, 60, r);
+        log_command_history(command);
+    }
+    close_command_history();
+    return 1;
+}
+
+int test_history_shared_file() {
+    printf("Running test_history_shared_file... ");
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/history", root);
+    setenv("SUDOSH_HISTORY_FILE", path, 1);
+
+    /* Entries from concurrent sessions land whole, one per line */
+    TEST_ASSERT(run_children(SESSIONS, history_session), "sessions logged history");
+
+    free_history_buffer();
+    TEST_ASSERT_EQ(0, load_history_buffer(), "history loaded");
+    TEST_ASSERT_EQ(SESSIONS * ROUNDS, get_history_count(), "every entry loaded once");
+    for (int i = 0; i < get_history_count(); i++) {
+        const char *entry = get_history_entry(i);
+        TEST_ASSERT(strncmp(entry, "echo session-", 13) == 0, "entry starts a command");
+        TEST_ASSERT_EQ(60, (int)strlen(strrchr(entry, ' ') + 1), "entry not torn");
+    }
+
+    /* Entries added this session follow the loaded ones and are freed separately */
+    add_to_history_buffer("uptime");
+    TEST_ASSERT_EQ(SESSIONS * ROUNDS + 1, get_history_count(), "new entry numbered after loaded ones");
+    TEST_ASSERT_STR_EQ("uptime", get_history_entry(SESSIONS * ROUNDS), "new entry");
+    free_history_buffer();
+    TEST_ASSERT_EQ(0, get_history_count(), "history freed");
+
+    unsetenv("SUDOSH_HISTORY_FILE");
+    printf("PASS\n");
+    return 1;
+}
+
+int test_lock_sweep_rate_limited() {
+    printf("Running test_lock_sweep_rate_limited... ");
+
+    char dir[PATH_MAX];
+    char stamp[PATH_MAX + 16];
+    struct stat st;
+    snprintf(dir, sizeof(dir), "%s/locks", root);
+    snprintf(stamp, sizeof(stamp), "%s/.sweep", dir);
+    setenv("SUDOSH_TEST_MODE", "1", 1);
+    setenv("SUDOSH_LOCK_DIR", dir, 1);
+
+    TEST_ASSERT_EQ(0, init_file_locking(), "lock directory shared through SUDOSH_LOCK_DIR");
+    TEST_ASSERT_EQ(0, stat(stamp, &st), "first session sweeps and stamps");
+
+    /* A stale lock left by a dead session stays until the next sweep is due... */
+    char target[PATH_MAX];
+    snprintf(target, sizeof(target), "%s/edited", root);
+    int fd = open(target, O_CREAT | O_WRONLY, 0644);
+    TEST_ASSERT(fd >= 0, "edited file");
+    close(fd);
+
+    pid_t dead = fork();
+    if (dead == 0) {
+        _exit(acquire_file_lock(target, "other", getpid()) == 0 ? 0 : 1);
+    }
+    int status;
+    waitpid(dead, &status, 0);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0, "lock taken by a session that exits");
+
+    TEST_ASSERT_EQ(0, init_file_locking(), "second session starts");
+    int listed = 0;
+    struct file_lock_info **locks = list_active_file_locks(&listed);
+    free_file_lock_list(locks, listed);
+    TEST_ASSERT_EQ(0, listed, "dead session's lock not listed");
+
+    /* ...but is reaped when someone wants the file */
+    TEST_ASSERT_EQ(0, acquire_file_lock(target, "tester", getpid()), "stale lock reaped on acquire");
+    TEST_ASSERT_EQ(0, release_file_lock(target, "tester", getpid()), "released");
+
+    /* An old stamp makes the next session sweep again */
+    struct timespec old[2] = { { st.st_mtime - SWEEP_AGE, 0 },
+                               { st.st_mtime - SWEEP_AGE, 0 } };
+    utimensat(AT_FDCWD, stamp, old, 0);
+    TEST_ASSERT_EQ(0, init_file_locking(), "third session starts");
+    struct stat st2;
+    TEST_ASSERT_EQ(0, stat(stamp, &st2), "stamp present");
+    TEST_ASSERT(st2.st_mtime > st.st_mtime - SWEEP_AGE, "overdue sweep ran");
+
+    cleanup_file_locking();
+    unlink(target);
+    unsetenv("SUDOSH_LOCK_DIR");
+    unsetenv("SUDOSH_TEST_MODE");
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+
+    printf("=== Shared Session State Tests ===\n");
+    if (!mkdtemp(root)) {
+        printf("cannot create %s\n", root);
+        return 1;
+    }
+
+    test_count = 3;
+    test_passes += test_auth_cache_concurrent_hits();
+    test_passes += test_history_shared_file();
+    test_passes += test_lock_sweep_rate_limited();
+
+    char command[PATH_MAX + 16];
+    snprintf(command, sizeof(command), "rm -rf '%s'", root);
+    if (system(command) != 0) {
+        printf("cannot remove %s\n", root);
+    }
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
@@ -118,8 +118,14 @@ int test_redirection_message_content(void) {
         /* Parent process: read output and verify content */
         close(pipefd[1]);
         
+        /* stderr is unbuffered, so the message arrives in several writes */
         char buffer[4096] = {0};
-        ssize_t bytes_read = read(pipefd[0], buffer, sizeof(buffer) - 1);
+        ssize_t bytes_read = 0;
+        ssize_t n;
+        while (bytes_read < (ssize_t)sizeof(buffer) - 1 &&
+               (n = read(pipefd[0], buffer + bytes_read, sizeof(buffer) - 1 - bytes_read)) > 0) {
+            bytes_read += n;
+        }
         close(pipefd[0]);
         
         int status;
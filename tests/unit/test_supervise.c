@@ -0,0 +1,164 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static pid_t spawn(const char *seconds, int self_signal) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (self_signal) {
+            usleep(100000);
+            raise(self_signal);
+        }
+        execl("/bin/sleep", "sleep", seconds, (char *)NULL);
+        _exit(127);
+    }
+    return pid;
+}
+
+int test_timeout_terminates_child() {
+    printf("Running test_timeout_terminates_child... ");
+
+    struct supervised_child child = {0};
+    struct supervision_result result;
+    child.pid = spawn("10", 0);
+    child.start_us = monotonic_usec();
+
+    TEST_ASSERT_EQ(0, supervise_children(&child, 1, 1, &result), "supervise");
+    TEST_ASSERT_EQ(1, result.timed_out, "limit expired");
+    TEST_ASSERT(WIFSIGNALED(child.status) && WTERMSIG(child.status) == SIGTERM, "child got SIGTERM");
+    TEST_ASSERT(child.elapsed_us >= 900000 && child.elapsed_us < 3000000, "stopped at the limit");
+    TEST_ASSERT_EQ(EXIT_COMMAND_TIMEOUT, supervised_exit_code(&child, &result), "timeout exit code");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_crashed_stage_tears_down_pipeline() {
+    printf("Running test_crashed_stage_tears_down_pipeline... ");
+
+    struct supervised_child stages[3];
+    struct supervision_result result;
+    memset(stages, 0, sizeof(stages));
+    stages[0].pid = spawn("10", 0);
+    stages[1].pid = spawn("10", SIGSEGV);
+    stages[2].pid = spawn("10", 0);
+    for (int i = 0; i < 3; i++) {
+        stages[i].start_us = monotonic_usec();
+    }
+
+    long long started = monotonic_usec();
+    TEST_ASSERT_EQ(0, supervise_children(stages, 3, 0, &result), "supervise");
+    TEST_ASSERT(monotonic_usec() - started < 3000000, "pipeline did not wait for sleepers");
+    TEST_ASSERT_EQ(1, result.torn_down, "pipeline torn down");
+    TEST_ASSERT_EQ(0, result.timed_out, "no time limit involved");
+    TEST_ASSERT(WIFSIGNALED(stages[1].status) && WTERMSIG(stages[1].status) == SIGSEGV, "crashed stage");
+    TEST_ASSERT(WIFSIGNALED(stages[0].status) && WTERMSIG(stages[0].status) == SIGTERM, "first stage stopped");
+    TEST_ASSERT(WIFSIGNALED(stages[2].status) && WTERMSIG(stages[2].status) == SIGTERM, "last stage stopped");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_per_stage_timing() {
+    printf("Running test_per_stage_timing... ");
+
+    struct supervised_child stages[2];
+    struct supervision_result result;
+    memset(stages, 0, sizeof(stages));
+    stages[0].pid = spawn("0.2", 0);
+    stages[0].start_us = monotonic_usec();
+    stages[1].pid = spawn("0.6", 0);
+    stages[1].start_us = monotonic_usec();
+
+    TEST_ASSERT_EQ(0, supervise_children(stages, 2, 5, &result), "supervise");
+    TEST_ASSERT_EQ(0, result.torn_down, "normal exits do not tear down");
+    TEST_ASSERT(WIFEXITED(stages[0].status) && WEXITSTATUS(stages[0].status) == 0, "stage 0 exit");
+    TEST_ASSERT(stages[0].elapsed_us >= 150000 && stages[0].elapsed_us < 500000, "stage 0 timing");
+    TEST_ASSERT(stages[1].elapsed_us >= 550000 && stages[1].elapsed_us < 1500000, "stage 1 timing");
+    TEST_ASSERT_EQ(0, supervised_exit_code(&stages[1], &result), "exit code");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_sigint_sent_to_sudosh_is_forwarded() {
+    printf("Running test_sigint_sent_to_sudosh_is_forwarded... ");
+
+    struct supervised_child child = {0};
+    struct supervision_result result;
+    child.pid = spawn("10", 0);
+    child.start_us = monotonic_usec();
+
+    pid_t self = getpid();
+    pid_t sender = fork();
+    if (sender == 0) {
+        usleep(200000);
+        kill(self, SIGINT);
+        _exit(0);
+    }
+
+    TEST_ASSERT_EQ(0, supervise_children(&child, 1, 5, &result), "supervise");
+    waitpid(sender, NULL, 0);
+    TEST_ASSERT_EQ(1, result.interrupted, "interrupt noticed");
+    TEST_ASSERT(WIFSIGNALED(child.status) && WTERMSIG(child.status) == SIGINT, "child got SIGINT");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_command_timeout_lookup() {
+    printf("Running test_command_timeout_lookup... ");
+
+    struct command_info cmd;
+    clear_command_timeouts();
+    TEST_ASSERT_EQ(0, set_command_timeout(NULL, 30), "default limit");
+    TEST_ASSERT_EQ(0, set_command_timeout("sleep", 1), "per-command limit");
+    TEST_ASSERT_EQ(-1, set_command_timeout("/bin/sleep", 1), "paths are rejected");
+    TEST_ASSERT_EQ(-1, set_command_timeout("sleep", -1), "negative rejected");
+
+    TEST_ASSERT_EQ(0, parse_command("/bin/sleep 5", &cmd), "parse");
+    TEST_ASSERT_EQ(1, get_command_timeout(&cmd), "matched by basename");
+    free_command_info(&cmd);
+    TEST_ASSERT_EQ(0, parse_command("ls", &cmd), "parse");
+    TEST_ASSERT_EQ(30, get_command_timeout(&cmd), "default applies");
+    free_command_info(&cmd);
+
+    /* execute_command enforces the limit */
+    struct user_info *user = get_user_info(getenv("USER"));
+    TEST_ASSERT_NOT_NULL(user, "user info");
+    TEST_ASSERT_EQ(0, parse_command("sleep 5", &cmd), "parse");
+    fflush(stdout);
+    TEST_ASSERT_EQ(EXIT_COMMAND_TIMEOUT, execute_command(&cmd, user), "command stopped at limit");
+    free_command_info(&cmd);
+    free_user_info(user);
+    clear_command_timeouts();
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+
+    printf("=== Child Supervision Tests ===\n");
+    test_passes += test_timeout_terminates_child();
+    test_passes += test_crashed_stage_tears_down_pipeline();
+    test_passes += test_per_stage_timing();
+    test_passes += test_sigint_sent_to_sudosh_is_forwarded();
+    test_passes += test_command_timeout_lookup();
+    test_count = 5;
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
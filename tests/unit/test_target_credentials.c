@@ -0,0 +1,132 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+int test_resolve_root() {
+    printf("Running test_resolve_root... ");
+
+    const struct target_credentials *cred = get_target_credentials("root");
+    TEST_ASSERT_NOT_NULL(cred, "root resolved");
+    TEST_ASSERT_EQ(0, (int)cred->uid, "uid 0");
+    TEST_ASSERT_EQ(0, (int)cred->gid, "gid 0");
+    TEST_ASSERT_STR_EQ("root", cred->name, "name");
+    TEST_ASSERT_NOT_NULL(cred->home, "home");
+    TEST_ASSERT_NOT_NULL(cred->shell, "shell");
+    TEST_ASSERT(cred->ngroups >= 1, "primary group included");
+
+    int has_primary = 0;
+    for (int i = 0; i < cred->ngroups; i++) {
+        if (cred->groups[i] == cred->gid) {
+            has_primary = 1;
+        }
+    }
+    TEST_ASSERT(has_primary, "group list contains primary gid");
+
+    TEST_ASSERT(get_target_credentials(NULL) == cred, "NULL means root");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_record_is_cached() {
+    printf("Running test_record_is_cached... ");
+
+    clear_target_credentials();
+    const struct target_credentials *first = get_target_credentials("root");
+    const struct target_credentials *second = get_target_credentials("root");
+    TEST_ASSERT_NOT_NULL(first, "resolved");
+    TEST_ASSERT(first == second, "second lookup reuses the record");
+
+    struct passwd *pwd = getpwnam("nobody");
+    if (pwd) {
+        const struct target_credentials *other = get_target_credentials("nobody");
+        TEST_ASSERT_NOT_NULL(other, "other user resolved");
+        TEST_ASSERT_EQ((int)pwd->pw_uid, (int)other->uid, "other uid");
+        TEST_ASSERT_STR_EQ("nobody", other->name, "record replaced");
+    }
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_unknown_user() {
+    printf("Running test_unknown_user... ");
+
+    TEST_ASSERT_NULL(get_target_credentials("sudosh-no-such-user-xyz"), "unknown user");
+    TEST_ASSERT_EQ(-1, apply_target_credentials(NULL), "NULL record");
+    TEST_ASSERT_EQ(EINVAL, errno, "EINVAL");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_apply_drops_privileges() {
+    printf("Running test_apply_drops_privileges... ");
+
+    const struct target_credentials *cred = get_target_credentials("nobody");
+    if (geteuid() != 0 || !cred) {
+        printf("SKIP (requires root and a nobody account)\n");
+        return 1;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (apply_target_credentials(cred) != 0) {
+            _exit(10);
+        }
+        if (getuid() != cred->uid || geteuid() != cred->uid) {
+            _exit(11);
+        }
+        if (getgid() != cred->gid || getegid() != cred->gid) {
+            _exit(12);
+        }
+        gid_t groups[NGROUPS_MAX];
+        int n = getgroups(NGROUPS_MAX, groups);
+        if (n != cred->ngroups) {
+            _exit(13);
+        }
+        if (setuid(0) == 0) {
+            _exit(14);
+        }
+        const char *home = getenv("HOME");
+        if (!home || strcmp(home, cred->home) != 0) {
+            _exit(15);
+        }
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    TEST_ASSERT(WIFEXITED(status), "child exited");
+    TEST_ASSERT_EQ(0, WEXITSTATUS(status), "identity switched without returning to root");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+
+    printf("=== Target Credential Tests ===\n");
+    test_passes += test_resolve_root();
+    test_passes += test_record_is_cached();
+    test_passes += test_unknown_user();
+    test_passes += test_apply_drops_privileges();
+    test_count = 4;
+
+    clear_target_credentials();
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
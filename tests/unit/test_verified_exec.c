@@ -0,0 +1,208 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char test_dir[] = "/tmp/sudosh-verified-exec-XXXXXX";
+
+static void write_file(const char *path, const char *content, mode_t mode) {
+    FILE *fp = fopen(path, "w");
+    if (fp) {
+        fputs(content, fp);
+        fclose(fp);
+    }
+    chmod(path, mode);
+}
+
+static int copy_file(const char *from, const char *to, mode_t mode) {
+    char buf[65536];
+    size_t n;
+    FILE *in = fopen(from, "rb");
+    FILE *out = fopen(to, "wb");
+    if (!in || !out) {
+        if (in) fclose(in);
+        if (out) fclose(out);
+        return -1;
+    }
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        fwrite(buf, 1, n, out);
+    }
+    fclose(in);
+    fclose(out);
+    return chmod(to, mode);
+}
+
+/* Run a verified binary in a child and return its wait status */
+static int run_verified(const struct verified_binary *vb, char *const argv[]) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        exec_verified_binary(vb, argv);
+        _exit(errno == ESTALE ? 98 : 99);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return status;
+}
+
+int test_system_binary_verifies() {
+    printf("Running test_system_binary_verifies... ");
+
+    struct verified_binary vb;
+    char *path = find_command_in_path("true");
+    TEST_ASSERT_NOT_NULL(path, "true found");
+    TEST_ASSERT_EQ(0, open_verified_binary(path, NULL, &vb), "verified");
+    TEST_ASSERT(vb.fd >= 0, "descriptor kept");
+    TEST_ASSERT(fcntl(vb.fd, F_GETFD) & FD_CLOEXEC, "descriptor is close-on-exec");
+
+    char *argv[] = { "true", NULL };
+    int status = run_verified(&vb, argv);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0, "executed by descriptor");
+
+    close_verified_binary(&vb);
+    TEST_ASSERT_EQ(-1, vb.fd, "descriptor closed");
+    free(path);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_unsafe_binaries_rejected() {
+    printf("Running test_unsafe_binaries_rejected... ");
+
+    struct verified_binary vb;
+    char path[PATH_MAX];
+
+    snprintf(path, sizeof(path), "%s/world", test_dir);
+    write_file(path, "#!/bin/sh\nexit 0\n", 0777);
+    TEST_ASSERT_EQ(-1, open_verified_binary(path, NULL, &vb), "world-writable");
+    TEST_ASSERT_STR_EQ("world-writable", vb.reason, "reason");
+
+    snprintf(path, sizeof(path), "%s/plain", test_dir);
+    write_file(path, "data\n", 0644);
+    TEST_ASSERT_EQ(-1, open_verified_binary(path, NULL, &vb), "not executable");
+    TEST_ASSERT_STR_EQ("not executable", vb.reason, "reason");
+
+    TEST_ASSERT_EQ(-1, open_verified_binary(test_dir, NULL, &vb), "directory");
+    TEST_ASSERT_STR_EQ("not a regular file", vb.reason, "reason");
+
+    snprintf(path, sizeof(path), "%s/missing", test_dir);
+    TEST_ASSERT_EQ(-1, open_verified_binary(path, NULL, &vb), "missing");
+    TEST_ASSERT_NULL(vb.reason, "errno failure, not policy");
+    TEST_ASSERT_EQ(ENOENT, errno, "ENOENT");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_script_runs_via_path_fallback() {
+    printf("Running test_script_runs_via_path_fallback... ");
+
+    struct verified_binary vb;
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/script", test_dir);
+    write_file(path, "#!/bin/sh\nexit 7\n", 0755);
+
+    TEST_ASSERT_EQ(0, open_verified_binary(path, NULL, &vb), "script verified");
+    char *argv[] = { path, NULL };
+    int status = run_verified(&vb, argv);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 7, "script ran");
+
+    /* A script replaced after verification is not run */
+    char replacement[PATH_MAX];
+    snprintf(replacement, sizeof(replacement), "%s/script.new", test_dir);
+    write_file(replacement, "#!/bin/sh\nexit 9\n", 0755);
+    TEST_ASSERT_EQ(0, rename(replacement, path), "replace script");
+    status = run_verified(&vb, argv);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 98, "stale script refused");
+    close_verified_binary(&vb);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_replaced_binary_runs_verified_file() {
+    printf("Running test_replaced_binary_runs_verified_file... ");
+
+#if defined(__linux__)
+    struct verified_binary vb;
+    char path[PATH_MAX], replacement[PATH_MAX];
+    char *true_path = find_command_in_path("true");
+    TEST_ASSERT_NOT_NULL(true_path, "true found");
+
+    snprintf(path, sizeof(path), "%s/tool", test_dir);
+    TEST_ASSERT_EQ(0, copy_file(true_path, path, 0755), "copy binary");
+    TEST_ASSERT_EQ(0, open_verified_binary(path, NULL, &vb), "verified");
+
+    /* Swap the path for something else after the check */
+    snprintf(replacement, sizeof(replacement), "%s/tool.new", test_dir);
+    write_file(replacement, "#!/bin/sh\nexit 9\n", 0755);
+    TEST_ASSERT_EQ(0, rename(replacement, path), "replace binary");
+
+    char *argv[] = { "tool", NULL };
+    int status = run_verified(&vb, argv);
+    TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0, "verified binary ran, not the swap");
+
+    close_verified_binary(&vb);
+    free(true_path);
+#endif
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_execute_command_refuses_unsafe_binary() {
+    printf("Running test_execute_command_refuses_unsafe_binary... ");
+
+    struct command_info cmd;
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/world", test_dir);
+
+    struct user_info *user = get_user_info(getenv("USER"));
+    TEST_ASSERT_NOT_NULL(user, "user info");
+    TEST_ASSERT_EQ(0, parse_command(path, &cmd), "parse");
+    fflush(stdout);
+    TEST_ASSERT_EQ(EXIT_COMMAND_NOT_FOUND, execute_command(&cmd, user), "refused");
+    free_command_info(&cmd);
+    free_user_info(user);
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+    if (!mkdtemp(test_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    printf("=== Verified Exec Tests ===\n");
+    test_passes += test_system_binary_verifies();
+    test_passes += test_unsafe_binaries_rejected();
+    test_passes += test_script_runs_via_path_fallback();
+    test_passes += test_replaced_binary_runs_verified_file();
+    test_passes += test_execute_command_refuses_unsafe_binary();
+    test_count = 5;
+
+    const char *files[] = { "world", "plain", "script", "tool", NULL };
+    for (int i = 0; files[i]; i++) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", test_dir, files[i]);
+        unlink(path);
+    }
+    rmdir(test_dir);
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}
@@ -0,0 +1,250 @@
+#include "test_framework.h"
+#include "sudosh.h"
+
+/* Global test counters */
+int test_count = 0;
+int test_passes = 0;
+int test_failures = 0;
+
+static char test_dir[] = "/tmp/sudosh-violation-XXXXXX";
+static char journal_path[PATH_MAX];
+
+/* What the journal shows for one violation message */
+struct tally {
+    int full;           /* Records logged as-is */
+    int summaries;      /* "last message repeated" records */
+    unsigned long repeats;
+    char last_summary[AUDIT_MAX_RECORD];
+};
+
+static void count_violations(const char *violation, struct tally *t) {
+    char line[AUDIT_MAX_RECORD];
+    char full[512];
+    FILE *fp;
+
+    memset(t, 0, sizeof(*t));
+    audit_flush();
+    fp = fopen(journal_path, "r");
+    if (!fp) {
+        return;
+    }
+    snprintf(full, sizeof(full), "\tmsg=%s\t", violation);
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strstr(line, "\ttype=VIOLATION\t")) {
+            continue;
+        }
+        char *repeated = strstr(line, "\tmsg=last message repeated ");
+        if (repeated) {
+            char *tail = strstr(repeated, "): ");
+            if (tail && strncmp(tail + 3, violation, strlen(violation)) == 0 &&
+                tail[3 + strlen(violation)] == '\t') {
+                t->summaries++;
+                t->repeats += strtoul(repeated + strlen("\tmsg=last message repeated "), NULL, 10);
+                snprintf(t->last_summary, sizeof(t->last_summary), "%s", line);
+            }
+        } else if (strstr(line, full)) {
+            t->full++;
+        }
+    }
+    fclose(fp);
+}
+
+/* Violations reported only in the end-of-session overflow line */
+static unsigned long count_overflow(void) {
+    char line[AUDIT_MAX_RECORD];
+    unsigned long total = 0;
+    FILE *fp;
+
+    audit_flush();
+    fp = fopen(journal_path, "r");
+    if (!fp) {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char *msg = strstr(line, "\tmsg=");
+        if (strstr(line, "\ttype=VIOLATION\t") && msg &&
+            strstr(msg, " more violations not logged individually ")) {
+            total += strtoul(msg + strlen("\tmsg="), NULL, 10);
+        }
+    }
+    fclose(fp);
+    return total;
+}
+
+int test_loop_is_coalesced() {
+    printf("Running test_loop_is_coalesced... ");
+
+    struct tally t;
+    reset_audit_journal(journal_path);
+
+    for (int i = 0; i < 5000; i++) {
+        log_security_violation("alice", "editor blocked: /usr/bin/vim");
+    }
+    count_violations("editor blocked: /usr/bin/vim", &t);
+    TEST_ASSERT(t.full >= 1, "first occurrence logged");
+    TEST_ASSERT(t.full <= VIOLATION_LOG_BURST + 1, "burst then limited");
+    TEST_ASSERT_EQ(0, t.summaries, "repeats held back until flushed");
+
+    flush_security_violations();
+    count_violations("editor blocked: /usr/bin/vim", &t);
+    TEST_ASSERT_EQ(1, t.summaries, "one summary for the loop");
+    TEST_ASSERT_EQ(5000, (int)(t.full + t.repeats), "every occurrence accounted for");
+    TEST_ASSERT(strstr(t.last_summary, "(first ") != NULL && strstr(t.last_summary, ", last ") != NULL,
+                "summary carries first and last times");
+
+    flush_security_violations();
+    count_violations("editor blocked: /usr/bin/vim", &t);
+    TEST_ASSERT_EQ(1, t.summaries, "nothing left to flush");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_distinct_violations_limited() {
+    printf("Running test_distinct_violations_limited... ");
+
+    struct tally t;
+    char msg[64];
+    int full = 0;
+    unsigned long repeats = 0;
+    reset_audit_journal(journal_path);
+
+    /* Drain the repeat bucket */
+    for (int i = 0; i < 100; i++) {
+        log_security_violation("alice", "pipeline permission check failed");
+    }
+
+    /* New messages have their own bucket: a loop over one does not hide them */
+    log_security_violation("alice", "stale lock removed: /tmp/file0");
+    count_violations("stale lock removed: /tmp/file0", &t);
+    TEST_ASSERT_EQ(1, t.full, "new violation logged despite the loop");
+
+    /* More distinct messages than slots: syslog is limited, the journal keeps each */
+    for (int i = 1; i < 100; i++) {
+        snprintf(msg, sizeof(msg), "stale lock removed: /tmp/file%d", i);
+        log_security_violation("alice", msg);
+    }
+    for (int i = 0; i < 100; i++) {
+        snprintf(msg, sizeof(msg), "stale lock removed: /tmp/file%d", i);
+        count_violations(msg, &t);
+        full += t.full == 1;
+    }
+    TEST_ASSERT_EQ(100, full, "every distinct violation journaled once in full");
+
+    /* An evicted message coming back is a repeat, not a new first occurrence */
+    count_violations("pipeline permission check failed", &t);
+    int before = t.full;
+    log_security_violation("alice", "pipeline permission check failed");
+    count_violations("pipeline permission check failed", &t);
+    TEST_ASSERT_EQ(before, t.full, "evicted repeat still limited");
+
+    /* Every occurrence is accounted for by the end of the session */
+    close_logging();
+    full = 0;
+    for (int i = 0; i < 100; i++) {
+        snprintf(msg, sizeof(msg), "stale lock removed: /tmp/file%d", i);
+        count_violations(msg, &t);
+        full += t.full;
+        repeats += t.repeats;
+    }
+    count_violations("pipeline permission check failed", &t);
+    full += t.full;
+    repeats += t.repeats;
+    TEST_ASSERT_EQ(201, (int)(full + repeats + count_overflow()), "held and overflowed accounted for");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_bucket_refills() {
+    printf("Running test_bucket_refills... ");
+
+    struct tally t;
+    reset_audit_journal(journal_path);
+
+    for (int i = 0; i < 50; i++) {
+        log_security_violation("alice", "dangerous command blocked");
+    }
+    count_violations("dangerous command blocked", &t);
+    int full = t.full;
+
+    /* After a pause the next repeat is logged with the held-back ones */
+    usleep(1000000 / VIOLATION_LOG_RATE + 100000);
+    log_security_violation("alice", "dangerous command blocked");
+    count_violations("dangerous command blocked", &t);
+    TEST_ASSERT_EQ(full, t.full, "no extra full record");
+    TEST_ASSERT_EQ(1, t.summaries, "summary logged once tokens returned");
+    TEST_ASSERT_EQ(51, (int)(t.full + t.repeats), "including the current repeat");
+
+    /* With tokens available and nothing held back, repeats are logged as-is */
+    usleep(1000000 / VIOLATION_LOG_RATE + 100000);
+    log_security_violation("alice", "dangerous command blocked");
+    count_violations("dangerous command blocked", &t);
+    TEST_ASSERT_EQ(full + 1, t.full, "repeat logged in full");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int test_child_does_not_report_parent_repeats() {
+    printf("Running test_child_does_not_report_parent_repeats... ");
+
+    struct tally t;
+    reset_audit_journal(journal_path);
+
+    for (int i = 0; i < 100; i++) {
+        log_security_violation("alice", "secure editor executed");
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        flush_security_violations();
+        log_security_violation("alice", "child violation");
+        close_logging();
+        _exit(0);
+    }
+    waitpid(pid, NULL, 0);
+
+    count_violations("secure editor executed", &t);
+    TEST_ASSERT_EQ(0, t.summaries, "child left the parent's repeats alone");
+    count_violations("child violation", &t);
+    TEST_ASSERT_EQ(1, t.full, "child logs its own violations");
+
+    close_logging();
+    count_violations("secure editor executed", &t);
+    TEST_ASSERT_EQ(100, (int)(t.full + t.repeats), "parent reports its repeats once");
+
+    printf("PASS\n");
+    return 1;
+}
+
+int main() {
+    test_mode = 1;
+    struct passwd *pwd = getpwuid(getuid());
+    if (pwd) {
+        setenv("USER", pwd->pw_name, 0);
+    }
+    if (!mkdtemp(test_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(journal_path, sizeof(journal_path), "%s/audit.log", test_dir);
+    setenv("SUDOSH_AUDIT_LOG", journal_path, 1);
+
+    printf("=== Security Violation Rate Limit Tests ===\n");
+    test_passes += test_loop_is_coalesced();
+    test_passes += test_distinct_violations_limited();
+    test_passes += test_bucket_refills();
+    test_passes += test_child_does_not_report_parent_repeats();
+    test_count = 4;
+
+    reset_audit_journal(journal_path);
+    rmdir(test_dir);
+
+    printf("\n=== Test Results ===\n");
+    printf("Total tests: %d\n", test_count);
+    printf("Passed: %d\n", test_passes);
+    printf("Failed: %d\n", test_count - test_passes);
+    return (test_passes == test_count) ? 0 : 1;
+}